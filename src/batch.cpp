@@ -0,0 +1,114 @@
+#include "batch.hpp"
+#include "logging.hpp"
+#include "psx.hpp"
+#include "session.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fmt/format.h>
+#include <memory>
+#include <sstream>
+#include <spdlog/sinks/basic_file_sink.h>
+#include <thread>
+
+namespace {
+	using namespace psycris;
+
+	batch_result run_job(batch_job const& job, config const& base, std::string log_file) {
+		config cfg = base;
+		cfg.mode = job.mode;
+		cfg.input_file = job.input_file;
+		cfg.ticks = job.ticks;
+		cfg.trace_file.clear();
+		cfg.profile_prefix.clear();
+		cfg.bus_stats_prefix.clear();
+
+		batch_result r{};
+		r.log_file = std::move(log_file);
+
+		// the log goes straight to the file, a verbose job can log much more
+		// than it is worth keeping in memory
+		std::shared_ptr<spdlog::logger> logger;
+		try {
+			auto sink = std::make_shared<spdlog::sinks::basic_file_sink_st>(r.log_file, true);
+			logger = std::make_shared<spdlog::logger>(logger_name, std::move(sink));
+		} catch (std::exception const& e) {
+			psycris::log->critical("{}: {}", job.input_file, e.what());
+			r.status = 1;
+			return r;
+		}
+		logger->set_pattern("[%l] %v");
+		if (cfg.verbose) {
+			logger->set_level(spdlog::level::level_enum::trace);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		try {
+			auto board = std::make_unique<psx>(cfg, logger);
+			r.status = run_session(*board);
+			r.ticks = board->cpu.ticks();
+		} catch (std::exception const& e) {
+			logger->critical("{}", e.what());
+			r.status = 1;
+		}
+		r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		logger->flush();
+		return r;
+	}
+}
+
+namespace psycris {
+	bool read_jobs(std::istream& in, std::vector<batch_job>& jobs) {
+		std::string line;
+		for (size_t n = 1; std::getline(in, line); n++) {
+			std::istringstream fields(line);
+			std::string mode;
+			if (!(fields >> mode) || mode[0] == '#') {
+				continue;
+			}
+
+			batch_job job;
+			if (mode == "bios") {
+				job.mode = config::bios;
+			} else if (mode == "restore") {
+				job.mode = config::restore;
+			} else {
+				log->critical("line {}: unknown start mode {}", n, mode);
+				return false;
+			}
+			if (!(fields >> job.input_file >> job.ticks)) {
+				log->critical("line {}: expected <input file> <ticks>", n);
+				return false;
+			}
+			jobs.push_back(job);
+		}
+		return true;
+	}
+
+	std::vector<batch_result> run_batch(std::vector<batch_job> const& jobs,
+	                                    config const& base,
+	                                    size_t threads,
+	                                    std::string const& log_prefix) {
+		std::vector<batch_result> results(jobs.size());
+
+		std::atomic<size_t> next{0};
+		auto worker = [&]() {
+			for (size_t ix = next++; ix < jobs.size(); ix = next++) {
+				results[ix] = run_job(jobs[ix], base, fmt::format("{}{}.log", log_prefix, ix));
+			}
+		};
+
+		std::vector<std::thread> pool;
+		threads = std::clamp<size_t>(threads, 1, std::max<size_t>(jobs.size(), 1));
+		for (size_t i = 0; i < threads; i++) {
+			pool.emplace_back(worker);
+		}
+		for (auto& t : pool) {
+			t.join();
+		}
+		return results;
+	}
+}
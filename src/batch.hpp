@@ -0,0 +1,46 @@
+#pragma once
+#include "config.hpp"
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace psycris {
+	struct batch_job {
+		config::start_mode mode;
+		std::string input_file;
+		uint64_t ticks;
+	};
+
+	struct batch_result {
+		// the status returned by `run_session`
+		int status;
+		uint64_t ticks;
+		double seconds;
+		// the file with the log of the board
+		std::string log_file;
+	};
+
+	/**
+	 * \brief reads a job list
+	 *
+	 * Every line is a job: the start mode (`bios` or `restore`), the input
+	 * file and the ticks to run. Empty lines and lines starting with `#` are
+	 * ignored. Returns false, after logging the line, on a syntax error.
+	 */
+	bool read_jobs(std::istream&, std::vector<batch_job>&);
+
+	/**
+	 * \brief runs the jobs on a pool of `threads` workers
+	 *
+	 * Every job runs a new board, with the settings of `base` except for the
+	 * input and the ticks; the trace and the profile are not recorded in
+	 * batch mode. The board of the n-th job logs into `<log_prefix><n>.log`.
+	 * The results are in the same order of the jobs.
+	 */
+	std::vector<batch_result> run_batch(std::vector<batch_job> const&,
+	                                    config const& base,
+	                                    size_t threads,
+	                                    std::string const& log_prefix);
+}
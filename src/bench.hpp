@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * \brief A minimal benchmark harness.
+ *
+ * A benchmark is a function that runs the measured code `iterations` times;
+ * the runner calls it with an increasing number of iterations until the run
+ * is long enough to be measured, then it reports the time spent for a single
+ * iteration.
+ *
+ * Benchmarks are registered with a static `registration` object:
+ *
+ *     psycris::bench::registration r{"bus", "ram load", [](size_t n) { ... }};
+ *
+ * The numbers are meaningful only for a release build without sanitizers.
+ */
+namespace psycris::bench {
+	using body = std::function<void(size_t iterations)>;
+
+	struct registration {
+		registration(std::string group, std::string name, body fn);
+	};
+
+	/**
+	 * \brief prevents the compiler from optimizing away `v`
+	 */
+	template <typename T>
+	inline void keep(T const& v) {
+		asm volatile("" : : "g"(&v) : "memory");
+	}
+}
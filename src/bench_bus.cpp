@@ -0,0 +1,77 @@
+#include "bench.hpp"
+#include "psx.hpp"
+
+namespace {
+	using psycris::bench::keep;
+	using psycris::bench::registration;
+
+	// the bus benchmarks use the real board layout; every iteration accesses
+	// a different word inside a 4KB window to keep the data in the cache.
+	psycris::psx& board() {
+		static psycris::psx b;
+		return b;
+	}
+
+	template <typename T>
+	void load(size_t n, uint32_t base) {
+		auto& bus = board().bus();
+		for (size_t i = 0; i < n; i++) {
+			keep(bus.read<T>(base + ((i * sizeof(T)) & 0xfff)));
+		}
+	}
+
+	template <typename T>
+	void store(size_t n, uint32_t base) {
+		auto& bus = board().bus();
+		for (size_t i = 0; i < n; i++) {
+			bus.write<T>(base + ((i * sizeof(T)) & 0xfff), static_cast<T>(i));
+		}
+	}
+
+	registration rom_fetch{"bus", "rom fetch (kseg1)", [](size_t n) { load<uint32_t>(n, 0xbfc0'0000); }};
+	registration ram_fetch{"bus", "ram fetch (kseg0)", [](size_t n) { load<uint32_t>(n, 0x8000'1000); }};
+	registration ram_load8{"bus", "ram load8 (kuseg)", [](size_t n) { load<uint8_t>(n, 0x0000'1000); }};
+	registration ram_store{"bus", "ram store (kseg0)", [](size_t n) { store<uint32_t>(n, 0x8000'1000); }};
+	registration io_load{"bus", "i/o load (I_MASK)", [](size_t n) {
+		                     auto& bus = board().bus();
+		                     for (size_t i = 0; i < n; i++) {
+			                     keep(bus.read<uint32_t>(0x1f80'1074));
+		                     }
+	                     }};
+	registration io_store{"bus", "i/o store (DPCR)", [](size_t n) {
+		                      auto& bus = board().bus();
+		                      for (size_t i = 0; i < n; i++) {
+			                      bus.write<uint32_t>(0x1f80'10f0, i);
+		                      }
+	                      }};
+	// a BIOS polling a missing device
+	registration unmapped_load{"bus", "unmapped load (JOY_STAT)", [](size_t n) {
+		                           auto& bus = board().bus();
+		                           for (size_t i = 0; i < n; i++) {
+			                           keep(bus.read<uint32_t>(0x1f80'1044));
+		                           }
+	                           }};
+	// a device without data ports outside the memory pages
+	registration scratchpad_store{"bus", "scratchpad store", [](size_t n) {
+		                              auto& bus = board().bus();
+		                              for (size_t i = 0; i < n; i++) {
+			                              bus.write<uint32_t>(0x1f80'0000 + ((i * 4) & 0x3ff), i);
+		                              }
+	                              }};
+
+	// moving 4KB inside the ram, a word at a time or as a block
+	registration ram_word_copy{"bus", "ram word copy (4KB)", [](size_t n) {
+		                           auto& bus = board().bus();
+		                           for (size_t i = 0; i < n; i++) {
+			                           for (uint32_t off = 0; off < 0x1000; off += 4) {
+				                           bus.write(0x8001'0000 + off, bus.read<uint32_t>(0x8000'1000 + off));
+			                           }
+		                           }
+	                           }};
+	registration ram_block_copy{"bus", "ram block copy (4KB)", [](size_t n) {
+		                            auto& bus = board().bus();
+		                            for (size_t i = 0; i < n; i++) {
+			                            bus.copy(0x8001'0000, 0x8000'1000, 0x1000);
+		                            }
+	                            }};
+}
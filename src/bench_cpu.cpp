@@ -0,0 +1,100 @@
+#include "bench.hpp"
+#include "cpu/profiler.hpp"
+#include "cpu/trace_recorder.hpp"
+#include "psx.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+namespace {
+	using psycris::bench::keep;
+	using psycris::bench::registration;
+
+	// clang-format off
+	enum reg : uint32_t { zero = 0, t0 = 8, t1, t2, t3, t4, t5, t6, ra = 31 };
+
+	uint32_t i_type(uint32_t op, uint32_t rs, uint32_t rt, uint32_t imm) { return op << 26 | rs << 21 | rt << 16 | (imm & 0xffff); }
+	uint32_t r_type(uint32_t funct, uint32_t rs, uint32_t rt, uint32_t rd, uint32_t shamt = 0) { return rs << 21 | rt << 16 | rd << 11 | shamt << 6 | funct; }
+	// clang-format on
+
+	// An endless loop that mixes alu operations, loads and stores to the
+	// RAM, branches and a function call.
+	std::vector<uint32_t> workload() {
+		uint32_t const func = 0x1fc0'0000 + 16 * 4;
+		return {
+		    i_type(0x0f, 0, t0, 0x8000),     // lui t0, 0x8000
+		    i_type(0x0d, zero, t1, 0),       // ori t1, zero, 0
+		    i_type(0x09, t1, t1, 1),         // loop: addiu t1, t1, 1
+		    i_type(0x0c, t1, t2, 0xff),      // andi t2, t1, 0xff
+		    r_type(0x00, 0, t2, t3, 2),      // sll t3, t2, 2
+		    r_type(0x21, t3, t0, t3),        // addu t3, t3, t0
+		    i_type(0x23, t3, t4, 0),         // lw t4, 0(t3)
+		    r_type(0x21, t4, t1, t4),        // addu t4, t4, t1
+		    i_type(0x2b, t3, t4, 0),         // sw t4, 0(t3)
+		    r_type(0x2a, t2, t1, t5),        // slt t5, t2, t1
+		    0x03 << 26 | (func >> 2 & 0x3ff'ffff), // jal func
+		    0,                               // nop
+		    i_type(0x05, t2, zero, -11),     // bne t2, zero, loop
+		    r_type(0x25, t6, t4, t6),        // or t6, t6, t4
+		    0x02 << 26 | ((0x1fc0'0000 + 2 * 4) >> 2 & 0x3ff'ffff), // j loop
+		    0,                               // nop
+		    r_type(0x02, 0, t4, t6, 3),      // func: srl t6, t4, 3
+		    r_type(0x08, ra, 0, 0),          // jr ra
+		    r_type(0x23, t6, t2, t6),        // subu t6, t6, t2
+		};
+	}
+
+	struct board : psycris::psx {
+		board(psycris::config settings = {}) : psx(std::move(settings)) {
+			auto code = workload();
+			std::memcpy(rom.memory().data(), code.data(), code.size() * sizeof(uint32_t));
+		}
+	};
+
+	// every iteration executes one instruction
+	template <void (cpu::mips::*Run)(uint64_t)>
+	void run(size_t n) {
+		static board b;
+		(b.cpu.*Run)(b.cpu.ticks() + n);
+	}
+
+	// every iteration decodes one instruction of the workload
+	registration decode{"cpu", "decode", [](size_t n) {
+		                    auto code = workload();
+		                    for (size_t i = 0; i < n; i++) {
+			                    keep(cpu::decode(cpu::decoder{code[i % code.size()]}));
+		                    }
+	                    }};
+	registration interpreter{"cpu", "interpreter", run<&cpu::mips::run<cpu::no_trace>>};
+	// the trace is formatted but filtered out by the log level
+	registration traced{"cpu", "interpreter (text trace)", run<&cpu::mips::run<cpu::text_trace>>};
+	registration recorded{"cpu", "interpreter (binary trace)", [](size_t n) {
+		                       static board b;
+		                       auto path = std::filesystem::temp_directory_path() / "psycris_bench.trace";
+		                       auto recorder = cpu::trace_recorder::create(path.string(), b.cpu.ticks());
+		                       // the file is released when the recorder is destroyed
+		                       std::remove(path.c_str());
+
+		                       b.cpu.record_to(recorder.get());
+		                       b.cpu.run<cpu::binary_trace>(b.cpu.ticks() + n);
+		                       b.cpu.record_to(nullptr);
+	                       }};
+	registration profiled{"cpu", "interpreter (profile)", [](size_t n) {
+		                       static board b;
+		                       static cpu::profiler profiler;
+		                       b.cpu.profile_with(&profiler);
+		                       b.cpu.run<cpu::profile>(b.cpu.ticks() + n);
+	                       }};
+	registration cached{"cpu", "cached interpreter", run<&cpu::mips::run_cached>};
+	registration jit{"cpu", "recompiler", run<&cpu::mips::run_jit>};
+	registration jit_fastmem{"cpu", "recompiler (fastmem)", [](size_t n) {
+		                         static board b{[] {
+			                         psycris::config settings;
+			                         settings.fastmem = true;
+			                         return settings;
+		                         }()};
+		                         b.cpu.run_jit(b.cpu.ticks() + n);
+	                         }};
+}
@@ -0,0 +1,139 @@
+#include "bench.hpp"
+#include "hw/devices/gpu_raster.hpp"
+
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+	using psycris::bench::keep;
+	using psycris::bench::registration;
+	using psycris::hw::rasterizer;
+
+	// the primitives are 64x64 pixels, drawn all over the VRAM
+	constexpr int32_t side = 64;
+
+	char const* isa_name(rasterizer::isa i) {
+		switch (i) {
+		case rasterizer::isa::avx2:
+			return "avx2";
+		case rasterizer::isa::sse2:
+			return "sse2";
+		default:
+			return "scalar";
+		}
+	}
+
+	rasterizer::vertex corner(int32_t x, int32_t y, uint8_t c, uint8_t u, uint8_t v) {
+		return {x, y, c, static_cast<uint8_t>(c / 2), static_cast<uint8_t>(255 - c), u, v};
+	}
+
+	// draws the k-th primitive, returns the pixels drawn
+	using draw = std::function<int32_t(rasterizer&, int32_t x, int32_t y)>;
+
+	int32_t quad(rasterizer& r, int32_t x, int32_t y, rasterizer::primitive const& p) {
+		auto a = corner(x, y, 0x20, 0, 0);
+		auto b = corner(x + side, y, 0xe0, side - 1, 0);
+		auto c = corner(x, y + side, 0x80, 0, side - 1);
+		auto d = corner(x + side, y + side, 0x40, side - 1, side - 1);
+		r.triangle({a, b, c}, p);
+		r.triangle({b, c, d}, p);
+		return side * side;
+	}
+
+	struct primitive_bench {
+		char const* name;
+		bool dither;
+		draw fn;
+	};
+
+	std::vector<primitive_bench> primitives() {
+		rasterizer::primitive flat;
+
+		rasterizer::primitive gouraud;
+		gouraud.gouraud = true;
+
+		rasterizer::primitive textured;
+		textured.gouraud = true;
+		textured.textured = true;
+		textured.depth = 1;
+		textured.page_x = 512;
+		textured.clut_y = 480;
+
+		rasterizer::primitive semi;
+		semi.semi_transparent = true;
+
+		rasterizer::primitive sprite = textured;
+		sprite.gouraud = false;
+		sprite.raw = true;
+
+		return {
+		    {"flat triangle", false, [=](rasterizer& r, int32_t x, int32_t y) { return quad(r, x, y, flat); }},
+		    {"gouraud triangle", true, [=](rasterizer& r, int32_t x, int32_t y) { return quad(r, x, y, gouraud); }},
+		    {"textured triangle", true, [=](rasterizer& r, int32_t x, int32_t y) { return quad(r, x, y, textured); }},
+		    {"semi triangle", false, [=](rasterizer& r, int32_t x, int32_t y) { return quad(r, x, y, semi); }},
+		    {"flat rectangle",
+		     false,
+		     [=](rasterizer& r, int32_t x, int32_t y) {
+			     r.rectangle(corner(x, y, 0x80, 0, 0), side, side, flat, false, false);
+			     return side * side;
+		     }},
+		    {"textured rectangle",
+		     false,
+		     [=](rasterizer& r, int32_t x, int32_t y) {
+			     r.rectangle(corner(x, y, 0x80, 0, 0), side, side, sprite, false, false);
+			     return side * side;
+		     }},
+		    {"fill",
+		     false,
+		     [](rasterizer& r, int32_t x, int32_t y) {
+			     r.fill(x, y, side, side, 0x1234);
+			     return side * side;
+		     }},
+		    {"gouraud line",
+		     true,
+		     [=](rasterizer& r, int32_t x, int32_t y) {
+			     r.line(corner(x, y, 0x20, 0, 0), corner(x + side - 1, y + side - 1, 0xe0, 0, 0), gouraud);
+			     return side;
+		     }},
+		};
+	}
+
+	// every iteration draws one pixel
+	std::vector<registration> register_primitives() {
+		std::vector<registration> r;
+		for (auto isa : {rasterizer::isa::scalar, rasterizer::isa::sse2, rasterizer::isa::avx2}) {
+			if (!rasterizer::supported(isa)) {
+				continue;
+			}
+			for (auto const& p : primitives()) {
+				std::string name = std::string(p.name) + " (" + isa_name(isa) + ")";
+				r.emplace_back("gpu", name, [isa, p](size_t n) {
+					std::vector<uint16_t> vram(rasterizer::vram_width * rasterizer::vram_height);
+					std::mt19937 rng{1};
+					for (auto& px : vram) {
+						px = static_cast<uint16_t>(rng());
+					}
+
+					rasterizer ras{vram.data()};
+					ras.use(isa);
+					ras.env.right = rasterizer::vram_width - 1;
+					ras.env.bottom = rasterizer::vram_height - 1;
+					ras.env.dither = p.dither;
+
+					// the texture page and the CLUT are left alone
+					int32_t k = 0;
+					for (size_t pixels = 0; pixels < n; k++) {
+						int32_t x = k % 8 * side;
+						int32_t y = k / 8 % 7 * side;
+						pixels += p.fn(ras, x, y);
+					}
+					keep(vram);
+				});
+			}
+		}
+		return r;
+	}
+
+	std::vector<registration> registrations = register_primitives();
+}
@@ -0,0 +1,114 @@
+#include "bench.hpp"
+#include "cpu/gte.hpp"
+
+#include <vector>
+
+namespace {
+	using cpu::gte;
+	using psycris::bench::keep;
+	using psycris::bench::registration;
+
+	constexpr uint32_t sf = 1 << 19;
+	constexpr uint32_t lm = 1 << 10;
+
+	// the commands used by a typical frame: the geometry, the lighting and
+	// the depth sorting
+	constexpr uint32_t commands[] = {
+	    sf | 0x01,                // rtps
+	    sf | 0x30,                // rtpt
+	    0x06,                     // nclip
+	    0x2d,                     // avsz3
+	    0x2e,                     // avsz4
+	    sf | lm | 0x12,           // mvmva rt * v0 + tr
+	    sf | lm | 0x12 | 1 << 17, // mvmva llm * v0 + tr
+	    sf | lm | 0x1e,           // ncs
+	    sf | lm | 0x20,           // nct
+	    sf | lm | 0x13,           // ncds
+	    sf | lm | 0x16,           // ncdt
+	    sf | lm | 0x3f,           // ncct
+	    sf | lm | 0x2a,           // dpct
+	    sf | 0x28,                // sqr
+	    sf | 0x3d,                // gpf
+	};
+
+	uint32_t pack(int16_t lo, int16_t hi) { return static_cast<uint16_t>(lo) | static_cast<uint16_t>(hi) << 16; }
+
+	// plausible values for a model in front of the camera, lit by one light
+	void scene(gte& g) {
+		uint32_t regs[64] = {};
+		regs[0] = pack(-256, -256);
+		regs[1] = 256;
+		regs[2] = pack(256, -256);
+		regs[3] = 256;
+		regs[4] = pack(256, 256);
+		regs[5] = -256;
+		regs[6] = 0x3080'8080;
+		regs[8] = 0x800;
+		regs[32 + 0] = pack(0xddb, 0);
+		regs[32 + 1] = pack(0x800, 0);
+		regs[32 + 2] = pack(0x1000, 0);
+		regs[32 + 3] = pack(-0x800, 0);
+		regs[32 + 4] = 0xddb;
+		regs[32 + 7] = 2000;
+		regs[32 + 8] = pack(0, 0);
+		regs[32 + 9] = pack(0, 0x1000);
+		regs[32 + 12] = 0;
+		regs[32 + 13] = 0x40;
+		regs[32 + 14] = 0x40;
+		regs[32 + 15] = 0x40;
+		regs[32 + 16] = pack(0x1000, 0x800);
+		regs[32 + 18] = pack(0x1000, 0);
+		regs[32 + 20] = 0x1000;
+		regs[32 + 21] = 0x80;
+		regs[32 + 24] = 160 << 16;
+		regs[32 + 25] = 120 << 16;
+		regs[32 + 26] = 300;
+		regs[32 + 27] = -0x100;
+		regs[32 + 28] = 0x1400000;
+		regs[32 + 29] = 0x155;
+		regs[32 + 30] = 0x100;
+
+		for (uint8_t ix = 0; ix < 64; ix++) {
+			g.write(ix, regs[ix]);
+		}
+	}
+
+	char const* isa_name(gte::isa i) {
+		switch (i) {
+		case gte::isa::avx2:
+			return "avx2";
+		case gte::isa::sse4:
+			return "sse4";
+		default:
+			return "scalar";
+		}
+	}
+
+	// every iteration executes one command
+	std::vector<registration> register_commands() {
+		std::vector<registration> r;
+		for (auto isa : {gte::isa::scalar, gte::isa::sse4, gte::isa::avx2}) {
+			if (!gte::supported(isa)) {
+				continue;
+			}
+			for (uint32_t cmd : commands) {
+				std::string name = std::string(gte::command_name(cmd));
+				if ((cmd & 0x3f) == 0x12) {
+					name += (cmd >> 17 & 0x3) == 0 ? " rt" : " llm";
+				}
+				r.emplace_back("gte", name + " (" + isa_name(isa) + ")", [isa, cmd](size_t n) {
+					gte g;
+					g.use(isa);
+					scene(g);
+					for (size_t i = 0; i < n; i++) {
+						g.command(cmd);
+						keep(g.regs);
+					}
+				});
+			}
+		}
+		return r;
+	}
+
+	std::vector<registration> registrations = register_commands();
+}
@@ -0,0 +1,57 @@
+#include "bench.hpp"
+#include "logging.hpp"
+
+#include <chrono>
+#include <fmt/format.h>
+#include <vector>
+
+namespace {
+	struct benchmark {
+		std::string group;
+		std::string name;
+		psycris::bench::body fn;
+	};
+
+	std::vector<benchmark>& benchmarks() {
+		static std::vector<benchmark> b;
+		return b;
+	}
+
+	double run(benchmark const& b) {
+		using clock = std::chrono::steady_clock;
+		const std::chrono::milliseconds min_time{200};
+
+		size_t iterations = 1;
+		while (true) {
+			auto start = clock::now();
+			b.fn(iterations);
+			auto elapsed = clock::now() - start;
+			if (elapsed >= min_time || iterations >= (size_t{1} << 40)) {
+				return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+			}
+			iterations *= 10;
+		}
+	}
+}
+
+namespace psycris::bench {
+	registration::registration(std::string group, std::string name, body fn) {
+		benchmarks().push_back({std::move(group), std::move(name), std::move(fn)});
+	}
+}
+
+int main(int argc, char* argv[]) {
+	psycris::init_logging(false);
+
+	// the only (optional) argument is a substring of the benchmarks to run
+	std::string filter = argc > 1 ? argv[1] : "";
+
+	for (auto& b : benchmarks()) {
+		std::string full_name = b.group + "/" + b.name;
+		if (full_name.find(filter) == std::string::npos) {
+			continue;
+		}
+		double ns = run(b);
+		fmt::print("{:<40} {:>12.2f} ns {:>14.0f} /s\n", full_name, ns, 1e9 / ns);
+	}
+}
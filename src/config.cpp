@@ -2,11 +2,61 @@
 #include <CLI/CLI.hpp>
 #include <cstdlib>
 
-namespace psycris {
-	config cfg;
+namespace {
+	// [r][w][x]:START[-END], the addresses in hex
+	psycris::config::watchpoint parse_watchpoint(std::string const& spec) {
+		auto invalid = [&] { return CLI::ValidationError("--watch", "invalid watchpoint: " + spec); };
+
+		psycris::config::watchpoint w{0, 0, false, false, false};
+		size_t colon = spec.find(':');
+		if (colon == 0 || colon == std::string::npos) {
+			throw invalid();
+		}
+		for (char c : spec.substr(0, colon)) {
+			switch (c) {
+			case 'r':
+				w.read = true;
+				break;
+			case 'w':
+				w.write = true;
+				break;
+			case 'x':
+				w.execute = true;
+				break;
+			default:
+				throw invalid();
+			}
+		}
+
+		auto address = [&](std::string const& s) {
+			size_t parsed = 0;
+			unsigned long v = 0;
+			try {
+				v = std::stoul(s, &parsed, 16);
+			} catch (std::exception const&) {
+				throw invalid();
+			}
+			if (parsed != s.size() || v > 0xffff'ffff) {
+				throw invalid();
+			}
+			return static_cast<uint32_t>(v);
+		};
 
-	void parse_cmdline(int argc, char* argv[]) {
+		std::string range = spec.substr(colon + 1);
+		size_t dash = range.find('-');
+		w.start = address(range.substr(0, dash));
+		w.end = dash == std::string::npos ? w.start : address(range.substr(dash + 1));
+		if (w.end < w.start) {
+			throw invalid();
+		}
+		return w;
+	}
+}
+
+namespace psycris {
+	config parse_cmdline(int argc, char* argv[]) {
 		CLI::App app("psycris");
+		config cfg;
 
 		app.add_flag("--verbose", cfg.verbose, "be verbose");
 		app.add_option("--ticks,-t", cfg.ticks, "number of CPU ticks to simulate");
@@ -15,14 +65,72 @@ namespace psycris {
 		             [&](size_t) { cfg.mode = cfg.restore; },
 		             "Restore the psx state from the input file. The input file is the result of a previous dump.");
 
+		std::string engine = "interpreter";
+		app.add_set("--cpu",
+		            engine,
+		            {"interpreter", "cached", "jit"},
+		            "the cpu engine; the plain or the cached interpreter, or the recompiler");
+
+		app.add_flag("--fastmem",
+		             cfg.fastmem,
+		             "let the recompiler access the guest memory with the host MMU, without going through the "
+		             "bus (Linux x86-64 only)");
+
+		app.add_option("--trace",
+		               cfg.trace_file,
+		               "record a binary trace in the given file; the trace is recorded by the interpreter");
+
+		app.add_option("--profile",
+		               cfg.profile_prefix,
+		               "profile the guest code with the interpreter; writes PREFIX.pcs, PREFIX.blocks, PREFIX.folded "
+		               "(for flamegraph.pl) and PREFIX.perf (perf script samples)");
+		app.add_option("--symbols", cfg.symbols_file, "the map file with the names of the guest functions");
+
+		app.add_option("--bus-stats",
+		               cfg.bus_stats_prefix,
+		               "count the bus accesses per device, data port and memory page; writes PREFIX.txt (a "
+		               "readable report) and PREFIX.json");
+
+		std::vector<std::string> watchpoints;
+		app.add_option("--watch",
+		               watchpoints,
+		               "end the run at the first access to a range: [r][w][x]:START[-END] (in hex), r for the "
+		               "loads, w for the stores and x for the instruction fetches; can be repeated");
+
+		app.add_flag("--lockstep",
+		             cfg.lockstep,
+		             "run the plain interpreter and the --cpu engine side by side, stopping (and dumping both "
+		             "boards) at the first difference");
+		app.add_option("--lockstep-step", cfg.lockstep_step, "the ticks between two comparisons in lockstep mode");
+
+		auto batch = app.add_option("--batch",
+		                            cfg.batch_file,
+		                            "run the jobs listed in the given file, one per line: "
+		                            "bios|restore <input file> <ticks>; the n-th job logs into <file>.<n>.log");
+		batch->check(CLI::ExistingFile);
+		app.add_option("--jobs,-j", cfg.jobs, "the worker threads of the batch mode (default: one per core)");
+
 		app.add_option("input_file", cfg.input_file, "the bios to load") //
-		    ->required()                                                 //
+		    ->excludes(batch)                                            //
 		    ->check(CLI::ExistingFile);                                  //
 
 		try {
 			app.parse(argc, argv);
+			if (cfg.input_file.empty() && cfg.batch_file.empty()) {
+				throw CLI::RequiredError("input_file");
+			}
+			for (auto& spec : watchpoints) {
+				cfg.watchpoints.push_back(parse_watchpoint(spec));
+			}
 		} catch (const CLI::ParseError& e) {
 			std::exit(app.exit(e));
 		}
+
+		if (engine == "cached") {
+			cfg.engine = cfg.cached_interpreter;
+		} else if (engine == "jit") {
+			cfg.engine = cfg.recompiler;
+		}
+		return cfg;
 	}
 }
\ No newline at end of file
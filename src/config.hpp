@@ -1,5 +1,7 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace psycris {
 	struct config {
@@ -13,11 +15,60 @@ namespace psycris {
 		};
 		start_mode mode = bios;
 
+		enum cpu_engine {
+			// fetch and decode every instruction
+			interpreter,
+			// execute the pre-decoded blocks of the block cache
+			cached_interpreter,
+			// translate the blocks into host code
+			recompiler,
+		};
+		cpu_engine engine = interpreter;
+
+		// map the board memory in a host region where the recompiler
+		// accesses it without the bus, see `bus::fastmem`
+		bool fastmem = false;
+
+		// record a binary trace of the executed instructions in this file
+		std::string trace_file;
+
+		// profile the guest code, the reports are written in files named
+		// after this prefix
+		std::string profile_prefix;
+		// the names of the guest functions used by the profiler
+		std::string symbols_file;
+
+		// count the bus accesses, the reports are written in files named
+		// after this prefix
+		std::string bus_stats_prefix;
+
+		// end the run at the first access of the given kinds to one of the
+		// ranges [start, end]
+		struct watchpoint {
+			uint32_t start;
+			uint32_t end;
+			bool read;
+			bool write;
+			bool execute;
+		};
+		std::vector<watchpoint> watchpoints;
+
 		size_t ticks = 10000;
 		bool dump_on_exit = false;
-	};
 
-	extern config cfg;
+		// run the plain interpreter and `engine` in lockstep, comparing the
+		// two boards every `lockstep_step` ticks
+		bool lockstep = false;
+		uint64_t lockstep_step = 100;
+
+		// the list of the jobs to run in batch mode, see `run_batch`
+		std::string batch_file;
+		// the worker threads of the batch mode, 0 for one per core
+		size_t jobs = 0;
+	};
 
-	void parse_cmdline(int argc, char* argv[]);
+	/**
+	 * \brief parses the command line; exits on errors
+	 */
+	config parse_cmdline(int argc, char* argv[]);
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "block_cache.hpp"
+
+namespace {
+	using cpu::op_id;
+
+	bool has_side_effects(op_id id) {
+		switch (id) {
+		case op_id::sb:
+		case op_id::sh:
+		case op_id::sw:
+		case op_id::swc2:
+		case op_id::syscall:
+		case op_id::cop0:
+		case op_id::cop2:
+		case op_id::cop_unusable:
+		case op_id::unknown:
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+namespace cpu {
+	block_cache::block_cache(psycris::bus::data_bus& b) : bus{&b}, uncached{nullptr, {}, false, false, {}}, _generation{0} {}
+
+	block& block_cache::fetch(uint32_t pc) {
+		retired.clear();
+
+		auto page = bus->code_page(pc);
+		if (page.empty() || (pc & 0x3) != 0) {
+			uncached.ops.assign(1, decode(decoder{bus->fetch(pc)}));
+			return uncached;
+		}
+
+		uint8_t const* host = page.data() + (pc & psycris::bus::data_bus::page_mask);
+		auto pos = blocks.find(host);
+		if (pos != std::end(blocks)) {
+			return *pos->second;
+		}
+		return compile(pc, page);
+	}
+
+	void block_cache::clear() {
+		for (auto& [host, b] : blocks) {
+			b->valid = false;
+			retired.push_back(std::move(b));
+		}
+		blocks.clear();
+		chunks.clear();
+		_generation++;
+	}
+
+	block& block_cache::compile(uint32_t pc, gsl::span<uint8_t> page) {
+		uint32_t offset = pc & psycris::bus::data_bus::page_mask;
+
+		auto b = std::make_unique<block>();
+		b->host = page.data() + offset;
+		b->valid = true;
+		b->polling = true;
+
+		bool delay_slot = false;
+		for (; offset + 4 <= page.size() && b->ops.size() < max_block_size; offset += 4) {
+			uint32_t raw;
+			std::memcpy(&raw, page.data() + offset, sizeof(raw));
+			b->ops.push_back(decode(decoder{raw}));
+
+			op_id id = b->ops.back().id;
+			b->polling = b->polling && !has_side_effects(id);
+			if (delay_slot || id == op_id::unknown) {
+				break;
+			}
+			delay_slot = has_delay_slot(id);
+		}
+
+		bus->watch_writes(page.data(), *this);
+
+		auto first = reinterpret_cast<uintptr_t>(b->host) >> chunk_bits;
+		auto last = (reinterpret_cast<uintptr_t>(b->host) + b->ops.size() * 4 - 1) >> chunk_bits;
+		for (auto chunk = first; chunk <= last; chunk++) {
+			chunks[chunk].push_back(b.get());
+		}
+
+		auto& inserted = blocks[b->host];
+		inserted = std::move(b);
+		return *inserted;
+	}
+
+	void block_cache::written(uint8_t const* host, size_t size) {
+		if (size == 0) {
+			return;
+		}
+
+		// a block write can span many chunks; an invalidated block is removed
+		// from all its chunks, so it is not found again in the next ones.
+		auto first_chunk = reinterpret_cast<uintptr_t>(host) >> chunk_bits;
+		auto last_chunk = (reinterpret_cast<uintptr_t>(host) + size - 1) >> chunk_bits;
+		for (auto current = first_chunk; current <= last_chunk; current++) {
+			auto chunk = chunks.find(current);
+			if (chunk == std::end(chunks)) {
+				continue;
+			}
+
+			auto& listed = chunk->second;
+			for (size_t ix = 0; ix < listed.size();) {
+				block* b = listed[ix];
+				bool touched = host + size > b->host && host < b->host + b->ops.size() * 4;
+				if (!touched) {
+					ix++;
+					continue;
+				}
+
+				// remove the block from all the chunks it is listed in; the
+				// current one is the only one we are iterating over.
+				auto first = reinterpret_cast<uintptr_t>(b->host) >> chunk_bits;
+				auto last = (reinterpret_cast<uintptr_t>(b->host) + b->ops.size() * 4 - 1) >> chunk_bits;
+				for (auto c = first; c <= last; c++) {
+					if (c == current) {
+						continue;
+					}
+					auto& others = chunks[c];
+					others.erase(std::remove(std::begin(others), std::end(others), b), std::end(others));
+				}
+				listed.erase(std::begin(listed) + ix);
+
+				auto pos = blocks.find(b->host);
+				b->valid = false;
+				_generation++;
+				retired.push_back(std::move(pos->second));
+				blocks.erase(pos);
+			}
+		}
+	}
+}
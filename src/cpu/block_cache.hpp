@@ -0,0 +1,107 @@
+#pragma once
+#include "../hw/bus.hpp"
+#include "instruction.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace cpu {
+	/**
+	 * \brief A sequence of pre-decoded instructions
+	 *
+	 * A block is a run of straight-line code: it ends with the delay slot of
+	 * the first branch or jump, at the first unknown instruction, at the end
+	 * of a bus page or when it reaches `block_cache::max_block_size`
+	 * instructions.
+	 */
+	struct block {
+		// the host memory where the code lives
+		uint8_t const* host;
+
+		std::vector<instruction> ops;
+
+		// false if the block has been invalidated by a write to its memory
+		bool valid;
+
+		// true if the only side effect of the block is on the cpu registers:
+		// it does not store and it has no coprocessor or system instruction.
+		// Executed twice on the same memory, such a block gives the same
+		// result, as long as its loads read the memory and not an I/O port
+		// (which the cpu checks while it runs, see `mips::skip_idle`).
+		bool polling;
+
+		// the host code generated by the `recompiler`, one entry for every
+		// guest address the block has been executed from.
+		struct native_code {
+			uint32_t pc;
+			uint32_t epoch;
+			void const* entry;
+		};
+		std::vector<native_code> native;
+	};
+
+	/**
+	 * \brief The cache of the already decoded blocks
+	 *
+	 * The blocks are indexed by the host memory that contains their code, so
+	 * the same block is shared by all the mirrors of a memory region.
+	 *
+	 * The cache watches the writes to every bus page with cached code; when
+	 * a write touches a block the block is invalidated. An invalidated block
+	 * is not destroyed immediately, it stays alive until the next `fetch`, so
+	 * the cpu can safely finish the instruction that caused the invalidation.
+	 */
+	class block_cache : private psycris::bus::write_observer {
+	  public:
+		static constexpr size_t max_block_size = 64;
+
+	  public:
+		block_cache(psycris::bus::data_bus&);
+
+	  public:
+		/**
+		 * \brief returns the block that starts at `pc`, decoding it if needed
+		 *
+		 * Code outside of a memory page, or in a page whose instruction
+		 * fetches are watched (see `data_bus::code_page`), is decoded on the
+		 * fly and never cached; the returned block is already invalid and
+		 * contains only one instruction.
+		 */
+		block& fetch(uint32_t pc);
+
+		/**
+		 * \brief drops all the cached blocks
+		 */
+		void clear();
+
+		/**
+		 * \brief a counter incremented every time a block is invalidated
+		 */
+		uint32_t const& generation() const { return _generation; }
+
+	  private:
+		block& compile(uint32_t pc, gsl::span<uint8_t> page);
+
+		void written(uint8_t const* host, size_t size) override;
+
+	  private:
+		psycris::bus::data_bus* bus;
+
+		std::unordered_map<uint8_t const*, std::unique_ptr<block>> blocks;
+
+		// To find the blocks touched by a write the memory is divided into
+		// chunks; every block is listed in all the chunks it overlaps.
+		static constexpr uint8_t chunk_bits = 8;
+		std::unordered_map<uintptr_t, std::vector<block*>> chunks;
+
+		// the invalidated blocks, destroyed by the next fetch
+		std::vector<std::unique_ptr<block>> retired;
+
+		// the single instruction block used for the code outside the memory
+		// pages
+		block uncached;
+
+		uint32_t _generation;
+	};
+}
@@ -76,6 +76,10 @@ namespace cpu {
 		// access only the data cache, and never memory
 		constexpr mask IsC{0x0001'0000};
 
+		// "interrupt mask": the interrupts (the IP bits of Cause) that can
+		// be taken
+		constexpr mask IM{0x0000'ff00};
+
 		// "boot exception vectors": when BEV == 1, the CPU uses the ROM (kseg1)
 		// space exception entry point . BEV is usually set to zero in running
 		// systems; this relocates the exception vectors. to RAM addresses,
@@ -84,6 +88,31 @@ namespace cpu {
 		constexpr mask BEV{0x0040'0000};
 	}
 
+	namespace dcic_bits {
+		using mask = psycris::bit_mask<class dcic_bits_>;
+
+		// the status bits, set by the hardware when a breakpoint is hit: any
+		// break, code break (BPC), data break (BDA) and the kind of the data
+		// access.
+		constexpr mask Any{0x0000'0001};
+		constexpr mask Code{0x0000'0002};
+		constexpr mask Data{0x0000'0004};
+		constexpr mask DataRead{0x0000'0008};
+		constexpr mask DataWrite{0x0000'0010};
+
+		// the code breakpoint (BPC/BPCM) and the data breakpoint (BDA/BDAM),
+		// on reads and/or writes
+		constexpr mask CodeEnable{0x0100'0000};
+		constexpr mask DataEnable{0x0200'0000};
+		constexpr mask ReadEnable{0x0400'0000};
+		constexpr mask WriteEnable{0x0800'0000};
+
+		// the breakpoints are armed only if these three bits are all set
+		constexpr mask SuperMaster1{0x0080'0000};
+		constexpr mask Master{0x4000'0000};
+		constexpr mask SuperMaster2{0x8000'0000};
+	}
+
 	class cop0 {
 	  public:
 		cop0() = default;
@@ -112,12 +141,43 @@ namespace cpu {
 			// any other exception this register is undefined. Note in
 			// particular that it is not set after a bus error.
 			BadVaddr = 8,
+			// The hardware breakpoints: an instruction fetch from an address
+			// that matches BPC in the bits set in BPCM, or a data access to an
+			// address that matches BDA in the bits set in BDAM, raises a debug
+			// exception if enabled in DCIC (see `dcic_bits`).
+			BPC = 3,
+			BDA = 5,
+			DCIC = 7,
+			BDAM = 9,
+			BPCM = 11,
 		};
 
 	  public:
 		void reset();
 
-		void interrupt_request();
+		/**
+		 * \brief asserts or clears the hardware interrupt `n` (0-5), the
+		 * bit 10 + `n` of Cause
+		 */
+		void interrupt_line(uint8_t n, bool asserted) {
+			uint32_t bit = 1 << (10 + n);
+			cause() = asserted ? cause() | bit : cause() & ~bit;
+			update_interrupts();
+		}
+
+		/**
+		 * \brief an interrupt must be taken: IEc is set and an IP bit of
+		 * Cause is enabled by IM
+		 *
+		 * The flag is cached, it must be recomputed (see `update_interrupts`)
+		 * after every change of SR or Cause.
+		 */
+		bool interrupt_pending() const { return pending; }
+
+		bool update_interrupts() {
+			pending = sr_bits::IEc(sr()) && (cause_bits::IP(cause()) & sr_bits::IM(sr())) != 0;
+			return pending;
+		}
 
 	  public:
 		enum exc_code {
@@ -146,7 +206,11 @@ namespace cpu {
 			         // instructions (e.g. addu ) never cause this exception.
 		};
 
-		void restore_from_exception() { sr_bits::AllExcBits(sr()) >>= 2; }
+		void restore_from_exception() {
+			// the KUo/IEo pair is left as it is
+			sr() = (sr() & ~0xfu) | ((sr() >> 2) & 0xf);
+			update_interrupts();
+		}
 
 		void enter_exception(exc_code c) {
 			// save the current values of KU and IE
@@ -156,10 +220,11 @@ namespace cpu {
 			sr_bits::IEc(sr()) = 0;
 			// store the exception cause
 			cause_bits::ExcCode(cause()) = c;
+			update_interrupts();
 		}
 
 	  public:
-		std::array<uint32_t, 32> regs;
+		std::array<uint32_t, 32> regs = {};
 
 		uint32_t prid() const { return regs[PRId]; }
 		uint32_t& prid() { return regs[PRId]; }
@@ -175,5 +240,11 @@ namespace cpu {
 
 		uint32_t bad_vaddr() const { return regs[BadVaddr]; }
 		uint32_t& bad_vaddr() { return regs[BadVaddr]; }
+
+		uint32_t dcic() const { return regs[DCIC]; }
+		uint32_t& dcic() { return regs[DCIC]; }
+
+	  private:
+		bool pending = false;
 	};
 }
\ No newline at end of file
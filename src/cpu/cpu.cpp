@@ -1,20 +1,14 @@
 #include "cpu.hpp"
 #include "../logging.hpp"
-#include "disassembly.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <ostream>
 
 namespace {
-	void unimplemented(uint32_t pc, uint64_t clock, cpu::decoder ins) {
-		psycris::log->critical("[CPU] unimplemented instruction pc={:0>8x} clock={} opcode={:0>#2x} funct={:0>#2x}",
-		                       pc,
-		                       clock,
-		                       ins.opcode(),
-		                       ins.funct());
-		std::exit(99);
-	}
-
 	// clang-format off
 	template <size_t AccessSize> struct bus_align;
 	template <> struct bus_align<1> { static constexpr uint8_t mask = 0x0; };
@@ -24,17 +18,47 @@ namespace {
 }
 
 namespace cpu {
-	mips::mips(bus::data_bus& b) : bus{&b} { reset(); }
+	mips::mips(bus::data_bus& b)
+	    : bus{&b},
+	      scratchpad_memory{nullptr},
+	      scratchpad{nullptr},
+	      fastmem_view{nullptr},
+	      code_breakpoint{0},
+	      data_breakpoint{0},
+	      debug_pending{false},
+	      blocks{b},
+	      rec{nullptr},
+	      prof{nullptr},
+	      idle{} {
+		reset();
+	}
+
+	mips::~mips() {
+		for (auto& [id, range] : watched) {
+			bus->unwatch(id);
+		}
+	}
 
 	void mips::reset() {
 		regs.fill(0);
+		mult_regs.fill(0);
 		clock = 0;
+		slice_end = 0;
+		halt_status = 0;
+
+		cop2.reset();
 
 		ins = mips::noop;
 		pc = mips::reset_vector - 4;
 
 		next_ins = mips::noop;
 		npc = mips::reset_vector;
+
+		idle.b = nullptr;
+
+		stop.reset();
+		debug_pending = false;
+		program_breakpoints();
 	}
 
 	void mips::trap(cop0::exc_code cause) {
@@ -47,264 +71,568 @@ namespace cpu {
 		}
 	}
 
+	template <typename Trace>
 	void mips::run(uint64_t until) {
-		using psycris::log;
+		Trace trace{*this};
 
-		reg_tracer rtracer;
+		start_run(until);
+		while (clock < slice_end) {
+			clock++;
 
-		while (clock++ < until) {
 			// prefecth the next instruction
-			next_ins = bus->read<uint32_t>(npc);
+			next_ins = bus->fetch(npc);
 
-			// adjust the program counters; for debug we want to print the
+			// adjust the program counters; for debug we want to trace the
 			// current instruction along with the location where we fetched it,
 			// but for the cpu the PC of the current instruction is pointing to
 			// the next instruction (the delay slot).
-			log->trace("{:0>8x}@{}: {}", pc, clock, disassembly(ins, pc));
+			trace.fetched(pc, clock, ins, regs);
 			// pc now points to the delay slot
 			pc = npc;
 			// npc to the instruction after the delay slot
 			npc += 4;
 
-			// execute
-			switch (ins.opcode()) {
-			case 0x00: // ALU Access
-				switch (ins.funct()) {
-				case 0x00: // SLL -- Shift Word Left logical
-					rd() = rt() << ins.shamt();
-					break;
-				case 0x02: // SRL -- Shift Word Right Logical
-					rd() = rt() >> ins.shamt();
-					break;
-				case 0x03: // SRA -- Shift Word Right Arithmetic
-					rd() = static_cast<int32_t>(rt() >> ins.shamt());
-					break;
-				case 0x04: // SLLV -- Shift Word Left Logical Variable
-					rd() = rt() << (rs() & 0x1f);
-					break;
-				case 0x07: // SRAV -- Shift Word Right Arithmetic Variable
-					rd() = static_cast<int32_t>(rt() >> (rs() & 0x1f));
-					break;
-				case 0x08: // JR -- Jump Register
-					npc = rs();
-					break;
-				case 0x09: // JALR -- Jump And Link Register
-					rd() = npc;
-					npc = rs();
-					break;
-				case 0x0c: // SYSCALL -- System Call
-					trap(cop0::Syscall);
-					break;
-				case 0x10: // MFHI -- Move From Hi
-					rd() = hi();
-					break;
-				case 0x11: // MTHI -- Move To Hi
-					hi() = rs();
-					break;
-				case 0x12: // MFLO -- Move From Lo
-					rd() = lo();
-					break;
-				case 0x13: // MTLO -- Move To Lo
-					lo() = rs();
-					break;
-				case 0x18: { // MULT -- Multiply Word
-					int64_t r = static_cast<int32_t>(rs()) * static_cast<int32_t>(rt());
-					lo() = r & 0x0000'0000'ffff'ffff;
-					hi() = r & 0xffff'ffff'0000'0000;
-					break;
-				}
-				case 0x19: { // MULTU -- Multiply Unsigned Word
-					uint64_t r = rs() * rt();
-					lo() = r & 0x0000'0000'ffff'ffff;
-					hi() = r & 0xffff'ffff'0000'0000;
-					break;
-				}
-				case 0x1a: { // DIV -- Divide Word
-					auto r = std::div(static_cast<int32_t>(rs()), static_cast<int32_t>(rt()));
-					lo() = r.quot;
-					hi() = r.rem;
-					break;
-				}
-				case 0x1b: // DIVU -- Divide Unsigned Word
-					lo() = rs() / rt();
-					hi() = rs() % rt();
-					break;
-				case 0x20: // ADD -- Add Word
-					add_with_overflow(rd(), rs(), rt());
-					break;
-				case 0x21: // ADDU -- Add Unsigned Word
-					rd() = rs() + rt();
-					break;
-				case 0x23: // SUBU -- Subtract Unsigned Word
-					rd() = rs() - rt();
-					break;
-				case 0x24: // AND -- And
-					rd() = rs() & rt();
-					break;
-				case 0x27: // NOR -- Nor
-					rd() = ~(rs() | rt());
-					break;
-				case 0x2a: // SLT -- Set On Less Than
-					rd() = static_cast<int32_t>(rs()) < static_cast<int32_t>(rt()) ? 1 : 0;
-					break;
-				case 0x2b: // SLTU -- Set On Less Than Unsigned
-					rd() = rs() < rt() ? 1 : 0;
-					break;
-				case 0x25: // OR -- Bitwise or
-					rd() = rs() | rt();
-					break;
-				default:
-					unimplemented(pc, clock, ins);
-				}
-				break;
-			case 0x01:
-				switch (ins.rt()) {
-				case 0x01: // BGEZ -- Branch On Greater Than Or Equal To Zero
-					if (static_cast<int32_t>(rs()) >= 0) {
-						npc = pc + sx(ins.uimm() << 2, 16);
-					}
-					break;
-				case 0x11: { // BGEZAL -- Branch On Greater Than Or Equal To Zero And Link
-					bool c = static_cast<int32_t>(rs()) >= 0;
-					regs[31] = npc;
-					if (c) {
-						npc = pc + sx(ins.uimm() << 2, 16);
-					}
-					break;
-				}
-				case 0x00: // BLTZ -- Branch On Less Than Zero
-					if (static_cast<int32_t>(rs()) < 0) {
-						npc = pc + sx(ins.uimm() << 2, 16);
-					}
-					break;
-				case 0x10: { // BLTZAL -- Branch On Less Than Zero And Link
-					bool c = static_cast<int32_t>(rs()) < 0;
-					regs[31] = npc;
-					if (c) {
-						npc = pc + sx(ins.uimm() << 2, 16);
-					}
-					break;
-				}
-				default:
-					unimplemented(pc, clock, ins);
-				}
-				break;
-			case 0x03: // JAL -- Jump And Link
-				regs[31] = npc;
-				[[fallthrough]];
-			case 0x02: // J -- Jump
-				npc = (pc & 0xf000'0000) | (ins.target() << 2);
-				break;
-			case 0x04: // BEQ -- Branch On Equal
-				if (rs() == rt()) {
-					npc = pc + sx(ins.uimm() << 2, 16);
-				}
-				break;
-			case 0x05: // BNE -- Branch On Not Equal
-				if (rs() != rt()) {
-					npc = pc + sx(ins.uimm() << 2, 16);
-				}
-				break;
-			case 0x06: // BLEZ -- Branch On Less Than Or Equal To Zero
-				if (static_cast<int32_t>(rs()) <= 0) {
-					npc = pc + sx(ins.uimm() << 2, 16);
-				}
-				break;
-			case 0x07: // BGTZ -- Branch On Greater Than Zero
-				if (static_cast<int32_t>(rs()) > 0) {
-					npc = pc + sx(ins.uimm() << 2, 16);
-				}
-				break;
-			case 0x08: // ADDI -- Add Immediate Word
-				add_with_overflow(rt(), rs(), ins.imm());
-				break;
-			case 0x09: // ADDIU -- Add immediate unsigned (no overflow)
-				rt() = rs() + ins.imm();
-				break;
-			case 0x0a: // SLTI -- Set On Less Than Immediate
-				rt() = static_cast<int32_t>(rs()) < ins.imm() ? 1 : 0;
-				break;
-			case 0x0b: // SLTIU -- Set On Less Than Immediate Unsigned
-				rt() = rs() < static_cast<uint32_t>(ins.imm()) ? 1 : 0;
-				break;
-			case 0x0c: // ANDI -- And Immediate
-				rt() = rs() & ins.uimm();
-				break;
-			case 0x0d: // ORI -- Bitwise or immediate
-				rt() = rs() | ins.uimm();
-				break;
-			case 0x0f: // LUI -- Load upper immediate
-				rt() = ins.uimm() << 16;
-				break;
-			case 0x20: // LB -- Load byte
-				rt() = sx(read<uint8_t>(rs() + ins.imm()), 8);
-				break;
-			case 0x21: // LH -- Load Halfword
-				rt() = sx(read<uint16_t>(rs() + ins.imm()), 16);
-				break;
-			case 0x23: // LW -- Load word
-				rt() = read<uint32_t>(rs() + ins.imm());
-				break;
-			case 0x24: // LBU -- Load Byte Unsigned
-				rt() = read<uint8_t>(rs() + ins.imm());
-				break;
-			case 0x25: // LHU -- Load Halfword Unsigned
-				rt() = read<uint16_t>(rs() + ins.imm());
-				break;
-			case 0x28: // SB -- Store Byte
-				write(rs() + ins.imm(), static_cast<uint8_t>(rt()));
-				break;
-			case 0x29: // SH -- Store Halfword
-				write(rs() + ins.imm(), static_cast<uint16_t>(rt()));
-				break;
-			case 0x2b: // SW -- Store word
-				write(rs() + ins.imm(), rt());
-				break;
-			case 0x10: // COP0
-				run_cop(cop0);
-				break;
-			case 0x12: // COP2
-				log->warn("[CPU] unimplemented instruction for coprocessor 2");
-				break;
-			case 0x11: // COP1
-			case 0x13: // COP3
-				log->warn("[CPU] instruction for unavailable coprocessor {}", ins.cop_n());
+			execute(decode(ins));
+
+			trace.executed(regs);
+
+			ins = next_ins;
+		}
+	}
+
+	template void mips::run<no_trace>(uint64_t);
+	template void mips::run<text_trace>(uint64_t);
+	template void mips::run<binary_trace>(uint64_t);
+	template void mips::run<profile>(uint64_t);
+
+	void mips::run_cached(uint64_t until) {
+		start_run(until);
+		execute_fetched();
+
+		while (clock < slice_end) {
+			uint32_t start = pc;
+			block const& b = blocks.fetch(start);
+			if (clock >= slice_end) {
+				// the fetch hit a watchpoint; like the plain interpreter stop
+				// before the instruction is executed
+				ins = next_ins = b.ops.front().ins;
+				return;
+			}
+			interpret(b);
+			skip_idle(b, start);
+		}
+		// like the plain interpreter, leave the cpu with the current
+		// instruction already fetched.
+		ins = next_ins = bus->fetch(pc);
+	}
+
+	void mips::run_jit(uint64_t until) {
+		if (!recompiler::available()) {
+			run_cached(until);
+			return;
+		}
+		if (!jit) {
+			jit = std::make_unique<recompiler>(*this);
+		}
+		if (!jit->ready()) {
+			run_cached(until);
+			return;
+		}
+
+		start_run(until);
+		execute_fetched();
+
+		while (clock < slice_end) {
+			uint32_t start = pc;
+			uint64_t before = clock;
+			block& b = blocks.fetch(start);
+			if (clock >= slice_end) {
+				ins = next_ins = b.ops.front().ins;
+				return;
+			}
+			if (b.valid && npc == start + 4 && slice_end - clock >= b.ops.size()) {
+				jit->run(b, start);
+			} else {
+				interpret(b);
+			}
+			// the recompiler may have run more than one block
+			if (clock - before == b.ops.size()) {
+				skip_idle(b, start);
+			} else {
+				idle.b = nullptr;
+			}
+		}
+		ins = next_ins = bus->fetch(pc);
+	}
+
+	void mips::halt(int status) {
+		halt_status = status;
+		stop_at(clock);
+	}
+
+	void mips::stop_at(uint64_t t) { slice_end = std::min(slice_end, t); }
+
+	void mips::interrupt_line(bool asserted) {
+		cop0.interrupt_line(0, asserted);
+		check_interrupts();
+	}
+
+	void mips::check_interrupts() {
+		if (cop0.update_interrupts()) {
+			stop_at(clock);
+		}
+	}
+
+	uint64_t mips::deadline() const { return slice_end; }
+
+	void mips::start_run(uint64_t until) {
+		slice_end = until;
+		stop.reset();
+
+		if (debug_pending) {
+			debug_pending = false;
+			// the current instruction is not executed, the handler returns
+			// to it
+			cop0.epc() = pc;
+			cop0.enter_exception(cop0::Bp);
+			ins = mips::noop;
+			npc = sr_bits::BEV(cop0.sr()) == 0 ? mips::dbg_vector : mips::rom_dbg_vector;
+		}
+
+		if (cop0.interrupt_pending()) {
+			// the current instruction is not executed; if it is in the delay
+			// slot of a taken branch the handler returns to the branch
+			bool delay_slot = npc != pc + 4;
+			cop0.epc() = delay_slot ? pc - 4 : pc;
+			cause_bits::BD(cop0.cause()) = delay_slot;
+			cop0.enter_exception(cop0::Int);
+			ins = mips::noop;
+			npc = sr_bits::BEV(cop0.sr()) == 0 ? mips::exc_vector : mips::rom_exc_vector;
+		}
+	}
+
+	uint32_t mips::watch(bus::address_range r, uint8_t kinds) { return add_watchpoint(r, kinds); }
+
+	void mips::unwatch(uint32_t id) {
+		if (id != code_breakpoint && id != data_breakpoint) {
+			remove_watchpoint(id);
+		}
+	}
+
+	void mips::hit(uint32_t id, uint32_t addr, uint8_t size, bus::access::kind kind) {
+		if (id != code_breakpoint && id != data_breakpoint) {
+			stop = watch_hit{id, kind, addr, size};
+			stop_at(clock);
+			return;
+		}
+
+		uint32_t& dcic = cop0.dcic();
+		if (id == code_breakpoint) {
+			if (((addr ^ cop0.regs[cop0::BPC]) & cop0.regs[cop0::BPCM]) != 0) {
+				return;
+			}
+			dcic_bits::Code(dcic) = 1;
+		} else {
+			if (((addr ^ cop0.regs[cop0::BDA]) & cop0.regs[cop0::BDAM]) != 0) {
+				return;
+			}
+			dcic_bits::Data(dcic) = 1;
+			if (kind == bus::access::read) {
+				dcic_bits::DataRead(dcic) = 1;
+			} else {
+				dcic_bits::DataWrite(dcic) = 1;
+			}
+		}
+		dcic_bits::Any(dcic) = 1;
+
+		debug_pending = true;
+		stop_at(clock);
+	}
+
+	void mips::program_breakpoints() {
+		uint32_t const dcic = cop0.dcic();
+		bool armed = dcic_bits::SuperMaster1(dcic) && dcic_bits::Master(dcic) && dcic_bits::SuperMaster2(dcic);
+
+		// the range that contains all the addresses `addr` matches in the
+		// bits set in `mask`
+		auto covering = [](uint32_t addr, uint32_t mask) {
+			return bus::address_range{addr & mask, (addr & mask) | ~mask};
+		};
+
+		remove_watchpoint(code_breakpoint);
+		remove_watchpoint(data_breakpoint);
+		code_breakpoint = data_breakpoint = 0;
+
+		if (armed && dcic_bits::CodeEnable(dcic)) {
+			auto range = covering(cop0.regs[cop0::BPC], cop0.regs[cop0::BPCM]);
+			code_breakpoint = add_watchpoint(range, bus::access::execute);
+		}
+
+		uint8_t kinds = (dcic_bits::ReadEnable(dcic) ? bus::access::read : 0)
+		    | (dcic_bits::WriteEnable(dcic) ? bus::access::write : 0);
+		if (armed && dcic_bits::DataEnable(dcic) && kinds != 0) {
+			auto range = covering(cop0.regs[cop0::BDA], cop0.regs[cop0::BDAM]);
+			data_breakpoint = add_watchpoint(range, kinds);
+		}
+	}
+
+	uint32_t mips::add_watchpoint(bus::address_range r, uint8_t kinds) {
+		uint32_t id = bus->watch(r, kinds, *this);
+		watched[id] = r;
+		if (kinds & bus::access::execute) {
+			// the blocks already decoded (and linked by the recompiler) would
+			// skip the instruction fetches
+			blocks.clear();
+		}
+		update_scratchpad();
+		return id;
+	}
+
+	void mips::remove_watchpoint(uint32_t id) {
+		if (watched.erase(id) == 0) {
+			return;
+		}
+		bus->unwatch(id);
+		update_scratchpad();
+	}
+
+	void mips::update_scratchpad() {
+		bool covered = std::any_of(std::begin(watched), std::end(watched), [](auto& w) {
+			auto& r = w.second;
+			return (r.start <= 0x1f80'03ff && r.end >= 0x1f80'0000) || (r.start <= 0x9f80'03ff && r.end >= 0x9f80'0000);
+		});
+		scratchpad = covered ? nullptr : scratchpad_memory;
+	}
+
+	void mips::skip_idle(block const& b, uint32_t start) {
+		if (!b.polling || !b.valid || pc != start || npc != start + 4) {
+			idle.b = nullptr;
+			return;
+		}
+
+		// a load served by a device may give a different value at every
+		// iteration, the loop is skipped only after an iteration that read
+		// the memory alone
+		uint64_t device_reads = bus->device_reads();
+		if (idle.b != &b || idle.start != start || idle.regs != regs || idle.mult_regs != mult_regs ||
+		    idle.device_reads != device_reads) {
+			idle.b = &b;
+			idle.start = start;
+			idle.regs = regs;
+			idle.mult_regs = mult_regs;
+			idle.device_reads = device_reads;
+			return;
+		}
+
+		uint64_t length = b.ops.size();
+		uint64_t skipped = (slice_end - clock) / length * length;
+		clock += skipped;
+		idle.skipped += skipped;
+	}
+
+	void mips::execute_fetched() {
+		// the current instruction has already been fetched (after a reset it
+		// is not even in memory), so it is executed as is; from now on `pc`
+		// is the address of the current instruction.
+		if (clock < slice_end) {
+			clock++;
+			pc = npc;
+			npc += 4;
+			execute(decode(ins));
+		}
+	}
+
+	void mips::interpret(block const& b) {
+		for (auto op = std::begin(b.ops);;) {
+			clock++;
+
+			// The next instruction was prefetched before the execution of
+			// the previous one; if the previous one invalidated this block
+			// we can execute the current instruction, but not the next.
+			bool stale = !b.valid;
+			uint32_t addr = pc;
+			uint32_t fetch = npc;
+
+			pc = npc;
+			npc += 4;
+
+			ins = op->ins;
+			execute(*op);
+
+			++op;
+			if (op == std::end(b.ops) || stale || fetch != addr + 4 || clock >= slice_end) {
 				break;
-			default:
-				unimplemented(pc, clock, ins);
 			}
+		}
+	}
+
+	template <op_id Id>
+	void mips::execute(instruction const& i) {
+		using psycris::log;
 
-			rtracer.trace(regs);
+		uint32_t& rs = regs[i.rs];
+		uint32_t& rt = regs[i.rt];
+		uint32_t& rd = regs[i.rd];
 
-			ins = next_ins;
+		// every instantiation keeps only its own case
+		switch (Id) {
+		case op_id::sll: // SLL -- Shift Word Left logical
+			rd = rt << i.shamt;
+			break;
+		case op_id::srl: // SRL -- Shift Word Right Logical
+			rd = rt >> i.shamt;
+			break;
+		case op_id::sra: // SRA -- Shift Word Right Arithmetic
+			rd = static_cast<int32_t>(rt >> i.shamt);
+			break;
+		case op_id::sllv: // SLLV -- Shift Word Left Logical Variable
+			rd = rt << (rs & 0x1f);
+			break;
+		case op_id::srav: // SRAV -- Shift Word Right Arithmetic Variable
+			rd = static_cast<int32_t>(rt >> (rs & 0x1f));
+			break;
+		case op_id::jr: // JR -- Jump Register
+			npc = rs;
+			break;
+		case op_id::jalr: // JALR -- Jump And Link Register
+			rd = npc;
+			npc = rs;
+			break;
+		case op_id::syscall: // SYSCALL -- System Call
+			trap(cop0::Syscall);
+			break;
+		case op_id::mfhi: // MFHI -- Move From Hi
+			rd = hi();
+			break;
+		case op_id::mthi: // MTHI -- Move To Hi
+			hi() = rs;
+			break;
+		case op_id::mflo: // MFLO -- Move From Lo
+			rd = lo();
+			break;
+		case op_id::mtlo: // MTLO -- Move To Lo
+			lo() = rs;
+			break;
+		case op_id::mult: { // MULT -- Multiply Word
+			int64_t r = static_cast<int32_t>(rs) * static_cast<int32_t>(rt);
+			lo() = r & 0x0000'0000'ffff'ffff;
+			hi() = r & 0xffff'ffff'0000'0000;
+			break;
+		}
+		case op_id::multu: { // MULTU -- Multiply Unsigned Word
+			uint64_t r = rs * rt;
+			lo() = r & 0x0000'0000'ffff'ffff;
+			hi() = r & 0xffff'ffff'0000'0000;
+			break;
+		}
+		case op_id::div: { // DIV -- Divide Word
+			auto r = std::div(static_cast<int32_t>(rs), static_cast<int32_t>(rt));
+			lo() = r.quot;
+			hi() = r.rem;
+			break;
+		}
+		case op_id::divu: // DIVU -- Divide Unsigned Word
+			lo() = rs / rt;
+			hi() = rs % rt;
+			break;
+		case op_id::add: // ADD -- Add Word
+			add_with_overflow(rd, rs, rt);
+			break;
+		case op_id::addu: // ADDU -- Add Unsigned Word
+			rd = rs + rt;
+			break;
+		case op_id::subu: // SUBU -- Subtract Unsigned Word
+			rd = rs - rt;
+			break;
+		case op_id::and_: // AND -- And
+			rd = rs & rt;
+			break;
+		case op_id::nor: // NOR -- Nor
+			rd = ~(rs | rt);
+			break;
+		case op_id::slt: // SLT -- Set On Less Than
+			rd = static_cast<int32_t>(rs) < static_cast<int32_t>(rt) ? 1 : 0;
+			break;
+		case op_id::sltu: // SLTU -- Set On Less Than Unsigned
+			rd = rs < rt ? 1 : 0;
+			break;
+		case op_id::or_: // OR -- Bitwise or
+			rd = rs | rt;
+			break;
+		case op_id::bgez: // BGEZ -- Branch On Greater Than Or Equal To Zero
+			if (static_cast<int32_t>(rs) >= 0) {
+				npc = pc + i.imm;
+			}
+			break;
+		case op_id::bgezal: { // BGEZAL -- Branch On Greater Than Or Equal To Zero And Link
+			bool c = static_cast<int32_t>(rs) >= 0;
+			regs[31] = npc;
+			if (c) {
+				npc = pc + i.imm;
+			}
+			break;
+		}
+		case op_id::bltz: // BLTZ -- Branch On Less Than Zero
+			if (static_cast<int32_t>(rs) < 0) {
+				npc = pc + i.imm;
+			}
+			break;
+		case op_id::bltzal: { // BLTZAL -- Branch On Less Than Zero And Link
+			bool c = static_cast<int32_t>(rs) < 0;
+			regs[31] = npc;
+			if (c) {
+				npc = pc + i.imm;
+			}
+			break;
+		}
+		case op_id::jal: // JAL -- Jump And Link
+			regs[31] = npc;
+			[[fallthrough]];
+		case op_id::j: // J -- Jump
+			npc = (pc & 0xf000'0000) | i.target;
+			break;
+		case op_id::beq: // BEQ -- Branch On Equal
+			if (rs == rt) {
+				npc = pc + i.imm;
+			}
+			break;
+		case op_id::bne: // BNE -- Branch On Not Equal
+			if (rs != rt) {
+				npc = pc + i.imm;
+			}
+			break;
+		case op_id::blez: // BLEZ -- Branch On Less Than Or Equal To Zero
+			if (static_cast<int32_t>(rs) <= 0) {
+				npc = pc + i.imm;
+			}
+			break;
+		case op_id::bgtz: // BGTZ -- Branch On Greater Than Zero
+			if (static_cast<int32_t>(rs) > 0) {
+				npc = pc + i.imm;
+			}
+			break;
+		case op_id::addi: // ADDI -- Add Immediate Word
+			add_with_overflow(rt, rs, i.imm);
+			break;
+		case op_id::addiu: // ADDIU -- Add immediate unsigned (no overflow)
+			rt = rs + i.imm;
+			break;
+		case op_id::slti: // SLTI -- Set On Less Than Immediate
+			rt = static_cast<int32_t>(rs) < i.imm ? 1 : 0;
+			break;
+		case op_id::sltiu: // SLTIU -- Set On Less Than Immediate Unsigned
+			rt = rs < static_cast<uint32_t>(i.imm) ? 1 : 0;
+			break;
+		case op_id::andi: // ANDI -- And Immediate
+			rt = rs & i.uimm;
+			break;
+		case op_id::ori: // ORI -- Bitwise or immediate
+			rt = rs | i.uimm;
+			break;
+		case op_id::lui: // LUI -- Load upper immediate
+			rt = i.uimm << 16;
+			break;
+		case op_id::lb: // LB -- Load byte
+			rt = sx(read<uint8_t>(rs + i.imm), 8);
+			break;
+		case op_id::lh: // LH -- Load Halfword
+			rt = sx(read<uint16_t>(rs + i.imm), 16);
+			break;
+		case op_id::lw: // LW -- Load word
+			rt = read<uint32_t>(rs + i.imm);
+			break;
+		case op_id::lbu: // LBU -- Load Byte Unsigned
+			rt = read<uint8_t>(rs + i.imm);
+			break;
+		case op_id::lhu: // LHU -- Load Halfword Unsigned
+			rt = read<uint16_t>(rs + i.imm);
+			break;
+		case op_id::sb: // SB -- Store Byte
+			write(rs + i.imm, static_cast<uint8_t>(rt));
+			break;
+		case op_id::sh: // SH -- Store Halfword
+			write(rs + i.imm, static_cast<uint16_t>(rt));
+			break;
+		case op_id::sw: // SW -- Store word
+			write(rs + i.imm, rt);
+			break;
+		case op_id::cop0: // COP0
+			run_cop(cop0, i);
+			break;
+		case op_id::lwc2: // LWC2 -- Load Word To Coprocessor 2
+			cop2.write(i.rt, read<uint32_t>(rs + i.imm));
+			break;
+		case op_id::swc2: // SWC2 -- Store Word From Coprocessor 2
+			write(rs + i.imm, cop2.read(i.rt));
+			break;
+		case op_id::cop2: // COP2
+			run_gte(i);
+			break;
+		case op_id::cop_unusable: // COP1, COP3
+			log->warn("[CPU] instruction for unavailable coprocessor {}", i.ins.cop_n());
+			break;
+		case op_id::unknown:
+			log->critical("[CPU] unimplemented instruction pc={:0>8x} clock={} opcode={:0>#2x} funct={:0>#2x}",
+			              pc,
+			              clock,
+			              i.ins.opcode(),
+			              i.ins.funct());
+			halt(99);
 		}
 	}
 
+	template <size_t... Ix>
+	constexpr std::array<mips::handler, sizeof...(Ix)> mips::make_handlers(std::index_sequence<Ix...>) {
+		return {[](mips& cpu, instruction const& i) { cpu.execute<static_cast<op_id>(Ix)>(i); }...};
+	}
+
+	const std::array<mips::handler, op_count> mips::handlers = make_handlers(std::make_index_sequence<op_count>{});
+
 	template <typename Coprocessor>
-	void mips::run_cop(Coprocessor& cop) {
+	void mips::run_cop(Coprocessor& cop, instruction const& i) {
 		using psycris::log;
 
-		if (ins.is_cop_fn()) {
-			switch (ins.cop_fn()) {
-			case 0x10: { // RFE -- Restore from Exception
-				uint32_t& sr = cop.sr();
-				sr |= (sr & 0x3c) >> 2;
+		if (i.ins.is_cop_fn()) {
+			switch (i.ins.cop_fn()) {
+			case 0x10: // RFE -- Restore from Exception
+				cop.restore_from_exception();
+				check_interrupts();
 				break;
-			}
 			default:
-				log->critical("[CPU][COP] unimplemented 'cop command' {}", ins.cop_fn());
+				log->critical("[CPU][COP] unimplemented 'cop command' {}", i.ins.cop_fn());
 				assert(0);
 			}
 			return;
 		}
 
-		switch (ins.cop_subop()) {
+		switch (i.ins.cop_subop()) {
 		case 0x00: // MFC
-			rt() = cop.regs[ins.rd()];
+			regs[i.rt] = cop.regs[i.rd];
 			break;
 		case 0x04: // MTC
-			log->info("[CPU][COP] PC={:0>8x}@{} reg{} = 0x{:0>8x}", pc - 4, clock, ins.rd(), rt());
-			cop.regs[ins.rd()] = rt();
+			log->info("[CPU][COP] PC={:0>8x}@{} reg{} = 0x{:0>8x}", pc - 4, clock, i.rd, regs[i.rt]);
+			if constexpr (std::is_same_v<Coprocessor, cpu::cop0>) {
+				uint32_t const old_value = cop.regs[i.rd];
+				cop.regs[i.rd] = regs[i.rt];
+				switch (i.rd) {
+				case cop0::Cause:
+					// only the two software interrupts can be written
+					cop.cause() = (old_value & ~0x300u) | (regs[i.rt] & 0x300);
+					check_interrupts();
+					break;
+				case cop0::SR:
+					check_interrupts();
+					break;
+				case cop0::BPC:
+				case cop0::BDA:
+				case cop0::DCIC:
+				case cop0::BDAM:
+				case cop0::BPCM:
+					program_breakpoints();
+				}
+			} else {
+				cop.regs[i.rd] = regs[i.rt];
+			}
 			break;
 		default:
 			log->warn("[CPU][COP] unimplemented instruction");
@@ -312,8 +640,47 @@ namespace cpu {
 		}
 	}
 
+	void mips::run_gte(instruction const& i) {
+		if (i.ins.is_cop_fn()) {
+			cop2.command(i.ins.cop_fn());
+			return;
+		}
+
+		switch (i.ins.cop_subop()) {
+		case 0x00: // MFC2
+			regs[i.rt] = cop2.read(i.rd);
+			break;
+		case 0x02: // CFC2
+			regs[i.rt] = cop2.read(i.rd + 32);
+			break;
+		case 0x04: // MTC2
+			cop2.write(i.rd, regs[i.rt]);
+			break;
+		case 0x06: // CTC2
+			cop2.write(i.rd + 32, regs[i.rt]);
+			break;
+		default:
+			psycris::log->warn("[CPU][GTE] unimplemented instruction {:0>8x}", i.ins.ins);
+			break;
+		}
+	}
+
+	void mips::map_scratchpad(gsl::span<uint8_t> memory) {
+		assert(memory.empty() || memory.size() == scratchpad_size);
+		scratchpad_memory = memory.empty() ? nullptr : memory.data();
+		update_scratchpad();
+	}
+
+	void mips::map_fastmem(bus::fastmem const* view) {
+		fastmem_view = view;
+		// the host code is generated for a given view
+		jit.reset();
+	}
+
 	uint64_t mips::ticks() const { return clock; }
 
+	uint64_t mips::idle_ticks() const { return idle.skipped; }
+
 	template <typename T>
 	T mips::read(uint32_t addr) const {
 		constexpr uint8_t mask = bus_align<sizeof(T)>::mask;
@@ -321,6 +688,12 @@ namespace cpu {
 			psycris::log->error("unaligned read at 0x{:0>8x} (TODO raise hw exception)", addr);
 			addr &= ~mask;
 		}
+
+		if (uint8_t const* host = scratchpad_ptr(addr)) {
+			T value;
+			std::memcpy(&value, host, sizeof(T));
+			return value;
+		}
 		return bus->read<T>(addr);
 	}
 
@@ -343,14 +716,20 @@ namespace cpu {
 			return;
 		}
 
+		if (uint8_t* host = scratchpad_ptr(addr)) {
+			std::memcpy(host, &val, sizeof(T));
+			return;
+		}
 		bus->write(addr, val);
 	}
 
-	uint32_t& mips::rs() { return regs[ins.rs()]; }
-
-	uint32_t& mips::rt() { return regs[ins.rt()]; }
-
-	uint32_t& mips::rd() { return regs[ins.rd()]; }
+	// used by the recompiler helpers
+	template uint8_t mips::read<uint8_t>(uint32_t) const;
+	template uint16_t mips::read<uint16_t>(uint32_t) const;
+	template uint32_t mips::read<uint32_t>(uint32_t) const;
+	template void mips::write<uint8_t>(uint32_t, uint8_t) const;
+	template void mips::write<uint16_t>(uint32_t, uint16_t) const;
+	template void mips::write<uint32_t>(uint32_t, uint32_t) const;
 
 	uint32_t& mips::hi() { return mult_regs[1]; }
 
@@ -361,8 +740,8 @@ namespace cpu {
 		uint32_t r;
 		if (__builtin_add_overflow(a, b, &r)) {
 			psycris::log->critical("integer overflow, TODO raise hw exception");
-			std::exit(99);
-			// return std::nullopt;
+			halt(99);
+			return;
 		}
 		c = r;
 	}
@@ -379,6 +758,7 @@ namespace cpu {
 		w(cpu.regs);
 		w(cpu.mult_regs);
 		w(cpu.cop0.regs);
+		w(cpu.cop2.regs);
 	}
 
 	void restore_cpu(std::istream& f, mips& cpu) {
@@ -393,7 +773,14 @@ namespace cpu {
 		r(cpu.regs);
 		r(cpu.mult_regs);
 		r(cpu.cop0.regs);
+		r(cpu.cop2.regs);
+
+		// the memory is about to be overwritten behind the bus
+		cpu.blocks.clear();
+		cpu.idle.b = nullptr;
 
-		cpu.clock--;
+		cpu.debug_pending = false;
+		cpu.program_breakpoints();
+		cpu.cop0.update_interrupts();
 	}
 }
\ No newline at end of file
@@ -1,19 +1,31 @@
 #pragma once
 #include "../hw/bus.hpp"
+#include "block_cache.hpp"
 #include "cop0.hpp"
 #include "decoder.hpp"
+#include "gte.hpp"
+#include "instruction.hpp"
+#include "opcodes.hpp"
+#include "recompiler.hpp"
+#include "tracing.hpp"
 
 #include <array>
 #include <cstdint>
 #include <iosfwd>
+#include <map>
+#include <memory>
+#include <optional>
+#include <utility>
 
 namespace bus = psycris::bus;
 
 namespace cpu {
-	class mips {
+	class mips : private bus::watch_listener {
 	  public:
 		static const uint32_t exc_vector = 0x8000'0080;
 		static const uint32_t rom_exc_vector = 0xbfc0'0180;
+		static const uint32_t dbg_vector = 0x8000'0040;
+		static const uint32_t rom_dbg_vector = 0xbfc0'0140;
 		static const uint32_t reset_vector = 0x1FC0'0000;
 
 		static const uint32_t noop = 0;
@@ -21,21 +33,248 @@ namespace cpu {
 	  public:
 		mips(bus::data_bus&);
 
+		~mips() override;
+
+		mips(mips const&) = delete;
+		mips& operator=(mips const&) = delete;
+
 	  public:
 		void reset();
 
 		void trap(cop0::exc_code);
 
+		/**
+		 * \brief stops the cpu after an unrecoverable error
+		 *
+		 * The current run ends after the current instruction; the board does
+		 * not run a halted cpu anymore (until a `reset`).
+		 */
+		void halt(int status);
+
+		/**
+		 * \brief the status passed to `halt`, 0 if the cpu is not halted
+		 */
+		int halted() const { return halt_status; }
+
+		/**
+		 * \brief drives the output of the interrupt controller, the hardware
+		 * interrupt 0 of the cop0
+		 *
+		 * A change that makes an interrupt pending ends the current run; the
+		 * interrupt is taken at the start of the next one, see `start_run`.
+		 */
+		void interrupt_line(bool asserted);
+
+		/**
+		 * \brief runs the cpu, fetching and decoding every instruction
+		 *
+		 * Every instruction is reported to the tracing policy `Trace`, see
+		 * `no_trace`.
+		 */
+		template <typename Trace = no_trace>
 		void run(uint64_t until);
 
+		/**
+		 * \brief runs the cpu executing the blocks in the `block_cache`
+		 *
+		 * The observable behavior is the same as `run`, but the code in the
+		 * memory pages is decoded only once.
+		 */
+		void run_cached(uint64_t until);
+
+		/**
+		 * \brief runs the cpu translating the blocks into host code
+		 *
+		 * The observable behavior is the same as `run`; the blocks that
+		 * cannot be executed as a whole (because they are entered in a delay
+		 * slot, they are too long for the ticks left or they lie outside the
+		 * memory pages) are interpreted. See `recompiler`.
+		 */
+		void run_jit(uint64_t until);
+
+		/**
+		 * \brief ends the current run no later than the tick `t`
+		 *
+		 * Used by the devices that schedule an event while the cpu is
+		 * running; the block engines stop after the instruction that reaches
+		 * `t`, exactly like the plain interpreter.
+		 */
+		void stop_at(uint64_t t);
+
+		/**
+		 * \brief the tick where the current (or the last) run ends
+		 */
+		uint64_t deadline() const;
+
+		/**
+		 * \brief a watchpoint hit that ended a run, see `watch`
+		 */
+		struct watch_hit {
+			uint32_t id;
+			bus::access::kind kind;
+			uint32_t addr;
+			uint8_t size;
+		};
+
+		/**
+		 * \brief ends the run at an access of the given `kinds` (see
+		 * `bus::access`) to the range `r`
+		 *
+		 * A load or a store ends the run after the instruction that performs
+		 * it; an instruction fetch ends the run before the instruction is
+		 * executed, the next run starts from it. The watched range is made
+		 * of bus addresses, the scratchpad included.
+		 *
+		 * \return the id of the watchpoint, see `unwatch`
+		 */
+		uint32_t watch(bus::address_range r, uint8_t kinds);
+
+		void unwatch(uint32_t id);
+
+		/**
+		 * \brief the watchpoint hit that ended the last run, if any
+		 *
+		 * The board does not start another slice after a hit; the next run
+		 * resumes the cpu.
+		 */
+		std::optional<watch_hit> const& stopped_by() const { return stop; }
+
+		/**
+		 * \brief the recorder used by `run<binary_trace>`
+		 *
+		 * The recorder is not owned by the cpu.
+		 */
+		void record_to(trace_recorder* r) { rec = r; }
+
+		trace_recorder* recorder() const { return rec; }
+
+		/**
+		 * \brief the profiler used by `run<profile>`
+		 *
+		 * The profiler is not owned by the cpu.
+		 */
+		void profile_with(profiler* p) { prof = p; }
+
+		profiler* profiled_by() const { return prof; }
+
+		/**
+		 * \brief serves the loads and stores to the scratchpad from `memory`
+		 *
+		 * The scratchpad (1KiB at 1F800000h and 9F800000h) is the data cache
+		 * used as fast RAM; its accesses skip the bus. `memory` is not owned
+		 * by the cpu, an empty span sends the accesses back to the bus.
+		 */
+		void map_scratchpad(gsl::span<uint8_t> memory);
+
+		/**
+		 * \brief lets the recompiler access the memory through `view`
+		 *
+		 * The loads and stores of the host code go straight to `view`, the
+		 * ones that fault there are completed through the bus (see
+		 * `recompiler`). `view` is not owned by the cpu, nullptr sends all
+		 * the accesses back to the bus.
+		 */
+		void map_fastmem(bus::fastmem const* view);
+
+		bus::fastmem const* fastmem() const { return fastmem_view; }
+
 	  public:
 		uint64_t ticks() const;
 
+		/**
+		 * \brief the ticks skipped by the idle loop detection
+		 */
+		uint64_t idle_ticks() const;
+
 	  private:
-		uint32_t& rs();
-		uint32_t& rt();
-		uint32_t& rd();
+		/**
+		 * \brief executes the current instruction
+		 *
+		 * When this method is called `pc` points to the delay slot and `npc`
+		 * to the instruction after it.
+		 */
+		void execute(instruction const& i) { handlers[static_cast<size_t>(i.id)](*this, i); }
 
+		/**
+		 * \brief the implementation of the instruction `Id`
+		 */
+		template <op_id Id>
+		void execute(instruction const&);
+
+		using handler = void (*)(mips&, instruction const&);
+
+		// the handler of every instruction, indexed by `op_id`
+		static const std::array<handler, op_count> handlers;
+
+		template <size_t... Ix>
+		static constexpr std::array<handler, sizeof...(Ix)> make_handlers(std::index_sequence<Ix...>);
+
+		/**
+		 * \brief executes the instruction already fetched in `ins`
+		 *
+		 * Afterwards `pc` is the address of the current instruction, as
+		 * expected by `interpret`.
+		 */
+		void execute_fetched();
+
+		/**
+		 * \brief executes the block `b` starting from the current instruction
+		 */
+		void interpret(block const& b);
+
+		/**
+		 * \brief skips the iterations of an idle loop
+		 *
+		 * Called after the whole block `b`, entered at `start`, has been
+		 * executed. A polling block (see `block::polling`) that jumps back to
+		 * its start leaving the registers as they were at the end of the
+		 * previous iteration, without reading from a device, is an idle loop:
+		 * with the same memory all the next iterations are the same, so the
+		 * clock is advanced by as many whole iterations as fit before the end
+		 * of the run. A device read (an I/O port, see `data_bus::device_reads`)
+		 * can change at every tick, such a loop is always executed.
+		 */
+		void skip_idle(block const& b, uint32_t start);
+
+		/**
+		 * \brief the common start of all the engines
+		 *
+		 * A hardware breakpoint hit during the previous run raises its debug
+		 * exception here, before the current instruction is executed; then a
+		 * pending interrupt is taken the same way. This is the only place
+		 * where the interrupts are checked.
+		 */
+		void start_run(uint64_t until);
+
+		/**
+		 * \brief ends the current run if an interrupt became pending, after a
+		 * change of SR or Cause
+		 */
+		void check_interrupts();
+
+		void hit(uint32_t id, uint32_t addr, uint8_t size, bus::access::kind kind) override;
+
+		/**
+		 * \brief updates the watchpoints of the hardware breakpoints after a
+		 * change of the COP0 debug registers
+		 *
+		 * An enabled breakpoint watches the range that covers all the
+		 * addresses selected by its mask; the hits are filtered again with
+		 * the mask.
+		 */
+		void program_breakpoints();
+
+		uint32_t add_watchpoint(bus::address_range r, uint8_t kinds);
+
+		void remove_watchpoint(uint32_t id);
+
+		/**
+		 * \brief sends the scratchpad accesses to the bus while a watchpoint
+		 * covers the scratchpad
+		 */
+		void update_scratchpad();
+
+	  private:
 		uint32_t& hi();
 		uint32_t& lo();
 
@@ -58,13 +297,27 @@ namespace cpu {
 		template <typename T>
 		void write(uint32_t, T) const;
 
+		/**
+		 * \brief the host memory of a scratchpad address, nullptr if `addr`
+		 * is not in the scratchpad
+		 */
+		uint8_t* scratchpad_ptr(uint32_t addr) const {
+			constexpr uint32_t mask = ~(scratchpad_size - 1) & 0x7fff'ffff;
+			if (scratchpad == nullptr || (addr & mask) != 0x1f80'0000) {
+				return nullptr;
+			}
+			return scratchpad + (addr & (scratchpad_size - 1));
+		}
+
 	  private:
 		template <typename B>
 		void add_with_overflow(uint32_t& c, uint32_t a, B b);
 
 	  private:
 		template <typename Coprocessor>
-		void run_cop(Coprocessor&);
+		void run_cop(Coprocessor&, instruction const&);
+
+		void run_gte(instruction const&);
 
 	  public:
 		std::array<uint32_t, 32> regs;
@@ -78,11 +331,38 @@ namespace cpu {
 
 		cpu::cop0 cop0;
 
+		cpu::gte cop2;
+
 	  private:
 		uint64_t clock;
 
+		// the end of the current run
+		uint64_t slice_end;
+
+		int halt_status;
+
 		bus::data_bus* bus;
 
+		static constexpr uint32_t scratchpad_size = 1024;
+		// the memory given to `map_scratchpad`; `scratchpad` is nullptr
+		// while the scratchpad is watched
+		uint8_t* scratchpad_memory;
+		uint8_t* scratchpad;
+
+		bus::fastmem const* fastmem_view;
+
+		// the range of every watchpoint, the hardware breakpoints included
+		std::map<uint32_t, bus::address_range> watched;
+
+		std::optional<watch_hit> stop;
+
+		// the watchpoints of the hardware breakpoints, 0 if disabled
+		uint32_t code_breakpoint;
+		uint32_t data_breakpoint;
+
+		// a hardware breakpoint has been hit, see `start_run`
+		bool debug_pending;
+
 		// the current instruction; the one executed during this clock cycle
 		decoder ins;
 		// the pc of the current instruction
@@ -97,6 +377,27 @@ namespace cpu {
 		decoder next_ins;
 		uint32_t npc;
 
+		block_cache blocks;
+
+		std::unique_ptr<recompiler> jit;
+
+		trace_recorder* rec;
+		profiler* prof;
+
+		// the state at the end of the last iteration of a polling loop
+		struct {
+			block const* b;
+			uint32_t start;
+			std::array<uint32_t, 32> regs;
+			std::array<uint32_t, 2> mult_regs;
+			// `data_bus::device_reads` at the end of the last iteration
+			uint64_t device_reads;
+
+			uint64_t skipped;
+		} idle;
+
+		friend class recompiler;
+		friend class translator;
 		friend void dump_cpu(std::ostream&, mips const&);
 		friend void restore_cpu(std::istream&, mips&);
 	};
@@ -116,6 +417,7 @@ namespace cpu {
 	 * | 24     | regs[0..31]         | 128
 	 * | 152    | mult regs (lo/hi)   | 8
 	 * | 160    | cop0 regs[0..31]    | 128
+	 * | 288    | cop2 (gte) regs     | sizeof(gte::registers)
 	 *
 	 */
 	void dump_cpu(std::ostream&, mips const&);
@@ -1,9 +1,11 @@
 #include "disassembly.hpp"
 #include "../logging.hpp"
 #include "decoder.hpp"
+#include "gte.hpp"
+#include "opcodes.hpp"
 #include <fmt/format.h>
 #include <fmt/ostream.h>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 namespace {
@@ -103,98 +105,14 @@ namespace {
 }
 
 namespace {
-	// clang-format off
-	std::unordered_map<uint8_t, std::string> iu_ins{
-        {0x02, "j {target}"},
-        {0x03, "jal {target}"},
-        {0x04, "beq {rs}, {rt}, {j_rel}"},
-        {0x05, "bne {rs}, {rt}, {j_rel}"},
-        {0x06, "blez {rs}, {j_rel}"},
-        {0x07, "bgtz {rs}, {j_rel}"},
-        {0x08, "addi {rs}, {rt}, {imm16}"},
-        {0x09, "addiu {rt}, {rs}, {imm16}"},
-        {0x0a, "slti {rt}, {rs}, {imm16}"},
-        {0x0b, "sltiu {rt}, {rs}, {imm16}"},
-        {0x0c, "andi {rt}, {rs}, {imm16}"},
-		{0x0d, "ori {rt}, {rs}, {imm16}"},
-        {0x0f, "lui {rt}, {imm16}"},
-        {0x20, "lb {rt}, {rs} + {imm16}"},
-        {0x21, "lh {rt}, {rs} + {imm16}"},
-        {0x23, "lw {rt}, {rs} + {imm16}"},
-        {0x24, "lbu {rt}, {rs} + {imm16}"},
-        {0x25, "lhu {rt}, {rs} + {imm16}"},
-        {0x28, "sb {rt}, {rs} + {imm16}"},
-        {0x29, "sh {rt}, {rs} + {imm16}"},
-		{0x2b, "sw {rt}, {rs} + {imm16}"},
-    };
-
-    std::unordered_map<uint8_t, std::string> iu_funct_ins{
-		{0x00, "sll {rd}, {rt}, {imm5}"},
-		{0x02, "srl {rd}, {rt}, {imm5}"},
-		{0x03, "sra {rd}, {rt}, {shamt}"},
-		{0x04, "sllv {rd}, {rt}, {rs}"},
-		{0x07, "srav {rd}, {rt}, {rs}"},
-		{0x08, "jr {rs}"},
-		{0x09, "jalr {rd}, {rs}"},
-		{0x0c, "syscall"},
-        {0x10, "mfhi {rd}"},
-        {0x11, "mthi {rs}"},
-        {0x12, "mflo {rd}"},
-        {0x13, "mtlo {rs}"},
-        {0x18, "mult {rs}, {rt}"},
-        {0x19, "multu {rs}, {rt}"},
-        {0x1a, "div {rs}, {rt}"},
-        {0x1b, "divu {rs}, {rt}"},
-		{0x20, "add {rd}, {rs}, {rt}"},
-		{0x21, "addu {rd}, {rs}, {rt}"},
-		{0x23, "subu {rd}, {rs}, {rt}"},
-		{0x24, "and {rd}, {rs}, {rt}"},
-		{0x25, "or {rd}, {rs}, {rt}"},
-        {0x27, "nor {rd}, {rs}, {rt}"},
-		{0x2a, "slt {rd}, {rs}, {rt}"},
-		{0x2b, "sltu {rd}, {rs}, {rt}"},
-    };
-	// clang-format on
-
 	std::string integer_unit(::decoder dec, uint32_t pc) {
-		std::string fmt;
-		{
-			auto r = iu_ins.find(dec.opcode());
-			if (r != iu_ins.end()) {
-				fmt = r->second;
-			}
-		}
+		std::string_view fmt = cpu::describe(cpu::identify(dec)).format;
 
-		if (fmt == "" && dec.opcode() == 0) {
-			// the opcode 0 is shared, we need to check the funct value
-			if (dec.ins == 0) {
-				fmt = "noop";
-			} else if (dec.funct() == 0x25 && dec.rs() == 0 && dec.rt() == 0) {
-				fmt = "move {rd}, zero";
-			} else {
-				auto r = iu_funct_ins.find(dec.funct());
-				if (r != iu_funct_ins.end()) {
-					fmt = r->second;
-				}
-			}
-		}
-
-		if (fmt == "" && dec.opcode() == 1) {
-			// the opcode 1 is shared, we need to check the rt value
-			switch (dec.rt()) {
-			case 0x01:
-				fmt = "bgez {rs}, {j_rel}";
-				break;
-			case 0x11:
-				fmt = "bgezal {rs}, {j_rel}";
-				break;
-			case 0x00:
-				fmt = "bltz {rs}, {j_rel}";
-				break;
-			case 0x10:
-				fmt = "bltzal {rs}, {j_rel}";
-				break;
-			}
+		// a couple of common idioms
+		if (dec.ins == 0) {
+			fmt = "noop";
+		} else if (dec.opcode() == 0 && dec.funct() == 0x25 && dec.rs() == 0 && dec.rt() == 0) {
+			fmt = "move {rd}, zero";
 		}
 
 		using namespace fmt::literals;
@@ -202,6 +120,7 @@ namespace {
 		                   "rt"_a = dec.rt(),
 		                   "rd"_a = dec.rd(),
 		                   "rs"_a = dec.rs(),
+		                   "crt"_a = cop_reg{static_cast<uint8_t>(dec.opcode() & 0x3), dec.rt()},
 		                   "shamt"_a = dec.shamt(),
 		                   "imm5"_a = dec.shamt(),
 		                   "imm16"_a = dec.uimm(),
@@ -220,9 +139,20 @@ namespace {
 			case 0x00:
 				fmt = "mfc{cn} {rt}, {rd}";
 				break;
+			case 0x02:
+				fmt = "cfc{cn} {rt}, {rd}";
+				break;
 			case 0x04:
 				fmt = "mtc{cn} {rt}, {rd}";
 				break;
+			case 0x06:
+				fmt = "ctc{cn} {rt}, {rd}";
+				break;
+			}
+		} else if (dec.cop_n() == 2) {
+			fmt = cpu::gte::command_name(dec.cop_fn());
+			if (!fmt.empty()) {
+				fmt += " {cmd:#x}";
 			}
 		} else {
 			switch (dec.cop_fn()) {
@@ -236,7 +166,8 @@ namespace {
 		return fmt::format(fmt,                                     //
 		                   "rd"_a = cop_reg{dec.cop_n(), dec.rd()}, //
 		                   "rt"_a = dec.rt(),                       //
-		                   "cn"_a = dec.cop_n());                   //
+		                   "cn"_a = dec.cop_n(),                    //
+		                   "cmd"_a = dec.cop_fn());                 //
 	}
 }
 
@@ -0,0 +1,885 @@
+#include "gte.hpp"
+
+#include <algorithm>
+
+namespace {
+	using cpu::gte;
+
+	// clang-format off
+	namespace flag {
+		constexpr uint32_t error = 1u << 31;
+		constexpr uint32_t mac_pos[] = {0, 1u << 30, 1u << 29, 1u << 28};
+		constexpr uint32_t mac_neg[] = {0, 1u << 27, 1u << 26, 1u << 25};
+		constexpr uint32_t ir[] = {1u << 12, 1u << 24, 1u << 23, 1u << 22};
+		constexpr uint32_t color[] = {0, 1u << 21, 1u << 20, 1u << 19};
+		constexpr uint32_t sz_otz = 1u << 18;
+		constexpr uint32_t divide = 1u << 17;
+		constexpr uint32_t mac0_pos = 1u << 16;
+		constexpr uint32_t mac0_neg = 1u << 15;
+		constexpr uint32_t sx2 = 1u << 14;
+		constexpr uint32_t sy2 = 1u << 13;
+
+		// the bits summarized by `error`
+		constexpr uint32_t error_bits = 0x7f87'e000;
+		constexpr uint32_t writable = 0x7fff'f000;
+	}
+	// clang-format on
+
+	constexpr std::array<uint8_t, 257> make_unr_table() {
+		std::array<uint8_t, 257> t{};
+		for (int i = 0; i < 257; i++) {
+			t[i] = static_cast<uint8_t>(std::max(0, (0x40000 / (i + 0x100) + 1) / 2 - 0x101));
+		}
+		return t;
+	}
+
+	// the table of the reciprocals used by the GTE division
+	constexpr auto unr_table = make_unr_table();
+
+	uint32_t pack(int16_t lo, int16_t hi) {
+		return static_cast<uint16_t>(lo) | static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16;
+	}
+
+	uint32_t pack(std::array<uint8_t, 4> const& c) { return c[0] | c[1] << 8 | c[2] << 16 | c[3] << 24; }
+
+	std::array<uint8_t, 4> unpack(uint32_t v) {
+		return {static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v >> 16),
+		        static_cast<uint8_t>(v >> 24)};
+	}
+
+	int16_t lo16(uint32_t v) { return static_cast<int16_t>(v); }
+	int16_t hi16(uint32_t v) { return static_cast<int16_t>(v >> 16); }
+
+	int32_t sext16(int16_t v) { return v; }
+
+	// a matrix is stored in 4 registers with two elements each, plus a
+	// register for the last element
+	uint32_t read_matrix(gte::matrix const& m, int reg) { return reg < 4 ? pack(m[2 * reg], m[2 * reg + 1]) : m[8]; }
+
+	void write_matrix(gte::matrix& m, int reg, uint32_t v) {
+		if (reg < 4) {
+			m[2 * reg] = lo16(v);
+			m[2 * reg + 1] = hi16(v);
+		} else {
+			m[8] = lo16(v);
+		}
+	}
+
+	int64_t shl(int64_t v, int bits) { return static_cast<int64_t>(static_cast<uint64_t>(v) << bits); }
+
+	constexpr std::array<int32_t, 3> no_translation = {0, 0, 0};
+}
+
+namespace cpu {
+	gte::isa gte::best_isa() {
+		if (supported(isa::avx2)) {
+			return isa::avx2;
+		}
+		if (supported(isa::sse4)) {
+			return isa::sse4;
+		}
+		return isa::scalar;
+	}
+
+	bool gte::supported(isa i) {
+#if defined(__x86_64__)
+		// the benchmarks and the tests may ask before the static constructors
+		__builtin_cpu_init();
+#endif
+		switch (i) {
+#if defined(__x86_64__)
+		case isa::avx2:
+			return __builtin_cpu_supports("avx2");
+		case isa::sse4:
+			return __builtin_cpu_supports("sse4.1");
+#endif
+		case isa::scalar:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	std::string_view gte::command_name(uint32_t cmd) {
+		switch (cmd & 0x3f) {
+		case 0x01:
+			return "rtps";
+		case 0x06:
+			return "nclip";
+		case 0x0c:
+			return "op";
+		case 0x10:
+			return "dpcs";
+		case 0x11:
+			return "intpl";
+		case 0x12:
+			return "mvmva";
+		case 0x13:
+			return "ncds";
+		case 0x14:
+			return "cdp";
+		case 0x16:
+			return "ncdt";
+		case 0x1b:
+			return "nccs";
+		case 0x1c:
+			return "cc";
+		case 0x1e:
+			return "ncs";
+		case 0x20:
+			return "nct";
+		case 0x28:
+			return "sqr";
+		case 0x29:
+			return "dcpl";
+		case 0x2a:
+			return "dpct";
+		case 0x2d:
+			return "avsz3";
+		case 0x2e:
+			return "avsz4";
+		case 0x30:
+			return "rtpt";
+		case 0x3d:
+			return "gpf";
+		case 0x3e:
+			return "gpl";
+		case 0x3f:
+			return "ncct";
+		default:
+			return "";
+		}
+	}
+
+	gte::gte() {
+		reset();
+		use(best_isa());
+	}
+
+	void gte::reset() { regs = {}; }
+
+	void gte::use(isa i) {
+		kernel_isa = i;
+		switch (i) {
+		case isa::avx2:
+			mat_vec_kernel = gte_kernels::mat_vec_avx2;
+			break;
+		case isa::sse4:
+			mat_vec_kernel = gte_kernels::mat_vec_sse4;
+			break;
+		default:
+			mat_vec_kernel = gte_kernels::mat_vec_scalar;
+			break;
+		}
+	}
+}
+
+namespace cpu {
+	uint32_t gte::read(uint8_t reg) const {
+		auto const& r = regs;
+		switch (reg) {
+		case 0:
+		case 2:
+		case 4:
+			return pack(r.v[reg / 2][0], r.v[reg / 2][1]);
+		case 1:
+		case 3:
+		case 5:
+			return sext16(r.v[reg / 2][2]);
+		case 6:
+			return pack(r.rgbc);
+		case 7:
+			return r.otz;
+		case 8:
+		case 9:
+		case 10:
+		case 11:
+			return sext16(r.ir[reg - 8]);
+		case 12:
+		case 13:
+		case 14:
+			return pack(r.sxy[reg - 12][0], r.sxy[reg - 12][1]);
+		case 15:
+			return pack(r.sxy[2][0], r.sxy[2][1]);
+		case 16:
+		case 17:
+		case 18:
+		case 19:
+			return r.sz[reg - 16];
+		case 20:
+		case 21:
+		case 22:
+			return pack(r.rgb[reg - 20]);
+		case 23:
+			return r.res1;
+		case 24:
+		case 25:
+		case 26:
+		case 27:
+			return r.mac[reg - 24];
+		case 28:
+		case 29: {
+			// IRGB and ORGB read the IR registers as a 15 bit color
+			uint32_t c = 0;
+			for (int i = 1; i <= 3; i++) {
+				c |= static_cast<uint32_t>(std::clamp(r.ir[i] >> 7, 0, 0x1f)) << (5 * (i - 1));
+			}
+			return c;
+		}
+		case 30:
+			return r.lzcs;
+		case 31: {
+			// the leading bits equal to the sign bit
+			uint32_t v = static_cast<int32_t>(r.lzcs) < 0 ? ~r.lzcs : r.lzcs;
+			return v == 0 ? 32 : __builtin_clz(v);
+		}
+
+		case 32 + 0:
+		case 32 + 1:
+		case 32 + 2:
+		case 32 + 3:
+		case 32 + 4:
+			return read_matrix(r.rt, reg - 32);
+		case 32 + 5:
+		case 32 + 6:
+		case 32 + 7:
+			return r.tr[reg - 32 - 5];
+		case 32 + 8:
+		case 32 + 9:
+		case 32 + 10:
+		case 32 + 11:
+		case 32 + 12:
+			return read_matrix(r.llm, reg - 32 - 8);
+		case 32 + 13:
+		case 32 + 14:
+		case 32 + 15:
+			return r.bk[reg - 32 - 13];
+		case 32 + 16:
+		case 32 + 17:
+		case 32 + 18:
+		case 32 + 19:
+		case 32 + 20:
+			return read_matrix(r.lcm, reg - 32 - 16);
+		case 32 + 21:
+		case 32 + 22:
+		case 32 + 23:
+			return r.fc[reg - 32 - 21];
+		case 32 + 24:
+			return r.ofx;
+		case 32 + 25:
+			return r.ofy;
+		case 32 + 26:
+			// H is unsigned, but it is read sign-extended
+			return sext16(static_cast<int16_t>(r.h));
+		case 32 + 27:
+			return sext16(r.dqa);
+		case 32 + 28:
+			return r.dqb;
+		case 32 + 29:
+			return sext16(r.zsf3);
+		case 32 + 30:
+			return sext16(r.zsf4);
+		case 32 + 31:
+			return r.flag;
+		default:
+			return 0;
+		}
+	}
+
+	void gte::write(uint8_t reg, uint32_t value) {
+		auto& r = regs;
+		switch (reg) {
+		case 0:
+		case 2:
+		case 4:
+			r.v[reg / 2][0] = lo16(value);
+			r.v[reg / 2][1] = hi16(value);
+			break;
+		case 1:
+		case 3:
+		case 5:
+			r.v[reg / 2][2] = lo16(value);
+			break;
+		case 6:
+			r.rgbc = unpack(value);
+			break;
+		case 7:
+			r.otz = static_cast<uint16_t>(value);
+			break;
+		case 8:
+		case 9:
+		case 10:
+		case 11:
+			r.ir[reg - 8] = lo16(value);
+			break;
+		case 12:
+		case 13:
+		case 14:
+			r.sxy[reg - 12] = {lo16(value), hi16(value)};
+			break;
+		case 15:
+			// SXYP pushes a new value in the FIFO
+			r.sxy[0] = r.sxy[1];
+			r.sxy[1] = r.sxy[2];
+			r.sxy[2] = {lo16(value), hi16(value)};
+			break;
+		case 16:
+		case 17:
+		case 18:
+		case 19:
+			r.sz[reg - 16] = static_cast<uint16_t>(value);
+			break;
+		case 20:
+		case 21:
+		case 22:
+			r.rgb[reg - 20] = unpack(value);
+			break;
+		case 23:
+			r.res1 = value;
+			break;
+		case 24:
+		case 25:
+		case 26:
+		case 27:
+			r.mac[reg - 24] = static_cast<int32_t>(value);
+			break;
+		case 28:
+			for (int i = 1; i <= 3; i++) {
+				r.ir[i] = static_cast<int16_t>(((value >> (5 * (i - 1))) & 0x1f) * 0x80);
+			}
+			break;
+		case 29:
+		case 31:
+			// read only
+			break;
+		case 30:
+			r.lzcs = value;
+			break;
+
+		case 32 + 0:
+		case 32 + 1:
+		case 32 + 2:
+		case 32 + 3:
+		case 32 + 4:
+			write_matrix(r.rt, reg - 32, value);
+			break;
+		case 32 + 5:
+		case 32 + 6:
+		case 32 + 7:
+			r.tr[reg - 32 - 5] = static_cast<int32_t>(value);
+			break;
+		case 32 + 8:
+		case 32 + 9:
+		case 32 + 10:
+		case 32 + 11:
+		case 32 + 12:
+			write_matrix(r.llm, reg - 32 - 8, value);
+			break;
+		case 32 + 13:
+		case 32 + 14:
+		case 32 + 15:
+			r.bk[reg - 32 - 13] = static_cast<int32_t>(value);
+			break;
+		case 32 + 16:
+		case 32 + 17:
+		case 32 + 18:
+		case 32 + 19:
+		case 32 + 20:
+			write_matrix(r.lcm, reg - 32 - 16, value);
+			break;
+		case 32 + 21:
+		case 32 + 22:
+		case 32 + 23:
+			r.fc[reg - 32 - 21] = static_cast<int32_t>(value);
+			break;
+		case 32 + 24:
+			r.ofx = static_cast<int32_t>(value);
+			break;
+		case 32 + 25:
+			r.ofy = static_cast<int32_t>(value);
+			break;
+		case 32 + 26:
+			r.h = static_cast<uint16_t>(value);
+			break;
+		case 32 + 27:
+			r.dqa = lo16(value);
+			break;
+		case 32 + 28:
+			r.dqb = static_cast<int32_t>(value);
+			break;
+		case 32 + 29:
+			r.zsf3 = lo16(value);
+			break;
+		case 32 + 30:
+			r.zsf4 = lo16(value);
+			break;
+		case 32 + 31:
+			r.flag = value & flag::writable;
+			if (r.flag & flag::error_bits) {
+				r.flag |= flag::error;
+			}
+			break;
+		}
+	}
+}
+
+namespace cpu {
+	int64_t gte::check_mac(int ix, int64_t value) {
+		if (value > 0x7ff'ffff'ffffll) {
+			set_flag(flag::mac_pos[ix]);
+		} else if (value < -0x800'0000'0000ll) {
+			set_flag(flag::mac_neg[ix]);
+		}
+		return value;
+	}
+
+	int64_t gte::extend_mac(int ix, int64_t value) { return shl(check_mac(ix, value), 20) >> 20; }
+
+	void gte::set_mac(int ix, int64_t value, int shift) {
+		regs.mac[ix] = static_cast<int32_t>(check_mac(ix, value) >> shift);
+	}
+
+	void gte::set_ir(int ix, int32_t value, bool lm) {
+		int32_t low = lm ? 0 : -0x8000;
+		if (value < low) {
+			value = low;
+			set_flag(flag::ir[ix]);
+		} else if (value > 0x7fff) {
+			value = 0x7fff;
+			set_flag(flag::ir[ix]);
+		}
+		regs.ir[ix] = static_cast<int16_t>(value);
+	}
+
+	void gte::set_mac_ir(int ix, int64_t value, int shift, bool lm) {
+		set_mac(ix, value, shift);
+		set_ir(ix, regs.mac[ix], lm);
+	}
+
+	void gte::set_mac0(int64_t value) {
+		if (value > INT32_MAX) {
+			set_flag(flag::mac0_pos);
+		} else if (value < INT32_MIN) {
+			set_flag(flag::mac0_neg);
+		}
+		regs.mac[0] = static_cast<int32_t>(value);
+	}
+
+	void gte::set_ir0(int32_t value) {
+		if (value < 0 || value > 0x1000) {
+			value = std::clamp(value, 0, 0x1000);
+			set_flag(flag::ir[0]);
+		}
+		regs.ir[0] = static_cast<int16_t>(value);
+	}
+
+	void gte::push_sz(int32_t value) {
+		if (value < 0 || value > 0xffff) {
+			value = std::clamp(value, 0, 0xffff);
+			set_flag(flag::sz_otz);
+		}
+		regs.sz[0] = regs.sz[1];
+		regs.sz[1] = regs.sz[2];
+		regs.sz[2] = regs.sz[3];
+		regs.sz[3] = static_cast<uint16_t>(value);
+	}
+
+	void gte::push_sxy(int32_t x, int32_t y) {
+		if (x < -0x400 || x > 0x3ff) {
+			x = std::clamp(x, -0x400, 0x3ff);
+			set_flag(flag::sx2);
+		}
+		if (y < -0x400 || y > 0x3ff) {
+			y = std::clamp(y, -0x400, 0x3ff);
+			set_flag(flag::sy2);
+		}
+		regs.sxy[0] = regs.sxy[1];
+		regs.sxy[1] = regs.sxy[2];
+		regs.sxy[2] = {static_cast<int16_t>(x), static_cast<int16_t>(y)};
+	}
+
+	void gte::push_rgb() {
+		std::array<uint8_t, 4> c;
+		for (int i = 1; i <= 3; i++) {
+			int32_t v = regs.mac[i] >> 4;
+			if (v < 0 || v > 0xff) {
+				v = std::clamp(v, 0, 0xff);
+				set_flag(flag::color[i]);
+			}
+			c[i - 1] = static_cast<uint8_t>(v);
+		}
+		c[3] = regs.rgbc[3];
+
+		regs.rgb[0] = regs.rgb[1];
+		regs.rgb[1] = regs.rgb[2];
+		regs.rgb[2] = c;
+	}
+
+	uint32_t gte::divide() const {
+		// an approximation of (H * 0x20000 / SZ3 + 1) / 2, computed with
+		// the Newton-Raphson method as the hardware does
+		uint32_t h = regs.h;
+		uint32_t sz3 = regs.sz[3];
+
+		int z = __builtin_clz(sz3) - 16;
+		uint64_t n = static_cast<uint64_t>(h) << z;
+		uint32_t d = sz3 << z;
+		uint32_t u = unr_table[(d - 0x7fc0) >> 7] + 0x101;
+		d = (0x200'0080 - d * u) >> 8;
+		d = (0x000'0080 + d * u) >> 8;
+		return static_cast<uint32_t>(std::min<uint64_t>(0x1'ffff, (n * d + 0x8000) >> 16));
+	}
+
+	uint32_t gte::divide_flagged() {
+		if (regs.h < regs.sz[3] * 2) {
+			return divide();
+		}
+		set_flag(flag::divide);
+		return 0x1'ffff;
+	}
+
+	void gte::products(matrix const& m,
+	                   std::array<int32_t, 3> const& t,
+	                   vector const* v,
+	                   int n,
+	                   std::array<int64_t, 3>* out) {
+		if (gte_kernels::fast_translation(t)) {
+			// no intermediate sum can overflow
+			mat_vec_kernel(m, t, v, n, out);
+			return;
+		}
+		for (int k = 0; k < n; k++) {
+			for (int i = 0; i < 3; i++) {
+				int64_t s = extend_mac(i + 1, int64_t{t[i]} * 0x1000 + int64_t{m[3 * i]} * v[k][0]);
+				s = extend_mac(i + 1, s + int64_t{m[3 * i + 1]} * v[k][1]);
+				s = extend_mac(i + 1, s + int64_t{m[3 * i + 2]} * v[k][2]);
+				out[k][i] = s;
+			}
+		}
+	}
+
+	void gte::mat_vec(matrix const& m, std::array<int32_t, 3> const& t, vector const& v, int shift, bool lm) {
+		std::array<int64_t, 3> out;
+		products(m, t, &v, 1, &out);
+		for (int i = 0; i < 3; i++) {
+			set_mac_ir(i + 1, out[i], shift, lm);
+		}
+	}
+
+	void gte::rtp(std::array<int64_t, 3> const& sum, int shift, bool lm, bool last) {
+		set_mac_ir(1, sum[0], shift, lm);
+		set_mac_ir(2, sum[1], shift, lm);
+		set_mac(3, sum[2], shift);
+
+		// IR3 is saturated as usual, but the flag is set when MAC3 SAR 12
+		// (instead of MAC3) is out of range
+		int32_t z = static_cast<int32_t>(sum[2] >> 12);
+		if (z < -0x8000 || z > 0x7fff) {
+			set_flag(flag::ir[3]);
+		}
+		regs.ir[3] = static_cast<int16_t>(std::clamp(regs.mac[3], lm ? 0 : -0x8000, 0x7fff));
+
+		push_sz(z);
+
+		int64_t n = divide_flagged();
+		int64_t x = n * regs.ir[1] + regs.ofx;
+		int64_t y = n * regs.ir[2] + regs.ofy;
+		set_mac0(x);
+		set_mac0(y);
+		push_sxy(static_cast<int32_t>(x >> 16), static_cast<int32_t>(y >> 16));
+
+		if (last) {
+			int64_t depth = n * regs.dqa + regs.dqb;
+			set_mac0(depth);
+			set_ir0(static_cast<int32_t>(depth >> 12));
+		}
+	}
+
+	void gte::nclip() {
+		auto const& s = regs.sxy;
+		int64_t v = int64_t{s[0][0]} * s[1][1] + int64_t{s[1][0]} * s[2][1] + int64_t{s[2][0]} * s[0][1] -
+		            int64_t{s[0][0]} * s[2][1] - int64_t{s[1][0]} * s[0][1] - int64_t{s[2][0]} * s[1][1];
+		set_mac0(v);
+	}
+
+	void gte::op(int shift, bool lm) {
+		int64_t d1 = regs.rt[0], d2 = regs.rt[4], d3 = regs.rt[8];
+		int64_t ir1 = regs.ir[1], ir2 = regs.ir[2], ir3 = regs.ir[3];
+		set_mac_ir(1, ir3 * d2 - ir2 * d3, shift, lm);
+		set_mac_ir(2, ir1 * d3 - ir3 * d1, shift, lm);
+		set_mac_ir(3, ir2 * d1 - ir1 * d2, shift, lm);
+	}
+
+	void gte::mvmva(uint32_t cmd, int shift, bool lm) {
+		matrix m;
+		switch ((cmd >> 17) & 0x3) {
+		case 0:
+			m = regs.rt;
+			break;
+		case 1:
+			m = regs.llm;
+			break;
+		case 2:
+			m = regs.lcm;
+			break;
+		default: {
+			// the "reserved" matrix is built from unrelated registers
+			auto r = static_cast<int16_t>(regs.rgbc[0] << 4);
+			m = {static_cast<int16_t>(-r), r, regs.ir[0], regs.rt[2], regs.rt[2],
+			     regs.rt[2], regs.rt[4], regs.rt[4], regs.rt[4]};
+			break;
+		}
+		}
+
+		vector v;
+		switch ((cmd >> 15) & 0x3) {
+		case 3:
+			v = ir_vector();
+			break;
+		default:
+			v = regs.v[(cmd >> 15) & 0x3];
+			break;
+		}
+
+		switch ((cmd >> 13) & 0x3) {
+		case 0:
+			mat_vec(m, regs.tr, v, shift, lm);
+			break;
+		case 1:
+			mat_vec(m, regs.bk, v, shift, lm);
+			break;
+		case 2:
+			// the far color vector is broken: the first column is only
+			// used to set the flags
+			for (int i = 0; i < 3; i++) {
+				int64_t partial = extend_mac(i + 1, int64_t{regs.fc[i]} * 0x1000 + int64_t{m[3 * i]} * v[0]);
+				int32_t ir = static_cast<int32_t>(partial >> shift);
+				if (ir < -0x8000 || ir > 0x7fff) {
+					set_flag(flag::ir[i + 1]);
+				}
+				int64_t s = extend_mac(i + 1, int64_t{m[3 * i + 1]} * v[1]) + int64_t{m[3 * i + 2]} * v[2];
+				set_mac_ir(i + 1, s, shift, lm);
+			}
+			break;
+		default:
+			mat_vec(m, no_translation, v, shift, lm);
+			break;
+		}
+	}
+
+	void gte::avsz3() {
+		int64_t v = int64_t{regs.zsf3} * (regs.sz[1] + regs.sz[2] + regs.sz[3]);
+		set_mac0(v);
+
+		int64_t otz = v >> 12;
+		if (otz < 0 || otz > 0xffff) {
+			otz = std::clamp<int64_t>(otz, 0, 0xffff);
+			set_flag(flag::sz_otz);
+		}
+		regs.otz = static_cast<uint16_t>(otz);
+	}
+
+	void gte::avsz4() {
+		int64_t v = int64_t{regs.zsf4} * (regs.sz[0] + regs.sz[1] + regs.sz[2] + regs.sz[3]);
+		set_mac0(v);
+
+		int64_t otz = v >> 12;
+		if (otz < 0 || otz > 0xffff) {
+			otz = std::clamp<int64_t>(otz, 0, 0xffff);
+			set_flag(flag::sz_otz);
+		}
+		regs.otz = static_cast<uint16_t>(otz);
+	}
+
+	void gte::sqr(int shift, bool lm) {
+		for (int i = 1; i <= 3; i++) {
+			int64_t ir = regs.ir[i];
+			set_mac_ir(i, ir * ir, shift, lm);
+		}
+	}
+
+	void gte::gpf(int shift, bool lm) {
+		for (int i = 1; i <= 3; i++) {
+			set_mac_ir(i, int64_t{regs.ir[0]} * regs.ir[i], shift, lm);
+		}
+		push_rgb();
+	}
+
+	void gte::gpl(int shift, bool lm) {
+		for (int i = 1; i <= 3; i++) {
+			set_mac_ir(i, shl(regs.mac[i], shift) + int64_t{regs.ir[0]} * regs.ir[i], shift, lm);
+		}
+		push_rgb();
+	}
+
+	void gte::depth_cue(int64_t mac1, int64_t mac2, int64_t mac3, int shift, bool lm) {
+		// [MAC1..3] = MAC + (FC - MAC) * IR0
+		int64_t mac[] = {0, mac1, mac2, mac3};
+		for (int i = 1; i <= 3; i++) {
+			set_mac_ir(i, int64_t{regs.fc[i - 1]} * 0x1000 - mac[i], shift, false);
+		}
+		for (int i = 1; i <= 3; i++) {
+			set_mac_ir(i, int64_t{regs.ir[i]} * regs.ir[0] + mac[i], shift, lm);
+		}
+	}
+
+	void gte::color_times_ir(int shift, bool lm, bool cue) {
+		// [MAC1..3] = [R*IR1, G*IR2, B*IR3] SHL 4
+		int64_t mac[3];
+		for (int i = 0; i < 3; i++) {
+			mac[i] = int64_t{regs.rgbc[i]} * regs.ir[i + 1] * 16;
+		}
+		if (cue) {
+			depth_cue(mac[0], mac[1], mac[2], shift, lm);
+		} else {
+			for (int i = 0; i < 3; i++) {
+				set_mac_ir(i + 1, mac[i], shift, lm);
+			}
+		}
+		push_rgb();
+	}
+
+	void gte::light(vector const* v, int n, int shift, bool lm, uint32_t cmd) {
+		// the normal vectors are transformed by the light matrix all at once
+		std::array<int64_t, 3> normals[3];
+		if (v) {
+			products(regs.llm, no_translation, v, n, normals);
+		}
+
+		for (int k = 0; k < n; k++) {
+			if (v) {
+				for (int i = 0; i < 3; i++) {
+					set_mac_ir(i + 1, normals[k][i], shift, lm);
+				}
+			}
+			mat_vec(regs.lcm, regs.bk, ir_vector(), shift, lm);
+
+			switch (cmd & 0x3f) {
+			case 0x1e: // NCS
+			case 0x20: // NCT
+				push_rgb();
+				break;
+			case 0x1b: // NCCS
+			case 0x3f: // NCCT
+			case 0x1c: // CC
+				color_times_ir(shift, lm, false);
+				break;
+			default: // NCDS, NCDT, CDP
+				color_times_ir(shift, lm, true);
+				break;
+			}
+		}
+	}
+
+	void gte::dpcs(std::array<uint8_t, 4> const& color, int shift, bool lm) {
+		depth_cue(int64_t{color[0]} << 16, int64_t{color[1]} << 16, int64_t{color[2]} << 16, shift, lm);
+		push_rgb();
+	}
+
+	void gte::intpl(int shift, bool lm) {
+		depth_cue(int64_t{regs.ir[1]} * 0x1000, int64_t{regs.ir[2]} * 0x1000, int64_t{regs.ir[3]} * 0x1000, shift, lm);
+		push_rgb();
+	}
+
+	void gte::command(uint32_t cmd) {
+		int shift = cmd & (1 << 19) ? 12 : 0;
+		bool lm = cmd & (1 << 10);
+
+		regs.flag = 0;
+		switch (cmd & 0x3f) {
+		case 0x01: { // RTPS
+			std::array<int64_t, 3> sum;
+			products(regs.rt, regs.tr, &regs.v[0], 1, &sum);
+			rtp(sum, shift, lm, true);
+			break;
+		}
+		case 0x30: { // RTPT
+			std::array<int64_t, 3> sums[3];
+			products(regs.rt, regs.tr, regs.v.data(), 3, sums);
+			for (int k = 0; k < 3; k++) {
+				rtp(sums[k], shift, lm, k == 2);
+			}
+			break;
+		}
+		case 0x06:
+			nclip();
+			break;
+		case 0x0c:
+			op(shift, lm);
+			break;
+		case 0x10:
+			dpcs(regs.rgbc, shift, lm);
+			break;
+		case 0x11:
+			intpl(shift, lm);
+			break;
+		case 0x12:
+			mvmva(cmd, shift, lm);
+			break;
+		case 0x13: // NCDS
+		case 0x1b: // NCCS
+		case 0x1e: // NCS
+			light(&regs.v[0], 1, shift, lm, cmd);
+			break;
+		case 0x16: // NCDT
+		case 0x3f: // NCCT
+		case 0x20: // NCT
+			light(regs.v.data(), 3, shift, lm, cmd);
+			break;
+		case 0x14: // CDP
+		case 0x1c: // CC
+			light(nullptr, 1, shift, lm, cmd);
+			break;
+		case 0x28:
+			sqr(shift, lm);
+			break;
+		case 0x29: { // DCPL
+			int64_t mac[3];
+			for (int i = 0; i < 3; i++) {
+				mac[i] = int64_t{regs.rgbc[i]} * regs.ir[i + 1] * 16;
+			}
+			depth_cue(mac[0], mac[1], mac[2], shift, lm);
+			push_rgb();
+			break;
+		}
+		case 0x2a: // DPCT
+			for (int k = 0; k < 3; k++) {
+				dpcs(regs.rgb[0], shift, lm);
+			}
+			break;
+		case 0x2d:
+			avsz3();
+			break;
+		case 0x2e:
+			avsz4();
+			break;
+		case 0x3d:
+			gpf(shift, lm);
+			break;
+		case 0x3e:
+			gpl(shift, lm);
+			break;
+		default:
+			break;
+		}
+
+		if (regs.flag & flag::error_bits) {
+			regs.flag |= flag::error;
+		}
+	}
+}
+
+namespace cpu::gte_kernels {
+	void mat_vec_scalar(gte::matrix const& m,
+	                    std::array<int32_t, 3> const& t,
+	                    gte::vector const* v,
+	                    int n,
+	                    std::array<int64_t, 3>* out) {
+		for (int k = 0; k < n; k++) {
+			for (int i = 0; i < 3; i++) {
+				out[k][i] = int64_t{t[i]} * 0x1000 + int64_t{m[3 * i]} * v[k][0] + int64_t{m[3 * i + 1]} * v[k][1] +
+				            int64_t{m[3 * i + 2]} * v[k][2];
+			}
+		}
+	}
+}
@@ -0,0 +1,213 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace cpu {
+	/**
+	 * \brief The Geometry Transformation Engine (COP2)
+	 *
+	 * https://problemkaputt.de/psx-spx.htm#geometrytransformationenginegte
+	 *
+	 * The GTE has 32 data registers (cop2r0..31) and 32 control registers
+	 * (cop2r32..63, accessed with CFC2/CTC2); `read` and `write` use the
+	 * registers numbering of the cpu, the control registers are at 32..63.
+	 *
+	 * The arithmetic follows the hardware: the MAC1..3 results are checked
+	 * for a 44 bit overflow after every addition, the IR and the color
+	 * values are saturated and every saturation is reported in FLAG.
+	 *
+	 * The matrix-vector products are computed by kernels chosen at runtime
+	 * among the instruction sets supported by the host; all of them give
+	 * exactly the same results as the scalar one.
+	 */
+	class gte {
+	  public:
+		enum class isa : uint8_t {
+			scalar,
+			sse4,
+			avx2,
+		};
+
+		/**
+		 * \brief the fastest instruction set supported by the host
+		 */
+		static isa best_isa();
+
+		/**
+		 * \brief checks if the host supports the given instruction set
+		 */
+		static bool supported(isa);
+
+		/**
+		 * \brief the name of a GTE command, empty if the command is unknown
+		 */
+		static std::string_view command_name(uint32_t cmd);
+
+	  public:
+		gte();
+
+		void reset();
+
+		/**
+		 * \brief uses the kernels for the given instruction set
+		 *
+		 * The instruction set must be `supported`.
+		 */
+		void use(isa);
+
+		isa kernels() const { return kernel_isa; }
+
+	  public:
+		uint32_t read(uint8_t reg) const;
+		void write(uint8_t reg, uint32_t value);
+
+		/**
+		 * \brief executes a GTE command (the 25 bits of a COP2 function)
+		 */
+		void command(uint32_t cmd);
+
+	  public:
+		// a 3x3 matrix of 1.3.12 fixed point values
+		using matrix = std::array<int16_t, 9>;
+		using vector = std::array<int16_t, 3>;
+
+		/**
+		 * \brief The GTE registers, as saved in a dump
+		 */
+		struct registers {
+			// data registers
+			std::array<vector, 3> v;
+			std::array<uint8_t, 4> rgbc;
+			uint16_t otz;
+			std::array<int16_t, 4> ir;
+			std::array<std::array<int16_t, 2>, 3> sxy;
+			std::array<uint16_t, 4> sz;
+			std::array<std::array<uint8_t, 4>, 3> rgb;
+			uint32_t res1;
+			std::array<int32_t, 4> mac;
+			uint32_t lzcs;
+
+			// control registers
+			matrix rt;
+			std::array<int32_t, 3> tr;
+			matrix llm;
+			std::array<int32_t, 3> bk;
+			matrix lcm;
+			std::array<int32_t, 3> fc;
+			int32_t ofx;
+			int32_t ofy;
+			uint16_t h;
+			int16_t dqa;
+			int32_t dqb;
+			int16_t zsf3;
+			int16_t zsf4;
+			uint32_t flag;
+		};
+
+		registers regs;
+
+	  public:
+		/**
+		 * \brief computes `(t << 12) + m * v` for `n` vectors
+		 *
+		 * The sums are exact, without the 44 bit overflow checks; the caller
+		 * ensures that `t` is small enough that no intermediate sum can
+		 * overflow (see `fast_translation`).
+		 */
+		using mat_vec_fn = void (*)(matrix const& m,
+		                            std::array<int32_t, 3> const& t,
+		                            vector const* v,
+		                            int n,
+		                            std::array<int64_t, 3>* out);
+
+	  private:
+		void set_flag(uint32_t bit) { regs.flag |= bit; }
+
+		int64_t check_mac(int ix, int64_t value);
+		int64_t extend_mac(int ix, int64_t value);
+		void set_mac(int ix, int64_t value, int shift);
+		void set_ir(int ix, int32_t value, bool lm);
+		void set_mac_ir(int ix, int64_t value, int shift, bool lm);
+		void set_mac0(int64_t value);
+		void set_ir0(int32_t value);
+
+		void push_sz(int32_t value);
+		void push_sxy(int32_t x, int32_t y);
+		void push_rgb();
+
+		uint32_t divide() const;
+		uint32_t divide_flagged();
+
+		/**
+		 * \brief computes `(t << 12) + m * v` for `n` vectors, checking the
+		 * 44 bit overflow of every intermediate sum
+		 */
+		void products(matrix const& m,
+		              std::array<int32_t, 3> const& t,
+		              vector const* v,
+		              int n,
+		              std::array<int64_t, 3>* out);
+
+		/**
+		 * \brief [MAC1..3] = [IR1..3] = ((t << 12) + m * v) >> shift
+		 */
+		void mat_vec(matrix const& m, std::array<int32_t, 3> const& t, vector const& v, int shift, bool lm);
+
+		void rtp(std::array<int64_t, 3> const& sum, int shift, bool lm, bool last);
+		void nclip();
+		void op(int shift, bool lm);
+		void mvmva(uint32_t cmd, int shift, bool lm);
+		void avsz3();
+		void avsz4();
+		void sqr(int shift, bool lm);
+		void gpf(int shift, bool lm);
+		void gpl(int shift, bool lm);
+
+		// the lighting of the color commands
+		void light(vector const* v, int n, int shift, bool lm, uint32_t cmd);
+		void depth_cue(int64_t mac1, int64_t mac2, int64_t mac3, int shift, bool lm);
+		void color_times_ir(int shift, bool lm, bool cue);
+		void dpcs(std::array<uint8_t, 4> const& color, int shift, bool lm);
+		void intpl(int shift, bool lm);
+
+		vector ir_vector() const { return {regs.ir[1], regs.ir[2], regs.ir[3]}; }
+
+	  private:
+		isa kernel_isa;
+		mat_vec_fn mat_vec_kernel;
+	};
+
+	namespace gte_kernels {
+		void mat_vec_scalar(gte::matrix const&,
+		                    std::array<int32_t, 3> const&,
+		                    gte::vector const*,
+		                    int,
+		                    std::array<int64_t, 3>*);
+		void mat_vec_sse4(gte::matrix const&,
+		                  std::array<int32_t, 3> const&,
+		                  gte::vector const*,
+		                  int,
+		                  std::array<int64_t, 3>*);
+		void mat_vec_avx2(gte::matrix const&,
+		                  std::array<int32_t, 3> const&,
+		                  gte::vector const*,
+		                  int,
+		                  std::array<int64_t, 3>*);
+
+		/**
+		 * \brief checks if the translation `t` cannot overflow the 44 bit
+		 * intermediate sums of a matrix-vector product
+		 */
+		inline bool fast_translation(std::array<int32_t, 3> const& t) {
+			// |t << 12| + 3 * 2^30 < 2^43
+			constexpr int32_t limit = 0x7ff0'0000;
+			for (int32_t x : t) {
+				if (x > limit || x < -limit) {
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#include "gte.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// The SIMD kernels of the GTE. Each one is compiled for its own instruction
+// set with a target attribute, `gte::use` never selects a kernel that the
+// host does not support.
+//
+// The products of two 16 bit values fit in 32 bits, but their sums with the
+// translation vector need 44 bits; the products are sign-extended to 64 bits
+// lanes and accumulated there.
+
+namespace cpu::gte_kernels {
+#if defined(__x86_64__)
+	__attribute__((target("sse4.1"))) void mat_vec_sse4(gte::matrix const& m,
+	                                                    std::array<int32_t, 3> const& t,
+	                                                    gte::vector const* v,
+	                                                    int n,
+	                                                    std::array<int64_t, 3>* out) {
+		// the columns of the matrix; rows 1 and 2 in `a`, row 3 in `b`
+		__m128i col_a[3], col_b[3];
+		for (int j = 0; j < 3; j++) {
+			col_a[j] = _mm_set_epi64x(m[3 + j], m[j]);
+			col_b[j] = _mm_set_epi64x(0, m[6 + j]);
+		}
+		__m128i const t_a = _mm_slli_epi64(_mm_set_epi64x(t[1], t[0]), 12);
+		__m128i const t_b = _mm_slli_epi64(_mm_set_epi64x(0, t[2]), 12);
+
+		for (int k = 0; k < n; k++) {
+			__m128i acc_a = t_a;
+			__m128i acc_b = t_b;
+			for (int j = 0; j < 3; j++) {
+				__m128i x = _mm_set1_epi64x(v[k][j]);
+				acc_a = _mm_add_epi64(acc_a, _mm_mul_epi32(col_a[j], x));
+				acc_b = _mm_add_epi64(acc_b, _mm_mul_epi32(col_b[j], x));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out[k].data()), acc_a);
+			out[k][2] = _mm_cvtsi128_si64(acc_b);
+		}
+	}
+
+	__attribute__((target("avx2"))) void mat_vec_avx2(gte::matrix const& m,
+	                                                  std::array<int32_t, 3> const& t,
+	                                                  gte::vector const* v,
+	                                                  int n,
+	                                                  std::array<int64_t, 3>* out) {
+		__m256i col[3];
+		for (int j = 0; j < 3; j++) {
+			col[j] = _mm256_set_epi64x(0, m[6 + j], m[3 + j], m[j]);
+		}
+		__m256i const tr = _mm256_slli_epi64(_mm256_set_epi64x(0, t[2], t[1], t[0]), 12);
+
+		for (int k = 0; k < n; k++) {
+			__m256i acc = tr;
+			for (int j = 0; j < 3; j++) {
+				acc = _mm256_add_epi64(acc, _mm256_mul_epi32(col[j], _mm256_set1_epi64x(v[k][j])));
+			}
+			alignas(32) int64_t r[4];
+			_mm256_store_si256(reinterpret_cast<__m256i*>(r), acc);
+			out[k] = {r[0], r[1], r[2]};
+		}
+	}
+#else
+	void mat_vec_sse4(gte::matrix const& m,
+	                  std::array<int32_t, 3> const& t,
+	                  gte::vector const* v,
+	                  int n,
+	                  std::array<int64_t, 3>* out) {
+		mat_vec_scalar(m, t, v, n, out);
+	}
+
+	void mat_vec_avx2(gte::matrix const& m,
+	                  std::array<int32_t, 3> const& t,
+	                  gte::vector const* v,
+	                  int n,
+	                  std::array<int64_t, 3>* out) {
+		mat_vec_scalar(m, t, v, n, out);
+	}
+#endif
+}
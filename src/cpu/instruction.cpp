@@ -0,0 +1,25 @@
+#include "instruction.hpp"
+#include "opcodes.hpp"
+
+namespace cpu {
+	instruction decode(decoder ins) {
+		instruction i;
+		i.id = identify(ins);
+		i.rs = ins.rs();
+		i.rt = ins.rt();
+		i.rd = ins.rd();
+		i.shamt = ins.shamt();
+		i.uimm = ins.uimm();
+		i.target = ins.target() << 2;
+		i.ins = ins;
+
+		if (has_delay_slot(i.id)) {
+			i.imm = sx(ins.uimm() << 2, 16);
+		} else {
+			i.imm = ins.imm();
+		}
+		return i;
+	}
+
+	bool has_delay_slot(op_id id) { return describe(id).delay_slot; }
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include "decoder.hpp"
+
+#include <cstdint>
+
+namespace cpu {
+	/**
+	 * \brief A flat identifier for every instruction known to the cpu.
+	 *
+	 * The mips encoding needs up to two levels of decoding (the primary opcode
+	 * and then the `funct` field for SPECIAL or the `rt` field for REGIMM);
+	 * an `op_id` resolves both of them.
+	 */
+	enum class op_id : uint8_t {
+		// SPECIAL
+		sll,
+		srl,
+		sra,
+		sllv,
+		srav,
+		jr,
+		jalr,
+		syscall,
+		mfhi,
+		mthi,
+		mflo,
+		mtlo,
+		mult,
+		multu,
+		div,
+		divu,
+		add,
+		addu,
+		subu,
+		and_,
+		or_,
+		nor,
+		slt,
+		sltu,
+		// REGIMM
+		bltz,
+		bgez,
+		bltzal,
+		bgezal,
+		// primary opcodes
+		j,
+		jal,
+		beq,
+		bne,
+		blez,
+		bgtz,
+		addi,
+		addiu,
+		slti,
+		sltiu,
+		andi,
+		ori,
+		lui,
+		lb,
+		lh,
+		lw,
+		lbu,
+		lhu,
+		sb,
+		sh,
+		sw,
+		lwc2,
+		swc2,
+		// coprocessors
+		cop0,
+		cop2,
+		cop_unusable,
+
+		unknown,
+	};
+
+	/**
+	 * \brief A pre-decoded instruction
+	 *
+	 * All the fields needed to execute the instruction are extracted once:
+	 * the register indices, the sign-extended immediate, the branch offset
+	 * and the jump target.
+	 */
+	struct instruction {
+		op_id id;
+
+		uint8_t rs;
+		uint8_t rt;
+		uint8_t rd;
+		uint8_t shamt;
+
+		// the sign-extended immediate; for the relative branches this is the
+		// (already shifted) offset from the delay slot.
+		int32_t imm;
+		// the zero-extended immediate
+		uint32_t uimm;
+		// the jump target, already shifted; the upper 4 bits come from the pc
+		uint32_t target;
+
+		// the raw instruction
+		decoder ins;
+	};
+
+	/**
+	 * \brief decodes a raw instruction
+	 */
+	instruction decode(decoder);
+
+	/**
+	 * \brief checks if the instruction is followed by a delay slot
+	 */
+	bool has_delay_slot(op_id);
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include "decoder.hpp"
+#include "instruction.hpp"
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace cpu {
+	/**
+	 * \brief where the opcode of an instruction is encoded
+	 */
+	enum class encoding : uint8_t {
+		// the primary opcode (bits 26..31)
+		primary,
+		// the `funct` field of a SPECIAL (primary opcode 0x00) instruction
+		special,
+		// the `rt` field of a REGIMM (primary opcode 0x01) instruction
+		regimm,
+	};
+
+	/**
+	 * \brief The description of an instruction known to the cpu
+	 *
+	 * The `format` is used by the disassembler, the named arguments are:
+	 *
+	 * - `rs`, `rt`, `rd`: the register fields
+	 * - `shamt`, `imm5`: the shift amount
+	 * - `imm16`: the 16 bit immediate
+	 * - `target`: the absolute target of a jump
+	 * - `j_rel`: the target of a relative branch
+	 * - `crt`: the `rt` field as a coprocessor register
+	 *
+	 * The coprocessor instructions have an empty format, they are further
+	 * decoded by the disassembler.
+	 */
+	struct opcode {
+		op_id id;
+		encoding enc;
+		// the value of the primary opcode, the funct or the rt field
+		uint8_t code;
+		bool delay_slot;
+		std::string_view format;
+	};
+
+	// clang-format off
+	inline constexpr opcode opcodes[] = {
+	    {op_id::sll,          encoding::special, 0x00, false, "sll {rd}, {rt}, {imm5}"},
+	    {op_id::srl,          encoding::special, 0x02, false, "srl {rd}, {rt}, {imm5}"},
+	    {op_id::sra,          encoding::special, 0x03, false, "sra {rd}, {rt}, {shamt}"},
+	    {op_id::sllv,         encoding::special, 0x04, false, "sllv {rd}, {rt}, {rs}"},
+	    {op_id::srav,         encoding::special, 0x07, false, "srav {rd}, {rt}, {rs}"},
+	    {op_id::jr,           encoding::special, 0x08, true,  "jr {rs}"},
+	    {op_id::jalr,         encoding::special, 0x09, true,  "jalr {rd}, {rs}"},
+	    {op_id::syscall,      encoding::special, 0x0c, false, "syscall"},
+	    {op_id::mfhi,         encoding::special, 0x10, false, "mfhi {rd}"},
+	    {op_id::mthi,         encoding::special, 0x11, false, "mthi {rs}"},
+	    {op_id::mflo,         encoding::special, 0x12, false, "mflo {rd}"},
+	    {op_id::mtlo,         encoding::special, 0x13, false, "mtlo {rs}"},
+	    {op_id::mult,         encoding::special, 0x18, false, "mult {rs}, {rt}"},
+	    {op_id::multu,        encoding::special, 0x19, false, "multu {rs}, {rt}"},
+	    {op_id::div,          encoding::special, 0x1a, false, "div {rs}, {rt}"},
+	    {op_id::divu,         encoding::special, 0x1b, false, "divu {rs}, {rt}"},
+	    {op_id::add,          encoding::special, 0x20, false, "add {rd}, {rs}, {rt}"},
+	    {op_id::addu,         encoding::special, 0x21, false, "addu {rd}, {rs}, {rt}"},
+	    {op_id::subu,         encoding::special, 0x23, false, "subu {rd}, {rs}, {rt}"},
+	    {op_id::and_,         encoding::special, 0x24, false, "and {rd}, {rs}, {rt}"},
+	    {op_id::or_,          encoding::special, 0x25, false, "or {rd}, {rs}, {rt}"},
+	    {op_id::nor,          encoding::special, 0x27, false, "nor {rd}, {rs}, {rt}"},
+	    {op_id::slt,          encoding::special, 0x2a, false, "slt {rd}, {rs}, {rt}"},
+	    {op_id::sltu,         encoding::special, 0x2b, false, "sltu {rd}, {rs}, {rt}"},
+
+	    {op_id::bltz,         encoding::regimm,  0x00, true,  "bltz {rs}, {j_rel}"},
+	    {op_id::bgez,         encoding::regimm,  0x01, true,  "bgez {rs}, {j_rel}"},
+	    {op_id::bltzal,       encoding::regimm,  0x10, true,  "bltzal {rs}, {j_rel}"},
+	    {op_id::bgezal,       encoding::regimm,  0x11, true,  "bgezal {rs}, {j_rel}"},
+
+	    {op_id::j,            encoding::primary, 0x02, true,  "j {target}"},
+	    {op_id::jal,          encoding::primary, 0x03, true,  "jal {target}"},
+	    {op_id::beq,          encoding::primary, 0x04, true,  "beq {rs}, {rt}, {j_rel}"},
+	    {op_id::bne,          encoding::primary, 0x05, true,  "bne {rs}, {rt}, {j_rel}"},
+	    {op_id::blez,         encoding::primary, 0x06, true,  "blez {rs}, {j_rel}"},
+	    {op_id::bgtz,         encoding::primary, 0x07, true,  "bgtz {rs}, {j_rel}"},
+	    {op_id::addi,         encoding::primary, 0x08, false, "addi {rs}, {rt}, {imm16}"},
+	    {op_id::addiu,        encoding::primary, 0x09, false, "addiu {rt}, {rs}, {imm16}"},
+	    {op_id::slti,         encoding::primary, 0x0a, false, "slti {rt}, {rs}, {imm16}"},
+	    {op_id::sltiu,        encoding::primary, 0x0b, false, "sltiu {rt}, {rs}, {imm16}"},
+	    {op_id::andi,         encoding::primary, 0x0c, false, "andi {rt}, {rs}, {imm16}"},
+	    {op_id::ori,          encoding::primary, 0x0d, false, "ori {rt}, {rs}, {imm16}"},
+	    {op_id::lui,          encoding::primary, 0x0f, false, "lui {rt}, {imm16}"},
+	    {op_id::cop0,         encoding::primary, 0x10, false, ""},
+	    {op_id::cop_unusable, encoding::primary, 0x11, false, ""},
+	    {op_id::cop2,         encoding::primary, 0x12, false, ""},
+	    {op_id::cop_unusable, encoding::primary, 0x13, false, ""},
+	    {op_id::lb,           encoding::primary, 0x20, false, "lb {rt}, {rs} + {imm16}"},
+	    {op_id::lh,           encoding::primary, 0x21, false, "lh {rt}, {rs} + {imm16}"},
+	    {op_id::lw,           encoding::primary, 0x23, false, "lw {rt}, {rs} + {imm16}"},
+	    {op_id::lbu,          encoding::primary, 0x24, false, "lbu {rt}, {rs} + {imm16}"},
+	    {op_id::lhu,          encoding::primary, 0x25, false, "lhu {rt}, {rs} + {imm16}"},
+	    {op_id::sb,           encoding::primary, 0x28, false, "sb {rt}, {rs} + {imm16}"},
+	    {op_id::sh,           encoding::primary, 0x29, false, "sh {rt}, {rs} + {imm16}"},
+	    {op_id::sw,           encoding::primary, 0x2b, false, "sw {rt}, {rs} + {imm16}"},
+	    {op_id::lwc2,         encoding::primary, 0x32, false, "lwc2 {crt}, {rs} + {imm16}"},
+	    {op_id::swc2,         encoding::primary, 0x3a, false, "swc2 {crt}, {rs} + {imm16}"},
+	};
+	// clang-format on
+
+	inline constexpr opcode unknown_opcode{op_id::unknown, encoding::primary, 0x00, false, ""};
+
+	inline constexpr size_t op_count = static_cast<size_t>(op_id::unknown) + 1;
+
+	namespace opcode_table {
+		// The decoding table has a slot for every primary opcode, followed by
+		// a slot for every SPECIAL funct and then for every REGIMM rt.
+		inline constexpr size_t special_base = 64;
+		inline constexpr size_t regimm_base = special_base + 64;
+		inline constexpr size_t slots = regimm_base + 32;
+
+		constexpr size_t slot(encoding enc, uint8_t code) {
+			switch (enc) {
+			case encoding::special:
+				return special_base + code;
+			case encoding::regimm:
+				return regimm_base + code;
+			default:
+				return code;
+			}
+		}
+
+		constexpr std::array<op_id, slots> make_decoding() {
+			std::array<op_id, slots> t{};
+			for (auto& id : t) {
+				id = op_id::unknown;
+			}
+			for (auto const& op : opcodes) {
+				t[slot(op.enc, op.code)] = op.id;
+			}
+			return t;
+		}
+
+		constexpr std::array<opcode, op_count> make_descriptions() {
+			std::array<opcode, op_count> t{};
+			for (auto& op : t) {
+				op = unknown_opcode;
+			}
+			for (auto const& op : opcodes) {
+				auto& d = t[static_cast<size_t>(op.id)];
+				if (d.id == op_id::unknown) {
+					d = op;
+				}
+			}
+			return t;
+		}
+
+		inline constexpr auto decoding = make_decoding();
+		inline constexpr auto descriptions = make_descriptions();
+	}
+
+	/**
+	 * \brief the position of an instruction in the decoding table
+	 */
+	inline size_t decoding_slot(decoder ins) {
+		switch (ins.opcode()) {
+		case 0x00:
+			return opcode_table::special_base + ins.funct();
+		case 0x01:
+			return opcode_table::regimm_base + ins.rt();
+		default:
+			return ins.opcode();
+		}
+	}
+
+	/**
+	 * \brief identifies a raw instruction with a single table lookup
+	 */
+	inline op_id identify(decoder ins) { return opcode_table::decoding[decoding_slot(ins)]; }
+
+	/**
+	 * \brief returns the description of an instruction
+	 */
+	constexpr opcode const& describe(op_id id) { return opcode_table::descriptions[static_cast<size_t>(id)]; }
+}
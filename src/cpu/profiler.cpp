@@ -0,0 +1,167 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <sstream>
+
+namespace {
+	template <typename Map>
+	std::vector<std::pair<uint32_t, uint64_t>> by_count(Map const& m) {
+		std::vector<std::pair<uint32_t, uint64_t>> v(std::begin(m), std::end(m));
+		std::sort(std::begin(v), std::end(v), [](auto const& a, auto const& b) {
+			return a.second != b.second ? a.second > b.second : a.first < b.first;
+		});
+		return v;
+	}
+}
+
+namespace cpu {
+	size_t symbol_map::load(std::istream& in) {
+		size_t loaded = 0;
+		std::string line;
+		while (std::getline(in, line)) {
+			std::istringstream fields(line);
+			std::string address, name;
+			if (!(fields >> address) || address[0] == '#') {
+				continue;
+			}
+
+			char* end;
+			unsigned long value = std::strtoul(address.c_str(), &end, 16);
+			if (*end != '\0') {
+				continue;
+			}
+			// the name is the last field
+			for (std::string f; fields >> f;) {
+				name = f;
+			}
+			if (!name.empty()) {
+				add(static_cast<uint32_t>(value), name);
+				loaded++;
+			}
+		}
+		return loaded;
+	}
+
+	void symbol_map::add(uint32_t address, std::string name) { symbols[address] = std::move(name); }
+
+	std::string symbol_map::name(uint32_t address) const {
+		auto pos = symbols.upper_bound(address);
+		if (pos == std::begin(symbols)) {
+			return fmt::format("0x{:0>8x}", address);
+		}
+		return std::prev(pos)->second;
+	}
+}
+
+namespace cpu {
+	profiler::profiler() : transfer{target, 0, op_id::unknown, 0} {
+		nodes.push_back({0, 0, 0});
+		stack.push_back({0, 0});
+	}
+
+	void profiler::enter_block(uint32_t pc) {
+		blocks[pc]++;
+		transfer.state = none;
+
+		switch (transfer.id) {
+		case op_id::unknown:
+			// the first instruction profiled
+			nodes[0].entry = pc;
+			break;
+		case op_id::jal:
+		case op_id::jalr: {
+			if (stack.size() == max_depth) {
+				break;
+			}
+			uint32_t parent = stack.back().node;
+			uint64_t key = uint64_t{parent} << 32 | pc;
+			auto pos = children.find(key);
+			if (pos == std::end(children)) {
+				nodes.push_back({pc, parent, 0});
+				pos = children.emplace(key, static_cast<uint32_t>(nodes.size() - 1)).first;
+			}
+			stack.push_back({pos->second, transfer.from + 8});
+			break;
+		}
+		case op_id::jr:
+			if (transfer.rs != 31) {
+				break;
+			}
+			// returns to the closest frame expecting `pc`; a return that
+			// does not match any frame (e.g. a longjmp) leaves the stack as
+			// it is.
+			for (size_t ix = stack.size() - 1; ix > 0; ix--) {
+				if (stack[ix].ret == pc) {
+					stack.resize(ix);
+					break;
+				}
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	std::vector<uint32_t> profiler::path(uint32_t n) const {
+		std::vector<uint32_t> p;
+		for (;; n = nodes[n].parent) {
+			p.push_back(nodes[n].entry);
+			if (n == 0) {
+				break;
+			}
+		}
+		std::reverse(std::begin(p), std::end(p));
+		return p;
+	}
+
+	void profiler::write_pcs(std::ostream& out, symbol_map const& symbols) const {
+		for (auto [pc, ticks] : by_count(pcs)) {
+			fmt::print(out, "{:0>8x} {} {}\n", pc, ticks, symbols.name(pc));
+		}
+	}
+
+	void profiler::write_blocks(std::ostream& out, symbol_map const& symbols) const {
+		for (auto [pc, entries] : by_count(blocks)) {
+			fmt::print(out, "{:0>8x} {} {}\n", pc, entries, symbols.name(pc));
+		}
+	}
+
+	void profiler::write_folded(std::ostream& out, symbol_map const& symbols) const {
+		// different call paths may have the same names
+		std::map<std::string, uint64_t> folded;
+		for (uint32_t n = 0; n < nodes.size(); n++) {
+			if (nodes[n].ticks == 0) {
+				continue;
+			}
+			std::string line;
+			for (uint32_t entry : path(n)) {
+				if (!line.empty()) {
+					line += ';';
+				}
+				line += symbols.name(entry);
+			}
+			folded[line] += nodes[n].ticks;
+		}
+		for (auto const& [line, ticks] : folded) {
+			fmt::print(out, "{} {}\n", line, ticks);
+		}
+	}
+
+	void profiler::write_perf_script(std::ostream& out, symbol_map const& symbols) const {
+		for (uint32_t n = 0; n < nodes.size(); n++) {
+			if (nodes[n].ticks == 0) {
+				continue;
+			}
+			fmt::print(out, "psycris 0 [000] 0.000000: {} cycles:\n", nodes[n].ticks);
+
+			auto p = path(n);
+			for (auto entry = std::rbegin(p); entry != std::rend(p); entry++) {
+				fmt::print(out, "\t{:>16x} {} (psx)\n", *entry, symbols.name(*entry));
+			}
+			fmt::print(out, "\n");
+		}
+	}
+}
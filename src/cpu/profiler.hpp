@@ -0,0 +1,147 @@
+#pragma once
+#include "decoder.hpp"
+#include "opcodes.hpp"
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cpu {
+	/**
+	 * \brief The names of the guest functions
+	 *
+	 * The map file has a symbol per line, an hexadecimal address followed by
+	 * the name; the `nm` output (address, type, name) is accepted too.
+	 */
+	class symbol_map {
+	  public:
+		/**
+		 * \brief loads the symbols from a map file, returns the number of
+		 * symbols read
+		 */
+		size_t load(std::istream&);
+
+		void add(uint32_t address, std::string name);
+
+		/**
+		 * \brief the name of the function containing `address`
+		 *
+		 * An address before any symbol is named after its value.
+		 */
+		std::string name(uint32_t address) const;
+
+	  private:
+		std::map<uint32_t, std::string> symbols;
+	};
+
+	/**
+	 * \brief Where the guest code spends its cycles
+	 *
+	 * The profiler is fed by `run<profile>` with every instruction and it
+	 * collects:
+	 *
+	 * - the ticks spent on every pc
+	 * - how many times every basic block is entered; a basic block starts at
+	 *   the target of a jump or a branch (taken or not)
+	 * - the ticks spent in every call stack; a call (JAL, JALR) pushes a
+	 *   frame, a `jr ra` pops the frames up to the one returning to its
+	 *   target
+	 *
+	 * The call stacks can be exported as folded stacks, for flamegraph.pl,
+	 * or as `perf script` samples.
+	 */
+	class profiler {
+	  public:
+		profiler();
+
+	  public:
+		void instruction(uint32_t pc, decoder ins) {
+			if (transfer.state == slot) {
+				transfer.state = target;
+			} else if (transfer.state == target) {
+				enter_block(pc);
+			}
+
+			pcs[pc]++;
+			nodes[stack.back().node].ticks++;
+
+			op_id id = identify(ins);
+			if (describe(id).delay_slot) {
+				transfer.state = slot;
+				transfer.from = pc;
+				transfer.id = id;
+				transfer.rs = ins.rs();
+			}
+		}
+
+	  public:
+		/**
+		 * \brief writes the ticks spent on every pc, the most expensive first
+		 */
+		void write_pcs(std::ostream&, symbol_map const&) const;
+
+		/**
+		 * \brief writes the entries of every basic block, the most frequent
+		 * first
+		 */
+		void write_blocks(std::ostream&, symbol_map const&) const;
+
+		/**
+		 * \brief writes the folded call stacks, one per line followed by its
+		 * ticks
+		 */
+		void write_folded(std::ostream&, symbol_map const&) const;
+
+		/**
+		 * \brief writes the call stacks as `perf script` samples
+		 *
+		 * Every stack is a single sample whose period is the ticks spent in
+		 * it.
+		 */
+		void write_perf_script(std::ostream&, symbol_map const&) const;
+
+	  private:
+		void enter_block(uint32_t pc);
+
+		std::vector<uint32_t> path(uint32_t node) const;
+
+	  private:
+		static constexpr size_t max_depth = 256;
+
+		enum transfer_state { none, slot, target };
+
+		// the last control transfer, applied when the instruction after its
+		// delay slot is fetched
+		struct {
+			transfer_state state;
+			uint32_t from;
+			op_id id;
+			uint8_t rs;
+		} transfer;
+
+		std::unordered_map<uint32_t, uint64_t> pcs;
+		std::unordered_map<uint32_t, uint64_t> blocks;
+
+		// the call tree; the root is the code running when the profile
+		// starts
+		struct node {
+			uint32_t entry;
+			uint32_t parent;
+			uint64_t ticks;
+		};
+		std::vector<node> nodes;
+		// the children of every node, by (parent << 32 | entry)
+		std::unordered_map<uint64_t, uint32_t> children;
+
+		struct frame {
+			uint32_t node;
+			// the return address, the root frame has none
+			uint32_t ret;
+		};
+		std::vector<frame> stack;
+	};
+}
@@ -0,0 +1,969 @@
+#include "recompiler.hpp"
+#include "../hw/fastmem.hpp"
+#include "../logging.hpp"
+#include "cpu.hpp"
+
+#if defined(__x86_64__)
+#include "x64_emitter.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+namespace {
+	using namespace cpu::x64;
+
+	constexpr size_t code_size = 32 * 1024 * 1024;
+
+	// an upper bound of the host code generated for a block
+	constexpr size_t max_block_code = cpu::block_cache::max_block_size * 512 + 1024;
+
+	// the mips* is in rbx, the ticks left in r15; the guest registers
+	// allocated to the host use the remaining callee-saved registers, so
+	// they survive the helper calls.
+	constexpr reg state = rbx;
+	constexpr reg ticks = r15;
+	constexpr reg allocable[] = {r12, r13, r14, rbp};
+
+	// the distance between the generation immediate of a link and the rel32
+	// of its jump: `cmp [rbx + disp32], imm32; jne rel32; jmp rel32`
+	constexpr ptrdiff_t link_generation = 4 + 6 + 1;
+
+	// the SIGSEGV handler replaced by the fastmem one
+	struct sigaction previous_segv;
+
+	bool is_store(cpu::op_id id) { return id == cpu::op_id::sb || id == cpu::op_id::sh || id == cpu::op_id::sw; }
+
+	// the registers read or written by an instruction translated to host code
+	template <typename F>
+	void for_each_reg(cpu::instruction const& i, F&& f) {
+		using cpu::op_id;
+		switch (i.id) {
+		case op_id::sll:
+		case op_id::srl:
+		case op_id::sra:
+			f(i.rt);
+			f(i.rd);
+			break;
+		case op_id::jr:
+		case op_id::mthi:
+		case op_id::mtlo:
+		case op_id::blez:
+		case op_id::bgtz:
+		case op_id::bltz:
+		case op_id::bgez:
+			f(i.rs);
+			break;
+		case op_id::jalr:
+			f(i.rs);
+			f(i.rd);
+			break;
+		case op_id::mfhi:
+		case op_id::mflo:
+			f(i.rd);
+			break;
+		case op_id::bltzal:
+		case op_id::bgezal:
+			f(i.rs);
+			f(31);
+			break;
+		case op_id::jal:
+			f(31);
+			break;
+		case op_id::lui:
+			f(i.rt);
+			break;
+		case op_id::sllv:
+		case op_id::srav:
+		case op_id::addu:
+		case op_id::subu:
+		case op_id::and_:
+		case op_id::or_:
+		case op_id::nor:
+		case op_id::slt:
+		case op_id::sltu:
+			f(i.rs);
+			f(i.rt);
+			f(i.rd);
+			break;
+		case op_id::beq:
+		case op_id::bne:
+		case op_id::addiu:
+		case op_id::slti:
+		case op_id::sltiu:
+		case op_id::andi:
+		case op_id::ori:
+		case op_id::lb:
+		case op_id::lh:
+		case op_id::lw:
+		case op_id::lbu:
+		case op_id::lhu:
+		case op_id::sb:
+		case op_id::sh:
+		case op_id::sw:
+			f(i.rs);
+			f(i.rt);
+			break;
+		default:
+			break;
+		}
+	}
+
+	// true if the instruction writes its destination register (which is
+	// then `rd` or `rt` depending on the encoding)
+	bool writes_rd(cpu::op_id id) {
+		using cpu::op_id;
+		switch (id) {
+		case op_id::sll:
+		case op_id::srl:
+		case op_id::sra:
+		case op_id::sllv:
+		case op_id::srav:
+		case op_id::jalr:
+		case op_id::mfhi:
+		case op_id::mflo:
+		case op_id::addu:
+		case op_id::subu:
+		case op_id::and_:
+		case op_id::or_:
+		case op_id::nor:
+		case op_id::slt:
+		case op_id::sltu:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool writes_rt(cpu::op_id id) {
+		using cpu::op_id;
+		switch (id) {
+		case op_id::addiu:
+		case op_id::slti:
+		case op_id::sltiu:
+		case op_id::andi:
+		case op_id::ori:
+		case op_id::lui:
+		case op_id::lb:
+		case op_id::lh:
+		case op_id::lw:
+		case op_id::lbu:
+		case op_id::lhu:
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+namespace cpu {
+	/**
+	 * \brief Translates a single block into host code
+	 *
+	 * The ops are translated in order; at any point of the generated code the
+	 * guest state is described by the address of the op being executed, so
+	 * the exits (out of budget, traps, self-modifying code) are emitted out
+	 * of line after the block body, each one writing back the exact state.
+	 */
+	class translator {
+	  public:
+		translator(recompiler& rc, emitter& e, block& b, uint32_t pc)
+		    : rc{rc}, e{e}, b{b}, pc{pc}, n{b.ops.size()}, host{}, dirty{}, offsets{rc.offsets} {
+			native.resize(n);
+			for (size_t m = 0; m < n; m++) {
+				// the branches located in a delay slot are left to the
+				// interpreter
+				native[m] = translatable(b.ops[m].id) && !(in_delay_slot(m) && has_delay_slot(b.ops[m].id));
+			}
+			allocate();
+		}
+
+		uint8_t* run() {
+			uint8_t* entry = e.here();
+
+			e.op64(alu::cmp, ticks, static_cast<uint32_t>(n));
+			exits.push_back({e.jcc(below), exit_kind::budget, 0});
+			e.op64(alu::sub, ticks, static_cast<uint32_t>(n));
+			reload();
+
+			for (size_t m = 0; m < n; m++) {
+				if (in_delay_slot(m)) {
+					// pc and npc are dynamic after a branch
+					e.mov(r32(rax), field(offsets.npc));
+					e.mov(field(offsets.pc), r32(rax));
+					e.op(alu::add, r32(rax), 4);
+					e.mov(field(offsets.npc), r32(rax));
+				}
+
+				if (native[m]) {
+					translate(m);
+				} else {
+					call_interpret(m);
+				}
+
+				if (m > 0 && may_invalidate(m - 1) && m + 1 < n) {
+					// the previous op may have invalidated this block; like the
+					// interpreter we stop after the current one.
+					e.mov64(rax, reinterpret_cast<uint64_t>(&b.valid));
+					e.cmp8(mem(rax, 0), 0);
+					exits.push_back({e.jcc(equal), exit_kind::after, m});
+				}
+			}
+			tail();
+
+			for (auto& s : stubs) {
+				emit_stub(s);
+			}
+			for (auto& x : exits) {
+				e.bind(x.site);
+				emit_exit(x.kind, x.m);
+			}
+			return entry;
+		}
+
+	  private:
+		enum class exit_kind { budget, after };
+
+		struct pending_exit {
+			uint8_t* site;
+			exit_kind kind;
+			size_t m;
+		};
+
+		// the slow path of a fastmem access, see `recompiler::fastmem_site`
+		struct pending_stub {
+			uint8_t* patch;
+			uint8_t const* access;
+			uint8_t const* resume;
+			// the jumps taken by the accesses that must not be tried
+			std::vector<uint8_t*> jumps;
+			size_t m;
+			void const* fn;
+			bool store;
+		};
+
+		static bool translatable(op_id id) {
+			switch (id) {
+			case op_id::syscall:
+			case op_id::mult:
+			case op_id::multu:
+			case op_id::div:
+			case op_id::divu:
+			case op_id::add:
+			case op_id::addi:
+			case op_id::cop0:
+			case op_id::cop2:
+			case op_id::lwc2:
+			case op_id::swc2:
+			case op_id::cop_unusable:
+			case op_id::unknown:
+				return false;
+			default:
+				return true;
+			}
+		}
+
+		bool in_delay_slot(size_t m) const { return m > 0 && has_delay_slot(b.ops[m - 1].id); }
+
+		bool may_invalidate(size_t m) const { return is_store(b.ops[m].id) || !native[m]; }
+
+		uint32_t address(size_t m) const { return pc + static_cast<uint32_t>(m * 4); }
+
+		// the branch target of the op `m`
+		uint32_t target(size_t m) const {
+			auto const& i = b.ops[m];
+			if (i.id == op_id::j || i.id == op_id::jal) {
+				return ((address(m) + 4) & 0xf000'0000) | i.target;
+			}
+			return address(m) + 4 + i.imm;
+		}
+
+	  private:
+		// keeps the most used guest registers of the block in host registers
+		void allocate() {
+			std::array<uint32_t, 32> uses{};
+			for (size_t m = 0; m < n; m++) {
+				if (native[m]) {
+					for_each_reg(b.ops[m], [&](uint8_t r) { uses[r]++; });
+				}
+			}
+
+			for (auto r : allocable) {
+				auto best = std::max_element(std::begin(uses), std::end(uses));
+				if (*best < 2) {
+					break;
+				}
+				auto guest = static_cast<uint8_t>(best - std::begin(uses));
+				host[guest] = r;
+				cached.push_back(guest);
+				*best = 0;
+			}
+
+			for (size_t m = 0; m < n; m++) {
+				auto const& i = b.ops[m];
+				if (!native[m]) {
+					continue;
+				}
+				if (writes_rd(i.id)) {
+					dirty[i.rd] = true;
+				} else if (writes_rt(i.id)) {
+					dirty[i.rt] = true;
+				} else if (i.id == op_id::jal || i.id == op_id::bltzal || i.id == op_id::bgezal) {
+					dirty[31] = true;
+				}
+			}
+		}
+
+		operand field(int32_t disp) const { return mem(state, disp); }
+
+		operand guest(uint8_t r) const {
+			if (host[r] != 0) {
+				return r32(host[r]);
+			}
+			return field(offsets.regs + 4 * r);
+		}
+
+		// copies the dirty cached registers back into `mips::regs`
+		void writeback() {
+			for (auto r : cached) {
+				if (dirty[r]) {
+					e.mov(field(offsets.regs + 4 * r), r32(host[r]));
+				}
+			}
+		}
+
+		void reload() {
+			for (auto r : cached) {
+				e.mov(r32(host[r]), field(offsets.regs + 4 * r));
+			}
+		}
+
+		// the ticks left after the op `m`, as seen by the interpreter
+		void ticks_left(reg dst, size_t m) { e.lea64(dst, ticks, static_cast<int32_t>(n - m - 1)); }
+
+		void call(void const* fn) {
+			e.mov64(rax, reinterpret_cast<uint64_t>(fn));
+			e.call(rax);
+		}
+
+	  private:
+		void translate(size_t m) {
+			auto const& i = b.ops[m];
+			uint32_t a = address(m);
+
+			switch (i.id) {
+			case op_id::sll:
+				shift_imm(i, x64::shl);
+				break;
+			case op_id::srl:
+			case op_id::sra: // the interpreter shifts logically
+				shift_imm(i, x64::shr);
+				break;
+			case op_id::sllv:
+				shift_var(i, x64::shl);
+				break;
+			case op_id::srav:
+				shift_var(i, x64::shr);
+				break;
+			case op_id::jr:
+				e.mov(r32(rax), guest(i.rs));
+				e.mov(field(offsets.npc), r32(rax));
+				break;
+			case op_id::jalr:
+				e.mov(r32(rax), guest(i.rs));
+				e.mov(guest(i.rd), a + 8);
+				e.mov(field(offsets.npc), r32(rax));
+				break;
+			case op_id::mfhi:
+				e.mov(r32(rax), field(offsets.hi));
+				e.mov(guest(i.rd), r32(rax));
+				break;
+			case op_id::mthi:
+				e.mov(r32(rax), guest(i.rs));
+				e.mov(field(offsets.hi), r32(rax));
+				break;
+			case op_id::mflo:
+				e.mov(r32(rax), field(offsets.lo));
+				e.mov(guest(i.rd), r32(rax));
+				break;
+			case op_id::mtlo:
+				e.mov(r32(rax), guest(i.rs));
+				e.mov(field(offsets.lo), r32(rax));
+				break;
+			case op_id::addu:
+				alu3(i, alu::add);
+				break;
+			case op_id::subu:
+				alu3(i, alu::sub);
+				break;
+			case op_id::and_:
+				alu3(i, alu::and_);
+				break;
+			case op_id::or_:
+				alu3(i, alu::or_);
+				break;
+			case op_id::nor:
+				e.mov(r32(rax), guest(i.rs));
+				e.op(alu::or_, r32(rax), guest(i.rt));
+				e.not_(rax);
+				e.mov(guest(i.rd), r32(rax));
+				break;
+			case op_id::slt:
+			case op_id::sltu:
+				e.mov(r32(rax), guest(i.rs));
+				e.op(alu::cmp, r32(rax), guest(i.rt));
+				e.setcc(i.id == op_id::slt ? less : below, rax);
+				e.mov(guest(i.rd), r32(rax));
+				break;
+			case op_id::bltz:
+				branch(m, less, false);
+				break;
+			case op_id::bgez:
+				branch(m, greater_equal, false);
+				break;
+			case op_id::bltzal:
+				branch(m, less, true);
+				break;
+			case op_id::bgezal:
+				branch(m, greater_equal, true);
+				break;
+			case op_id::blez:
+				branch(m, less_equal, false);
+				break;
+			case op_id::bgtz:
+				branch(m, greater, false);
+				break;
+			case op_id::beq:
+			case op_id::bne:
+				e.mov(r32(rax), guest(i.rs));
+				e.op(alu::cmp, r32(rax), guest(i.rt));
+				e.mov(r32(rcx), a + 8);
+				e.mov(r32(rdx), target(m));
+				e.cmov(i.id == op_id::beq ? equal : not_equal, rcx, r32(rdx));
+				e.mov(field(offsets.npc), r32(rcx));
+				break;
+			case op_id::jal:
+				e.mov(guest(31), a + 8);
+				[[fallthrough]];
+			case op_id::j:
+				e.mov(field(offsets.npc), target(m));
+				break;
+			case op_id::addiu:
+				alu_imm(i, alu::add, static_cast<uint32_t>(i.imm));
+				break;
+			case op_id::andi:
+				alu_imm(i, alu::and_, i.uimm);
+				break;
+			case op_id::ori:
+				alu_imm(i, alu::or_, i.uimm);
+				break;
+			case op_id::slti:
+			case op_id::sltiu:
+				e.mov(r32(rax), guest(i.rs));
+				e.op(alu::cmp, r32(rax), static_cast<uint32_t>(i.imm));
+				e.setcc(i.id == op_id::slti ? less : below, rax);
+				e.mov(guest(i.rt), r32(rax));
+				break;
+			case op_id::lui:
+				e.mov(guest(i.rt), i.uimm << 16);
+				break;
+			case op_id::lb:
+				load<uint8_t>(m);
+				e.movsx8(rax);
+				e.mov(guest(i.rt), r32(rax));
+				leave_if(rdx, m);
+				break;
+			case op_id::lh:
+				load<uint16_t>(m);
+				e.movsx16(rax);
+				e.mov(guest(i.rt), r32(rax));
+				leave_if(rdx, m);
+				break;
+			case op_id::lw:
+				load<uint32_t>(m);
+				e.mov(guest(i.rt), r32(rax));
+				leave_if(rdx, m);
+				break;
+			case op_id::lbu:
+				load<uint8_t>(m);
+				e.mov(guest(i.rt), r32(rax));
+				leave_if(rdx, m);
+				break;
+			case op_id::lhu:
+				load<uint16_t>(m);
+				e.mov(guest(i.rt), r32(rax));
+				leave_if(rdx, m);
+				break;
+			case op_id::sb:
+				store<uint8_t>(m);
+				break;
+			case op_id::sh:
+				store<uint16_t>(m);
+				break;
+			case op_id::sw:
+				store<uint32_t>(m);
+				break;
+			default:
+				assert(0);
+			}
+		}
+
+		void shift_imm(instruction const& i, x64::shift s) {
+			e.mov(r32(rax), guest(i.rt));
+			e.op(s, rax, i.shamt);
+			e.mov(guest(i.rd), r32(rax));
+		}
+
+		void shift_var(instruction const& i, x64::shift s) {
+			// the host masks the shift amount to 5 bits, like the interpreter
+			e.mov(r32(rcx), guest(i.rs));
+			e.mov(r32(rax), guest(i.rt));
+			e.op_cl(s, rax);
+			e.mov(guest(i.rd), r32(rax));
+		}
+
+		void alu3(instruction const& i, alu o) {
+			e.mov(r32(rax), guest(i.rs));
+			e.op(o, r32(rax), guest(i.rt));
+			e.mov(guest(i.rd), r32(rax));
+		}
+
+		void alu_imm(instruction const& i, alu o, uint32_t imm) {
+			e.mov(r32(rax), guest(i.rs));
+			e.op(o, r32(rax), imm);
+			e.mov(guest(i.rt), r32(rax));
+		}
+
+		void branch(size_t m, cond c, bool link) {
+			auto const& i = b.ops[m];
+			e.mov(r32(rax), guest(i.rs));
+			e.test(rax, rax);
+			if (link) {
+				e.mov(guest(31), address(m) + 8);
+			}
+			e.mov(r32(rcx), address(m) + 8);
+			e.mov(r32(rdx), target(m));
+			e.cmov(c, rcx, r32(rdx));
+			e.mov(field(offsets.npc), r32(rcx));
+		}
+
+		// leaves the loaded value in rax and, if the deadline has changed,
+		// a non zero value in rdx
+		template <typename T>
+		void load(size_t m) {
+			auto const& i = b.ops[m];
+			auto fn = reinterpret_cast<void const*>(&recompiler::load<T>);
+			e.mov(r32(rsi), guest(i.rs));
+			e.op(alu::add, r32(rsi), static_cast<uint32_t>(i.imm));
+			if (rc.fastmem_base == nullptr) {
+				e.mov64(rdi, state);
+				ticks_left(rdx, m);
+				call(fn);
+				return;
+			}
+
+			pending_stub s{e.here(), nullptr, nullptr, {}, m, fn, false};
+			check_alignment(s, sizeof(T));
+			e.mov64(rdi, reinterpret_cast<uint64_t>(rc.fastmem_base));
+			s.access = e.here();
+			e.load_indexed(sizeof(T), rax, rdi, rsi);
+			e.op(alu::xor_, r32(rdx), r32(rdx));
+			s.resume = e.here();
+			stubs.push_back(std::move(s));
+		}
+
+		template <typename T>
+		void store(size_t m) {
+			auto const& i = b.ops[m];
+			auto fn = reinterpret_cast<void const*>(&recompiler::store<T>);
+			e.mov(r32(rsi), guest(i.rs));
+			e.op(alu::add, r32(rsi), static_cast<uint32_t>(i.imm));
+			e.mov(r32(rdx), guest(i.rt));
+			if (rc.fastmem_base == nullptr) {
+				e.mov64(rdi, state);
+				ticks_left(rcx, m);
+				call(fn);
+				leave_if(rax, m);
+				return;
+			}
+
+			pending_stub s{e.here(), nullptr, nullptr, {}, m, fn, true};
+			// the stores to the isolated cache are left to the cpu
+			e.test(field(offsets.sr), sr_bits::IsC.mask);
+			s.jumps.push_back(e.jcc(not_equal));
+			check_alignment(s, sizeof(T));
+			e.mov64(rdi, reinterpret_cast<uint64_t>(rc.fastmem_base));
+			s.access = e.here();
+			e.store_indexed(sizeof(T), rdi, rsi, rdx);
+			s.resume = e.here();
+			stubs.push_back(std::move(s));
+		}
+
+		// the unaligned accesses are left to the cpu (that reports them)
+		void check_alignment(pending_stub& s, uint8_t size) {
+			if (size > 1) {
+				e.test(r32(rsi), size - 1u);
+				s.jumps.push_back(e.jcc(not_equal));
+			}
+		}
+
+		// calls the helper of the access with the registers of the fast path
+		void emit_stub(pending_stub const& s) {
+			uint8_t const* stub = e.here();
+			for (auto site : s.jumps) {
+				e.bind(site);
+			}
+			e.mov64(rdi, state);
+			ticks_left(s.store ? rcx : rdx, s.m);
+			call(s.fn);
+			if (s.store) {
+				leave_if(rax, s.m);
+			}
+			e.jmp(s.resume);
+			rc.sites.push_back({s.access, s.patch, stub});
+		}
+
+		// returns to the dispatcher after the op `m` if `r` is not zero
+		void leave_if(reg r, size_t m) {
+			e.test(r, r);
+			exits.push_back({e.jcc(not_equal), exit_kind::after, m});
+		}
+
+		void call_interpret(size_t m) {
+			uint32_t a = address(m);
+			bool ds = in_delay_slot(m);
+			if (!ds) {
+				e.mov(field(offsets.pc), a + 4);
+				e.mov(field(offsets.npc), a + 8);
+			}
+			writeback();
+			e.mov64(rdi, state);
+			e.mov64(rsi, reinterpret_cast<uint64_t>(&b.ops[m]));
+			ticks_left(rdx, m);
+			call(reinterpret_cast<void const*>(&recompiler::interpret));
+			reload();
+			leave_if(rax, m);
+
+			if (!ds) {
+				// a trap changes the control flow
+				e.op(alu::cmp, field(offsets.npc), a + 8);
+				exits.push_back({e.jcc(not_equal), exit_kind::after, m});
+			}
+		}
+
+	  private:
+		void tail() {
+			size_t last = n - 1;
+			if (in_delay_slot(last)) {
+				size_t br = last - 1;
+				auto id = b.ops[br].id;
+				bool linkable = native[br] && native[last] && id != op_id::jr && id != op_id::jalr;
+				if (!linkable) {
+					exit_dynamic();
+				} else if (id == op_id::j || id == op_id::jal) {
+					link(target(br));
+				} else {
+					e.op(alu::cmp, field(offsets.pc), target(br));
+					uint8_t* not_taken = e.jcc(not_equal);
+					link(target(br));
+					e.bind(not_taken);
+					link(address(br) + 8);
+				}
+			} else if (has_delay_slot(b.ops[last].id)) {
+				// the block has been cut right after a branch
+				emit_exit(exit_kind::after, last);
+			} else {
+				link(address(last) + 4);
+			}
+		}
+
+		void exit_dynamic() {
+			writeback();
+			e.mov(r32(rax), 0);
+			e.jmp(rc.epilogue);
+		}
+
+		/**
+		 * \brief emits a jump to the block at `target`
+		 *
+		 * The jump initially leads to a stub that returns to the dispatcher
+		 * with the location to patch.
+		 */
+		void link(uint32_t target) {
+			writeback();
+			if (target == pc && b.polling) {
+				// a polling loop returns to the dispatcher at every iteration
+				// to be checked for idleness, see `mips::skip_idle`.
+				e.mov(field(offsets.pc), target);
+				e.mov(field(offsets.npc), target + 4);
+				e.mov(r32(rax), 0);
+				e.jmp(rc.epilogue);
+				return;
+			}
+
+			e.op(alu::cmp, field(offsets.generation), rc.cpu->blocks.generation());
+			uint8_t* guard = e.jcc(not_equal);
+			uint8_t* site = e.jmp();
+			assert(site == guard + 5);
+
+			e.bind(guard);
+			e.bind(site);
+			e.mov(field(offsets.pc), target);
+			e.mov(field(offsets.npc), target + 4);
+			e.mov64(rax, reinterpret_cast<uint64_t>(site));
+			e.jmp(rc.epilogue);
+		}
+
+		void emit_exit(exit_kind kind, size_t m) {
+			if (kind == exit_kind::budget) {
+				e.mov(field(offsets.pc), pc);
+				e.mov(field(offsets.npc), pc + 4);
+				e.mov(r32(rax), 0);
+				e.jmp(rc.epilogue);
+				return;
+			}
+
+			// refund the ticks of the ops not executed
+			if (m + 1 < n) {
+				e.op64(alu::add, ticks, static_cast<uint32_t>(n - m - 1));
+			}
+			if (!in_delay_slot(m)) {
+				e.mov(field(offsets.pc), address(m) + 4);
+				if (native[m] && !has_delay_slot(b.ops[m].id)) {
+					e.mov(field(offsets.npc), address(m) + 8);
+				}
+			}
+			exit_dynamic();
+		}
+
+	  private:
+		recompiler& rc;
+		emitter& e;
+		block& b;
+		uint32_t pc;
+		size_t n;
+
+		std::vector<bool> native;
+
+		// the host register of every guest register, 0 (rax) if not cached
+		std::array<reg, 32> host;
+		std::array<bool, 32> dirty;
+		std::vector<uint8_t> cached;
+
+		std::vector<pending_exit> exits;
+		std::vector<pending_stub> stubs;
+		recompiler::layout const& offsets;
+	};
+
+	thread_local recompiler* recompiler::running = nullptr;
+
+	recompiler::recompiler(mips& m) : cpu{&m}, code{nullptr}, epoch{0}, until{0}, fastmem_base{nullptr} {
+		void* p = mmap(nullptr, code_size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			psycris::log->warn("[CPU] cannot allocate the memory for the recompiler ({}), using the cached interpreter",
+			                   std::strerror(errno));
+			return;
+		}
+		code = static_cast<uint8_t*>(p);
+
+		auto offset = [&](void const* field) {
+			return static_cast<int32_t>(static_cast<uint8_t const*>(field) - reinterpret_cast<uint8_t const*>(cpu));
+		};
+		offsets = {
+		    offset(&m.regs),
+		    offset(&m.mult_regs[0]),
+		    offset(&m.mult_regs[1]),
+		    offset(&m.pc),
+		    offset(&m.npc),
+		    offset(&m.blocks.generation()),
+		    offset(&m.cop0.regs[cop0::SR]),
+		};
+
+		if (m.fastmem() != nullptr) {
+			fastmem_base = m.fastmem()->base();
+
+			// the handler is installed again if it has been replaced
+			static std::mutex installing;
+			std::lock_guard<std::mutex> lock{installing};
+			struct sigaction current;
+			sigaction(SIGSEGV, nullptr, &current);
+			if (!(current.sa_flags & SA_SIGINFO) || current.sa_sigaction != &recompiler::on_fault) {
+				struct sigaction sa = {};
+				sa.sa_sigaction = &recompiler::on_fault;
+				sa.sa_flags = SA_SIGINFO;
+				sigemptyset(&sa.sa_mask);
+				sigaction(SIGSEGV, &sa, &previous_segv);
+			}
+		}
+
+		flush();
+	}
+
+	recompiler::~recompiler() {
+		if (code) {
+			munmap(code, code_size);
+		}
+	}
+
+	bool recompiler::available() { return true; }
+
+	void recompiler::flush() {
+		epoch++;
+		pending = {nullptr, 0, 0};
+		sites.clear();
+
+		emitter e{code, code + code_size};
+
+		// exit_state enter(mips* rdi, void const* code rsi, uint64_t ticks rdx)
+		enter = reinterpret_cast<entry_fn>(e.here());
+		for (auto r : {rbx, rbp, r12, r13, r14, r15}) {
+			e.push(r);
+		}
+		// keep the stack aligned for the helper calls
+		e.op64(alu::sub, rsp, 8);
+		e.mov64(state, rdi);
+		e.mov64(ticks, rdx);
+		e.jmp(rsi);
+
+		epilogue = e.here();
+		e.mov64(rdx, ticks);
+		e.op64(alu::add, rsp, 8);
+		for (auto r : {r15, r14, r13, r12, rbp, rbx}) {
+			e.pop(r);
+		}
+		e.ret();
+
+		free = e.here();
+	}
+
+	void const* recompiler::translate(block& b, uint32_t pc) {
+		if (static_cast<size_t>(code + code_size - free) < max_block_code) {
+			flush();
+		}
+
+		emitter e{free, free + max_block_code};
+		translator t{*this, e, b, pc};
+		uint8_t* entry = t.run();
+		free = e.here();
+
+		b.native.push_back({pc, epoch, entry});
+		return entry;
+	}
+
+	void recompiler::link(uint8_t* site, void const* target) {
+		uint32_t generation = cpu->blocks.generation();
+		std::memcpy(site - link_generation, &generation, sizeof(generation));
+		emitter::bind(site, static_cast<uint8_t const*>(target));
+	}
+
+	void recompiler::run(block& b, uint32_t pc) {
+		until = cpu->slice_end;
+
+		// forget the code of the previous flushes
+		auto& native = b.native;
+		native.erase(std::remove_if(std::begin(native),
+		                            std::end(native),
+		                            [&](auto const& x) { return x.epoch != epoch; }),
+		             std::end(native));
+
+		auto code = std::find_if(std::begin(native), std::end(native), [&](auto const& x) { return x.pc == pc; });
+		void const* entry = code != std::end(native) ? code->entry : translate(b, pc);
+
+		if (pending.site != nullptr && pending.pc == pc && pending.epoch == epoch) {
+			link(pending.site, entry);
+		}
+
+		running = this;
+		exit_state exit = enter(cpu, entry, until - cpu->clock);
+		running = nullptr;
+		cpu->clock = until - exit.ticks_left;
+
+		if (exit.link != nullptr) {
+			pending = {exit.link, cpu->pc, epoch};
+		} else {
+			pending = {nullptr, 0, 0};
+		}
+	}
+
+	uint8_t const* recompiler::recover(uint8_t const* rip, void const* addr) {
+		if (fastmem_base == nullptr || !cpu->fastmem()->contains(addr)) {
+			return nullptr;
+		}
+		auto site = std::lower_bound(std::begin(sites), std::end(sites), rip, [](auto const& s, uint8_t const* p) {
+			return s.access < p;
+		});
+		if (site == std::end(sites) || site->access != rip) {
+			return nullptr;
+		}
+
+		// from now on the access is always served by the stub
+		emitter e{site->patch, site->patch + 5};
+		e.jmp(site->stub);
+		return site->stub;
+	}
+
+	void recompiler::on_fault(int sig, siginfo_t* info, void* context) {
+		auto& rip = static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_RIP];
+		if (running != nullptr) {
+			if (uint8_t const* stub = running->recover(reinterpret_cast<uint8_t const*>(rip), info->si_addr)) {
+				rip = reinterpret_cast<greg_t>(stub);
+				return;
+			}
+		}
+
+		// a genuine fault
+		if (previous_segv.sa_flags & SA_SIGINFO) {
+			previous_segv.sa_sigaction(sig, info, context);
+		} else if (previous_segv.sa_handler != SIG_DFL && previous_segv.sa_handler != SIG_IGN) {
+			previous_segv.sa_handler(sig);
+		} else {
+			// the faulting instruction is executed again, and kills the
+			// process
+			signal(sig, SIG_DFL);
+		}
+	}
+
+	template <typename T>
+	recompiler::loaded recompiler::load(mips* cpu, uint32_t addr, uint64_t ticks_left) {
+		cpu->clock = cpu->jit->until - ticks_left;
+		uint32_t value = cpu->read<T>(addr);
+		return {value, cpu->slice_end != cpu->jit->until};
+	}
+
+	template <typename T>
+	uint32_t recompiler::store(mips* cpu, uint32_t addr, uint32_t value, uint64_t ticks_left) {
+		cpu->clock = cpu->jit->until - ticks_left;
+		cpu->write(addr, static_cast<T>(value));
+		return cpu->slice_end != cpu->jit->until;
+	}
+
+	uint32_t recompiler::interpret(mips* cpu, instruction const* i, uint64_t ticks_left) {
+		cpu->clock = cpu->jit->until - ticks_left;
+		cpu->ins = i->ins;
+		cpu->execute(*i);
+		return cpu->slice_end != cpu->jit->until;
+	}
+}
+#else
+namespace cpu {
+	recompiler::recompiler(mips& m)
+	    : cpu{&m},
+	      code{nullptr},
+	      free{nullptr},
+	      enter{nullptr},
+	      epilogue{nullptr},
+	      epoch{0},
+	      until{0},
+	      pending{},
+	      fastmem_base{nullptr} {}
+
+	recompiler::~recompiler() = default;
+
+	bool recompiler::available() { return false; }
+
+	void recompiler::run(block&, uint32_t) { assert(0); }
+}
+#endif
@@ -0,0 +1,170 @@
+#pragma once
+#include "block_cache.hpp"
+
+#include <csignal>
+#include <cstdint>
+#include <vector>
+
+namespace cpu {
+	class mips;
+
+	/**
+	 * \brief An x86-64 dynamic recompiler for the blocks of the `block_cache`
+	 *
+	 * Every block is translated into host code once for every guest address
+	 * it is executed from (the mirrors of the same memory share the block,
+	 * but not the generated code, because of the absolute jumps).
+	 *
+	 * The generated code keeps the most used guest registers of a block in
+	 * host registers, calls into `mips::read`/`mips::write` for the loads and
+	 * stores, and into `mips::execute` for the instructions it does not
+	 * translate (coprocessors, traps, multiplications and divisions and the
+	 * unknown opcodes).
+	 *
+	 * If the cpu has a fastmem (see `mips::map_fastmem`) the loads and
+	 * stores access it directly, with a single host instruction; when one of
+	 * them faults (the page is an I/O one or it is watched) the SIGSEGV
+	 * handler resumes the execution in an out of line stub that calls into
+	 * the cpu, and the access is patched to always take the stub from then
+	 * on.
+	 *
+	 * A block jumps directly into the next one; the jump is patched the first
+	 * time it is taken and it is guarded by the block cache generation, so an
+	 * invalidation breaks all the links at once. The cpu state (`regs`, `pc`,
+	 * `npc` and `clock`) is in sync with the interpreter every time the
+	 * control returns to `mips::run_jit`.
+	 *
+	 * On a host other than x86-64 `available()` returns false and the cpu
+	 * falls back to the cached interpreter; so it does when the host refuses
+	 * the executable memory for the generated code (`ready()` is false).
+	 */
+	class recompiler {
+	  public:
+		recompiler(mips&);
+		~recompiler();
+
+		recompiler(recompiler const&) = delete;
+		recompiler& operator=(recompiler const&) = delete;
+
+	  public:
+		static bool available();
+
+		/**
+		 * \brief false if the memory for the host code could not be allocated
+		 */
+		bool ready() const { return code != nullptr; }
+
+		/**
+		 * \brief runs the host code for the block `b`, executed from `pc`
+		 *
+		 * The block is translated if needed; the execution continues through
+		 * the linked blocks until an exit is reached or there are not enough
+		 * ticks left before `mips::deadline()` to execute a whole block.
+		 */
+		void run(block& b, uint32_t pc);
+
+	  private:
+		struct exit_state {
+			// the jump to patch to link the next block, nullptr if the exit
+			// is not linkable
+			uint8_t* link;
+			// how many ticks are left before `until`
+			uint64_t ticks_left;
+		};
+
+		using entry_fn = exit_state (*)(mips*, void const* code, uint64_t ticks);
+
+		// a link reached by the last run, patched if the next run starts
+		// from `pc`
+		struct link_request {
+			uint8_t* site;
+			uint32_t pc;
+			uint32_t epoch;
+		};
+
+		// the displacements of the `mips` fields used by the generated code
+		struct layout {
+			int32_t regs;
+			int32_t lo;
+			int32_t hi;
+			int32_t pc;
+			int32_t npc;
+			int32_t generation;
+			int32_t sr;
+		};
+
+		// a load or a store of the fastmem; if the `access` faults the code
+		// from `patch` on is replaced with a jump to `stub`, that completes
+		// the access through the cpu.
+		struct fastmem_site {
+			uint8_t const* access;
+			uint8_t* patch;
+			uint8_t const* stub;
+		};
+
+		void const* translate(block& b, uint32_t pc);
+
+		void flush();
+
+		void link(uint8_t* site, void const* target);
+
+		/**
+		 * \brief the stub of the fastmem access at `rip`, patching the access
+		 *
+		 * Returns nullptr if `rip` is not a fastmem access or `addr` is not
+		 * in the fastmem. Called by the signal handler.
+		 */
+		uint8_t const* recover(uint8_t const* rip, void const* addr);
+
+		static void on_fault(int sig, siginfo_t* info, void* context);
+
+	  private:
+		// The helpers called by the generated code; they return true when the
+		// deadline of the cpu has been changed (by a device scheduling an
+		// event), the generated code then returns to the dispatcher.
+		struct loaded {
+			uint32_t value;
+			uint64_t leave;
+		};
+
+		template <typename T>
+		static loaded load(mips*, uint32_t addr, uint64_t ticks_left);
+
+		template <typename T>
+		static uint32_t store(mips*, uint32_t addr, uint32_t value, uint64_t ticks_left);
+
+		static uint32_t interpret(mips*, instruction const*, uint64_t ticks_left);
+
+	  private:
+		mips* cpu;
+
+		// the executable memory
+		uint8_t* code;
+		uint8_t* free;
+
+		entry_fn enter;
+		uint8_t const* epilogue;
+
+		// incremented every time the code memory is flushed
+		uint32_t epoch;
+
+		// the deadline of the current `run` (used to compute the clock)
+		uint64_t until;
+
+		link_request pending;
+
+		layout offsets;
+
+		// the base of the fastmem, nullptr if the accesses go through the
+		// helpers
+		uint8_t* fastmem_base;
+
+		// sorted by `access`, emptied at every flush
+		std::vector<fastmem_site> sites;
+
+		// the recompiler running on this thread, see `on_fault`
+		static thread_local recompiler* running;
+
+		friend class translator;
+	};
+}
@@ -0,0 +1,156 @@
+#include "trace_recorder.hpp"
+#include "../logging.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+	// the file is grown (and mapped again) in steps of this size
+	constexpr size_t file_step = 64 << 20;
+}
+
+namespace cpu {
+	std::unique_ptr<trace_recorder> trace_recorder::create(std::string const& path, uint64_t clock) {
+		int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			psycris::log->critical("cannot create the trace file {}: {}", path, std::strerror(errno));
+			return nullptr;
+		}
+
+		std::unique_ptr<trace_recorder> r{new trace_recorder(fd, clock)};
+		if (!r->grow(file_step)) {
+			psycris::log->critical("cannot map the trace file {}: {}", path, std::strerror(errno));
+			return nullptr;
+		}
+
+		trace_header h;
+		std::memcpy(h.magic, trace_header::signature, sizeof(h.magic));
+		h.version = trace_header::current_version;
+		h.record_size = sizeof(trace_record);
+		h.start_clock = clock;
+		std::memcpy(r->mapped, &h, sizeof(h));
+		r->size = sizeof(h);
+
+		r->writer = std::thread(&trace_recorder::drain, r.get());
+		return r;
+	}
+
+	trace_recorder::trace_recorder(int fd, uint64_t clock)
+	    : last_clock{clock},
+	      ring(ring_size),
+	      head{0},
+	      cached_tail{0},
+	      tail{0},
+	      closing{false},
+	      failed{false},
+	      error{0},
+	      fd{fd},
+	      mapped{nullptr},
+	      mapped_size{0},
+	      size{0} {}
+
+	trace_recorder::~trace_recorder() { finish(); }
+
+	bool trace_recorder::finish() {
+		if (fd < 0) {
+			return !failed;
+		}
+
+		if (writer.joinable()) {
+			closing.store(true, std::memory_order_release);
+			writer.join();
+		}
+		if (mapped) {
+			::munmap(mapped, mapped_size);
+			mapped = nullptr;
+		}
+		if (size > 0 && ::ftruncate(fd, size) != 0) {
+			psycris::log->error("cannot truncate the trace file: {}", std::strerror(errno));
+		}
+		::close(fd);
+		fd = -1;
+
+		if (failed) {
+			psycris::log->critical("cannot grow the trace file, the trace is incomplete: {}", std::strerror(error));
+			return false;
+		}
+		return true;
+	}
+
+	void trace_recorder::drain() {
+		uint64_t t = tail.load(std::memory_order_relaxed);
+		while (true) {
+			// read `closing` before `head`, the last records pushed are
+			// visible once the cpu has stopped
+			bool last = closing.load(std::memory_order_acquire);
+			uint64_t h = head.load(std::memory_order_acquire);
+			if (h == t) {
+				if (last) {
+					return;
+				}
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+				continue;
+			}
+
+			while (t != h) {
+				size_t ix = t & mask;
+				size_t n = std::min<uint64_t>(h - t, ring.size() - ix);
+				if (!write_out(&ring[ix], n)) {
+					// the failure is reported by `finish`, on the cpu thread
+					error = errno;
+					failed.store(true, std::memory_order_release);
+					return;
+				}
+				t += n;
+			}
+			tail.store(t, std::memory_order_release);
+		}
+	}
+
+	bool trace_recorder::write_out(trace_record const* r, size_t n) {
+		size_t bytes = n * sizeof(trace_record);
+		if (size + bytes > mapped_size && !grow(std::max(mapped_size * 2, size + bytes))) {
+			return false;
+		}
+		std::memcpy(mapped + size, r, bytes);
+		size += bytes;
+		return true;
+	}
+
+	bool trace_recorder::grow(size_t new_size) {
+		if (mapped) {
+			::munmap(mapped, mapped_size);
+			mapped = nullptr;
+		}
+		if (::ftruncate(fd, new_size) != 0) {
+			return false;
+		}
+		void* p = ::mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (p == MAP_FAILED) {
+			return false;
+		}
+		mapped = static_cast<uint8_t*>(p);
+		mapped_size = new_size;
+		return true;
+	}
+}
+
+namespace cpu {
+	trace_reader::trace_reader(std::istream& s) : in{&s}, head{}, ok{false} {
+		in->read(reinterpret_cast<char*>(&head), sizeof(head));
+		ok = *in && std::memcmp(head.magic, trace_header::signature, sizeof(head.magic)) == 0 &&
+		     head.version == trace_header::current_version && head.record_size == sizeof(trace_record);
+	}
+
+	bool trace_reader::next(trace_record& r) {
+		if (!ok) {
+			return false;
+		}
+		return static_cast<bool>(in->read(reinterpret_cast<char*>(&r), sizeof(r)));
+	}
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cpu {
+	/**
+	 * \brief An executed instruction, as stored in a binary trace
+	 */
+	struct trace_record {
+		static constexpr uint8_t no_reg = 0xff;
+		static constexpr uint8_t mem_write = 0x80;
+
+		uint32_t pc;
+		uint32_t ins;
+		// the ticks elapsed since the previous record
+		uint32_t clock_delta;
+		uint32_t reg_value;
+		uint32_t mem_addr;
+		uint32_t mem_value;
+		// the register written by the instruction, or `no_reg`
+		uint8_t reg;
+		// the size of the memory access (0 if none), or'ed with `mem_write`
+		// for a store
+		uint8_t mem;
+		uint16_t reserved;
+	};
+	static_assert(sizeof(trace_record) == 28);
+
+	/**
+	 * \brief The header at the beginning of a binary trace file
+	 *
+	 * The records follow the header, the clock of a record is `start_clock`
+	 * plus the deltas of all the records up to it.
+	 */
+	struct trace_header {
+		static constexpr char signature[8] = {'P', 'S', 'X', 'T', 'R', 'A', 'C', 'E'};
+		static constexpr uint32_t current_version = 0x1;
+
+		char magic[8];
+		uint32_t version;
+		uint32_t record_size;
+		uint64_t start_clock;
+	};
+
+	/**
+	 * \brief Records a binary trace into a file
+	 *
+	 * The cpu pushes the records into a single producer, single consumer
+	 * ring buffer; a writer thread drains them into the file, mapped in
+	 * memory and grown as needed. When the ring is full the cpu waits for
+	 * the writer, no record is lost.
+	 *
+	 * If the file cannot be grown the writer stops; from then on the records
+	 * that do not fit in the ring are dropped and `finish` reports the
+	 * failure. The file is completed by `finish`, or when the recorder is
+	 * destroyed.
+	 */
+	class trace_recorder {
+	  public:
+		/**
+		 * \brief creates the trace file `path`
+		 *
+		 * `clock` is the clock of the cpu when the recording starts; returns
+		 * nullptr (after logging the reason) if the file cannot be created.
+		 */
+		static std::unique_ptr<trace_recorder> create(std::string const& path, uint64_t clock);
+
+		~trace_recorder();
+
+		trace_recorder(trace_recorder const&) = delete;
+		trace_recorder& operator=(trace_recorder const&) = delete;
+
+	  public:
+		void push(trace_record const& r) {
+			uint64_t h = head.load(std::memory_order_relaxed);
+			while (h - cached_tail == ring.size()) {
+				cached_tail = tail.load(std::memory_order_acquire);
+				if (h - cached_tail == ring.size()) {
+					if (failed.load(std::memory_order_acquire)) {
+						// the writer is gone, the ring is never drained again
+						return;
+					}
+					std::this_thread::yield();
+				}
+			}
+			ring[h & mask] = r;
+			head.store(h + 1, std::memory_order_release);
+		}
+
+		/**
+		 * \brief waits for the writer to store all the records and closes
+		 * the file
+		 *
+		 * Returns false (after logging the reason) if the writer failed and
+		 * the trace is incomplete. Nothing can be pushed after `finish`.
+		 */
+		bool finish();
+
+		// the clock of the last record pushed
+		uint64_t last_clock;
+
+	  private:
+		trace_recorder(int fd, uint64_t clock);
+
+		void drain();
+		bool write_out(trace_record const* r, size_t n);
+		bool grow(size_t size);
+
+	  private:
+		static constexpr size_t ring_size = 1 << 16;
+		static constexpr size_t mask = ring_size - 1;
+
+		std::vector<trace_record> ring;
+
+		// the producer (cpu) side
+		alignas(64) std::atomic<uint64_t> head;
+		uint64_t cached_tail;
+
+		// the consumer (writer) side
+		alignas(64) std::atomic<uint64_t> tail;
+		std::atomic<bool> closing;
+		// set by the writer when it stops, after `error`
+		std::atomic<bool> failed;
+		int error;
+
+		int fd;
+		uint8_t* mapped;
+		size_t mapped_size;
+		// the bytes already written in the file
+		size_t size;
+
+		std::thread writer;
+	};
+
+	/**
+	 * \brief Reads back a binary trace
+	 */
+	class trace_reader {
+	  public:
+		trace_reader(std::istream&);
+
+		/**
+		 * \brief false if the stream does not start with a valid header
+		 */
+		bool valid() const { return ok; }
+
+		trace_header const& header() const { return head; }
+
+		/**
+		 * \brief reads the next record, false at the end of the trace
+		 */
+		bool next(trace_record&);
+
+	  private:
+		std::istream* in;
+		trace_header head;
+		bool ok;
+	};
+}
@@ -0,0 +1,27 @@
+#include "tracing.hpp"
+#include "../logging.hpp"
+#include "cpu.hpp"
+
+#include <cassert>
+
+namespace cpu {
+	// only the changes made during this run are traced
+	text_trace::text_trace(mips const& cpu) : text_trace(cpu.regs) {}
+
+	text_trace::text_trace(registers const& r) : regs{r} {}
+
+	void text_trace::fetched(uint32_t pc, uint64_t clock, decoder ins, registers const&) {
+		psycris::log->trace("{:0>8x}@{}: {}", pc, clock, disassembly(ins, pc));
+	}
+
+	void text_trace::executed(registers const& r) { regs.trace(r); }
+
+	binary_trace::binary_trace(mips const& cpu) : recorder{cpu.recorder()}, r{} {
+		assert(recorder);
+		last_clock = recorder->last_clock;
+	}
+
+	binary_trace::~binary_trace() { recorder->last_clock = last_clock; }
+
+	profile::profile(mips const& cpu) : p{cpu.profiled_by()} { assert(p); }
+}
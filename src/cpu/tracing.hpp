@@ -0,0 +1,128 @@
+#pragma once
+#include "decoder.hpp"
+#include "disassembly.hpp"
+#include "profiler.hpp"
+#include "trace_recorder.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace cpu {
+	class mips;
+
+	using registers = std::array<uint32_t, 32>;
+
+	/**
+	 * \brief The tracing policies of `mips::run`
+	 *
+	 * A policy is constructed at the beginning of every run; `fetched` is
+	 * called with every instruction about to be executed, together with its
+	 * address, the clock and the registers, and `executed` right after its
+	 * execution.
+	 *
+	 * `run` is instantiated for every policy, so a policy that does nothing
+	 * costs nothing.
+	 */
+	struct no_trace {
+		explicit no_trace(mips const&) {}
+
+		void fetched(uint32_t, uint64_t, decoder, registers const&) {}
+		void executed(registers const&) {}
+	};
+
+	/**
+	 * \brief logs the disassembly of every instruction and the registers it
+	 * changes
+	 */
+	struct text_trace {
+		explicit text_trace(mips const&);
+		explicit text_trace(registers const&);
+
+		void fetched(uint32_t pc, uint64_t clock, decoder ins, registers const&);
+		void executed(registers const&);
+
+		reg_tracer regs;
+	};
+
+	/**
+	 * \brief records every instruction into the `trace_recorder` of the cpu
+	 *
+	 * The memory access of the loads and the stores is computed from the
+	 * registers before the execution, the written register is found
+	 * comparing the registers before and after it.
+	 */
+	struct binary_trace {
+		explicit binary_trace(mips const&);
+		~binary_trace();
+
+		void fetched(uint32_t pc, uint64_t clock, decoder ins, registers const& regs) {
+			r.pc = pc;
+			r.ins = ins;
+			r.clock_delta = static_cast<uint32_t>(clock - last_clock);
+			last_clock = clock;
+
+			r.mem = access_size(ins);
+			if (r.mem) {
+				r.mem_addr = regs[ins.rs()] + ins.imm();
+				if (r.mem & trace_record::mem_write) {
+					uint32_t bits = (r.mem & 0x7) * 8;
+					r.mem_value = bits == 32 ? regs[ins.rt()] : regs[ins.rt()] & ((1u << bits) - 1);
+				}
+			}
+			before = regs;
+		}
+
+		void executed(registers const& regs) {
+			r.reg = trace_record::no_reg;
+			for (uint8_t ix = 0; ix < regs.size(); ix++) {
+				if (regs[ix] != before[ix]) {
+					r.reg = ix;
+					r.reg_value = regs[ix];
+					break;
+				}
+			}
+			if (r.mem && !(r.mem & trace_record::mem_write)) {
+				r.mem_value = regs[decoder{r.ins}.rt()];
+			}
+			recorder->push(r);
+		}
+
+		static uint8_t access_size(decoder ins) {
+			switch (ins.opcode()) {
+			case 0x20: // lb
+			case 0x24: // lbu
+				return 1;
+			case 0x21: // lh
+			case 0x25: // lhu
+				return 2;
+			case 0x23: // lw
+				return 4;
+			case 0x28: // sb
+				return 1 | trace_record::mem_write;
+			case 0x29: // sh
+				return 2 | trace_record::mem_write;
+			case 0x2b: // sw
+				return 4 | trace_record::mem_write;
+			default:
+				return 0;
+			}
+		}
+
+		trace_recorder* recorder;
+		uint64_t last_clock;
+		trace_record r;
+		registers before;
+	};
+
+	/**
+	 * \brief feeds every instruction to the `profiler` of the cpu
+	 */
+	struct profile {
+		explicit profile(mips const&);
+
+		void fetched(uint32_t pc, uint64_t, decoder ins, registers const&) { p->instruction(pc, ins); }
+		void executed(registers const&) {}
+
+		profiler* p;
+	};
+}
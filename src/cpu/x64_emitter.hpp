@@ -0,0 +1,298 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * \brief A minimal x86-64 machine code emitter
+ *
+ * Only the handful of instructions needed by the recompiler are supported.
+ * Unless stated otherwise the operations are 32 bit wide; an operand is
+ * either a register or a dword in memory at `[base + disp32]`. Only the
+ * indexed loads and stores address the memory at `[base + index]`.
+ */
+namespace cpu::x64 {
+	enum reg : uint8_t { rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi, r8, r9, r10, r11, r12, r13, r14, r15 };
+
+	enum cond : uint8_t {
+		below = 0x2,
+		above_equal = 0x3,
+		equal = 0x4,
+		not_equal = 0x5,
+		less = 0xc,
+		greater_equal = 0xd,
+		less_equal = 0xe,
+		greater = 0xf,
+	};
+
+	// the opcode extension (the /digit) of the group 1 (81 /digit) opcodes;
+	// the same value, shifted by 3, is the base of the r/m <-> reg forms.
+	enum alu : uint8_t { add = 0, or_ = 1, and_ = 4, sub = 5, xor_ = 6, cmp = 7 };
+
+	// the opcode extension of the group 2 (C1 /digit) opcodes
+	enum shift : uint8_t { shl = 4, shr = 5, sar = 7 };
+
+	struct operand {
+		bool memory;
+		reg r;
+		int32_t disp;
+	};
+
+	inline operand r32(reg r) { return {false, r, 0}; }
+	inline operand mem(reg base, int32_t disp) { return {true, base, disp}; }
+
+	class emitter {
+	  public:
+		emitter(uint8_t* begin, uint8_t* end) : p{begin}, limit{end} {}
+
+		uint8_t* here() const { return p; }
+
+		size_t room() const { return limit - p; }
+
+	  public:
+		// mov dst, src (at least one of the two must be a register)
+		void mov(operand dst, operand src) {
+			if (dst.memory) {
+				modrm_op(0x89, src.r, dst);
+			} else {
+				modrm_op(0x8b, dst.r, src);
+			}
+		}
+
+		void mov(operand dst, uint32_t imm) {
+			if (dst.memory) {
+				modrm_op(0xc7, 0, dst);
+			} else {
+				rex(false, 0, dst.r);
+				byte(0xb8 + (dst.r & 7));
+			}
+			dword(imm);
+		}
+
+		// op dst, src (at least one of the two must be a register)
+		void op(alu o, operand dst, operand src) {
+			if (dst.memory) {
+				modrm_op(o << 3 | 0x01, src.r, dst);
+			} else {
+				modrm_op(o << 3 | 0x03, dst.r, src);
+			}
+		}
+
+		void op(alu o, operand dst, uint32_t imm) {
+			modrm_op(0x81, o, dst);
+			dword(imm);
+		}
+
+		void op(shift s, reg r, uint8_t amount) {
+			modrm_op(0xc1, s, r32(r));
+			byte(amount);
+		}
+
+		// shifts `r` by the cl register
+		void op_cl(shift s, reg r) { modrm_op(0xd3, s, r32(r)); }
+
+		void not_(reg r) { modrm_op(0xf7, 2, r32(r)); }
+
+		void test(reg a, reg b) { modrm_op(0x85, b, r32(a)); }
+
+		void test(operand dst, uint32_t imm) {
+			modrm_op(0xf7, 0, dst);
+			dword(imm);
+		}
+
+		// cmp byte [base + disp32], imm8
+		void cmp8(operand dst, uint8_t imm) {
+			modrm_op(0x80, alu::cmp, dst);
+			byte(imm);
+		}
+
+		// dst = condition ? 1 : 0 (dst must be one of rax, rcx, rdx, rbx)
+		void setcc(cond c, reg dst) {
+			assert(dst < rsp);
+			byte(0x0f);
+			byte(0x90 + c);
+			byte(0xc0 | dst);
+			// movzx dst, dst8
+			byte(0x0f);
+			byte(0xb6);
+			byte(0xc0 | dst << 3 | dst);
+		}
+
+		void cmov(cond c, reg dst, operand src) { modrm_op2(0x0f, 0x40 + c, dst, src); }
+
+		// sign extends the low byte/word of `r`
+		void movsx8(reg r) { modrm_op2(0x0f, 0xbe, r, r32(r)); }
+		void movsx16(reg r) { modrm_op2(0x0f, 0xbf, r, r32(r)); }
+
+		// dst = the zero extended byte, word or dword at [base + index]
+		void load_indexed(uint8_t size, reg dst, reg base, reg index) {
+			rex_sib(dst, base, index);
+			if (size == 4) {
+				byte(0x8b);
+			} else {
+				byte(0x0f);
+				byte(size == 1 ? 0xb6 : 0xb7);
+			}
+			sib(dst, base, index);
+		}
+
+		// [base + index] = the low byte, word or dword of `src` (one of rax,
+		// rcx, rdx, rbx for a byte)
+		void store_indexed(uint8_t size, reg base, reg index, reg src) {
+			assert(size != 1 || src < rsp);
+			if (size == 2) {
+				byte(0x66);
+			}
+			rex_sib(src, base, index);
+			byte(size == 1 ? 0x88 : 0x89);
+			sib(src, base, index);
+		}
+
+		// 64 bit operations
+		void mov64(reg dst, uint64_t imm) {
+			rex(true, 0, dst);
+			byte(0xb8 + (dst & 7));
+			std::memcpy(p, &imm, sizeof(imm));
+			p += sizeof(imm);
+		}
+
+		void mov64(reg dst, reg src) {
+			rex(true, src, dst);
+			byte(0x89);
+			byte(0xc0 | (src & 7) << 3 | (dst & 7));
+		}
+
+		// lea dst, [base + disp32]
+		void lea64(reg dst, reg base, int32_t disp) {
+			rex(true, dst, base);
+			byte(0x8d);
+			modrm(dst, mem(base, disp));
+		}
+
+		void op64(alu o, reg dst, uint32_t imm) {
+			rex(true, 0, dst);
+			byte(0x81);
+			byte(0xc0 | o << 3 | (dst & 7));
+			dword(imm);
+		}
+
+		void push(reg r) {
+			rex(false, 0, r);
+			byte(0x50 + (r & 7));
+		}
+
+		void pop(reg r) {
+			rex(false, 0, r);
+			byte(0x58 + (r & 7));
+		}
+
+		void call(reg r) {
+			rex(false, 0, r);
+			byte(0xff);
+			byte(0xd0 | (r & 7));
+		}
+
+		void jmp(reg r) {
+			rex(false, 0, r);
+			byte(0xff);
+			byte(0xe0 | (r & 7));
+		}
+
+		void ret() { byte(0xc3); }
+
+	  public:
+		// the jumps return the location of their rel32 field, see `bind`
+		uint8_t* jmp() {
+			byte(0xe9);
+			return rel32();
+		}
+
+		uint8_t* jcc(cond c) {
+			byte(0x0f);
+			byte(0x80 + c);
+			return rel32();
+		}
+
+		void jmp(uint8_t const* target) { bind(jmp(), target); }
+
+		/**
+		 * \brief points the jump with the rel32 field at `site` to `target`
+		 */
+		static void bind(uint8_t* site, uint8_t const* target) {
+			int32_t rel = static_cast<int32_t>(target - (site + 4));
+			std::memcpy(site, &rel, sizeof(rel));
+		}
+
+		void bind(uint8_t* site) { bind(site, p); }
+
+	  private:
+		void byte(uint8_t b) {
+			assert(p < limit);
+			*p++ = b;
+		}
+
+		void dword(uint32_t d) {
+			assert(p + 4 <= limit);
+			std::memcpy(p, &d, sizeof(d));
+			p += 4;
+		}
+
+		uint8_t* rel32() {
+			uint8_t* site = p;
+			dword(0);
+			return site;
+		}
+
+		void rex(bool w, uint8_t r, uint8_t b) {
+			uint8_t prefix = 0x40 | (w ? 0x8 : 0) | (r & 8 ? 0x4 : 0) | (b & 8 ? 0x1 : 0);
+			if (prefix != 0x40) {
+				byte(prefix);
+			}
+		}
+
+		void rex_sib(uint8_t r, uint8_t base, uint8_t index) {
+			uint8_t prefix = 0x40 | (r & 8 ? 0x4 : 0) | (index & 8 ? 0x2 : 0) | (base & 8 ? 0x1 : 0);
+			if (prefix != 0x40) {
+				byte(prefix);
+			}
+		}
+
+		// [base + index] without displacement
+		void sib(uint8_t r, uint8_t base, uint8_t index) {
+			// rbp and r13 as base need a displacement, rsp cannot be an index
+			assert((base & 7) != rbp && index != rsp);
+			byte(0x04 | (r & 7) << 3);
+			byte((index & 7) << 3 | (base & 7));
+		}
+
+		void modrm(uint8_t r, operand rm) {
+			if (!rm.memory) {
+				byte(0xc0 | (r & 7) << 3 | (rm.r & 7));
+				return;
+			}
+			byte(0x80 | (r & 7) << 3 | (rm.r & 7));
+			if ((rm.r & 7) == rsp) {
+				// rsp and r12 as base need a SIB byte
+				byte(0x24);
+			}
+			dword(rm.disp);
+		}
+
+		void modrm_op(uint8_t opcode, uint8_t r, operand rm) {
+			rex(false, r, rm.r);
+			byte(opcode);
+			modrm(r, rm);
+		}
+
+		void modrm_op2(uint8_t escape, uint8_t opcode, uint8_t r, operand rm) {
+			rex(false, r, rm.r);
+			byte(escape);
+			byte(opcode);
+			modrm(r, rm);
+		}
+
+	  private:
+		uint8_t* p;
+		uint8_t* limit;
+	};
+}
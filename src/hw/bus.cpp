@@ -1,325 +1,722 @@
 #include "bus.hpp"
-#include <unordered_map>
+#include "bus_stats.hpp"
+#include "fastmem.hpp"
+#include <algorithm>
+#include <array>
 
 namespace {
 	struct io_port {
+		// the port covers the addresses [addr, addr | mask]
 		uint32_t addr;
 		uint32_t mask;
-
-		bool operator==(io_port o) const { return addr == o.addr && mask == o.mask; }
-
-		bool operator==(uint32_t a) const { return (addr & ~mask) == a; }
-	};
-}
-
-namespace std {
-	template <>
-	struct hash<io_port> {
-		size_t operator()(io_port const& p) const {
-			uint32_t val = p.addr & ~p.mask;
-			return std::hash<uint32_t>{}(val);
-		}
+		std::string_view description;
 	};
-}
 
-namespace {
 	// this map is extracted from https://problemkaputt.de/psx-spx.htm#iomap
-	std::unordered_map<io_port, std::string> io_map{
+	constexpr io_port io_map[] = {
 	    // Memory Control 1
-	    {{0x1F801'000, 0}, "Expansion 1 Base Address (usually 1F000000h)"},
-	    {{0x1F801'004, 0}, "Expansion 2 Base Address (usually 1F802000h)"},
-	    {{0x1F801'008, 0}, "Expansion 1 Delay/Size (usually 0013243Fh; 512Kbytes 8bit-bus)"},
-	    {{0x1F801'00C, 0}, "Expansion 3 Delay/Size (usually 00003022h; 1 byte)"},
-	    {{0x1F801'010, 0}, "BIOS ROM    Delay/Size (usually 0013243Fh; 512Kbytes 8bit-bus)"},
-	    {{0x1F801'014, 0}, "SPU_DELAY   Delay/Size (usually 200931E1h)"},
-	    {{0x1F801'018, 0}, "CDROM_DELAY Delay/Size (usually 00020843h or 00020943h)"},
-	    {{0x1F801'01C, 0}, "Expansion 2 Delay/Size (usually 00070777h; 128-bytes 8bit-bus)"},
-	    {{0x1F801'020, 0}, "COM_DELAY / COMMON_DELAY (00031125h or 0000132Ch or 00001325h)"},
+	    {0x1F801'000, 0, "Expansion 1 Base Address (usually 1F000000h)"},
+	    {0x1F801'004, 0, "Expansion 2 Base Address (usually 1F802000h)"},
+	    {0x1F801'008, 0, "Expansion 1 Delay/Size (usually 0013243Fh; 512Kbytes 8bit-bus)"},
+	    {0x1F801'00C, 0, "Expansion 3 Delay/Size (usually 00003022h; 1 byte)"},
+	    {0x1F801'010, 0, "BIOS ROM    Delay/Size (usually 0013243Fh; 512Kbytes 8bit-bus)"},
+	    {0x1F801'014, 0, "SPU_DELAY   Delay/Size (usually 200931E1h)"},
+	    {0x1F801'018, 0, "CDROM_DELAY Delay/Size (usually 00020843h or 00020943h)"},
+	    {0x1F801'01C, 0, "Expansion 2 Delay/Size (usually 00070777h; 128-bytes 8bit-bus)"},
+	    {0x1F801'020, 0, "COM_DELAY / COMMON_DELAY (00031125h or 0000132Ch or 00001325h)"},
 	    // Peripheral I/O Ports
-	    {{0x1F801'040, 0}, "JOY_DATA Joypad/Memory Card Data (R/W)"},
-	    {{0x1F801'044, 0}, "JOY_STAT Joypad/Memory Card Status (R)"},
-	    {{0x1F801'048, 0}, "JOY_MODE Joypad/Memory Card Mode (R/W)"},
-	    {{0x1F801'04A, 0}, "JOY_CTRL Joypad/Memory Card Control (R/W)"},
-	    {{0x1F801'04E, 0}, "JOY_BAUD Joypad/Memory Card Baudrate (R/W)"},
-	    {{0x1F801'050, 0}, "SIO_DATA Serial Port Data (R/W)"},
-	    {{0x1F801'054, 0}, "SIO_STAT Serial Port Status (R)"},
-	    {{0x1F801'058, 0}, "SIO_MODE Serial Port Mode (R/W)"},
-	    {{0x1F801'05A, 0}, "SIO_CTRL Serial Port Control (R/W)"},
-	    {{0x1F801'05C, 0}, "SIO_MISC Serial Port Internal Register (R/W)"},
-	    {{0x1F801'05E, 0}, "SIO_BAUD Serial Port Baudrate (R/W)"},
+	    {0x1F801'040, 0, "JOY_DATA Joypad/Memory Card Data (R/W)"},
+	    {0x1F801'044, 0, "JOY_STAT Joypad/Memory Card Status (R)"},
+	    {0x1F801'048, 0, "JOY_MODE Joypad/Memory Card Mode (R/W)"},
+	    {0x1F801'04A, 0, "JOY_CTRL Joypad/Memory Card Control (R/W)"},
+	    {0x1F801'04E, 0, "JOY_BAUD Joypad/Memory Card Baudrate (R/W)"},
+	    {0x1F801'050, 0, "SIO_DATA Serial Port Data (R/W)"},
+	    {0x1F801'054, 0, "SIO_STAT Serial Port Status (R)"},
+	    {0x1F801'058, 0, "SIO_MODE Serial Port Mode (R/W)"},
+	    {0x1F801'05A, 0, "SIO_CTRL Serial Port Control (R/W)"},
+	    {0x1F801'05C, 0, "SIO_MISC Serial Port Internal Register (R/W)"},
+	    {0x1F801'05E, 0, "SIO_BAUD Serial Port Baudrate (R/W)"},
 	    // Memory Control 2
-	    {{0x1F801'060, 0}, "RAM_SIZE (usually 00000B88h; 2MB RAM mirrored in first 8MB)"},
+	    {0x1F801'060, 0, "RAM_SIZE (usually 00000B88h; 2MB RAM mirrored in first 8MB)"},
 	    // Interrupt Control
-	    {{0x1F801'070, 0}, "I_STAT - Interrupt status register"},
-	    {{0x1F801'074, 0}, "I_MASK - Interrupt mask register"},
+	    {0x1F801'070, 0, "I_STAT - Interrupt status register"},
+	    {0x1F801'074, 0, "I_MASK - Interrupt mask register"},
 	    // DMA Registers
-	    {{0x1F801'080, 0xf}, "DMA0 channel 0 - MDECin"},
-	    {{0x1F801'090, 0xf}, "DMA1 channel 1 - MDECout"},
-	    {{0x1F801'0A0, 0xf}, "DMA2 channel 2 - GPU (lists + image data)"},
-	    {{0x1F801'0B0, 0xf}, "DMA3 channel 3 - CDROM"},
-	    {{0x1F801'0C0, 0xf}, "DMA4 channel 4 - SPU"},
-	    {{0x1F801'0D0, 0xf}, "DMA5 channel 5 - PIO (Expansion Port)"},
-	    {{0x1F801'0E0, 0xf}, "DMA6 channel 6 - OTC (reverse clear OT) (GPU related)"},
-	    {{0x1F801'0F0, 0}, "DPCR - DMA Control register"},
-	    {{0x1F801'0F4, 0}, "DICR - DMA Interrupt register"},
-	    {{0x1F801'0F8, 0}, "unknown"},
-	    {{0x1F801'0FC, 0}, "unknown"},
+	    {0x1F801'080, 0xf, "DMA0 channel 0 - MDECin"},
+	    {0x1F801'090, 0xf, "DMA1 channel 1 - MDECout"},
+	    {0x1F801'0A0, 0xf, "DMA2 channel 2 - GPU (lists + image data)"},
+	    {0x1F801'0B0, 0xf, "DMA3 channel 3 - CDROM"},
+	    {0x1F801'0C0, 0xf, "DMA4 channel 4 - SPU"},
+	    {0x1F801'0D0, 0xf, "DMA5 channel 5 - PIO (Expansion Port)"},
+	    {0x1F801'0E0, 0xf, "DMA6 channel 6 - OTC (reverse clear OT) (GPU related)"},
+	    {0x1F801'0F0, 0, "DPCR - DMA Control register"},
+	    {0x1F801'0F4, 0, "DICR - DMA Interrupt register"},
+	    {0x1F801'0F8, 0, "unknown"},
+	    {0x1F801'0FC, 0, "unknown"},
 	    // Timers (aka Root counters)
-	    {{0x1F801'100, 0xf}, "Timer 0 Dotclock"},
-	    {{0x1F801'110, 0xf}, "Timer 1 Horizontal Retrace"},
-	    {{0x1F801'120, 0xf}, "Timer 2 1/8 system clock"},
+	    {0x1F801'100, 0xf, "Timer 0 Dotclock"},
+	    {0x1F801'110, 0xf, "Timer 1 Horizontal Retrace"},
+	    {0x1F801'120, 0xf, "Timer 2 1/8 system clock"},
 	    // CDROM Registers (Address.Read/Write.Index)
-	    {{0x1F801'800, 0}, "CD Index/Status Register (Bit0-1 R/W, Bit2-7 Read Only)"},
-	    {{0x1F801'801, 0}, "CD Response Fifo (R) (usually with Index1)"},
-	    {{0x1F801'802, 0}, "CD Data Fifo - 8bit/16bit (R) (usually with Index0..1)"},
-	    {{0x1F801'803, 0}, "CD Interrupt Enable Register (R)"},
-	    {{0x1F801'803, 0}, "CD Interrupt Flag Register (R/W)"},
-	    {{0x1F801'803, 0}, "CD Interrupt Enable Register (R) (Mirror)"},
-	    {{0x1F801'803, 0}, "CD Interrupt Flag Register (R/W) (Mirror)"},
-	    {{0x1F801'801, 0}, "CD Command Register (W)"},
-	    {{0x1F801'802, 0}, "CD Parameter Fifo (W)"},
-	    {{0x1F801'803, 0}, "CD Request Register (W)"},
-	    {{0x1F801'801, 0}, "Unknown/unused"},
-	    {{0x1F801'802, 0}, "CD Interrupt Enable Register (W)"},
-	    {{0x1F801'803, 0}, "CD Interrupt Flag Register (R/W)"},
-	    {{0x1F801'801, 0}, "Unknown/unused"},
-	    {{0x1F801'802, 0}, "CD Audio Volume for Left-CD-Out to Left-SPU-Input (W)"},
-	    {{0x1F801'803, 0}, "CD Audio Volume for Left-CD-Out to Right-SPU-Input (W)"},
-	    {{0x1F801'801, 0}, "CD Audio Volume for Right-CD-Out to Right-SPU-Input (W)"},
-	    {{0x1F801'802, 0}, "CD Audio Volume for Right-CD-Out to Left-SPU-Input (W)"},
-	    {{0x1F801'803, 0}, "CD Audio Volume Apply Changes (by writing bit5=1)"},
+	    {0x1F801'800, 0, "CD Index/Status Register (Bit0-1 R/W, Bit2-7 Read Only)"},
+	    {0x1F801'801, 0, "CD Response Fifo (R) (usually with Index1)"},
+	    {0x1F801'802, 0, "CD Data Fifo - 8bit/16bit (R) (usually with Index0..1)"},
+	    {0x1F801'803, 0, "CD Interrupt Enable Register (R)"},
+	    {0x1F801'803, 0, "CD Interrupt Flag Register (R/W)"},
+	    {0x1F801'803, 0, "CD Interrupt Enable Register (R) (Mirror)"},
+	    {0x1F801'803, 0, "CD Interrupt Flag Register (R/W) (Mirror)"},
+	    {0x1F801'801, 0, "CD Command Register (W)"},
+	    {0x1F801'802, 0, "CD Parameter Fifo (W)"},
+	    {0x1F801'803, 0, "CD Request Register (W)"},
+	    {0x1F801'801, 0, "Unknown/unused"},
+	    {0x1F801'802, 0, "CD Interrupt Enable Register (W)"},
+	    {0x1F801'803, 0, "CD Interrupt Flag Register (R/W)"},
+	    {0x1F801'801, 0, "Unknown/unused"},
+	    {0x1F801'802, 0, "CD Audio Volume for Left-CD-Out to Left-SPU-Input (W)"},
+	    {0x1F801'803, 0, "CD Audio Volume for Left-CD-Out to Right-SPU-Input (W)"},
+	    {0x1F801'801, 0, "CD Audio Volume for Right-CD-Out to Right-SPU-Input (W)"},
+	    {0x1F801'802, 0, "CD Audio Volume for Right-CD-Out to Left-SPU-Input (W)"},
+	    {0x1F801'803, 0, "CD Audio Volume Apply Changes (by writing bit5=1)"},
 	    // GPU Registers
-	    {{0x1F801'810, 0}, "GP0 Send GP0 Commands/Packets (Rendering and VRAM Access)"},
-	    {{0x1F801'814, 0}, "GP1 Send GP1 Commands (Display Control)"},
-	    {{0x1F801'810, 0}, "GPUREAD Read responses to GP0(C0h) and GP1(10h) commands"},
-	    {{0x1F801'814, 0}, "GPUSTAT Read GPU Status Register"},
+	    {0x1F801'810, 0, "GP0 Send GP0 Commands/Packets (Rendering and VRAM Access)"},
+	    {0x1F801'814, 0, "GP1 Send GP1 Commands (Display Control)"},
+	    {0x1F801'810, 0, "GPUREAD Read responses to GP0(C0h) and GP1(10h) commands"},
+	    {0x1F801'814, 0, "GPUSTAT Read GPU Status Register"},
 	    // MDEC Registers
-	    {{0x1F801'820, 0}, "MDEC Command/Parameter Register (W)"},
-	    {{0x1F801'820, 0}, "MDEC Data/Response Register (R)"},
-	    {{0x1F801'824, 0}, "MDEC Control/Reset Register (W)"},
-	    {{0x1F801'824, 0}, "MDEC Status Register (R)"},
+	    {0x1F801'820, 0, "MDEC Command/Parameter Register (W)"},
+	    {0x1F801'820, 0, "MDEC Data/Response Register (R)"},
+	    {0x1F801'824, 0, "MDEC Control/Reset Register (W)"},
+	    {0x1F801'824, 0, "MDEC Status Register (R)"},
 	    // SPU Voice 0..23 Registers
-	    {{0x1F801'C00 + 0 * 0x10, 0}, "Voice 1 Volume Left/Right"},
-	    {{0x1F801'C04 + 0 * 0x10, 0}, "Voice 1 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 0 * 0x10, 0}, "Voice 1 ADPCM Start Address"},
-	    {{0x1F801'C08 + 0 * 0x10, 0}, "Voice 1 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 0 * 0x10, 0}, "Voice 1 ADSR Current Volume"},
-	    {{0x1F801'C0E + 0 * 0x10, 0}, "Voice 1 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 0 * 0x10, 0, "Voice 1 Volume Left/Right"},
+	    {0x1F801'C04 + 0 * 0x10, 0, "Voice 1 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 0 * 0x10, 0, "Voice 1 ADPCM Start Address"},
+	    {0x1F801'C08 + 0 * 0x10, 0, "Voice 1 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 0 * 0x10, 0, "Voice 1 ADSR Current Volume"},
+	    {0x1F801'C0E + 0 * 0x10, 0, "Voice 1 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 1 * 0x10, 0}, "Voice 2 Volume Left/Right"},
-	    {{0x1F801'C04 + 1 * 0x10, 0}, "Voice 2 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 1 * 0x10, 0}, "Voice 2 ADPCM Start Address"},
-	    {{0x1F801'C08 + 1 * 0x10, 0}, "Voice 2 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 1 * 0x10, 0}, "Voice 2 ADSR Current Volume"},
-	    {{0x1F801'C0E + 1 * 0x10, 0}, "Voice 2 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 1 * 0x10, 0, "Voice 2 Volume Left/Right"},
+	    {0x1F801'C04 + 1 * 0x10, 0, "Voice 2 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 1 * 0x10, 0, "Voice 2 ADPCM Start Address"},
+	    {0x1F801'C08 + 1 * 0x10, 0, "Voice 2 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 1 * 0x10, 0, "Voice 2 ADSR Current Volume"},
+	    {0x1F801'C0E + 1 * 0x10, 0, "Voice 2 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 2 * 0x10, 0}, "Voice 3 Volume Left/Right"},
-	    {{0x1F801'C04 + 2 * 0x10, 0}, "Voice 3 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 2 * 0x10, 0}, "Voice 3 ADPCM Start Address"},
-	    {{0x1F801'C08 + 2 * 0x10, 0}, "Voice 3 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 2 * 0x10, 0}, "Voice 3 ADSR Current Volume"},
-	    {{0x1F801'C0E + 2 * 0x10, 0}, "Voice 3 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 2 * 0x10, 0, "Voice 3 Volume Left/Right"},
+	    {0x1F801'C04 + 2 * 0x10, 0, "Voice 3 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 2 * 0x10, 0, "Voice 3 ADPCM Start Address"},
+	    {0x1F801'C08 + 2 * 0x10, 0, "Voice 3 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 2 * 0x10, 0, "Voice 3 ADSR Current Volume"},
+	    {0x1F801'C0E + 2 * 0x10, 0, "Voice 3 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 3 * 0x10, 0}, "Voice 4 Volume Left/Right"},
-	    {{0x1F801'C04 + 3 * 0x10, 0}, "Voice 4 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 3 * 0x10, 0}, "Voice 4 ADPCM Start Address"},
-	    {{0x1F801'C08 + 3 * 0x10, 0}, "Voice 4 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 3 * 0x10, 0}, "Voice 4 ADSR Current Volume"},
-	    {{0x1F801'C0E + 3 * 0x10, 0}, "Voice 4 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 3 * 0x10, 0, "Voice 4 Volume Left/Right"},
+	    {0x1F801'C04 + 3 * 0x10, 0, "Voice 4 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 3 * 0x10, 0, "Voice 4 ADPCM Start Address"},
+	    {0x1F801'C08 + 3 * 0x10, 0, "Voice 4 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 3 * 0x10, 0, "Voice 4 ADSR Current Volume"},
+	    {0x1F801'C0E + 3 * 0x10, 0, "Voice 4 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 4 * 0x10, 0}, "Voice 5 Volume Left/Right"},
-	    {{0x1F801'C04 + 4 * 0x10, 0}, "Voice 5 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 4 * 0x10, 0}, "Voice 5 ADPCM Start Address"},
-	    {{0x1F801'C08 + 4 * 0x10, 0}, "Voice 5 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 4 * 0x10, 0}, "Voice 5 ADSR Current Volume"},
-	    {{0x1F801'C0E + 4 * 0x10, 0}, "Voice 5 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 4 * 0x10, 0, "Voice 5 Volume Left/Right"},
+	    {0x1F801'C04 + 4 * 0x10, 0, "Voice 5 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 4 * 0x10, 0, "Voice 5 ADPCM Start Address"},
+	    {0x1F801'C08 + 4 * 0x10, 0, "Voice 5 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 4 * 0x10, 0, "Voice 5 ADSR Current Volume"},
+	    {0x1F801'C0E + 4 * 0x10, 0, "Voice 5 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 5 * 0x10, 0}, "Voice 6 Volume Left/Right"},
-	    {{0x1F801'C04 + 5 * 0x10, 0}, "Voice 6 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 5 * 0x10, 0}, "Voice 6 ADPCM Start Address"},
-	    {{0x1F801'C08 + 5 * 0x10, 0}, "Voice 6 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 5 * 0x10, 0}, "Voice 6 ADSR Current Volume"},
-	    {{0x1F801'C0E + 5 * 0x10, 0}, "Voice 6 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 5 * 0x10, 0, "Voice 6 Volume Left/Right"},
+	    {0x1F801'C04 + 5 * 0x10, 0, "Voice 6 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 5 * 0x10, 0, "Voice 6 ADPCM Start Address"},
+	    {0x1F801'C08 + 5 * 0x10, 0, "Voice 6 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 5 * 0x10, 0, "Voice 6 ADSR Current Volume"},
+	    {0x1F801'C0E + 5 * 0x10, 0, "Voice 6 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 6 * 0x10, 0}, "Voice 7 Volume Left/Right"},
-	    {{0x1F801'C04 + 6 * 0x10, 0}, "Voice 7 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 6 * 0x10, 0}, "Voice 7 ADPCM Start Address"},
-	    {{0x1F801'C08 + 6 * 0x10, 0}, "Voice 7 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 6 * 0x10, 0}, "Voice 7 ADSR Current Volume"},
-	    {{0x1F801'C0E + 6 * 0x10, 0}, "Voice 7 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 6 * 0x10, 0, "Voice 7 Volume Left/Right"},
+	    {0x1F801'C04 + 6 * 0x10, 0, "Voice 7 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 6 * 0x10, 0, "Voice 7 ADPCM Start Address"},
+	    {0x1F801'C08 + 6 * 0x10, 0, "Voice 7 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 6 * 0x10, 0, "Voice 7 ADSR Current Volume"},
+	    {0x1F801'C0E + 6 * 0x10, 0, "Voice 7 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 7 * 0x10, 0}, "Voice 8 Volume Left/Right"},
-	    {{0x1F801'C04 + 7 * 0x10, 0}, "Voice 8 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 7 * 0x10, 0}, "Voice 8 ADPCM Start Address"},
-	    {{0x1F801'C08 + 7 * 0x10, 0}, "Voice 8 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 7 * 0x10, 0}, "Voice 8 ADSR Current Volume"},
-	    {{0x1F801'C0E + 7 * 0x10, 0}, "Voice 8 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 7 * 0x10, 0, "Voice 8 Volume Left/Right"},
+	    {0x1F801'C04 + 7 * 0x10, 0, "Voice 8 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 7 * 0x10, 0, "Voice 8 ADPCM Start Address"},
+	    {0x1F801'C08 + 7 * 0x10, 0, "Voice 8 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 7 * 0x10, 0, "Voice 8 ADSR Current Volume"},
+	    {0x1F801'C0E + 7 * 0x10, 0, "Voice 8 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 8 * 0x10, 0}, "Voice 9 Volume Left/Right"},
-	    {{0x1F801'C04 + 8 * 0x10, 0}, "Voice 9 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 8 * 0x10, 0}, "Voice 9 ADPCM Start Address"},
-	    {{0x1F801'C08 + 8 * 0x10, 0}, "Voice 9 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 8 * 0x10, 0}, "Voice 9 ADSR Current Volume"},
-	    {{0x1F801'C0E + 8 * 0x10, 0}, "Voice 9 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 8 * 0x10, 0, "Voice 9 Volume Left/Right"},
+	    {0x1F801'C04 + 8 * 0x10, 0, "Voice 9 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 8 * 0x10, 0, "Voice 9 ADPCM Start Address"},
+	    {0x1F801'C08 + 8 * 0x10, 0, "Voice 9 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 8 * 0x10, 0, "Voice 9 ADSR Current Volume"},
+	    {0x1F801'C0E + 8 * 0x10, 0, "Voice 9 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 9 * 0x10, 0}, "Voice 10 Volume Left/Right"},
-	    {{0x1F801'C04 + 9 * 0x10, 0}, "Voice 10 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 9 * 0x10, 0}, "Voice 10 ADPCM Start Address"},
-	    {{0x1F801'C08 + 9 * 0x10, 0}, "Voice 10 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 9 * 0x10, 0}, "Voice 10 ADSR Current Volume"},
-	    {{0x1F801'C0E + 9 * 0x10, 0}, "Voice 10 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 9 * 0x10, 0, "Voice 10 Volume Left/Right"},
+	    {0x1F801'C04 + 9 * 0x10, 0, "Voice 10 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 9 * 0x10, 0, "Voice 10 ADPCM Start Address"},
+	    {0x1F801'C08 + 9 * 0x10, 0, "Voice 10 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 9 * 0x10, 0, "Voice 10 ADSR Current Volume"},
+	    {0x1F801'C0E + 9 * 0x10, 0, "Voice 10 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 10 * 0x10, 0}, "Voice 11 Volume Left/Right"},
-	    {{0x1F801'C04 + 10 * 0x10, 0}, "Voice 11 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 10 * 0x10, 0}, "Voice 11 ADPCM Start Address"},
-	    {{0x1F801'C08 + 10 * 0x10, 0}, "Voice 11 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 10 * 0x10, 0}, "Voice 11 ADSR Current Volume"},
-	    {{0x1F801'C0E + 10 * 0x10, 0}, "Voice 11 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 10 * 0x10, 0, "Voice 11 Volume Left/Right"},
+	    {0x1F801'C04 + 10 * 0x10, 0, "Voice 11 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 10 * 0x10, 0, "Voice 11 ADPCM Start Address"},
+	    {0x1F801'C08 + 10 * 0x10, 0, "Voice 11 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 10 * 0x10, 0, "Voice 11 ADSR Current Volume"},
+	    {0x1F801'C0E + 10 * 0x10, 0, "Voice 11 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 11 * 0x10, 0}, "Voice 12 Volume Left/Right"},
-	    {{0x1F801'C04 + 11 * 0x10, 0}, "Voice 12 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 11 * 0x10, 0}, "Voice 12 ADPCM Start Address"},
-	    {{0x1F801'C08 + 11 * 0x10, 0}, "Voice 12 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 11 * 0x10, 0}, "Voice 12 ADSR Current Volume"},
-	    {{0x1F801'C0E + 11 * 0x10, 0}, "Voice 12 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 11 * 0x10, 0, "Voice 12 Volume Left/Right"},
+	    {0x1F801'C04 + 11 * 0x10, 0, "Voice 12 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 11 * 0x10, 0, "Voice 12 ADPCM Start Address"},
+	    {0x1F801'C08 + 11 * 0x10, 0, "Voice 12 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 11 * 0x10, 0, "Voice 12 ADSR Current Volume"},
+	    {0x1F801'C0E + 11 * 0x10, 0, "Voice 12 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 12 * 0x10, 0}, "Voice 13 Volume Left/Right"},
-	    {{0x1F801'C04 + 12 * 0x10, 0}, "Voice 13 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 12 * 0x10, 0}, "Voice 13 ADPCM Start Address"},
-	    {{0x1F801'C08 + 12 * 0x10, 0}, "Voice 13 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 12 * 0x10, 0}, "Voice 13 ADSR Current Volume"},
-	    {{0x1F801'C0E + 12 * 0x10, 0}, "Voice 13 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 12 * 0x10, 0, "Voice 13 Volume Left/Right"},
+	    {0x1F801'C04 + 12 * 0x10, 0, "Voice 13 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 12 * 0x10, 0, "Voice 13 ADPCM Start Address"},
+	    {0x1F801'C08 + 12 * 0x10, 0, "Voice 13 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 12 * 0x10, 0, "Voice 13 ADSR Current Volume"},
+	    {0x1F801'C0E + 12 * 0x10, 0, "Voice 13 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 13 * 0x10, 0}, "Voice 14 Volume Left/Right"},
-	    {{0x1F801'C04 + 13 * 0x10, 0}, "Voice 14 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 13 * 0x10, 0}, "Voice 14 ADPCM Start Address"},
-	    {{0x1F801'C08 + 13 * 0x10, 0}, "Voice 14 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 13 * 0x10, 0}, "Voice 14 ADSR Current Volume"},
-	    {{0x1F801'C0E + 13 * 0x10, 0}, "Voice 14 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 13 * 0x10, 0, "Voice 14 Volume Left/Right"},
+	    {0x1F801'C04 + 13 * 0x10, 0, "Voice 14 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 13 * 0x10, 0, "Voice 14 ADPCM Start Address"},
+	    {0x1F801'C08 + 13 * 0x10, 0, "Voice 14 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 13 * 0x10, 0, "Voice 14 ADSR Current Volume"},
+	    {0x1F801'C0E + 13 * 0x10, 0, "Voice 14 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 14 * 0x10, 0}, "Voice 15 Volume Left/Right"},
-	    {{0x1F801'C04 + 14 * 0x10, 0}, "Voice 15 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 14 * 0x10, 0}, "Voice 15 ADPCM Start Address"},
-	    {{0x1F801'C08 + 14 * 0x10, 0}, "Voice 15 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 14 * 0x10, 0}, "Voice 15 ADSR Current Volume"},
-	    {{0x1F801'C0E + 14 * 0x10, 0}, "Voice 15 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 14 * 0x10, 0, "Voice 15 Volume Left/Right"},
+	    {0x1F801'C04 + 14 * 0x10, 0, "Voice 15 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 14 * 0x10, 0, "Voice 15 ADPCM Start Address"},
+	    {0x1F801'C08 + 14 * 0x10, 0, "Voice 15 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 14 * 0x10, 0, "Voice 15 ADSR Current Volume"},
+	    {0x1F801'C0E + 14 * 0x10, 0, "Voice 15 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 15 * 0x10, 0}, "Voice 16 Volume Left/Right"},
-	    {{0x1F801'C04 + 15 * 0x10, 0}, "Voice 16 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 15 * 0x10, 0}, "Voice 16 ADPCM Start Address"},
-	    {{0x1F801'C08 + 15 * 0x10, 0}, "Voice 16 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 15 * 0x10, 0}, "Voice 16 ADSR Current Volume"},
-	    {{0x1F801'C0E + 15 * 0x10, 0}, "Voice 16 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 15 * 0x10, 0, "Voice 16 Volume Left/Right"},
+	    {0x1F801'C04 + 15 * 0x10, 0, "Voice 16 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 15 * 0x10, 0, "Voice 16 ADPCM Start Address"},
+	    {0x1F801'C08 + 15 * 0x10, 0, "Voice 16 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 15 * 0x10, 0, "Voice 16 ADSR Current Volume"},
+	    {0x1F801'C0E + 15 * 0x10, 0, "Voice 16 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 16 * 0x10, 0}, "Voice 17 Volume Left/Right"},
-	    {{0x1F801'C04 + 16 * 0x10, 0}, "Voice 17 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 16 * 0x10, 0}, "Voice 17 ADPCM Start Address"},
-	    {{0x1F801'C08 + 16 * 0x10, 0}, "Voice 17 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 16 * 0x10, 0}, "Voice 17 ADSR Current Volume"},
-	    {{0x1F801'C0E + 16 * 0x10, 0}, "Voice 17 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 16 * 0x10, 0, "Voice 17 Volume Left/Right"},
+	    {0x1F801'C04 + 16 * 0x10, 0, "Voice 17 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 16 * 0x10, 0, "Voice 17 ADPCM Start Address"},
+	    {0x1F801'C08 + 16 * 0x10, 0, "Voice 17 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 16 * 0x10, 0, "Voice 17 ADSR Current Volume"},
+	    {0x1F801'C0E + 16 * 0x10, 0, "Voice 17 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 17 * 0x10, 0}, "Voice 18 Volume Left/Right"},
-	    {{0x1F801'C04 + 17 * 0x10, 0}, "Voice 18 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 17 * 0x10, 0}, "Voice 18 ADPCM Start Address"},
-	    {{0x1F801'C08 + 17 * 0x10, 0}, "Voice 18 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 17 * 0x10, 0}, "Voice 18 ADSR Current Volume"},
-	    {{0x1F801'C0E + 17 * 0x10, 0}, "Voice 18 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 17 * 0x10, 0, "Voice 18 Volume Left/Right"},
+	    {0x1F801'C04 + 17 * 0x10, 0, "Voice 18 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 17 * 0x10, 0, "Voice 18 ADPCM Start Address"},
+	    {0x1F801'C08 + 17 * 0x10, 0, "Voice 18 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 17 * 0x10, 0, "Voice 18 ADSR Current Volume"},
+	    {0x1F801'C0E + 17 * 0x10, 0, "Voice 18 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 18 * 0x10, 0}, "Voice 19 Volume Left/Right"},
-	    {{0x1F801'C04 + 18 * 0x10, 0}, "Voice 19 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 18 * 0x10, 0}, "Voice 19 ADPCM Start Address"},
-	    {{0x1F801'C08 + 18 * 0x10, 0}, "Voice 19 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 18 * 0x10, 0}, "Voice 19 ADSR Current Volume"},
-	    {{0x1F801'C0E + 18 * 0x10, 0}, "Voice 19 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 18 * 0x10, 0, "Voice 19 Volume Left/Right"},
+	    {0x1F801'C04 + 18 * 0x10, 0, "Voice 19 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 18 * 0x10, 0, "Voice 19 ADPCM Start Address"},
+	    {0x1F801'C08 + 18 * 0x10, 0, "Voice 19 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 18 * 0x10, 0, "Voice 19 ADSR Current Volume"},
+	    {0x1F801'C0E + 18 * 0x10, 0, "Voice 19 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 19 * 0x10, 0}, "Voice 20 Volume Left/Right"},
-	    {{0x1F801'C04 + 19 * 0x10, 0}, "Voice 20 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 19 * 0x10, 0}, "Voice 20 ADPCM Start Address"},
-	    {{0x1F801'C08 + 19 * 0x10, 0}, "Voice 20 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 19 * 0x10, 0}, "Voice 20 ADSR Current Volume"},
-	    {{0x1F801'C0E + 19 * 0x10, 0}, "Voice 20 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 19 * 0x10, 0, "Voice 20 Volume Left/Right"},
+	    {0x1F801'C04 + 19 * 0x10, 0, "Voice 20 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 19 * 0x10, 0, "Voice 20 ADPCM Start Address"},
+	    {0x1F801'C08 + 19 * 0x10, 0, "Voice 20 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 19 * 0x10, 0, "Voice 20 ADSR Current Volume"},
+	    {0x1F801'C0E + 19 * 0x10, 0, "Voice 20 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 20 * 0x10, 0}, "Voice 21 Volume Left/Right"},
-	    {{0x1F801'C04 + 20 * 0x10, 0}, "Voice 21 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 20 * 0x10, 0}, "Voice 21 ADPCM Start Address"},
-	    {{0x1F801'C08 + 20 * 0x10, 0}, "Voice 21 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 20 * 0x10, 0}, "Voice 21 ADSR Current Volume"},
-	    {{0x1F801'C0E + 20 * 0x10, 0}, "Voice 21 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 20 * 0x10, 0, "Voice 21 Volume Left/Right"},
+	    {0x1F801'C04 + 20 * 0x10, 0, "Voice 21 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 20 * 0x10, 0, "Voice 21 ADPCM Start Address"},
+	    {0x1F801'C08 + 20 * 0x10, 0, "Voice 21 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 20 * 0x10, 0, "Voice 21 ADSR Current Volume"},
+	    {0x1F801'C0E + 20 * 0x10, 0, "Voice 21 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 21 * 0x10, 0}, "Voice 22 Volume Left/Right"},
-	    {{0x1F801'C04 + 21 * 0x10, 0}, "Voice 22 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 21 * 0x10, 0}, "Voice 22 ADPCM Start Address"},
-	    {{0x1F801'C08 + 21 * 0x10, 0}, "Voice 22 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 21 * 0x10, 0}, "Voice 22 ADSR Current Volume"},
-	    {{0x1F801'C0E + 21 * 0x10, 0}, "Voice 22 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 21 * 0x10, 0, "Voice 22 Volume Left/Right"},
+	    {0x1F801'C04 + 21 * 0x10, 0, "Voice 22 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 21 * 0x10, 0, "Voice 22 ADPCM Start Address"},
+	    {0x1F801'C08 + 21 * 0x10, 0, "Voice 22 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 21 * 0x10, 0, "Voice 22 ADSR Current Volume"},
+	    {0x1F801'C0E + 21 * 0x10, 0, "Voice 22 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 22 * 0x10, 0}, "Voice 23 Volume Left/Right"},
-	    {{0x1F801'C04 + 22 * 0x10, 0}, "Voice 23 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 22 * 0x10, 0}, "Voice 23 ADPCM Start Address"},
-	    {{0x1F801'C08 + 22 * 0x10, 0}, "Voice 23 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 22 * 0x10, 0}, "Voice 23 ADSR Current Volume"},
-	    {{0x1F801'C0E + 22 * 0x10, 0}, "Voice 23 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 22 * 0x10, 0, "Voice 23 Volume Left/Right"},
+	    {0x1F801'C04 + 22 * 0x10, 0, "Voice 23 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 22 * 0x10, 0, "Voice 23 ADPCM Start Address"},
+	    {0x1F801'C08 + 22 * 0x10, 0, "Voice 23 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 22 * 0x10, 0, "Voice 23 ADSR Current Volume"},
+	    {0x1F801'C0E + 22 * 0x10, 0, "Voice 23 ADPCM Repeat Address"},
 	    //
-	    {{0x1F801'C00 + 23 * 0x10, 0}, "Voice 24 Volume Left/Right"},
-	    {{0x1F801'C04 + 23 * 0x10, 0}, "Voice 24 ADPCM Sample Rate"},
-	    {{0x1F801'C06 + 23 * 0x10, 0}, "Voice 24 ADPCM Start Address"},
-	    {{0x1F801'C08 + 23 * 0x10, 0}, "Voice 24 ADSR Attack/Decay/Sustain/Release"},
-	    {{0x1F801'C0C + 23 * 0x10, 0}, "Voice 24 ADSR Current Volume"},
-	    {{0x1F801'C0E + 23 * 0x10, 0}, "Voice 24 ADPCM Repeat Address"},
+	    {0x1F801'C00 + 23 * 0x10, 0, "Voice 24 Volume Left/Right"},
+	    {0x1F801'C04 + 23 * 0x10, 0, "Voice 24 ADPCM Sample Rate"},
+	    {0x1F801'C06 + 23 * 0x10, 0, "Voice 24 ADPCM Start Address"},
+	    {0x1F801'C08 + 23 * 0x10, 0, "Voice 24 ADSR Attack/Decay/Sustain/Release"},
+	    {0x1F801'C0C + 23 * 0x10, 0, "Voice 24 ADSR Current Volume"},
+	    {0x1F801'C0E + 23 * 0x10, 0, "Voice 24 ADPCM Repeat Address"},
 	    // SPU Control Registers
-	    {{0x1F801'D80, 0}, "Main Volume Left/Right"},
-	    {{0x1F801'D84, 0}, "Reverb Output Volume Left/Right"},
-	    {{0x1F801'D88, 0}, "Voice 0..23 Key ON (Start Attack/Decay/Sustain) (W)"},
-	    {{0x1F801'D8C, 0}, "Voice 0..23 Key OFF (Start Release) (W)"},
-	    {{0x1F801'D90, 0}, "Voice 0..23 Channel FM (pitch lfo) mode (R/W)"},
-	    {{0x1F801'D94, 0}, "Voice 0..23 Channel Noise mode (R/W)"},
-	    {{0x1F801'D98, 0}, "Voice 0..23 Channel Reverb mode (R/W)"},
-	    {{0x1F801'D9C, 0}, "Voice 0..23 Channel ON/OFF (status) (R)"},
-	    {{0x1F801'DA0, 0}, "Unknown? (R) or (W)"},
-	    {{0x1F801'DA2, 0}, "Sound RAM Reverb Work Area Start Address"},
-	    {{0x1F801'DA4, 0}, "Sound RAM IRQ Address"},
-	    {{0x1F801'DA6, 0}, "Sound RAM Data Transfer Address"},
-	    {{0x1F801'DA8, 0}, "Sound RAM Data Transfer Fifo"},
-	    {{0x1F801'DAA, 0}, "SPU Control Register (SPUCNT)"},
-	    {{0x1F801'DAC, 0}, "Sound RAM Data Transfer Control"},
-	    {{0x1F801'DAE, 0}, "SPU Status Register (SPUSTAT) (R)"},
-	    {{0x1F801'DB0, 0}, "CD Volume Left/Right"},
-	    {{0x1F801'DB4, 0}, "Extern Volume Left/Right"},
-	    {{0x1F801'DB8, 0}, "Current Main Volume Left/Right"},
-	    {{0x1F801'DBC, 0}, "Unknown? (R/W)"},
+	    {0x1F801'D80, 0, "Main Volume Left/Right"},
+	    {0x1F801'D84, 0, "Reverb Output Volume Left/Right"},
+	    {0x1F801'D88, 0, "Voice 0..23 Key ON (Start Attack/Decay/Sustain) (W)"},
+	    {0x1F801'D8C, 0, "Voice 0..23 Key OFF (Start Release) (W)"},
+	    {0x1F801'D90, 0, "Voice 0..23 Channel FM (pitch lfo) mode (R/W)"},
+	    {0x1F801'D94, 0, "Voice 0..23 Channel Noise mode (R/W)"},
+	    {0x1F801'D98, 0, "Voice 0..23 Channel Reverb mode (R/W)"},
+	    {0x1F801'D9C, 0, "Voice 0..23 Channel ON/OFF (status) (R)"},
+	    {0x1F801'DA0, 0, "Unknown? (R) or (W)"},
+	    {0x1F801'DA2, 0, "Sound RAM Reverb Work Area Start Address"},
+	    {0x1F801'DA4, 0, "Sound RAM IRQ Address"},
+	    {0x1F801'DA6, 0, "Sound RAM Data Transfer Address"},
+	    {0x1F801'DA8, 0, "Sound RAM Data Transfer Fifo"},
+	    {0x1F801'DAA, 0, "SPU Control Register (SPUCNT)"},
+	    {0x1F801'DAC, 0, "Sound RAM Data Transfer Control"},
+	    {0x1F801'DAE, 0, "SPU Status Register (SPUSTAT) (R)"},
+	    {0x1F801'DB0, 0, "CD Volume Left/Right"},
+	    {0x1F801'DB4, 0, "Extern Volume Left/Right"},
+	    {0x1F801'DB8, 0, "Current Main Volume Left/Right"},
+	    {0x1F801'DBC, 0, "Unknown? (R/W)"},
 	    // SPU Reverb Configuration Area
-	    {{0x1F801'DC0, 0}, "dAPF1  Reverb APF Offset 1"},
-	    {{0x1F801'DC2, 0}, "dAPF2  Reverb APF Offset 2"},
-	    {{0x1F801'DC4, 0}, "vIIR   Reverb Reflection Volume 1"},
-	    {{0x1F801'DC6, 0}, "vCOMB1 Reverb Comb Volume 1"},
-	    {{0x1F801'DC8, 0}, "vCOMB2 Reverb Comb Volume 2"},
-	    {{0x1F801'DCA, 0}, "vCOMB3 Reverb Comb Volume 3"},
-	    {{0x1F801'DCC, 0}, "vCOMB4 Reverb Comb Volume 4"},
-	    {{0x1F801'DCE, 0}, "vWALL  Reverb Reflection Volume 2"},
-	    {{0x1F801'DD0, 0}, "vAPF1  Reverb APF Volume 1"},
-	    {{0x1F801'DD2, 0}, "vAPF2  Reverb APF Volume 2"},
-	    {{0x1F801'DD4, 0}, "mSAME  Reverb Same Side Reflection Address 1 Left/Right"},
-	    {{0x1F801'DD8, 0}, "mCOMB1 Reverb Comb Address 1 Left/Right"},
-	    {{0x1F801'DDC, 0}, "mCOMB2 Reverb Comb Address 2 Left/Right"},
-	    {{0x1F801'DE0, 0}, "dSAME  Reverb Same Side Reflection Address 2 Left/Right"},
-	    {{0x1F801'DE4, 0}, "mDIFF  Reverb Different Side Reflection Address 1 Left/Right"},
-	    {{0x1F801'DE8, 0}, "mCOMB3 Reverb Comb Address 3 Left/Right"},
-	    {{0x1F801'DEC, 0}, "mCOMB4 Reverb Comb Address 4 Left/Right"},
-	    {{0x1F801'DF0, 0}, "dDIFF  Reverb Different Side Reflection Address 2 Left/Right"},
-	    {{0x1F801'DF4, 0}, "mAPF1  Reverb APF Address 1 Left/Right"},
-	    {{0x1F801'DF8, 0}, "mAPF2  Reverb APF Address 2 Left/Right"},
-	    {{0x1F801'DFC, 0}, "vIN    Reverb Input Volume Left/Right"},
+	    {0x1F801'DC0, 0, "dAPF1  Reverb APF Offset 1"},
+	    {0x1F801'DC2, 0, "dAPF2  Reverb APF Offset 2"},
+	    {0x1F801'DC4, 0, "vIIR   Reverb Reflection Volume 1"},
+	    {0x1F801'DC6, 0, "vCOMB1 Reverb Comb Volume 1"},
+	    {0x1F801'DC8, 0, "vCOMB2 Reverb Comb Volume 2"},
+	    {0x1F801'DCA, 0, "vCOMB3 Reverb Comb Volume 3"},
+	    {0x1F801'DCC, 0, "vCOMB4 Reverb Comb Volume 4"},
+	    {0x1F801'DCE, 0, "vWALL  Reverb Reflection Volume 2"},
+	    {0x1F801'DD0, 0, "vAPF1  Reverb APF Volume 1"},
+	    {0x1F801'DD2, 0, "vAPF2  Reverb APF Volume 2"},
+	    {0x1F801'DD4, 0, "mSAME  Reverb Same Side Reflection Address 1 Left/Right"},
+	    {0x1F801'DD8, 0, "mCOMB1 Reverb Comb Address 1 Left/Right"},
+	    {0x1F801'DDC, 0, "mCOMB2 Reverb Comb Address 2 Left/Right"},
+	    {0x1F801'DE0, 0, "dSAME  Reverb Same Side Reflection Address 2 Left/Right"},
+	    {0x1F801'DE4, 0, "mDIFF  Reverb Different Side Reflection Address 1 Left/Right"},
+	    {0x1F801'DE8, 0, "mCOMB3 Reverb Comb Address 3 Left/Right"},
+	    {0x1F801'DEC, 0, "mCOMB4 Reverb Comb Address 4 Left/Right"},
+	    {0x1F801'DF0, 0, "dDIFF  Reverb Different Side Reflection Address 2 Left/Right"},
+	    {0x1F801'DF4, 0, "mAPF1  Reverb APF Address 1 Left/Right"},
+	    {0x1F801'DF8, 0, "mAPF2  Reverb APF Address 2 Left/Right"},
+	    {0x1F801'DFC, 0, "vIN    Reverb Input Volume Left/Right"},
 	};
+
+	// `io_map` sorted by address, for a binary search; the sort is stable,
+	// between the ports at the same address the first one listed wins
+	constexpr auto sorted_io_map = [] {
+		constexpr size_t n = std::size(io_map);
+		std::array<io_port, n> sorted{};
+		for (size_t ix = 0; ix < n; ix++) {
+			size_t pos = ix;
+			while (pos > 0 && sorted[pos - 1].addr > io_map[ix].addr) {
+				sorted[pos] = sorted[pos - 1];
+				pos--;
+			}
+			sorted[pos] = io_map[ix];
+		}
+		return sorted;
+	}();
 }
 
 namespace psycris::bus {
-	std::string guess_io_port(uint32_t addr) {
+	void data_bus::map_pages(device_map const& map) {
+		if (map.ports) {
+			// every write to a device with data ports must be notified
+			return;
+		}
+
+		auto memory = map.d->memory();
+		uint32_t first = map.range.start >> page_bits;
+		uint32_t last = map.range.end >> page_bits;
+		for (uint32_t page = first; page <= last; page++) {
+			uint32_t page_start = page << page_bits;
+			uint32_t page_end = page_start + page_mask;
+
+			bool covered = map.range.start <= page_start && map.range.end >= page_end
+			    && map.offset(page_start) + page_size <= static_cast<size_t>(memory.size());
+			if (!covered || host_pages[page].memory != nullptr) {
+				continue;
+			}
+
+			// the device search returns the first match, a previous mapping
+			// that overlaps this page takes precedence
+			bool claimed = std::any_of(std::begin(devices), std::end(devices) - 1, [=](auto& m) {
+				return m.range.start <= page_end && m.range.end >= page_start;
+			});
+			if (!claimed) {
+				uint8_t* host = memory.data() + map.offset(page_start);
+				host_pages[page] = {host, host, host, host};
+				update_page(page);
+			}
+		}
+	}
+
+	void data_bus::read_block(uint32_t addr, gsl::span<uint8_t> out) {
+		while (!out.empty()) {
+			auto memory = page_memory(addr, &page::memory);
+			if (memory.empty()) {
+				memory = plain_memory(addr);
+			}
+
+			size_t n;
+			if (!memory.empty()) {
+				n = std::min<size_t>(out.size(), memory.size());
+				std::memcpy(out.data(), memory.data(), n);
+			} else if (addr % 4 == 0 && out.size() >= 4) {
+				n = 4;
+				uint32_t v = read<uint32_t>(addr);
+				std::memcpy(out.data(), &v, n);
+			} else if (addr % 2 == 0 && out.size() >= 2) {
+				n = 2;
+				uint16_t v = read<uint16_t>(addr);
+				std::memcpy(out.data(), &v, n);
+			} else {
+				n = 1;
+				out[0] = read<uint8_t>(addr);
+			}
+
+			addr += n;
+			out = out.subspan(n);
+		}
+	}
+
+	void data_bus::write_block(uint32_t addr, gsl::span<uint8_t const> in) {
+		while (!in.empty()) {
+			bool watched = false;
+			auto memory = page_memory(addr, &page::writable);
+			if (memory.empty()) {
+				memory = page_memory(addr, &page::observed);
+				watched = !memory.empty();
+			}
+			if (memory.empty()) {
+				memory = plain_memory(addr);
+			}
+
+			size_t n;
+			if (!memory.empty()) {
+				n = std::min<size_t>(in.size(), memory.size());
+				std::memcpy(memory.data(), in.data(), n);
+				if (watched) {
+					for (auto observer : observers) {
+						observer->written(memory.data(), n);
+					}
+				}
+			} else if (addr % 4 == 0 && in.size() >= 4) {
+				n = 4;
+				uint32_t v;
+				std::memcpy(&v, in.data(), n);
+				write(addr, v);
+			} else if (addr % 2 == 0 && in.size() >= 2) {
+				n = 2;
+				uint16_t v;
+				std::memcpy(&v, in.data(), n);
+				write(addr, v);
+			} else {
+				n = 1;
+				write(addr, in[0]);
+			}
+
+			addr += n;
+			in = in.subspan(n);
+		}
+	}
+
+	void data_bus::copy(uint32_t dst, uint32_t src, uint32_t size) {
+		std::array<uint8_t, 256> buffer;
+
+		while (size > 0) {
+			auto from = page_memory(src, &page::memory);
+			auto to = page_memory(dst, &page::writable);
+
+			uint32_t n;
+			if (!from.empty() && !to.empty()) {
+				n = std::min({size, static_cast<uint32_t>(from.size()), static_cast<uint32_t>(to.size())});
+				std::memmove(to.data(), from.data(), n);
+			} else {
+				// a watched page, a device or a page boundary; `write_block`
+				// takes care of the details
+				n = std::min(size, static_cast<uint32_t>(buffer.size()));
+				if (!from.empty()) {
+					n = std::min(n, static_cast<uint32_t>(from.size()));
+				}
+				auto chunk = gsl::span<uint8_t>{buffer.data(), n};
+				read_block(src, chunk);
+				write_block(dst, chunk);
+			}
+
+			src += n;
+			dst += n;
+			size -= n;
+		}
+	}
+
+	gsl::span<uint8_t> data_bus::plain_memory(uint32_t addr) const {
+		if (io) {
+			return io->plain_memory(addr);
+		}
+
+		auto map = find_device(addr);
+		if (!map || map->ports || map->lazy) {
+			return {};
+		}
+
+		auto memory = map->d->memory();
+		uint32_t offset = map->offset(addr);
+		size_t n = std::min<size_t>(map->range.end - addr + 1, memory.size() - std::min<size_t>(offset, memory.size()));
+		return {memory.data() + offset, static_cast<gsl::span<uint8_t>::index_type>(n)};
+	}
+
+	void data_bus::watch_writes(uint8_t const* host, write_observer& observer) {
+		if (std::find(std::begin(observers), std::end(observers), &observer) == std::end(observers)) {
+			observers.push_back(&observer);
+		}
+
+		for (size_t ix = 0; ix < host_pages.size(); ix++) {
+			if (host_pages[ix].memory == host) {
+				host_pages[ix].writable = nullptr;
+				update_page(ix);
+			}
+		}
+	}
+
+	void data_bus::update_page(size_t ix) {
+		page p = host_pages[ix];
+		uint8_t kinds = watched_kinds[ix];
+		if (kinds & access::read) {
+			p.memory = nullptr;
+		}
+		if (kinds & access::write) {
+			p.writable = nullptr;
+			p.observed = nullptr;
+		}
+		if (kinds & access::execute) {
+			p.code = nullptr;
+		}
+		if (stats) {
+			p = {nullptr, nullptr, nullptr, nullptr};
+		}
+		pages[ix] = p;
+
+		if (view != nullptr) {
+			view->map(static_cast<uint32_t>(ix), p.memory, p.writable != nullptr);
+		}
+	}
+
+	void data_bus::mirror_to(fastmem* v) {
+		view = v;
+		for (size_t ix = 0; view != nullptr && ix < pages.size(); ix++) {
+			update_page(ix);
+		}
+	}
+
+	void data_bus::collect_stats(access_stats* s) {
+		stats = s;
+		for (size_t ix = 0; ix < pages.size(); ix++) {
+			update_page(ix);
+		}
+		update_io();
+	}
+
+	uint32_t data_bus::watch(address_range r, uint8_t kinds, watch_listener& listener) {
+		assert(r.start <= r.end);
+		uint32_t id = ++last_watch_id;
+		watchpoints.push_back({id, r, kinds, &listener});
+
+		for (size_t ix = r.start >> page_bits; ix <= r.end >> page_bits; ix++) {
+			watched_kinds[ix] |= kinds;
+			update_page(ix);
+		}
+		update_io();
+		return id;
+	}
+
+	void data_bus::unwatch(uint32_t id) {
+		auto pos = std::find_if(std::begin(watchpoints), std::end(watchpoints), [=](auto& w) { return w.id == id; });
+		if (pos == std::end(watchpoints)) {
+			return;
+		}
+		address_range r = pos->range;
+		watchpoints.erase(pos);
+
+		// the other watchpoints can share the pages of the removed one
+		size_t first = r.start >> page_bits;
+		size_t last = r.end >> page_bits;
+		std::fill(&watched_kinds[first], &watched_kinds[last] + 1, 0);
+		for (auto& w : watchpoints) {
+			size_t from = std::max<size_t>(first, w.range.start >> page_bits);
+			size_t to = std::min<size_t>(last, w.range.end >> page_bits);
+			for (size_t ix = from; ix <= to; ix++) {
+				watched_kinds[ix] |= w.kinds;
+			}
+		}
+		for (size_t ix = first; ix <= last; ix++) {
+			update_page(ix);
+		}
+		update_io();
+	}
+
+	void data_bus::notify_watchpoints(uint32_t addr, uint8_t size, access::kind kind) {
+		uint32_t last = addr + size - 1;
+		// a listener can add or remove the watchpoints
+		auto hits = watchpoints;
+		for (auto& w : hits) {
+			if ((w.kinds & kind) && w.range.start <= last && w.range.end >= addr) {
+				w.listener->hit(w.id, addr, size, kind);
+			}
+		}
+	}
+
+	uint32_t data_bus::fetch_device(uint32_t addr) {
+		if (io == &monitor) {
+			return monitor.fetch(addr);
+		}
+		return read<uint32_t>(addr);
+	}
+
+	uint32_t data_bus::access_monitor::read(uint32_t addr, uint8_t size) {
+		switch (size) {
+		case 1:
+			return read<uint8_t>(addr, access::read);
+		case 2:
+			return read<uint16_t>(addr, access::read);
+		default:
+			return read<uint32_t>(addr, access::read);
+		}
+	}
+
+	void data_bus::access_monitor::write(uint32_t addr, uint32_t value, uint8_t size) {
+		switch (size) {
+		case 1:
+			write(addr, static_cast<uint8_t>(value));
+			break;
+		case 2:
+			write(addr, static_cast<uint16_t>(value));
+			break;
+		default:
+			write(addr, value);
+		}
+	}
+
+	template <typename T>
+	T data_bus::access_monitor::read(uint32_t addr, access::kind kind) {
+		if (bus.stats) {
+			bus.count(addr, sizeof(T), false);
+		}
+
+		T value;
+		if (uint8_t const* host = host_ptr<T>(bus.host_pages, addr, &page::memory)) {
+			std::memcpy(&value, host, sizeof(T));
+		} else if (bus.routed_io) {
+			value = static_cast<T>(bus.routed_io->read(addr, sizeof(T)));
+		} else {
+			value = bus.read_device<T>(addr);
+		}
+
+		bus.check_watchpoints(addr, sizeof(T), kind);
+		return value;
+	}
+
+	template <typename T>
+	void data_bus::access_monitor::write(uint32_t addr, T val) {
+		if (bus.stats) {
+			bus.count(addr, sizeof(T), true);
+		}
+
+		if (uint8_t* host = host_ptr<T>(bus.host_pages, addr, &page::memory)) {
+			std::memcpy(host, &val, sizeof(T));
+			if (!host_ptr<T>(bus.host_pages, addr, &page::writable)) {
+				for (auto observer : bus.observers) {
+					observer->written(host, sizeof(T));
+				}
+			}
+		} else if (bus.routed_io) {
+			bus.routed_io->write(addr, val, sizeof(T));
+		} else {
+			bus.write_device(addr, val);
+		}
+
+		bus.check_watchpoints(addr, sizeof(T), access::write);
+	}
+
+	void data_bus::count(uint32_t addr, uint8_t size, bool write) {
+		auto map = find_device(addr);
+		if (!map) {
+			stats->device(access_stats::unmapped, size, write);
+			return;
+		}
+
+		std::string_view name = map->d->name();
+		stats->device(name, size, write);
+
+		if (host_pages[addr >> page_bits].memory) {
+			stats->page(name, addr, size, write);
+		}
+
+		if (map->ports) {
+			// an access can touch more than one port
+			uint32_t offset = map->offset(addr);
+			int64_t last = -1;
+			for (uint32_t b = offset; b < offset + size; b++) {
+				int64_t port = map->d->port_at(b);
+				if (port >= 0 && port != last) {
+					uint32_t port_offset = static_cast<uint32_t>(port);
+					stats->port(name, port_offset, map->range.start + port_offset, size, write);
+					last = port;
+				}
+			}
+		}
+	}
+
+	std::string_view guess_io_port(uint32_t addr) {
 		addr &= 0x1fff'ffff;
-		for (auto& [port, d] : io_map) {
-			if (port == addr) {
-				return d;
+
+		// the first port at the greatest address <= `addr`
+		auto pos = std::upper_bound(std::begin(sorted_io_map),
+		                            std::end(sorted_io_map),
+		                            addr,
+		                            [](uint32_t a, io_port const& p) { return a < p.addr; });
+		if (pos == std::begin(sorted_io_map)) {
+			return {};
+		}
+		uint32_t start = std::prev(pos)->addr;
+		pos = std::lower_bound(std::begin(sorted_io_map), pos, start, [](io_port const& p, uint32_t a) {
+			return p.addr < a;
+		});
+		return addr <= (pos->addr | pos->mask) ? pos->description : std::string_view{};
+	}
+
+	void unmapped_accesses::read(uint32_t addr, uint8_t size) {
+		auto& c = counters[addr];
+		if (c.reads++ == 0 && c.writes == 0) {
+			psycris::log->warn("[BUS] unmapped read of {} bytes at {:0>8x} ({})", size, addr, guess_io_port(addr));
+			c.reported_reads = 1;
+		}
+	}
+
+	void unmapped_accesses::write(uint32_t addr, uint8_t size, uint32_t value) {
+		auto& c = counters[addr];
+		if (c.writes++ == 0 && c.reads == 0) {
+			psycris::log->warn("[BUS] unmapped write of {} bytes at {:0>8x} ({:0>8x}) ({})",
+			                   size,
+			                   addr,
+			                   value,
+			                   guess_io_port(addr));
+			c.reported_writes = 1;
+		}
+	}
+
+	void unmapped_accesses::report() {
+		for (auto& [addr, c] : counters) {
+			uint64_t reads = c.reads - c.reported_reads;
+			uint64_t writes = c.writes - c.reported_writes;
+			if (reads + writes > 0) {
+				psycris::log->warn("[BUS] {} unmapped reads and {} writes at {:0>8x} ({})",
+				                   reads,
+				                   writes,
+				                   addr,
+				                   guess_io_port(addr));
 			}
+			c.reported_reads = c.reads;
+			c.reported_writes = c.writes;
 		}
-		return {};
 	}
 }
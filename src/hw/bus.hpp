@@ -5,6 +5,8 @@
 #include <cstring>
 
 #include <gsl/span>
+#include <map>
+#include <string_view>
 #include <vector>
 
 #include "../logging.hpp"
@@ -13,10 +15,9 @@
  * \brief The `bus` namespace contains the type `data_bus` and the interfaces
  * needed to implement the devices to connect to.
  *
- * There are three main types in this namespace:
+ * There are two main types in this namespace:
  * - data_bus
  * - device
- * - data_port
  *
  * The `data_bus` is a concrete type that models the bus that connect a cpu with
  * the board devices. It has three main methods: `connect`, `read` and `write`.
@@ -26,51 +27,78 @@
  * The `device` is a virtual class that defines the interface that a device must
  * implement to be connectable to a bus.
  *
- * A `device` can be logically divided into "data ports"; a `data_port` is a sub
+ * A `device` can be logically divided into "data ports"; a data port is a sub
  * part of a device, it is placed at an offset from the beginning of the device
  * and it's size can only be 1, 2 or 4 bytes.
  *
- * The method `data_port::post_write` is called by the bus whenever the
- * data_port memory is written
+ * The method `device::post_write` is called by the bus whenever the memory of
+ * a device with data ports is written; the device then notifies the touched
+ * ports (see `mmap_device`). Likewise `device::pre_read` is called before a
+ * read of a device with lazy ports, the ports whose value is computed on
+ * demand.
+ *
+ * To keep the common case fast the `data_bus` splits the address space in
+ * pages and, when a device is connected, resolves every page fully covered by
+ * a plain memory device (a device without data ports) to a host pointer. An
+ * access to such a page is a single lookup plus a `memcpy`; only the other
+ * pages (the I/O ones) go through the device search and the data ports.
+ *
+ * The writes to a memory page can be watched by a `write_observer`; the
+ * watched pages leave the write fast path, the other ones are not affected.
+ *
+ * The accesses outside the memory pages can be routed to an `io_space`; a
+ * board uses a `static_bus`, that knows its devices at compile time.
+ *
+ * The accesses can be counted in an `access_stats`; while they are counted
+ * every page leaves the fast path and the accesses are routed to an
+ * `io_space` that counts them, otherwise nothing changes.
+ *
+ * The reads, writes and instruction fetches of an address range can be
+ * watched by a `watch_listener`; only the kind of access watched leaves the
+ * fast path, and only on the pages that contain a watched range.
+ *
+ * The fast path can be mirrored in a `fastmem`, where the memory pages are
+ * mapped at their guest addresses.
  */
 namespace psycris::bus {
+	class access_stats;
+	class fastmem;
+
 	/**
 	 * \brief given an IO addres returns a string describing its use
 	 *
-	 * This function is intended to be used during the debug only.
+	 * This function is intended to be used during the debug only; the
+	 * description is empty for an unknown port.
 	 */
-	std::string guess_io_port(uint32_t addr);
+	std::string_view guess_io_port(uint32_t addr);
 
-	class data_port {
+	/**
+	 * \brief counts the accesses to the unmapped addresses
+	 *
+	 * Only the first access to an address is logged, the following ones are
+	 * counted and logged, one line per address, by `report`; a BIOS that
+	 * polls a missing device does not flood the log.
+	 */
+	class unmapped_accesses {
 	  public:
-		data_port(uint32_t offset, uint8_t size) : _offset{offset}, _size{size} {}
+		void read(uint32_t addr, uint8_t size);
 
-		virtual ~data_port() = default;
-
-	  public:
-		uint32_t offset() const { return _offset; }
-		uint8_t size() const { return _size; }
+		void write(uint32_t addr, uint8_t size, uint32_t value);
 
-	  public:
 		/**
-		 * \brief called by the `data_bus` when a write involves this port
-		 *
-		 * When this method is called, the device memory has already been
-		 * updated.
-		 *
-		 * \param new_value the new value for this port
-		 * \param old_value the previous value of this port
-		 *
-		 * The type for the two values is always `uint32_t` even if the write
-		 * was smaller (in this case the upper bits of the values are set to
-		 * zero). This decision was made to only require a single virtual
-		 * method.
+		 * \brief logs the accesses not yet reported
 		 */
-		virtual void post_write(uint32_t new_value, uint32_t old_value) const = 0;
+		void report();
 
 	  private:
-		uint32_t _offset;
-		uint8_t _size;
+		struct counter {
+			uint64_t reads;
+			uint64_t writes;
+			uint64_t reported_reads;
+			uint64_t reported_writes;
+		};
+
+		std::map<uint32_t, counter> counters;
 	};
 
 	class device {
@@ -91,12 +119,113 @@ namespace psycris::bus {
 		virtual gsl::span<uint8_t> memory() const = 0;
 
 		/**
-		 * \brief returns this device data ports
+		 * \brief checks if the device has data ports
+		 *
+		 * The writes to a device without data ports are plain memory writes.
+		 */
+		virtual bool has_ports() const = 0;
+
+		/**
+		 * \brief called by the `data_bus` after a write to a device with
+		 * data ports
 		 *
-		 * \return std::vector<bus::data_port const*> const& with the device
-		 * ports sorted by their offset.
+		 * When this method is called, the device memory has already been
+		 * updated.
+		 *
+		 * \param offset where the write starts from the device POV
+		 * \param size how many bytes were written
+		 * \param overwritten the previous value of the written bytes
+		 */
+		virtual void post_write(uint32_t offset, uint8_t size, uint32_t overwritten) = 0;
+
+		/**
+		 * \brief checks if the device has lazy ports
+		 *
+		 * The reads from a device without lazy ports are plain memory reads.
 		 */
-		virtual std::vector<bus::data_port const*> const& ports() = 0;
+		virtual bool has_lazy_ports() const = 0;
+
+		/**
+		 * \brief called by the `data_bus` before a read from a device with
+		 * lazy ports
+		 *
+		 * The device updates the memory of the ports about to be read.
+		 *
+		 * \param offset where the read starts from the device POV
+		 * \param size how many bytes are going to be read
+		 */
+		virtual void pre_read(uint32_t offset, uint8_t size) = 0;
+
+		/**
+		 * \brief the offset of the data port that contains the byte at
+		 * `offset`, -1 if the byte is not in a data port
+		 */
+		virtual int64_t port_at(uint32_t offset) const = 0;
+	};
+
+	/**
+	 * \brief the kinds of access a watchpoint can watch, they can be or-ed
+	 *
+	 * The kinds are nested to keep `read` and `write` out of the namespace.
+	 */
+	struct access {
+		enum kind : uint8_t {
+			read = 1,
+			write = 2,
+			// an instruction fetch, see `data_bus::fetch`
+			execute = 4,
+		};
+	};
+
+	class watch_listener {
+	  public:
+		virtual ~watch_listener() = default;
+
+	  public:
+		/**
+		 * \brief called by the `data_bus` after an access to a watched range
+		 *
+		 * \param id the watchpoint hit, as returned by `data_bus::watch`
+		 * \param addr where the access starts
+		 * \param size how many bytes were accessed
+		 */
+		virtual void hit(uint32_t id, uint32_t addr, uint8_t size, access::kind kind) = 0;
+	};
+
+	class write_observer {
+	  public:
+		virtual ~write_observer() = default;
+
+	  public:
+		/**
+		 * \brief called by the `data_bus` after a write to a watched page
+		 *
+		 * \param host the host memory just written
+		 * \param size how many bytes were written
+		 */
+		virtual void written(uint8_t const* host, size_t size) = 0;
+	};
+
+	/**
+	 * \brief the accesses of a `data_bus` outside its memory pages
+	 *
+	 * See `data_bus::route_io`.
+	 */
+	class io_space {
+	  public:
+		virtual ~io_space() = default;
+
+	  public:
+		virtual uint32_t read(uint32_t addr, uint8_t size) = 0;
+
+		virtual void write(uint32_t addr, uint32_t value, uint8_t size) = 0;
+
+		/**
+		 * \brief the host memory from `addr` to the end of its mapping, if
+		 * `addr` is mapped to a plain memory device (without data ports);
+		 * an empty span otherwise
+		 */
+		virtual gsl::span<uint8_t> plain_memory(uint32_t addr) = 0;
 	};
 
 	struct address_range {
@@ -113,10 +242,48 @@ namespace psycris::bus {
 		 */
 		static const uint32_t open_bus = 0xffff'ffff;
 
+		/**
+		 * \brief the page size of the lookup table, in bits
+		 */
+		static constexpr uint8_t page_bits = 16;
+		static constexpr uint32_t page_size = 1 << page_bits;
+		static constexpr uint32_t page_mask = page_size - 1;
+
+	  public:
+		data_bus()
+		    : pages(1 << (32 - page_bits), page{nullptr, nullptr, nullptr, nullptr}),
+		      host_pages(pages),
+		      watched_kinds(pages.size(), 0) {}
+
+		data_bus(data_bus const&) = delete;
+		data_bus& operator=(data_bus const&) = delete;
+
 	  private:
+		struct page {
+			// the host memory of this page, nullptr if the page needs the
+			// device path (an unmapped or I/O page)
+			uint8_t* memory;
+
+			// the same as `memory` if a write needs no further processing,
+			// nullptr if the page is watched
+			uint8_t* writable;
+
+			// the same as `memory` if a write needs only to be notified to
+			// the write observers
+			uint8_t* observed;
+
+			// the same as `memory` if an instruction fetch needs no further
+			// processing
+			uint8_t* code;
+		};
+
 		struct device_map {
 			address_range range;
 			device* d;
+			// `d->has_ports()` and `d->has_lazy_ports()`, cached when the
+			// device is connected
+			bool ports;
+			bool lazy;
 
 			uint32_t offset(uint32_t addr) const {
 				assert(addr <= range.end);
@@ -131,26 +298,127 @@ namespace psycris::bus {
 		 * The device is mapped to the specified address range. The same device
 		 * can be mapped multiple times to different ranges.
 		 */
-		void connect(address_range r, device& dp) { devices.push_back({r, &dp}); }
+		void connect(address_range r, device& dp) {
+			devices.push_back({r, &dp, dp.has_ports(), dp.has_lazy_ports()});
+			map_pages(devices.back());
+		}
 
 		void connect(uint32_t start, device& dp) {
 			connect({start, gsl::narrow_cast<uint32_t>(start + dp.memory().size())}, dp);
 		}
 
+	  public:
+		/**
+		 * \brief returns the host memory of the page that contains `addr`
+		 *
+		 * The returned span is empty if the page is not backed by a memory
+		 * device.
+		 */
+		gsl::span<uint8_t> host_page(uint32_t addr) const {
+			uint8_t* memory = host_pages[addr >> page_bits].memory;
+			return memory ? gsl::span<uint8_t>{memory, page_size} : gsl::span<uint8_t>{};
+		}
+
+		/**
+		 * \brief the same as `host_page`, but the span is empty if the
+		 * instruction fetches from the page are watched
+		 *
+		 * The code of such a page must be fetched with `fetch`.
+		 */
+		gsl::span<uint8_t> code_page(uint32_t addr) const {
+			if (watched_kinds[addr >> page_bits] & access::execute) {
+				return {};
+			}
+			return host_page(addr);
+		}
+
+		/**
+		 * \brief notifies `observer` of every write to the memory page `host`
+		 *
+		 * `host` must be the start of a memory page (see `host_page`); every
+		 * mapping of that page is watched.
+		 */
+		void watch_writes(uint8_t const* host, write_observer& observer);
+
+		/**
+		 * \brief sends to `io` the accesses outside the memory pages
+		 *
+		 * The connected devices still provide the memory pages, but they are
+		 * no longer searched; `io` is not owned by the bus.
+		 */
+		void route_io(io_space& io) {
+			routed_io = &io;
+			update_io();
+		}
+
+		/**
+		 * \brief the accesses to the unmapped addresses, see `report`
+		 */
+		unmapped_accesses& unmapped() { return unmapped_log; }
+
+		/**
+		 * \brief counts every access in `stats`, until called with nullptr
+		 *
+		 * While the accesses are counted the memory pages are served by the
+		 * slow path and the blocks are transferred a word at a time; the
+		 * accesses served without the bus (e.g. the cpu scratchpad) are not
+		 * counted. `stats` is not owned by the bus.
+		 */
+		void collect_stats(access_stats* stats);
+
+		/**
+		 * \brief keeps `view` in sync with the lookup table of the fast path,
+		 * until called with nullptr
+		 *
+		 * `view` is not owned by the bus.
+		 */
+		void mirror_to(fastmem* view);
+
+		/**
+		 * \brief notifies `listener` of the accesses of the given `kinds`
+		 * (see `access`) that touch the range `r`
+		 *
+		 * The listener is called after the access; the range is made of bus
+		 * addresses, the mirrors of a watched address are not watched. Only
+		 * the pages that contain a watched range leave the fast path and
+		 * only for the kinds of access watched; while there is a watchpoint
+		 * the accesses outside the memory pages pay a lookup in the table
+		 * of the watched pages.
+		 *
+		 * \return the id of the watchpoint, never 0
+		 */
+		uint32_t watch(address_range r, uint8_t kinds, watch_listener& listener);
+
+		/**
+		 * \brief removes the watchpoint `id`, an unknown id is ignored
+		 */
+		void unwatch(uint32_t id);
+
+		/**
+		 * \brief the number of reads served outside the memory pages
+		 *
+		 * Such a read may change the device or depend on the clock; the cpu
+		 * uses the count to tell an idle loop from one that polls a device.
+		 */
+		uint64_t device_reads() const { return device_read_count; }
+
 	  public:
 		template <typename T>
 		T read(uint32_t addr) {
 			static_assert(std::is_unsigned_v<T> && sizeof(T) <= 4,
 			              "The data_bus read type must be a 8/16/32 unsigned int");
 
-			auto device = find_device(addr);
-			if (!device) {
-				psycris::log->warn(
-				    "[BUS] unmapped read of {} bytes at {:0>8x} ({})", sizeof(T), addr, guess_io_port(addr));
-				return static_cast<T>(open_bus);
+			if (uint8_t const* host = host_ptr<T>(addr, &page::memory)) {
+				T value;
+				std::memcpy(&value, host, sizeof(T));
+				return value;
 			}
 
-			return read<T>(*device, addr);
+			device_read_count++;
+			if (io) {
+				return static_cast<T>(io->read(addr, sizeof(T)));
+			}
+			return read_device<T>(addr);
 		}
 
 		template <typename T>
@@ -158,22 +426,229 @@ namespace psycris::bus {
 			static_assert(std::is_unsigned_v<T> && sizeof(T) <= 4,
 			              "The data_bus write type must be a 8/16/32 unsigned int");
 
+			if (uint8_t* host = host_ptr<T>(addr, &page::writable)) {
+				std::memcpy(host, &val, sizeof(T));
+				return;
+			}
+
+			if (uint8_t* host = host_ptr<T>(addr, &page::observed)) {
+				std::memcpy(host, &val, sizeof(T));
+				for (auto observer : observers) {
+					observer->written(host, sizeof(T));
+				}
+				return;
+			}
+
+			if (io) {
+				io->write(addr, val, sizeof(T));
+				return;
+			}
+
+			write_device(addr, val);
+		}
+
+		/**
+		 * \brief reads the instruction at `addr`
+		 *
+		 * The same as `read<uint32_t>` but the access is an instruction fetch
+		 * for the watchpoints.
+		 */
+		uint32_t fetch(uint32_t addr) {
+			if (uint8_t const* host = host_ptr<uint32_t>(addr, &page::code)) {
+				uint32_t value;
+				std::memcpy(&value, host, sizeof(value));
+				return value;
+			}
+			return fetch_device(addr);
+		}
+
+	  public:
+		/**
+		 * \brief reads `out.size()` bytes starting from `addr`
+		 *
+		 * A range in a memory page or in a plain memory device is copied with
+		 * a single `memcpy`; the rest is read with accesses of at most 4
+		 * bytes that never cross a word boundary, so the lazy ports are
+		 * computed as usual. The unmapped bytes read as `open_bus`.
+		 */
+		void read_block(uint32_t addr, gsl::span<uint8_t> out);
+
+		/**
+		 * \brief writes `in` starting from `addr`
+		 *
+		 * The same as `read_block`: the ranges of plain memory are copied with
+		 * a `memcpy` (and reported to the write observers), the data ports
+		 * are written a word at most at a time and their callbacks are called.
+		 */
+		void write_block(uint32_t addr, gsl::span<uint8_t const> in);
+
+		/**
+		 * \brief copies `size` bytes from `src` to `dst`
+		 *
+		 * The ranges must not overlap. When both the ranges are in the memory
+		 * pages the bytes are moved page by page, without any intermediate
+		 * buffer.
+		 */
+		void copy(uint32_t dst, uint32_t src, uint32_t size);
+
+	  private:
+		/**
+		 * \brief the slow path of `read` and `write`: the connected devices
+		 * are searched
+		 *
+		 * Out of the fast path, so that the page lookup stays small enough
+		 * to be inlined in the callers.
+		 */
+		template <typename T>
+		T read_device(uint32_t addr) {
 			auto device = find_device(addr);
 			if (!device) {
-				psycris::log->warn("[BUS] unmapped write of {} bytes at {:0>8x} ({:0>8x}) ({})",
-				                   sizeof(T),
-				                   addr,
-				                   val,
-				                   guess_io_port(addr));
+				unmapped_log.read(addr, sizeof(T));
+				return static_cast<T>(open_bus);
+			}
+
+			if (device->lazy) {
+				device->d->pre_read(device->offset(addr), sizeof(T));
+			}
+			return read<T>(*device, addr);
+		}
+
+		uint32_t fetch_device(uint32_t addr);
+
+		template <typename T>
+		void write_device(uint32_t addr, T val) {
+			auto device = find_device(addr);
+			if (!device) {
+				unmapped_log.write(addr, sizeof(T), val);
+				return;
+			}
+
+			if (!device->ports) {
+				write(*device, addr, val);
 				return;
 			}
 
 			T prev_value = read<T>(*device, addr);
 			write(*device, addr, val);
-			touch_data_ports<T>(*device, addr, prev_value);
+			device->d->post_write(device->offset(addr), sizeof(T), prev_value);
 		}
 
+		/**
+		 * \brief the `io_space` of a bus whose accesses are counted or
+		 * watched
+		 *
+		 * Every access out of the fast path lands here; the memory pages are
+		 * served from `host_pages`, the other accesses go where they would
+		 * go without the stats and the watchpoints.
+		 */
+		class access_monitor final : public io_space {
+		  public:
+			access_monitor(data_bus& bus) : bus{bus} {}
+
+			uint32_t read(uint32_t addr, uint8_t size) override;
+
+			void write(uint32_t addr, uint32_t value, uint8_t size) override;
+
+			// a block is transferred a word at a time, every word is counted
+			// and checked
+			gsl::span<uint8_t> plain_memory(uint32_t) override { return {}; }
+
+			uint32_t fetch(uint32_t addr) { return read<uint32_t>(addr, access::execute); }
+
+		  private:
+			template <typename T>
+			T read(uint32_t addr, access::kind kind);
+
+			template <typename T>
+			void write(uint32_t addr, T val);
+
+		  private:
+			data_bus& bus;
+		};
+
+		/**
+		 * \brief counts in `stats` an access of `size` bytes at `addr`
+		 */
+		void count(uint32_t addr, uint8_t size, bool write);
+
+		/**
+		 * \brief notifies the watchpoints hit by an access of `size` bytes at
+		 * `addr`
+		 */
+		void check_watchpoints(uint32_t addr, uint8_t size, access::kind kind) {
+			uint8_t kinds = watched_kinds[addr >> page_bits] | watched_kinds[(addr + size - 1) >> page_bits];
+			if (kinds & kind) {
+				notify_watchpoints(addr, size, kind);
+			}
+		}
+
+		void notify_watchpoints(uint32_t addr, uint8_t size, access::kind kind);
+
 	  private:
+		/**
+		 * \brief updates the lookup table for the pages covered by `map`
+		 *
+		 * A page is resolved to a host pointer only if it is not already
+		 * claimed by a previous mapping and `map` is a plain memory device
+		 * that covers the whole page.
+		 */
+		void map_pages(device_map const& map);
+
+		/**
+		 * \brief updates the lookup table of the fast path for the page `ix`
+		 *
+		 * An entry is the same as in `host_pages`, without the kinds of
+		 * access that are watched; all the entries are empty while the
+		 * accesses are counted. The page is updated in the `fastmem` too.
+		 */
+		void update_page(size_t ix);
+
+		/**
+		 * \brief routes the accesses outside the fast path to the
+		 * `monitor` if they are counted or watched
+		 */
+		void update_io() { io = stats || !watchpoints.empty() ? &monitor : routed_io; }
+
+		/**
+		 * \brief returns the host memory for an access of `sizeof(T)` bytes at
+		 * `addr`, or nullptr if the access must go through the slow path.
+		 *
+		 * \param kind which one of the page pointers to use
+		 */
+		template <typename T>
+		uint8_t* host_ptr(uint32_t addr, uint8_t* page::*kind) const {
+			return host_ptr<T>(pages, addr, kind);
+		}
+
+		template <typename T>
+		static uint8_t* host_ptr(std::vector<page> const& table, uint32_t addr, uint8_t* page::*kind) {
+			uint8_t* memory = table[addr >> page_bits].*kind;
+			uint32_t offset = addr & page_mask;
+			// an access that spans two pages always takes the slow path
+			if (memory == nullptr || offset > page_size - sizeof(T)) {
+				return nullptr;
+			}
+			return memory + offset;
+		}
+
+		/**
+		 * \brief the host memory of a page from `addr` to the page end; an
+		 * empty span if the page is not a memory page
+		 */
+		gsl::span<uint8_t> page_memory(uint32_t addr, uint8_t* page::*kind) const {
+			uint8_t* memory = pages[addr >> page_bits].*kind;
+			if (memory == nullptr) {
+				return {};
+			}
+			uint32_t offset = addr & page_mask;
+			return {memory + offset, page_size - offset};
+		}
+
+		/**
+		 * \brief see `io_space::plain_memory`
+		 */
+		gsl::span<uint8_t> plain_memory(uint32_t addr) const;
+
 		device_map const* find_device(uint32_t addr) const {
 			auto pos = std::find_if(                    //
 			    std::begin(devices),                    //
@@ -191,74 +666,51 @@ namespace psycris::bus {
 			return value;
 		}
 
-		uint32_t read(device_map const& map, data_port const& port) const {
-			uint32_t value;
-			auto device_memory = map.d->memory();
-			std::memcpy(&value, &device_memory[port.offset()], sizeof(value));
-			if (port.size() == 1) {
-				value &= 0x0000'00ff;
-			} else if (port.size() == 2) {
-				value &= 0x0000'ffff;
-			}
-			return value;
-		}
-
 		template <typename T>
 		void write(device_map const& map, uint32_t addr, T value) {
 			auto device_memory = map.d->memory();
 			std::memcpy(&device_memory[map.offset(addr)], &value, sizeof(T));
 		}
 
-		template <typename T>
-		void touch_data_ports(device_map const& map, uint32_t addr, T overwritten_value) {
-			int8_t written_bytes = sizeof(T);
+	  private:
+		std::vector<device_map> devices;
 
-			// where the write starts from the device POV
-			uint32_t device_offset = map.offset(addr);
+		// the lookup table of the fast path; all the pages leave it while
+		// the accesses are counted, see `update_page`
+		std::vector<page> pages;
 
-			// a char pointer to the overwritten value; it is used to recover
-			// the old value for every port
-			auto over = reinterpret_cast<char*>(&overwritten_value);
+		// the memory pages, the same as `pages` when the accesses are not
+		// counted or watched
+		std::vector<page> host_pages;
 
-			for (auto& port : map.d->ports()) {
-				uint32_t next_port_offset = port->offset() + port->size();
+		std::vector<write_observer*> observers;
 
-				bool touched = device_offset >= port->offset() && device_offset < next_port_offset;
-				if (!touched) {
-					continue;
-				}
+		struct watchpoint {
+			uint32_t id;
+			address_range range;
+			uint8_t kinds;
+			watch_listener* listener;
+		};
 
-				// how many bytes of this port are touched by this write
-				uint8_t port_bytes = std::min(gsl::narrow_cast<int8_t>(next_port_offset - device_offset),
-				                              written_bytes);
-				{
-					uint32_t new_value = read(map, *port);
-					uint32_t old_value = new_value;
+		std::vector<watchpoint> watchpoints;
 
-					// `p` points to the overwritten portion of `old_value`
-					auto p = reinterpret_cast<char*>(&old_value) + (device_offset - port->offset());
-					std::memcpy(p, over, port_bytes);
+		// the kinds of access watched in every page
+		std::vector<uint8_t> watched_kinds;
 
-					port->post_write(new_value, old_value);
-				}
+		uint32_t last_watch_id = 0;
 
-				written_bytes -= port_bytes;
-				if (written_bytes <= 0) {
-					break;
-				}
+		// where the accesses outside the fast path are sent: `routed_io` or,
+		// while the accesses are counted or watched, `monitor`
+		io_space* io = nullptr;
+		io_space* routed_io = nullptr;
 
-				over += port_bytes;
-				device_offset = next_port_offset;
-			}
+		unmapped_accesses unmapped_log;
 
-			if (map.d->ports().size() > 0 && written_bytes > 0) {
-				assert(!"TODO implement a multi-device write");
-				psycris::log->warn(
-				    "write {:x} to {} - {} {:0>8x}", read<T>(map, addr), map.d->name(), guess_io_port(addr), addr);
-			}
-		}
+		access_stats* stats = nullptr;
+		access_monitor monitor{*this};
 
-	  private:
-		std::vector<device_map> devices;
+		uint64_t device_read_count = 0;
+
+		fastmem* view = nullptr;
 	};
 }
\ No newline at end of file
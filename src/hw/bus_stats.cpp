@@ -0,0 +1,143 @@
+#include "bus_stats.hpp"
+#include "bus.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <vector>
+
+namespace {
+	using psycris::bus::access_stats;
+
+	// the entries of `m` sorted by the number of accesses, the busiest first
+	template <typename Map, typename F>
+	auto busiest(Map const& m, F&& accesses) {
+		std::vector<typename Map::const_pointer> entries;
+		for (auto& e : m) {
+			entries.push_back(&e);
+		}
+		std::stable_sort(std::begin(entries), std::end(entries), [&](auto a, auto b) {
+			return accesses(a->second).total() > accesses(b->second).total();
+		});
+		return entries;
+	}
+
+	void write_row(std::ostream& out, std::string_view name, access_stats::counter const& c) {
+		out << fmt::format("  {:<60} {:>12} {:>12}   {:>10} {:>10} {:>10}   {:>10} {:>10} {:>10}\n",
+		                   name,
+		                   c.total_reads(),
+		                   c.total_writes(),
+		                   c.reads[0],
+		                   c.reads[1],
+		                   c.reads[2],
+		                   c.writes[0],
+		                   c.writes[1],
+		                   c.writes[2]);
+	}
+
+	void write_header(std::ostream& out, std::string_view title) {
+		out << fmt::format("{}\n  {:<60} {:>12} {:>12}   {:>10} {:>10} {:>10}   {:>10} {:>10} {:>10}\n",
+		                   title,
+		                   "",
+		                   "reads",
+		                   "writes",
+		                   "r8",
+		                   "r16",
+		                   "r32",
+		                   "w8",
+		                   "w16",
+		                   "w32");
+	}
+
+	std::string json_string(std::string_view s) {
+		std::string r = "\"";
+		for (char c : s) {
+			if (c == '"' || c == '\\') {
+				r += '\\';
+			}
+			r += c;
+		}
+		return r + '"';
+	}
+
+	std::string json_counters(access_stats::counter const& c) {
+		return fmt::format(R"("reads": [{}, {}, {}], "writes": [{}, {}, {}])",
+		                   c.reads[0],
+		                   c.reads[1],
+		                   c.reads[2],
+		                   c.writes[0],
+		                   c.writes[1],
+		                   c.writes[2]);
+	}
+}
+
+namespace psycris::bus {
+	void access_stats::port(std::string_view device, uint32_t offset, uint32_t addr, uint8_t size, bool write) {
+		auto [pos, inserted] = ports.try_emplace({device, offset}, port_counter{addr, {}});
+		pos->second.accesses.add(size, write);
+	}
+
+	void access_stats::page(std::string_view device, uint32_t addr, uint8_t size, bool write) {
+		uint32_t physical = addr & 0x1fff'ffff;
+		auto [pos, inserted] = pages.try_emplace(physical >> page_bits << page_bits, page_counter{device, {}});
+		pos->second.accesses.add(size, write);
+	}
+
+	void access_stats::write_report(std::ostream& out, size_t max_pages) const {
+		auto identity = [](counter const& c) -> counter const& { return c; };
+		auto port_accesses = [](port_counter const& p) -> counter const& { return p.accesses; };
+		auto page_accesses = [](page_counter const& p) -> counter const& { return p.accesses; };
+
+		write_header(out, "bus accesses by device");
+		for (auto e : busiest(devices, identity)) {
+			write_row(out, e->first, e->second);
+		}
+
+		write_header(out, "\nbus accesses by data port");
+		for (auto e : busiest(ports, port_accesses)) {
+			auto& [device, offset] = e->first;
+			std::string name = fmt::format("{} +{:x} ({})", device, offset, guess_io_port(e->second.addr));
+			write_row(out, name, e->second.accesses);
+		}
+
+		write_header(out, fmt::format("\nbus accesses by memory page (the {} busiest)", max_pages));
+		auto entries = busiest(pages, page_accesses);
+		entries.resize(std::min(entries.size(), max_pages));
+		for (auto e : entries) {
+			write_row(out, fmt::format("{:0>8x} {}", e->first, e->second.device), e->second.accesses);
+		}
+	}
+
+	void access_stats::write_json(std::ostream& out) const {
+		out << "{\n  \"devices\": [";
+		char const* sep = "\n";
+		for (auto& [name, c] : devices) {
+			out << sep << fmt::format(R"(    {{"name": {}, {}}})", json_string(name), json_counters(c));
+			sep = ",\n";
+		}
+
+		out << "\n  ],\n  \"ports\": [";
+		sep = "\n";
+		for (auto& [key, p] : ports) {
+			out << sep
+			    << fmt::format(R"(    {{"device": {}, "offset": {}, "address": {}, "description": {}, {}}})",
+			                   json_string(key.first),
+			                   key.second,
+			                   p.addr,
+			                   json_string(guess_io_port(p.addr)),
+			                   json_counters(p.accesses));
+			sep = ",\n";
+		}
+
+		out << "\n  ],\n  \"pages\": [";
+		sep = "\n";
+		for (auto& [addr, p] : pages) {
+			out << sep
+			    << fmt::format(R"(    {{"address": {}, "device": {}, {}}})",
+			                   addr,
+			                   json_string(p.device),
+			                   json_counters(p.accesses));
+			sep = ",\n";
+		}
+		out << "\n  ]\n}\n";
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string_view>
+#include <utility>
+
+namespace psycris::bus {
+	/**
+	 * \brief Which devices, data ports and memory pages a workload accesses
+	 *
+	 * The stats are fed by a `data_bus` (see `data_bus::collect_stats`) with
+	 * every read and write; the accesses are counted:
+	 *
+	 * - per device, the unmapped addresses are counted as a device
+	 * - per data port of a device
+	 * - per 4KB page of a memory device, the mirrors of a page are counted
+	 *   together
+	 *
+	 * every counter is split by the access size.
+	 */
+	class access_stats {
+	  public:
+		static constexpr uint8_t page_bits = 12;
+
+		/**
+		 * \brief the name of the unmapped "device"
+		 */
+		static constexpr std::string_view unmapped = "unmapped";
+
+		struct counter {
+			// indexed by the access size: 1, 2 and 4 bytes
+			std::array<uint64_t, 3> reads = {};
+			std::array<uint64_t, 3> writes = {};
+
+			void add(uint8_t size, bool write) { (write ? writes : reads)[size >> 1]++; }
+
+			uint64_t total_reads() const { return reads[0] + reads[1] + reads[2]; }
+			uint64_t total_writes() const { return writes[0] + writes[1] + writes[2]; }
+			uint64_t total() const { return total_reads() + total_writes(); }
+		};
+
+		struct port_counter {
+			// the bus address of the port, the first one seen
+			uint32_t addr;
+			counter accesses;
+		};
+
+		struct page_counter {
+			std::string_view device;
+			counter accesses;
+		};
+
+	  public:
+		/**
+		 * \brief counts an access of `size` bytes to `device`
+		 */
+		void device(std::string_view device, uint8_t size, bool write) { devices[device].add(size, write); }
+
+		/**
+		 * \brief counts an access to the port at `offset` of `device`,
+		 * mapped at `addr`
+		 */
+		void port(std::string_view device, uint32_t offset, uint32_t addr, uint8_t size, bool write);
+
+		/**
+		 * \brief counts an access to the memory page that contains `addr`
+		 */
+		void page(std::string_view device, uint32_t addr, uint8_t size, bool write);
+
+	  public:
+		std::map<std::string_view, counter> const& by_device() const { return devices; }
+
+		// keyed by (device, port offset)
+		std::map<std::pair<std::string_view, uint32_t>, port_counter> const& by_port() const { return ports; }
+
+		// keyed by the physical address of the page
+		std::map<uint32_t, page_counter> const& by_page() const { return pages; }
+
+	  public:
+		/**
+		 * \brief writes a human readable report, the busiest entries first
+		 *
+		 * Only the `max_pages` busiest pages are listed.
+		 */
+		void write_report(std::ostream&, size_t max_pages = 32) const;
+
+		/**
+		 * \brief writes all the counters as a JSON object
+		 */
+		void write_json(std::ostream&) const;
+
+	  private:
+		std::map<std::string_view, counter> devices;
+		std::map<std::pair<std::string_view, uint32_t>, port_counter> ports;
+		std::map<uint32_t, page_counter> pages;
+	};
+}
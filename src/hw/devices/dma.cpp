@@ -1,9 +1,117 @@
 #include "dma.hpp"
+#include "../../logging.hpp"
 #include "interrupt_control.hpp"
 
+#include <algorithm>
+#include <fmt/format.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// the DMA sees only the RAM, the addresses wrap at its end
+	constexpr uint32_t ram_size = 0x20'0000;
+	constexpr uint32_t ram_mask = ram_size - 4;
+
+	// the data is moved through a buffer of this size
+	constexpr uint32_t chunk_bytes = 4096;
+
+	// a linked list with more nodes than this is assumed to be endless
+	constexpr uint32_t max_list_nodes = 0x10'0000;
+
+	// the value of the last header of a linked list and of the last entry
+	// of an ordering table
+	constexpr uint32_t end_of_list = 0x00ff'ffff;
+
+	// the word count of BCR (in sync mode 0) or the block size (in sync mode
+	// 1); 0 means 0x10000
+	uint32_t word_count(uint32_t bcr) {
+		uint32_t n = bcr & 0xffff;
+		return n == 0 ? 0x1'0000 : n;
+	}
+
+	// updates the master flag of `dicr`, see `dicr_bits::master_flag`
+	uint32_t update_master_flag(uint32_t dicr) {
+		using namespace psycris::hw::dicr_bits;
+		uint32_t channels = enabled_channels(dicr) & flagged_channels(dicr);
+		master_flag(dicr) = force_irq(dicr) || (master_enable(dicr) && channels != 0);
+		return dicr;
+	}
+
+	// swaps the order of the words of `data`
+	void reverse_words(gsl::span<uint8_t> data) {
+		for (uint32_t a = 0, b = static_cast<uint32_t>(data.size()) - 4; a < b; a += 4, b -= 4) {
+			std::swap_ranges(&data[a], &data[a] + 4, &data[b]);
+		}
+	}
+
+	// fills `out` with `n` pointers to the RAM: first, first + 4, ...
+	void fill_pointers(uint8_t* out, uint32_t first, uint32_t n) {
+		uint32_t i = 0;
+#if defined(__SSE2__)
+		__m128i p = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(first)), _mm_setr_epi32(0, 4, 8, 12));
+		__m128i const step = _mm_set1_epi32(16);
+		__m128i const mask = _mm_set1_epi32(ram_mask);
+		for (; i + 4 <= n; i += 4) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i), _mm_and_si128(p, mask));
+			p = _mm_add_epi32(p, step);
+		}
+#endif
+		for (; i < n; i++) {
+			uint32_t v = (first + 4 * i) & ram_mask;
+			std::memcpy(out + 4 * i, &v, sizeof(v));
+		}
+	}
+}
+
 namespace psycris::hw {
-	dma::dma(gsl::span<uint8_t, size> buffer, interrupt_control& icontrol) : mmap_device{buffer}, ic{&icontrol} {
-		write<dicr>(0x0765'4321);
+	dma::dma(gsl::span<uint8_t, size> buffer, interrupt_control& icontrol, scheduler& events, bus::data_bus& bus)
+	    : mmap_device{buffer}, ic{&icontrol}, events{&events}, bus{&bus}, ports{} {
+		write<dpcr>(0x0765'4321);
+
+		irq = events.add("DMA IRQ", [this](uint64_t) { ic->request(interrupt_control::DMA); });
+		for (uint8_t c = 0; c < channels; c++) {
+			done[c] = events.add(fmt::format("DMA{} DONE", c), [this, c](uint64_t) {
+				complete(static_cast<channel>(c));
+			});
+		}
+	}
+
+	void dma::connect(channel c, dma_port& port) { ports[c] = &port; }
+
+	uint32_t dma::reg(channel c, channel_reg r) const {
+		uint32_t v;
+		std::memcpy(&v, memory().data() + 0x10 * c + r, sizeof(v));
+		return v;
+	}
+
+	void dma::set_reg(channel c, channel_reg r, uint32_t value) {
+		std::memcpy(memory().data() + 0x10 * c + r, &value, sizeof(value));
+	}
+
+	void dma::chcr_written(channel c, uint32_t new_value, uint32_t old_value) {
+		using namespace chcr_bits;
+
+		if (c == otc) {
+			// only the start bits can be written, the table always runs
+			// backwards
+			new_value = (new_value & (busy.mask | trigger.mask | 0x4000'0000)) | decrement.mask;
+			set_reg(c, CHCR, new_value);
+		}
+
+		if (busy(old_value) && !busy(new_value)) {
+			// the transfer is stopped before its completion
+			events->cancel(done[c]);
+		}
+		try_start(c);
+	}
+
+	void dma::wcb(dpcr, uint32_t, uint32_t) {
+		// the channels written while disabled
+		for (uint8_t c = 0; c < channels; c++) {
+			try_start(static_cast<channel>(c));
+		}
 	}
 
 	void dma::wcb(dicr, uint32_t new_value, uint32_t old_value) {
@@ -14,19 +122,179 @@ namespace psycris::hw {
 		// To ack a flagged channel (ie set the bit to 0) a write of "1" is
 		// needed.
 		uint32_t ack = flagged_channels(new_value);
-		flagged_channels(new_value) &= ~ack;
-
-		// when request is 1 an interrupt can be requested
-		uint32_t request = force_irq(new_value)
-		    | (master_enable(new_value) & (enabled_channels(new_value) & flagged_channels(new_value)));
+		uint32_t flagged = flagged_channels(old_value);
+		flagged_channels(new_value) = flagged & ~ack;
 
 		// the master_flag cannot be written, so I can change it here
-		master_flag(new_value) = request;
-
+		new_value = update_master_flag(new_value);
 		write<dicr>(new_value);
 
-		if (request && master_flag(old_value)) {
+		if (master_flag(new_value) && !master_flag(old_value)) {
+			events->schedule(irq, events->now());
+		}
+	}
+
+	void dma::try_start(channel c) {
+		using namespace chcr_bits;
+
+		uint32_t ctrl = reg(c, CHCR);
+		bool enabled = (read<dpcr>() >> (4 * c + 3)) & 1;
+		bool running = events->when(done[c]) != scheduler::never;
+		if (!busy(ctrl) || !enabled || running || (sync_mode(ctrl) == 0 && !trigger(ctrl))) {
+			return;
+		}
+		trigger(ctrl) = 0;
+		set_reg(c, CHCR, ctrl);
+
+		uint64_t words = std::max<uint32_t>(transfer(c), 1);
+		events->schedule(done[c], events->now() + words * word_ticks);
+	}
+
+	uint32_t dma::transfer(channel c) {
+		using namespace chcr_bits;
+
+		uint32_t ctrl = reg(c, CHCR);
+		uint32_t count = reg(c, BCR);
+		if (c == otc) {
+			clear_ordering_table(word_count(count));
+			return word_count(count);
+		}
+
+		switch (static_cast<uint32_t>(sync_mode(ctrl))) {
+		case 0:
+			transfer_block(c, word_count(count));
+			return word_count(count);
+		case 1: {
+			// the blocks requested by the device follow each other; the
+			// registers track the progress of the transfer
+			uint32_t words = word_count(count) * (count >> 16);
+			set_reg(c, MADR, transfer_block(c, words));
+			set_reg(c, BCR, count & 0xffff);
+			return words;
+		}
+		case 2:
+			return transfer_list(c);
+		default:
+			psycris::log->warn("[DMA] channel {} started in the reserved sync mode 3", c);
+			return 0;
+		}
+	}
+
+	uint32_t dma::transfer_block(channel c, uint32_t words) {
+		using namespace chcr_bits;
+
+		uint32_t ctrl = reg(c, CHCR);
+		bool down = decrement(ctrl);
+		uint32_t addr = reg(c, MADR) & ram_mask;
+		dma_port* port = ports[c];
+		if (port == nullptr) {
+			psycris::log->warn("[DMA] channel {} has no device, {} words not transferred", c, words);
+			return (down ? addr - 4 * words : addr + 4 * words) & ram_mask;
+		}
+
+		std::array<uint8_t, chunk_bytes> buffer;
+		while (words > 0) {
+			// the words of a chunk are contiguous in the RAM
+			uint32_t room = down ? addr / 4 + 1 : (ram_size - addr) / 4;
+			uint32_t n = std::min({words, room, chunk_bytes / 4});
+			uint32_t start = down ? addr - 4 * (n - 1) : addr;
+			auto data = gsl::span<uint8_t>(buffer).first(4 * n);
+
+			if (from_ram(ctrl)) {
+				bus->read_block(start, data);
+				if (down) {
+					reverse_words(data);
+				}
+				port->dma_write(data);
+			} else {
+				port->dma_read(data);
+				if (down) {
+					reverse_words(data);
+				}
+				bus->write_block(start, data);
+			}
+
+			words -= n;
+			addr = (down ? start - 4 : addr + 4 * n) & ram_mask;
+		}
+		return addr;
+	}
+
+	uint32_t dma::transfer_list(channel c) {
+		if (!chcr_bits::from_ram(reg(c, CHCR))) {
+			psycris::log->warn("[DMA] channel {} cannot write a linked list to the RAM", c);
+			return 0;
+		}
+
+		dma_port* port = ports[c];
+		std::array<uint8_t, 255 * 4> buffer;
+		uint32_t addr = reg(c, MADR) & ram_mask;
+		uint32_t words = 0;
+		for (uint32_t nodes = 0;; nodes++) {
+			if (nodes == max_list_nodes) {
+				psycris::log->warn("[DMA] the linked list of channel {} does not end", c);
+				break;
+			}
+
+			// a header is the size of the node and the address of the next one
+			uint32_t header = bus->read<uint32_t>(addr);
+			uint32_t n = header >> 24;
+			if (port != nullptr && n > 0) {
+				auto data = gsl::span<uint8_t>(buffer).first(4 * n);
+				bus->read_block((addr + 4) & ram_mask, data);
+				port->dma_write(data);
+			}
+			words += n + 1;
+
+			if (header & 0x80'0000) {
+				break;
+			}
+			addr = header & ram_mask;
+		}
+		if (port == nullptr) {
+			psycris::log->warn("[DMA] channel {} has no device, {} words not transferred", c, words);
+		}
+
+		set_reg(c, MADR, end_of_list);
+		return words;
+	}
+
+	void dma::clear_ordering_table(uint32_t words) {
+		// every entry points to the previous one, the last one ends the list
+		std::array<uint8_t, chunk_bytes> buffer;
+		uint32_t top = reg(otc, MADR) & ram_mask;
+		while (words > 0) {
+			uint32_t n = std::min({words, top / 4 + 1, chunk_bytes / 4});
+			uint32_t start = top - 4 * (n - 1);
+
+			fill_pointers(buffer.data(), start - 4, n);
+			if (words == n) {
+				std::memcpy(buffer.data(), &end_of_list, sizeof(end_of_list));
+			}
+			bus->write_block(start, gsl::span<uint8_t>(buffer).first(4 * n));
+
+			words -= n;
+			top = (start - 4) & ram_mask;
+		}
+	}
+
+	void dma::complete(channel c) {
+		using namespace dicr_bits;
+
+		uint32_t ctrl = reg(c, CHCR);
+		chcr_bits::busy(ctrl) = 0;
+		set_reg(c, CHCR, ctrl);
+
+		uint32_t old_value = read<dicr>();
+		uint32_t value = old_value;
+		if ((enabled_channels(value) >> c) & 1) {
+			flagged_channels(value) = flagged_channels(value) | (1 << c);
+		}
+		value = update_master_flag(value);
+		write<dicr>(value);
+
+		if (master_flag(value) && !master_flag(old_value)) {
 			ic->request(interrupt_control::DMA);
 		}
 	}
-}
\ No newline at end of file
+}
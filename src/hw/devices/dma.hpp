@@ -1,10 +1,35 @@
 #pragma once
 #include "../../bitmask.hpp"
+#include "../../scheduler.hpp"
 #include "../mmap_device.hpp"
 
+#include <array>
+
 namespace psycris::hw {
 	class interrupt_control;
 
+	namespace chcr_bits {
+		using mask = psycris::bit_mask<class chcr_bits_>;
+
+		// 0: from the device to the RAM, 1: from the RAM to the device
+		constexpr mask from_ram{0x0000'0001};
+
+		// 0: the memory address is incremented after every word, 1: it is
+		// decremented
+		constexpr mask decrement{0x0000'0002};
+
+		// 0: the words are sent at once (the start must be triggered),
+		// 1: in blocks, as requested by the device, 2: following a linked
+		// list of headers in the RAM
+		constexpr mask sync_mode{0x0000'0600};
+
+		// set to start a transfer, reset when the transfer is completed
+		constexpr mask busy{0x0100'0000};
+
+		// set to start a transfer in sync mode 0, reset when it starts
+		constexpr mask trigger{0x1000'0000};
+	}
+
 	namespace dicr_bits {
 		using mask = psycris::bit_mask<class dicr_bits_>;
 
@@ -12,7 +37,7 @@ namespace psycris::hw {
 		constexpr mask force_irq{0x0000'8000};
 
 		// The flags to enable the dma interrupts, 7 bits for 7 channels.
-		constexpr mask enabled_channels{0x003f'0000};
+		constexpr mask enabled_channels{0x007f'0000};
 
 		// The master control switch to enable/disable the interrupts.
 		constexpr mask master_enable{0x0080'0000};
@@ -23,7 +48,7 @@ namespace psycris::hw {
 		// `enabled_channels` are set.
 		//
 		// These bits are acknowledged (reset to zero) by writing a "1".
-		constexpr mask flagged_channels{0x3f00'0000};
+		constexpr mask flagged_channels{0x7f00'0000};
 
 		/**
 		 * \brief Bit31 is a simple readonly flag set to 1 if an interrupt is
@@ -38,21 +63,140 @@ namespace psycris::hw {
 		constexpr mask master_flag{0x8000'0000};
 	}
 
-	class dma : public mmap_device<dma, 8> {
+	/**
+	 * \brief The device side of a DMA channel
+	 *
+	 * The data is moved in whole words, a span is always a multiple of 4
+	 * bytes long.
+	 */
+	class dma_port {
+	  public:
+		virtual ~dma_port() = default;
+
+		/**
+		 * \brief receives the words read from the RAM
+		 */
+		virtual void dma_write(gsl::span<uint8_t const> data) = 0;
+
+		/**
+		 * \brief fills `data` with the words to write in the RAM
+		 */
+		virtual void dma_read(gsl::span<uint8_t> data) = 0;
+	};
+
+	/**
+	 * \brief The DMA controller, with its seven channels
+	 *
+	 * A channel starts when its CHCR is written with the busy bit set (plus
+	 * the trigger bit in sync mode 0) and the channel is enabled in DPCR; a
+	 * channel written while disabled starts as soon as it is enabled.
+	 *
+	 * The data is moved at once, when the channel starts: the RAM side is
+	 * copied in blocks through the data bus (see `data_bus::read_block`), the
+	 * device side is a `dma_port`. The channel registers are updated as on
+	 * the hardware at the end of the transfer. The completion, that resets
+	 * the busy bit and flags the channel in DICR, is scheduled `word_ticks`
+	 * ticks per word later; the cpu keeps running meanwhile.
+	 *
+	 * Channel 6 (OTC) has no device: it fills the RAM with an empty ordering
+	 * table, a list of pointers that runs backwards.
+	 */
+	class dma : public mmap_device<dma, 0x80> {
 	  public:
 		static constexpr char const* device_name = "DMA";
 
-		dma(gsl::span<uint8_t, size> buffer, interrupt_control& icontrol);
+		enum channel : uint8_t { mdec_in, mdec_out, gpu, cdrom, spu, pio, otc };
+
+		static constexpr uint8_t channels = 7;
+
+		/**
+		 * \brief the ticks needed to transfer a word
+		 */
+		static constexpr uint64_t word_ticks = 1;
+
+		dma(gsl::span<uint8_t, size> buffer, interrupt_control& icontrol, scheduler& events, bus::data_bus& bus);
+
+		/**
+		 * \brief connects the device side of the channel `c`
+		 *
+		 * A channel without a port moves no data; `port` is not owned by the
+		 * dma.
+		 */
+		void connect(channel c, dma_port& port);
 
 	  private:
-		using dpcr = data_reg<0>;
-		using dicr = data_reg<4>;
+		// the registers of a channel, at 0x10 * channel
+		enum channel_reg : uint32_t { MADR = 0x0, BCR = 0x4, CHCR = 0x8 };
+
+		template <uint8_t Channel>
+		struct chcr : data_reg<0x10 * Channel + CHCR> {};
+
+		using dpcr = data_reg<0x70>;
+		using dicr = data_reg<0x74>;
+
+		using data_ports =
+		    std::tuple<chcr<0>, chcr<1>, chcr<2>, chcr<3>, chcr<4>, chcr<5>, chcr<6>, dpcr, dicr>;
 
 		friend mmap_device;
 
+		template <uint8_t Channel>
+		void wcb(chcr<Channel>, uint32_t new_value, uint32_t old_value) {
+			chcr_written(static_cast<channel>(Channel), new_value, old_value);
+		}
+
+		void wcb(dpcr, uint32_t, uint32_t);
 		void wcb(dicr, uint32_t, uint32_t);
 
+	  private:
+		uint32_t reg(channel c, channel_reg r) const;
+		void set_reg(channel c, channel_reg r, uint32_t value);
+
+		void chcr_written(channel c, uint32_t new_value, uint32_t old_value);
+
+		/**
+		 * \brief starts the channel `c` if it is busy, triggered and enabled
+		 */
+		void try_start(channel c);
+
+		/**
+		 * \brief moves the data of the channel `c`
+		 *
+		 * \return the words transferred
+		 */
+		uint32_t transfer(channel c);
+
+		/**
+		 * \brief moves `words` words between the RAM and the port of `c`
+		 *
+		 * \return the address that follows the last word
+		 */
+		uint32_t transfer_block(channel c, uint32_t words);
+
+		/**
+		 * \brief sends to the port of `c` the linked list that starts at MADR
+		 *
+		 * \return the words read, the headers included
+		 */
+		uint32_t transfer_list(channel c);
+
+		void clear_ordering_table(uint32_t words);
+
+		/**
+		 * \brief resets the busy bit of `c` and flags the channel in DICR
+		 */
+		void complete(channel c);
+
 	  private:
 		interrupt_control* ic;
+
+		scheduler* events;
+		// raises the DMA interrupt
+		scheduler::event irq;
+		// the completion of every channel
+		std::array<scheduler::event, channels> done;
+
+		bus::data_bus* bus;
+
+		std::array<dma_port*, channels> ports;
 	};
 }
\ No newline at end of file
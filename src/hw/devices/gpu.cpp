@@ -0,0 +1,552 @@
+#include "gpu.hpp"
+#include "../../logging.hpp"
+#include "interrupt_control.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+namespace {
+	using psycris::hw::rasterizer;
+
+	// the coordinates of the vertices are 11 bit signed values
+	int32_t sign_extend11(uint32_t v) { return static_cast<int32_t>(v << 21) >> 21; }
+
+	uint16_t rgb15(uint32_t color) {
+		return static_cast<uint16_t>((color >> 3 & 0x1f) | (color >> 11 & 0x1f) << 5 | (color >> 19 & 0x1f) << 10);
+	}
+
+	void set_color(rasterizer::vertex& v, uint32_t color) {
+		v.r = static_cast<uint8_t>(color);
+		v.g = static_cast<uint8_t>(color >> 8);
+		v.b = static_cast<uint8_t>(color >> 16);
+	}
+
+	void set_texcoord(rasterizer::vertex& v, uint32_t word) {
+		v.u = static_cast<uint8_t>(word);
+		v.v = static_cast<uint8_t>(word >> 8);
+	}
+
+	// the words of the GP0 command that starts with `word`
+	uint8_t command_length(uint32_t word) {
+		uint8_t op = word >> 24;
+		switch (op >> 5) {
+		case 1: {
+			// polygons: the vertices, their texture coordinates and the colors
+			// after the first one
+			int n = op & 0x08 ? 4 : 3;
+			bool textured = op & 0x04;
+			bool gouraud = op & 0x10;
+			return static_cast<uint8_t>(1 + n * (1 + textured) + (gouraud ? n - 1 : 0));
+		}
+		case 2:
+			// lines, the polylines continue until the terminator
+			return op & 0x10 ? 4 : 3;
+		case 3: {
+			// rectangles, the size follows if variable
+			bool textured = op & 0x04;
+			bool variable = (op & 0x18) == 0;
+			return static_cast<uint8_t>(2 + textured + variable);
+		}
+		case 4:
+			return 4;
+		case 5:
+		case 6:
+			return 3;
+		default:
+			return op == 0x02 ? 3 : 1;
+		}
+	}
+
+	// ends a polyline
+	bool is_terminator(uint32_t word) { return (word & 0xf000'f000) == 0x5000'5000; }
+
+	void advance(int32_t& col, int32_t& row, int32_t w) {
+		if (++col == w) {
+			col = 0;
+			row++;
+		}
+	}
+}
+
+namespace psycris::hw {
+	gpu::gpu(gsl::span<uint8_t, size> buffer, vram& video_ram, interrupt_control& icontrol)
+	    : mmap_device{buffer}, ic{&icontrol}, raster{video_ram.pixels()} {
+		reset();
+	}
+
+	void gpu::dma_write(gsl::span<uint8_t const> data) {
+		for (std::ptrdiff_t i = 0; i < data.size(); i += 4) {
+			uint32_t word;
+			std::memcpy(&word, &data[i], sizeof(word));
+			gp0_written(word);
+		}
+	}
+
+	void gpu::dma_read(gsl::span<uint8_t> data) {
+		for (std::ptrdiff_t i = 0; i < data.size(); i += 4) {
+			uint32_t word = gpuread();
+			std::memcpy(&data[i], &word, sizeof(word));
+		}
+	}
+
+	void gpu::reset() {
+		fifo.fill(0);
+		fifo_size = 0;
+		expected = 0;
+		polyline = false;
+		to_vram = {};
+		from_vram = {};
+
+		stat = gpustat_bits::display_disable.mask | gpustat_bits::interlace_field.mask;
+		latch = 0;
+		for (uint32_t op = 0xe1; op <= 0xe6; op++) {
+			environment(op << 24);
+		}
+
+		display_start = 0;
+		display_h_range = 0x200 | 0xc00 << 12;
+		display_v_range = 0x10 | 0x100 << 10;
+	}
+
+	void gpu::gp0_written(uint32_t word) {
+		if (to_vram.left > 0) {
+			for (int half = 0; half < 2 && to_vram.left > 0; half++) {
+				store(to_vram.x + to_vram.col, to_vram.y + to_vram.row, static_cast<uint16_t>(word >> 16 * half));
+				advance(to_vram.col, to_vram.row, to_vram.w);
+				to_vram.left--;
+			}
+			return;
+		}
+
+		if (polyline && is_terminator(word)) {
+			polyline = false;
+			fifo_size = 0;
+			return;
+		}
+
+		if (fifo_size == 0) {
+			expected = command_length(word);
+		}
+		fifo[fifo_size++] = word;
+		if (fifo_size < expected) {
+			return;
+		}
+
+		execute();
+		if (!polyline) {
+			fifo_size = 0;
+		}
+	}
+
+	void gpu::execute() {
+		uint32_t const word = fifo[0];
+		uint8_t const op = word >> 24;
+		switch (op >> 5) {
+		case 0:
+			if (op == 0x02) {
+				fill();
+			} else if (op == 0x1f) {
+				gpustat_bits::irq(stat) = true;
+				ic->request(interrupt_control::GPU);
+			}
+			// the others are nops or clear the texture cache, that is not
+			// emulated
+			break;
+		case 1:
+			polygon();
+			break;
+		case 2:
+			line();
+			break;
+		case 3:
+			rectangle();
+			break;
+		case 4:
+			copy();
+			break;
+		case 5:
+			to_vram = transfer_of(fifo[1], fifo[2]);
+			break;
+		case 6:
+			from_vram = transfer_of(fifo[1], fifo[2]);
+			break;
+		default:
+			environment(word);
+			break;
+		}
+	}
+
+	rasterizer::vertex gpu::vertex(uint32_t word) const {
+		rasterizer::vertex v{};
+		v.x = sign_extend11(word) + offset_x;
+		v.y = sign_extend11(word >> 16) + offset_y;
+		return v;
+	}
+
+	rasterizer::primitive gpu::primitive(uint32_t command) const {
+		uint8_t op = command >> 24;
+		rasterizer::primitive p = page;
+		p.semi_transparent = op & 0x02;
+		p.gouraud = (op & 0x10) && (op >> 5) != 3;
+		p.textured = (op & 0x04) && (op >> 5) != 2;
+		p.raw = p.textured && (op & 0x01);
+		return p;
+	}
+
+	void gpu::polygon() {
+		uint8_t const op = fifo[0] >> 24;
+		bool const gouraud = op & 0x10;
+		bool const textured = op & 0x04;
+		int const n = op & 0x08 ? 4 : 3;
+
+		std::array<rasterizer::vertex, 4> v;
+		uint32_t clut = 0;
+		uint32_t color = fifo[0];
+		size_t w = 1;
+		for (int i = 0; i < n; i++) {
+			if (i > 0 && gouraud) {
+				color = fifo[w++];
+			}
+			v[i] = vertex(fifo[w++]);
+			set_color(v[i], color);
+			if (textured) {
+				uint32_t uv = fifo[w++];
+				set_texcoord(v[i], uv);
+				if (i == 0) {
+					clut = uv >> 16;
+				} else if (i == 1) {
+					texture_page(uv >> 16);
+				}
+			}
+		}
+
+		// the page of a textured polygon is used by the next primitives too
+		rasterizer::primitive p = primitive(fifo[0]);
+		p.clut_x = static_cast<uint16_t>((clut & 0x3f) * 16);
+		p.clut_y = static_cast<uint16_t>((clut >> 6) & 0x1ff);
+		raster.triangle({v[0], v[1], v[2]}, p);
+		if (n == 4) {
+			raster.triangle({v[1], v[2], v[3]}, p);
+		}
+	}
+
+	void gpu::line() {
+		uint8_t const op = fifo[0] >> 24;
+		bool const gouraud = op & 0x10;
+
+		uint32_t const end = fifo[gouraud ? 3 : 2];
+		uint32_t const end_color = gouraud ? fifo[2] : fifo[0];
+		rasterizer::vertex a = vertex(fifo[1]);
+		rasterizer::vertex b = vertex(end);
+		set_color(a, fifo[0]);
+		set_color(b, end_color);
+		raster.line(a, b, primitive(fifo[0]));
+
+		if (op & 0x08) {
+			// the end of the segment starts the next one
+			polyline = true;
+			fifo[0] = (fifo[0] & 0xff00'0000) | (end_color & 0x00ff'ffff);
+			fifo[1] = end;
+			fifo_size = 2;
+		}
+	}
+
+	void gpu::rectangle() {
+		uint8_t const op = fifo[0] >> 24;
+		bool const textured = op & 0x04;
+
+		rasterizer::primitive p = primitive(fifo[0]);
+		rasterizer::vertex v = vertex(fifo[1]);
+		set_color(v, fifo[0]);
+		size_t w = 2;
+		if (textured) {
+			uint32_t uv = fifo[w++];
+			set_texcoord(v, uv);
+			p.clut_x = static_cast<uint16_t>((uv >> 16 & 0x3f) * 16);
+			p.clut_y = static_cast<uint16_t>((uv >> 22) & 0x1ff);
+		}
+
+		int32_t width, height;
+		switch ((op >> 3) & 3) {
+		case 0:
+			width = fifo[w] & 0x3ff;
+			height = (fifo[w] >> 16) & 0x1ff;
+			break;
+		case 1:
+			width = height = 1;
+			break;
+		case 2:
+			width = height = 8;
+			break;
+		default:
+			width = height = 16;
+			break;
+		}
+		raster.rectangle(v, width, height, p, flip_x, flip_y);
+	}
+
+	void gpu::fill() {
+		// the fill works in blocks of 16 pixels
+		int32_t x = fifo[1] & 0x3f0;
+		int32_t y = (fifo[1] >> 16) & 0x1ff;
+		int32_t w = ((fifo[2] & 0x3ff) + 15) & ~15;
+		int32_t h = (fifo[2] >> 16) & 0x1ff;
+		raster.fill(x, y, w, h, rgb15(fifo[0]));
+	}
+
+	void gpu::copy() {
+		transfer src = transfer_of(fifo[1], fifo[3]);
+		transfer dst = transfer_of(fifo[2], fifo[3]);
+		for (int32_t row = 0; row < src.h; row++) {
+			for (int32_t col = 0; col < src.w; col++) {
+				store(dst.x + col, dst.y + row, raster.pixel(src.x + col, src.y + row));
+			}
+		}
+	}
+
+	gpu::transfer gpu::transfer_of(uint32_t position, uint32_t size) {
+		transfer t{};
+		t.x = position & 0x3ff;
+		t.y = (position >> 16) & 0x1ff;
+		t.w = (((size & 0xffff) - 1) & 0x3ff) + 1;
+		t.h = (((size >> 16) - 1) & 0x1ff) + 1;
+		t.left = static_cast<uint32_t>(t.w * t.h);
+		return t;
+	}
+
+	void gpu::store(int32_t x, int32_t y, uint16_t pixel) {
+		uint16_t& p = raster.pixel(x, y);
+		if (raster.env.check_mask && (p & 0x8000)) {
+			return;
+		}
+		p = pixel | (raster.env.set_mask ? 0x8000 : 0);
+	}
+
+	void gpu::environment(uint32_t word) {
+		using namespace gpustat_bits;
+
+		auto& env = raster.env;
+		switch (word >> 24) {
+		case 0xe1:
+			texture_page(word);
+			env.dither = word & 0x200;
+			dither(stat) = env.dither;
+			draw_to_display(stat) = (word >> 10) & 1;
+			flip_x = word & 0x1000;
+			flip_y = word & 0x2000;
+			break;
+		case 0xe2:
+			texture_window = word & 0xf'ffff;
+			env.window_mask_x = word & 0x1f;
+			env.window_mask_y = (word >> 5) & 0x1f;
+			env.window_offset_x = (word >> 10) & 0x1f;
+			env.window_offset_y = (word >> 15) & 0x1f;
+			break;
+		case 0xe3:
+			area_top_left = word & 0xf'ffff;
+			env.left = word & 0x3ff;
+			env.top = (word >> 10) & 0x1ff;
+			break;
+		case 0xe4:
+			area_bottom_right = word & 0xf'ffff;
+			env.right = word & 0x3ff;
+			env.bottom = (word >> 10) & 0x1ff;
+			break;
+		case 0xe5:
+			draw_offset = word & 0x3f'ffff;
+			offset_x = sign_extend11(word);
+			offset_y = sign_extend11(word >> 11);
+			break;
+		case 0xe6:
+			env.set_mask = word & 0x1;
+			env.check_mask = word & 0x2;
+			set_mask(stat) = env.set_mask;
+			check_mask(stat) = env.check_mask;
+			break;
+		default:
+			psycris::log->warn("[GPU] unknown GP0 command {:0>8x}", word);
+			break;
+		}
+	}
+
+	void gpu::texture_page(uint32_t bits) {
+		using namespace gpustat_bits;
+
+		draw_mode(stat) = bits & 0x1ff;
+		texture_disable(stat) = (bits >> 11) & 1;
+		page.page_x = static_cast<uint16_t>((bits & 0xf) * 64);
+		page.page_y = static_cast<uint16_t>((bits >> 4 & 1) * 256);
+		page.semi_mode = (bits >> 5) & 3;
+		// the reserved depth 3 is the same as 2
+		page.depth = static_cast<uint8_t>(std::min<uint32_t>((bits >> 7) & 3, 2));
+	}
+
+	void gpu::gp1_written(uint32_t word) {
+		using namespace gpustat_bits;
+
+		uint8_t op = (word >> 24) & 0x3f;
+		switch (op) {
+		case 0x00:
+			reset();
+			break;
+		case 0x01:
+			fifo_size = 0;
+			polyline = false;
+			to_vram.left = 0;
+			break;
+		case 0x02:
+			irq(stat) = false;
+			break;
+		case 0x03:
+			display_disable(stat) = word & 1;
+			break;
+		case 0x04:
+			dma_direction(stat) = word & 3;
+			break;
+		case 0x05:
+			display_start = word & 0x7'ffff;
+			break;
+		case 0x06:
+			display_h_range = word & 0xff'ffff;
+			break;
+		case 0x07:
+			display_v_range = word & 0xf'ffff;
+			break;
+		case 0x08:
+			// the bit 6 is the first of the display mode in GPUSTAT
+			display_mode(stat) = (word & 0x3f) << 1 | ((word >> 6) & 1);
+			reverse(stat) = (word >> 7) & 1;
+			break;
+		default:
+			if (op >= 0x10 && op <= 0x1f) {
+				// the gpu info, in GPUREAD
+				switch (word & 0x7) {
+				case 2:
+					latch = texture_window;
+					break;
+				case 3:
+					latch = area_top_left;
+					break;
+				case 4:
+					latch = area_bottom_right;
+					break;
+				case 5:
+					latch = draw_offset;
+					break;
+				case 7:
+					// the gpu version
+					latch = 2;
+					break;
+				}
+			} else {
+				psycris::log->warn("[GPU] unknown GP1 command {:0>8x}", word);
+			}
+			break;
+		}
+	}
+
+	uint32_t gpu::gpuread() {
+		if (from_vram.left > 0) {
+			uint32_t word = 0;
+			for (int half = 0; half < 2 && from_vram.left > 0; half++) {
+				uint16_t p = raster.pixel(from_vram.x + from_vram.col, from_vram.y + from_vram.row);
+				word |= uint32_t(p) << 16 * half;
+				advance(from_vram.col, from_vram.row, from_vram.w);
+				from_vram.left--;
+			}
+			latch = word;
+		}
+		return latch;
+	}
+
+	uint32_t gpu::status() const {
+		using namespace gpustat_bits;
+
+		uint32_t s = stat;
+		ready_for_command(s) = true;
+		ready_for_dma(s) = true;
+		ready_to_send(s) = from_vram.left > 0;
+		switch (static_cast<uint32_t>(dma_direction(s))) {
+		case 0:
+			dma_request(s) = false;
+			break;
+		case 1:
+		case 2:
+			dma_request(s) = true;
+			break;
+		default:
+			dma_request(s) = static_cast<uint32_t>(ready_to_send(s));
+			break;
+		}
+		return s;
+	}
+
+	template <typename Self, typename F>
+	void gpu::state_fields(Self& self, F&& f) {
+		f(self.fifo);
+		f(self.fifo_size);
+		f(self.expected);
+		f(self.polyline);
+
+		for (auto* t : {&self.to_vram, &self.from_vram}) {
+			f(t->x);
+			f(t->y);
+			f(t->w);
+			f(t->h);
+			f(t->col);
+			f(t->row);
+			f(t->left);
+		}
+
+		f(self.stat);
+		f(self.latch);
+
+		f(self.texture_window);
+		f(self.area_top_left);
+		f(self.area_bottom_right);
+		f(self.draw_offset);
+		f(self.offset_x);
+		f(self.offset_y);
+
+		auto& env = self.raster.env;
+		f(env.left);
+		f(env.top);
+		f(env.right);
+		f(env.bottom);
+		f(env.dither);
+		f(env.set_mask);
+		f(env.check_mask);
+		f(env.window_mask_x);
+		f(env.window_mask_y);
+		f(env.window_offset_x);
+		f(env.window_offset_y);
+
+		auto& page = self.page;
+		f(page.gouraud);
+		f(page.textured);
+		f(page.raw);
+		f(page.semi_transparent);
+		f(page.semi_mode);
+		f(page.page_x);
+		f(page.page_y);
+		f(page.depth);
+		f(page.clut_x);
+		f(page.clut_y);
+		f(self.flip_x);
+		f(self.flip_y);
+
+		f(self.display_start);
+		f(self.display_h_range);
+		f(self.display_v_range);
+	}
+
+	void dump_gpu(std::ostream& f, gpu const& g) {
+		gpu::state_fields(g, [&](auto const& v) { f.write(reinterpret_cast<char const*>(&v), sizeof(v)); });
+	}
+
+	void restore_gpu(std::istream& f, gpu& g) {
+		gpu::state_fields(g, [&](auto& v) { f.read(reinterpret_cast<char*>(&v), sizeof(v)); });
+	}
+}
@@ -0,0 +1,221 @@
+#pragma once
+#include "../../bitmask.hpp"
+#include "../mmap_device.hpp"
+#include "dma.hpp"
+#include "gpu_raster.hpp"
+
+#include <array>
+#include <iosfwd>
+
+namespace psycris::hw {
+	class interrupt_control;
+
+	namespace gpustat_bits {
+		using mask = psycris::bit_mask<class gpustat_bits_>;
+
+		// the texture page, the semi-transparency and the texture depth, as
+		// set by GP0(E1h)
+		constexpr mask draw_mode{0x0000'01ff};
+
+		constexpr mask dither{0x0000'0200};
+
+		// the drawing to the displayed area is allowed
+		constexpr mask draw_to_display{0x0000'0400};
+
+		constexpr mask set_mask{0x0000'0800};
+		constexpr mask check_mask{0x0000'1000};
+
+		// always 1 without interlace
+		constexpr mask interlace_field{0x0000'2000};
+
+		constexpr mask reverse{0x0000'4000};
+		constexpr mask texture_disable{0x0000'8000};
+
+		// the display mode, as set by GP1(08h)
+		constexpr mask display_mode{0x007f'0000};
+
+		constexpr mask display_disable{0x0080'0000};
+
+		// set by GP0(1Fh), reset by GP1(02h)
+		constexpr mask irq{0x0100'0000};
+
+		// depends on the dma direction
+		constexpr mask dma_request{0x0200'0000};
+
+		constexpr mask ready_for_command{0x0400'0000};
+		constexpr mask ready_to_send{0x0800'0000};
+		constexpr mask ready_for_dma{0x1000'0000};
+
+		// 0: off, 1: fifo, 2: cpu to GP0, 3: GPUREAD to cpu
+		constexpr mask dma_direction{0x6000'0000};
+	}
+
+	/**
+	 * \brief The 1MiB of video RAM, 1024x512 16 bit pixels
+	 *
+	 * The VRAM is not on the data bus, it is reached through the gpu only.
+	 */
+	class vram : public mmap_device<vram, 1024 * 1024> {
+	  public:
+		static constexpr char const* device_name = "VRAM";
+
+		vram(gsl::span<uint8_t, size> buffer) : mmap_device{buffer} {}
+
+		uint16_t* pixels() const { return reinterpret_cast<uint16_t*>(memory().data()); }
+	};
+
+	/**
+	 * \brief The GPU, its command processor and the display control
+	 *
+	 * https://problemkaputt.de/psx-spx.htm#graphicsprocessingunitgpu
+	 *
+	 * The GP0 words are collected until a command is complete, then the
+	 * command is executed at once: the gpu draws in no time and is always
+	 * ready for the next command. The image transfers between the cpu and
+	 * the VRAM move two pixels per word, through GP0 (or the DMA channel 2)
+	 * to the VRAM and through GPUREAD from it.
+	 *
+	 * GP1 only sets the display registers and reports them in GPUSTAT: the
+	 * image is not shown and the video timing (and the vertical blank) is
+	 * still the fixed NTSC one of the board.
+	 */
+	class gpu : public mmap_device<gpu, 8>, public dma_port {
+	  public:
+		static constexpr char const* device_name = "GPU";
+
+		gpu(gsl::span<uint8_t, size> buffer, vram& video_ram, interrupt_control& icontrol);
+
+		rasterizer& renderer() { return raster; }
+
+	  public:
+		void dma_write(gsl::span<uint8_t const> data) override;
+		void dma_read(gsl::span<uint8_t> data) override;
+
+	  private:
+		// GP0 is written with the commands, read as GPUREAD
+		using gp0 = data_reg<0>;
+		// GP1 is written with the display commands, read as GPUSTAT
+		using gp1 = data_reg<4>;
+
+		using data_ports = std::tuple<gp0, gp1>;
+
+		friend mmap_device;
+
+		void wcb(gp0, uint32_t new_value, uint32_t) { gp0_written(new_value); }
+		void rcb(gp0) { write<gp0>(gpuread()); }
+
+		void wcb(gp1, uint32_t new_value, uint32_t) { gp1_written(new_value); }
+		void rcb(gp1) { write<gp1>(status()); }
+
+	  private:
+		void gp0_written(uint32_t word);
+		void gp1_written(uint32_t word);
+
+		uint32_t gpuread();
+		uint32_t status() const;
+
+		void reset();
+
+		/**
+		 * \brief executes the command in `fifo`
+		 */
+		void execute();
+
+		void polygon();
+		void line();
+		void rectangle();
+		void fill();
+		void copy();
+		void environment(uint32_t word);
+
+		/**
+		 * \brief sets the texture page of the next primitives, the bits 0-8
+		 * and 11 of GP0(E1h)
+		 */
+		void texture_page(uint32_t bits);
+
+		// a vertex word, with the drawing offset added
+		rasterizer::vertex vertex(uint32_t word) const;
+		rasterizer::primitive primitive(uint32_t command) const;
+
+		// a pixel moved by an image transfer or a copy, honoring the mask bits
+		void store(int32_t x, int32_t y, uint16_t pixel);
+
+	  private:
+		// an image transfer between the cpu and a rectangle of the VRAM
+		struct transfer {
+			int32_t x, y;
+			int32_t w, h;
+			// the next pixel
+			int32_t col, row;
+			// the pixels left
+			uint32_t left;
+		};
+
+		static transfer transfer_of(uint32_t position, uint32_t size);
+
+		/**
+		 * \brief calls `f` with every member of the state of `self` that is
+		 * not in the device memory, see `dump_gpu`
+		 */
+		template <typename Self, typename F>
+		static void state_fields(Self& self, F&& f);
+
+	  private:
+		interrupt_control* ic;
+
+		rasterizer raster;
+
+		// the words of the command being collected, the longest command is
+		// the gouraud shaded textured quad
+		std::array<uint32_t, 12> fifo;
+		uint8_t fifo_size;
+		uint8_t expected;
+		// a polyline is drawn one segment at a time, until the terminator
+		bool polyline;
+
+		transfer to_vram;
+		transfer from_vram;
+
+		// GPUSTAT, without the bits computed on read
+		uint32_t stat;
+		// the last value read through GPUREAD, or set by GP1(10h)
+		uint32_t latch;
+
+		// the environment as written, reported by GP1(10h)
+		uint32_t texture_window;
+		uint32_t area_top_left;
+		uint32_t area_bottom_right;
+		uint32_t draw_offset;
+		int32_t offset_x;
+		int32_t offset_y;
+
+		// the texture page of the rectangles, and the flip bits of GP0(E1h)
+		rasterizer::primitive page;
+		bool flip_x;
+		bool flip_y;
+
+		// the display registers of GP1(05h-07h)
+		uint32_t display_start;
+		uint32_t display_h_range;
+		uint32_t display_v_range;
+
+		friend void dump_gpu(std::ostream&, gpu const&);
+		friend void restore_gpu(std::istream&, gpu&);
+	};
+
+	/**
+	 * \brief Writes the state of the gpu kept outside the device memory
+	 *
+	 * The command being collected, the two image transfers, GPUSTAT and the
+	 * GPUREAD latch, the environment as written and as used by the
+	 * rasterizer, the texture page and the display registers; every field
+	 * is written on its own, in the order of the members.
+	 */
+	void dump_gpu(std::ostream&, gpu const&);
+
+	/**
+	 * \brief Restores the state saved by `dump_gpu`
+	 */
+	void restore_gpu(std::istream&, gpu&);
+}
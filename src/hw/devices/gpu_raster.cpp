@@ -0,0 +1,405 @@
+#include "gpu_raster.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace {
+	using psycris::hw::rasterizer;
+
+	// the offsets added to the 8 bit colors before they are truncated to 5
+	// bits, indexed by y & 3 and x & 3
+	constexpr int8_t dither_matrix[4][4] = {
+	    {-4, +0, -3, +1},
+	    {+2, -2, +3, -1},
+	    {-3, +1, -4, +0},
+	    {+3, -1, +2, -2},
+	};
+
+	constexpr int8_t no_dither[4] = {0, 0, 0, 0};
+
+	// the interpolated attributes are kept in these ranges, so that a span of
+	// the whole VRAM width never overflows 32 bits
+	constexpr int64_t max_attr = int64_t(1) << 28;
+	constexpr int64_t max_step = int64_t(1) << 20;
+
+	int32_t clamp_attr(int64_t v, int64_t limit) { return static_cast<int32_t>(std::clamp(v, -limit, limit)); }
+
+	uint16_t rgb15(int r, int g, int b) { return static_cast<uint16_t>(r >> 3 | (g >> 3) << 5 | (b >> 3) << 10); }
+
+	// an 8 bit color channel after the dithering, truncated to 5 bits
+	int channel5(int c, int dither) { return std::clamp(c + dither, 0, 255) >> 3; }
+
+	int32_t floor_div(int32_t a, int32_t b) {
+		int32_t q = a / b;
+		return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+	}
+
+	int32_t ceil_div(int32_t a, int32_t b) { return -floor_div(-a, b); }
+
+	// the five interpolated attributes of a vertex, in fixed point
+	std::array<int64_t, 5> attributes(rasterizer::vertex const& v) {
+		return {v.r << 12, v.g << 12, v.b << 12, v.u << 12, v.v << 12};
+	}
+}
+
+namespace psycris::hw {
+	rasterizer::isa rasterizer::best_isa() {
+		if (supported(isa::avx2)) {
+			return isa::avx2;
+		}
+		if (supported(isa::sse2)) {
+			return isa::sse2;
+		}
+		return isa::scalar;
+	}
+
+	bool rasterizer::supported(isa i) {
+#if defined(__x86_64__)
+		__builtin_cpu_init();
+#endif
+		switch (i) {
+#if defined(__x86_64__)
+		case isa::avx2:
+			return __builtin_cpu_supports("avx2");
+		case isa::sse2:
+			return true;
+#endif
+		case isa::scalar:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	rasterizer::rasterizer(uint16_t* vram) : vram{vram} { use(best_isa()); }
+
+	void rasterizer::use(isa i) {
+		kernel_isa = i;
+		switch (i) {
+		case isa::avx2:
+			fill_kernel = gpu_kernels::fill_avx2;
+			gouraud_kernel = gpu_kernels::gouraud_avx2;
+			write_kernel = gpu_kernels::write_avx2;
+			break;
+		case isa::sse2:
+			fill_kernel = gpu_kernels::fill_sse2;
+			gouraud_kernel = gpu_kernels::gouraud_sse2;
+			write_kernel = gpu_kernels::write_sse2;
+			break;
+		default:
+			fill_kernel = gpu_kernels::fill_scalar;
+			gouraud_kernel = gpu_kernels::gouraud_scalar;
+			write_kernel = gpu_kernels::write_scalar;
+			break;
+		}
+	}
+
+	rasterizer::write_mode rasterizer::mode_of(primitive const& p) const {
+		return {static_cast<int8_t>(p.semi_transparent ? p.semi_mode : -1),
+		        p.textured,
+		        env.check_mask,
+		        static_cast<uint16_t>(env.set_mask ? 0x8000 : 0)};
+	}
+
+	uint16_t rasterizer::texel(primitive const& p, uint32_t u, uint32_t v) {
+		u = (u & ~(env.window_mask_x * 8u)) | ((env.window_offset_x & env.window_mask_x) * 8u);
+		v = (v & ~(env.window_mask_y * 8u)) | ((env.window_offset_y & env.window_mask_y) * 8u);
+
+		int32_t y = p.page_y + v;
+		switch (p.depth) {
+		case 0: {
+			uint16_t ix = (pixel(p.page_x + u / 4, y) >> (u % 4 * 4)) & 0xf;
+			return pixel(p.clut_x + ix, p.clut_y);
+		}
+		case 1: {
+			uint16_t ix = (pixel(p.page_x + u / 2, y) >> (u % 2 * 8)) & 0xff;
+			return pixel(p.clut_x + ix, p.clut_y);
+		}
+		default:
+			return pixel(p.page_x + u, y);
+		}
+	}
+
+	void rasterizer::texture_span(primitive const& p,
+	                              int n,
+	                              int32_t x,
+	                              int32_t y,
+	                              std::array<int32_t, 5> attr,
+	                              std::array<int32_t, 5> const& step,
+	                              bool dither) {
+		int8_t const* offsets = dither ? dither_matrix[y & 3] : no_dither;
+		for (int i = 0; i < n; i++) {
+			uint16_t t = texel(p, (attr[3] >> 12) & 0xff, (attr[4] >> 12) & 0xff);
+			// a texel 0000h is transparent
+			keep_buffer[i] = t == 0 ? 0 : 0xffff;
+			if (p.raw || t == 0) {
+				line_buffer[i] = t;
+			} else {
+				// the texel is modulated by the color, 80h is the texel as is
+				int d = offsets[(x + i) & 3];
+				int r = channel5(((t & 0x1f) * (attr[0] >> 12)) >> 4, d);
+				int g = channel5((((t >> 5) & 0x1f) * (attr[1] >> 12)) >> 4, d);
+				int b = channel5((((t >> 10) & 0x1f) * (attr[2] >> 12)) >> 4, d);
+				line_buffer[i] = static_cast<uint16_t>(r | g << 5 | b << 10 | (t & 0x8000));
+			}
+			for (size_t a = 0; a < attr.size(); a++) {
+				attr[a] += step[a];
+			}
+		}
+	}
+
+	void rasterizer::span(primitive const& p,
+	                      int n,
+	                      int32_t x,
+	                      int32_t y,
+	                      std::array<int32_t, 5> const& attr,
+	                      std::array<int32_t, 5> const& step,
+	                      uint16_t flat,
+	                      bool dither) {
+		uint16_t* dst = &pixel(x, y);
+		write_mode m = mode_of(p);
+		if (p.textured) {
+			texture_span(p, n, x, y, attr, step, dither && !p.raw);
+			write_kernel(dst, line_buffer.data(), keep_buffer.data(), n, m);
+			return;
+		}
+
+		if (!p.gouraud) {
+			if (m.semi < 0 && !m.check_mask) {
+				// the common case, straight into the VRAM
+				fill_kernel(dst, n, flat | m.set_mask);
+				return;
+			}
+			fill_kernel(line_buffer.data(), n, flat);
+		} else {
+			gouraud_kernel(line_buffer.data(),
+			               n,
+			               {attr[0], attr[1], attr[2]},
+			               {step[0], step[1], step[2]},
+			               dither ? dither_matrix[y & 3] : no_dither,
+			               x);
+		}
+		write_kernel(dst, line_buffer.data(), nullptr, n, m);
+	}
+
+	void rasterizer::triangle(std::array<vertex, 3> v, primitive const& p) {
+		// the hardware skips the polygons too large
+		for (int i = 0; i < 3; i++) {
+			auto const& a = v[i];
+			auto const& b = v[(i + 1) % 3];
+			if (std::abs(a.x - b.x) > 1023 || std::abs(a.y - b.y) > 511) {
+				return;
+			}
+		}
+
+		int64_t dx1 = v[1].x - v[0].x, dy1 = v[1].y - v[0].y;
+		int64_t dx2 = v[2].x - v[0].x, dy2 = v[2].y - v[0].y;
+		int64_t area = dx1 * dy2 - dy1 * dx2;
+		if (area == 0) {
+			return;
+		}
+		if (area < 0) {
+			std::swap(v[1], v[2]);
+			std::swap(dx1, dx2);
+			std::swap(dy1, dy2);
+			area = -area;
+		}
+
+		int32_t min_y = std::max(std::min({v[0].y, v[1].y, v[2].y}), env.top);
+		int32_t max_y = std::min(std::max({v[0].y, v[1].y, v[2].y}), env.bottom);
+		int32_t min_x = std::max(std::min({v[0].x, v[1].x, v[2].x}), env.left);
+		int32_t max_x = std::min(std::max({v[0].x, v[1].x, v[2].x}), env.right);
+
+		// the edge functions A * x + B * y + C, positive inside; a pixel on
+		// an edge is drawn only if the edge is a top or a left one. The size
+		// limits keep them in 32 bits, whose divisions are cheaper
+		struct edge {
+			int32_t a, b, c;
+		};
+		std::array<edge, 3> edges;
+		for (int i = 0; i < 3; i++) {
+			auto const& s = v[i];
+			auto const& e = v[(i + 1) % 3];
+			int32_t a = s.y - e.y;
+			int32_t b = e.x - s.x;
+			bool top_left = a > 0 || (a == 0 && b > 0);
+			edges[i] = {a, b, -a * s.x - b * s.y + (top_left ? 0 : -1)};
+		}
+
+		// the attribute planes
+		auto a0 = attributes(v[0]);
+		auto a1 = attributes(v[1]);
+		auto a2 = attributes(v[2]);
+		std::array<int32_t, 5> step_x, step_y;
+		for (size_t i = 0; i < 5; i++) {
+			int64_t d1 = a1[i] - a0[i];
+			int64_t d2 = a2[i] - a0[i];
+			step_x[i] = clamp_attr((d1 * dy2 - d2 * dy1) / area, max_step);
+			step_y[i] = clamp_attr((d2 * dx1 - d1 * dx2) / area, max_step);
+		}
+
+		uint16_t flat = rgb15(v[0].r, v[0].g, v[0].b);
+		bool dither = env.dither && (p.gouraud || (p.textured && !p.raw));
+		for (int32_t y = min_y; y <= max_y; y++) {
+			int32_t left = min_x, right = max_x;
+			for (auto const& e : edges) {
+				int32_t k = e.b * y + e.c;
+				if (e.a > 0) {
+					left = std::max(left, ceil_div(-k, e.a));
+				} else if (e.a < 0) {
+					right = std::min(right, floor_div(k, -e.a));
+				} else if (k < 0) {
+					right = left - 1;
+				}
+			}
+			if (left > right) {
+				continue;
+			}
+
+			std::array<int32_t, 5> attr;
+			for (size_t i = 0; i < 5; i++) {
+				int64_t value =
+				    a0[i] + 0x800 + int64_t(step_x[i]) * (left - v[0].x) + int64_t(step_y[i]) * (y - v[0].y);
+				attr[i] = clamp_attr(value, max_attr);
+			}
+			span(p, right - left + 1, left, y, attr, step_x, flat, dither);
+		}
+	}
+
+	void rasterizer::rectangle(vertex const& v, int32_t w, int32_t h, primitive const& p, bool flip_x, bool flip_y) {
+		int32_t x0 = std::max(v.x, env.left);
+		int32_t x1 = std::min(v.x + w - 1, env.right);
+		int32_t y0 = std::max(v.y, env.top);
+		int32_t y1 = std::min(v.y + h - 1, env.bottom);
+		if (x0 > x1 || y0 > y1) {
+			return;
+		}
+
+		uint16_t flat = rgb15(v.r, v.g, v.b);
+		int32_t du = flip_x ? -1 : 1;
+		int32_t dv = flip_y ? -1 : 1;
+		std::array<int32_t, 5> step = {0, 0, 0, du * 4096, 0};
+		for (int32_t y = y0; y <= y1; y++) {
+			std::array<int32_t, 5> attr = {
+			    v.r << 12, v.g << 12, v.b << 12, (v.u + du * (x0 - v.x)) * 4096, (v.v + dv * (y - v.y)) * 4096};
+			span(p, x1 - x0 + 1, x0, y, attr, step, flat, false);
+		}
+	}
+
+	void rasterizer::line(vertex const& a, vertex const& b, primitive const& p) {
+		int32_t dx = b.x - a.x;
+		int32_t dy = b.y - a.y;
+		if (std::abs(dx) > 1023 || std::abs(dy) > 511) {
+			return;
+		}
+
+		int32_t steps = std::max(std::abs(dx), std::abs(dy));
+		auto per_step = [&](int32_t d, int bits) { return steps == 0 ? 0 : d * (int64_t(1) << bits) / steps; };
+
+		// the coordinates in 16.16 fixed point, from the center of the pixel
+		int64_t x = a.x * int64_t(0x10000) + 0x8000, sx = per_step(dx, 16);
+		int64_t y = a.y * int64_t(0x10000) + 0x8000, sy = per_step(dy, 16);
+
+		std::array<int32_t, 3> color = {(a.r << 12) + 0x800, (a.g << 12) + 0x800, (a.b << 12) + 0x800};
+		std::array<int32_t, 3> step = {0, 0, 0};
+		if (p.gouraud) {
+			step = {static_cast<int32_t>(per_step(b.r - a.r, 12)),
+			        static_cast<int32_t>(per_step(b.g - a.g, 12)),
+			        static_cast<int32_t>(per_step(b.b - a.b, 12))};
+		}
+
+		uint16_t const flat = rgb15(a.r, a.g, a.b);
+		bool const dither = env.dither && p.gouraud;
+		write_mode const m = mode_of(p);
+		for (int32_t i = 0; i <= steps; i++) {
+			auto px = static_cast<int32_t>(x >> 16);
+			auto py = static_cast<int32_t>(y >> 16);
+			if (px >= env.left && px <= env.right && py >= env.top && py <= env.bottom) {
+				uint16_t c = flat;
+				if (p.gouraud) {
+					int d = dither ? dither_matrix[py & 3][px & 3] : 0;
+					c = static_cast<uint16_t>(channel5(color[0] >> 12, d) | channel5(color[1] >> 12, d) << 5
+					                          | channel5(color[2] >> 12, d) << 10);
+				}
+				gpu_kernels::write_scalar(&pixel(px, py), &c, nullptr, 1, m);
+			}
+			x += sx;
+			y += sy;
+			for (int ch = 0; ch < 3; ch++) {
+				color[ch] += step[ch];
+			}
+		}
+	}
+
+	void rasterizer::fill(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) {
+		x &= vram_width - 1;
+		for (int32_t row = 0; row < h; row++) {
+			// the part past the right edge wraps to the left one
+			int32_t first = std::min(w, vram_width - x);
+			fill_kernel(&pixel(x, y + row), first, color);
+			if (w > first) {
+				fill_kernel(&pixel(0, y + row), w - first, color);
+			}
+		}
+	}
+}
+
+namespace psycris::hw::gpu_kernels {
+	uint16_t blend(uint16_t back, uint16_t front, int mode) {
+		uint16_t out = 0;
+		for (int shift : {0, 5, 10}) {
+			int b = (back >> shift) & 0x1f;
+			int f = (front >> shift) & 0x1f;
+			int c;
+			switch (mode) {
+			case 0:
+				c = (b + f) >> 1;
+				break;
+			case 1:
+				c = std::min(b + f, 0x1f);
+				break;
+			case 2:
+				c = std::max(b - f, 0);
+				break;
+			default:
+				c = std::min(b + f / 4, 0x1f);
+				break;
+			}
+			out |= static_cast<uint16_t>(c << shift);
+		}
+		return out;
+	}
+
+	void fill_scalar(uint16_t* dst, int n, uint16_t color) { std::fill_n(dst, n, color); }
+
+	void gouraud_scalar(uint16_t* out,
+	                    int n,
+	                    std::array<int32_t, 3> const& start,
+	                    std::array<int32_t, 3> const& step,
+	                    int8_t const* dither,
+	                    int x) {
+		for (int i = 0; i < n; i++) {
+			int d = dither[(x + i) & 3];
+			int r = channel5((start[0] + i * step[0]) >> 12, d);
+			int g = channel5((start[1] + i * step[1]) >> 12, d);
+			int b = channel5((start[2] + i * step[2]) >> 12, d);
+			out[i] = static_cast<uint16_t>(r | g << 5 | b << 10);
+		}
+	}
+
+	void write_scalar(uint16_t* dst, uint16_t const* src, uint16_t const* keep, int n, rasterizer::write_mode m) {
+		for (int i = 0; i < n; i++) {
+			uint16_t d = dst[i];
+			if ((keep != nullptr && keep[i] == 0) || (m.check_mask && (d & 0x8000) != 0)) {
+				continue;
+			}
+			uint16_t s = src[i];
+			uint16_t c = s & 0x7fff;
+			if (m.semi >= 0 && (!m.textured || (s & 0x8000) != 0)) {
+				c = blend(d, c, m.semi);
+			}
+			dst[i] = c | (s & 0x8000) | m.set_mask;
+		}
+	}
+}
@@ -0,0 +1,265 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+namespace psycris::hw {
+	/**
+	 * \brief The drawing engine of the GPU, working on the 1024x512 16 bit
+	 * pixels of the VRAM
+	 *
+	 * https://problemkaputt.de/psx-spx.htm#gpurenderingattributes
+	 *
+	 * A primitive is split in horizontal spans; a span is shaded in a line
+	 * buffer, then merged into the VRAM applying the semi-transparency and
+	 * the mask bits. The shading of the untextured spans and the merge are
+	 * kernels chosen at runtime among the instruction sets supported by the
+	 * host; all of them give exactly the same pixels as the scalar one. The
+	 * texels are fetched one by one.
+	 *
+	 * The coordinates are VRAM coordinates: the drawing offset has already
+	 * been added by the gpu. The colors are interpolated (and the texture
+	 * coordinates stepped) in fixed point, with 12 fractional bits.
+	 */
+	class rasterizer {
+	  public:
+		static constexpr int vram_width = 1024;
+		static constexpr int vram_height = 512;
+
+		enum class isa : uint8_t {
+			scalar,
+			sse2,
+			avx2,
+		};
+
+		/**
+		 * \brief the fastest instruction set supported by the host
+		 */
+		static isa best_isa();
+
+		/**
+		 * \brief checks if the host supports the given instruction set
+		 */
+		static bool supported(isa);
+
+		struct vertex {
+			int32_t x, y;
+			uint8_t r, g, b;
+			uint8_t u, v;
+		};
+
+		/**
+		 * \brief how a primitive is drawn, besides the drawing environment
+		 */
+		struct primitive {
+			// the colors are interpolated between the vertices
+			bool gouraud = false;
+			bool textured = false;
+			// the texels are not modulated by the color
+			bool raw = false;
+			bool semi_transparent = false;
+			// 0: B/2 + F/2, 1: B + F, 2: B - F, 3: B + F/4
+			uint8_t semi_mode = 0;
+
+			// the texture page, its depth (0: 4 bit, 1: 8 bit, 2: 15 bit) and
+			// the color lookup table of the 4 and 8 bit textures
+			uint16_t page_x = 0;
+			uint16_t page_y = 0;
+			uint8_t depth = 0;
+			uint16_t clut_x = 0;
+			uint16_t clut_y = 0;
+		};
+
+		/**
+		 * \brief the state set by the GP0 environment commands (E1h-E6h)
+		 */
+		struct environment {
+			// the drawing area, inclusive
+			int32_t left = 0;
+			int32_t top = 0;
+			int32_t right = 0;
+			int32_t bottom = 0;
+
+			bool dither = false;
+			// the pixels are drawn with the mask bit set
+			bool set_mask = false;
+			// the pixels with the mask bit set are not drawn over
+			bool check_mask = false;
+
+			// the texture window, in 8 pixels steps
+			uint8_t window_mask_x = 0;
+			uint8_t window_mask_y = 0;
+			uint8_t window_offset_x = 0;
+			uint8_t window_offset_y = 0;
+		};
+
+		/**
+		 * \brief how a span is merged into the VRAM
+		 */
+		struct write_mode {
+			// -1 if the span is opaque, otherwise the `primitive::semi_mode`
+			int8_t semi;
+			// a textured span is semi-transparent only where the texels have
+			// the bit 15 set, that is also kept in the VRAM
+			bool textured;
+			bool check_mask;
+			uint16_t set_mask;
+		};
+
+		/**
+		 * \brief fills `n` pixels with `color`
+		 */
+		using fill_fn = void (*)(uint16_t* dst, int n, uint16_t color);
+
+		/**
+		 * \brief shades `n` pixels interpolating the colors
+		 *
+		 * `start` and `step` are the red, green and blue of the first pixel
+		 * and their increment per pixel; the colors are dithered with the
+		 * offsets in `dither`, indexed by the VRAM x & 3 (the first pixel is
+		 * at `x`).
+		 */
+		using gouraud_fn = void (*)(uint16_t* out,
+		                            int n,
+		                            std::array<int32_t, 3> const& start,
+		                            std::array<int32_t, 3> const& step,
+		                            int8_t const* dither,
+		                            int x);
+
+		/**
+		 * \brief merges the span `src` into `dst`
+		 *
+		 * A pixel is skipped if `keep` is not nullptr and its entry is 0.
+		 */
+		using write_fn = void (*)(uint16_t* dst, uint16_t const* src, uint16_t const* keep, int n, write_mode m);
+
+	  public:
+		/**
+		 * \brief a rasterizer drawing in `vram`, that must be
+		 * `vram_width * vram_height` pixels
+		 */
+		explicit rasterizer(uint16_t* vram);
+
+		/**
+		 * \brief uses the kernels for the given instruction set
+		 *
+		 * The instruction set must be `supported`.
+		 */
+		void use(isa);
+
+		isa kernels() const { return kernel_isa; }
+
+	  public:
+		void triangle(std::array<vertex, 3> v, primitive const& p);
+
+		/**
+		 * \brief a rectangle with the top-left corner at `v`
+		 *
+		 * The rectangles are never dithered; a texture is stepped left to
+		 * right (right to left if `flip_x`) and top to bottom (bottom to top
+		 * if `flip_y`).
+		 */
+		void rectangle(vertex const& v, int32_t w, int32_t h, primitive const& p, bool flip_x, bool flip_y);
+
+		/**
+		 * \brief a line, both the ends included
+		 */
+		void line(vertex const& a, vertex const& b, primitive const& p);
+
+		/**
+		 * \brief fills a rectangle, ignoring the drawing area and the mask
+		 *
+		 * The rectangle wraps at the VRAM edges.
+		 */
+		void fill(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color);
+
+		/**
+		 * \brief the pixel at (`x`, `y`), the coordinates wrap at the VRAM
+		 * edges
+		 */
+		uint16_t& pixel(int32_t x, int32_t y) {
+			return vram[(y & (vram_height - 1)) * vram_width + (x & (vram_width - 1))];
+		}
+
+		environment env;
+
+	  private:
+		write_mode mode_of(primitive const& p) const;
+
+		uint16_t texel(primitive const& p, uint32_t u, uint32_t v);
+
+		/**
+		 * \brief shades `n` textured pixels in `line`, marking the
+		 * transparent ones in `keep`
+		 *
+		 * `attr` are the red, green, blue, u and v of the first pixel,
+		 * `step` their increment per pixel.
+		 */
+		void texture_span(primitive const& p,
+		                  int n,
+		                  int32_t x,
+		                  int32_t y,
+		                  std::array<int32_t, 5> attr,
+		                  std::array<int32_t, 5> const& step,
+		                  bool dither);
+
+		/**
+		 * \brief shades the span [x, x + n) of the row `y` and merges it
+		 *
+		 * `flat` is the color of an untextured span that is not gouraud
+		 * shaded.
+		 */
+		void span(primitive const& p,
+		          int n,
+		          int32_t x,
+		          int32_t y,
+		          std::array<int32_t, 5> const& attr,
+		          std::array<int32_t, 5> const& step,
+		          uint16_t flat,
+		          bool dither);
+
+	  private:
+		uint16_t* vram;
+
+		isa kernel_isa;
+		fill_fn fill_kernel;
+		gouraud_fn gouraud_kernel;
+		write_fn write_kernel;
+
+		std::array<uint16_t, vram_width> line_buffer;
+		std::array<uint16_t, vram_width> keep_buffer;
+	};
+
+	namespace gpu_kernels {
+		void fill_scalar(uint16_t*, int, uint16_t);
+		void fill_sse2(uint16_t*, int, uint16_t);
+		void fill_avx2(uint16_t*, int, uint16_t);
+
+		void gouraud_scalar(uint16_t*,
+		                    int,
+		                    std::array<int32_t, 3> const&,
+		                    std::array<int32_t, 3> const&,
+		                    int8_t const*,
+		                    int);
+		void gouraud_sse2(uint16_t*,
+		                  int,
+		                  std::array<int32_t, 3> const&,
+		                  std::array<int32_t, 3> const&,
+		                  int8_t const*,
+		                  int);
+		void gouraud_avx2(uint16_t*,
+		                  int,
+		                  std::array<int32_t, 3> const&,
+		                  std::array<int32_t, 3> const&,
+		                  int8_t const*,
+		                  int);
+
+		void write_scalar(uint16_t*, uint16_t const*, uint16_t const*, int, rasterizer::write_mode);
+		void write_sse2(uint16_t*, uint16_t const*, uint16_t const*, int, rasterizer::write_mode);
+		void write_avx2(uint16_t*, uint16_t const*, uint16_t const*, int, rasterizer::write_mode);
+
+		/**
+		 * \brief blends two 15 bit colors, see `rasterizer::primitive::semi_mode`
+		 */
+		uint16_t blend(uint16_t back, uint16_t front, int mode);
+	}
+}
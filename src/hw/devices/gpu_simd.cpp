@@ -0,0 +1,286 @@
+#include "gpu_raster.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// The SIMD span kernels of the rasterizer. Each one is compiled for its own
+// instruction set with a target attribute, `rasterizer::use` never selects a
+// kernel that the host does not support.
+//
+// A pixel is a 16 bit lane; the color channels are split in their own lanes
+// to be shaded or blended, and the pixels not written are merged back with a
+// mask. The tail of a span shorter than a register goes to the kernel of the
+// narrower instruction set, down to the scalar one.
+
+namespace psycris::hw::gpu_kernels {
+#if defined(__x86_64__)
+	namespace {
+		__attribute__((target("sse2"))) __m128i blend_sse2(__m128i back, __m128i front, int mode) {
+			__m128i const five = _mm_set1_epi16(0x1f);
+			__m128i out = _mm_setzero_si128();
+			for (int shift : {0, 5, 10}) {
+				__m128i b = _mm_and_si128(_mm_srli_epi16(back, shift), five);
+				__m128i f = _mm_and_si128(_mm_srli_epi16(front, shift), five);
+				__m128i c;
+				switch (mode) {
+				case 0:
+					c = _mm_srli_epi16(_mm_add_epi16(b, f), 1);
+					break;
+				case 1:
+					c = _mm_min_epi16(_mm_add_epi16(b, f), five);
+					break;
+				case 2:
+					c = _mm_subs_epu16(b, f);
+					break;
+				default:
+					c = _mm_min_epi16(_mm_add_epi16(b, _mm_srli_epi16(f, 2)), five);
+					break;
+				}
+				out = _mm_or_si128(out, _mm_slli_epi16(c, shift));
+			}
+			return out;
+		}
+
+		__attribute__((target("avx2"))) __m256i blend_avx2(__m256i back, __m256i front, int mode) {
+			__m256i const five = _mm256_set1_epi16(0x1f);
+			__m256i out = _mm256_setzero_si256();
+			for (int shift : {0, 5, 10}) {
+				__m256i b = _mm256_and_si256(_mm256_srli_epi16(back, shift), five);
+				__m256i f = _mm256_and_si256(_mm256_srli_epi16(front, shift), five);
+				__m256i c;
+				switch (mode) {
+				case 0:
+					c = _mm256_srli_epi16(_mm256_add_epi16(b, f), 1);
+					break;
+				case 1:
+					c = _mm256_min_epi16(_mm256_add_epi16(b, f), five);
+					break;
+				case 2:
+					c = _mm256_subs_epu16(b, f);
+					break;
+				default:
+					c = _mm256_min_epi16(_mm256_add_epi16(b, _mm256_srli_epi16(f, 2)), five);
+					break;
+				}
+				out = _mm256_or_si256(out, _mm256_slli_epi16(c, shift));
+			}
+			return out;
+		}
+	}
+
+	__attribute__((target("sse2"))) void fill_sse2(uint16_t* dst, int n, uint16_t color) {
+		__m128i const c = _mm_set1_epi16(static_cast<int16_t>(color));
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), c);
+		}
+		fill_scalar(dst + i, n - i, color);
+	}
+
+	__attribute__((target("avx2"))) void fill_avx2(uint16_t* dst, int n, uint16_t color) {
+		__m256i const c = _mm256_set1_epi16(static_cast<int16_t>(color));
+		int i = 0;
+		for (; i + 16 <= n; i += 16) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), c);
+		}
+		fill_sse2(dst + i, n - i, color);
+	}
+
+	__attribute__((target("sse2"))) void gouraud_sse2(uint16_t* out,
+	                                                  int n,
+	                                                  std::array<int32_t, 3> const& start,
+	                                                  std::array<int32_t, 3> const& step,
+	                                                  int8_t const* dither,
+	                                                  int x) {
+		// the dithering offsets repeat every 4 pixels, the same for every
+		// block of 8
+		__m128i const offsets = _mm_set_epi16(dither[(x + 7) & 3],
+		                                      dither[(x + 6) & 3],
+		                                      dither[(x + 5) & 3],
+		                                      dither[(x + 4) & 3],
+		                                      dither[(x + 3) & 3],
+		                                      dither[(x + 2) & 3],
+		                                      dither[(x + 1) & 3],
+		                                      dither[x & 3]);
+		__m128i const max = _mm_set1_epi16(0xff);
+		__m128i const zero = _mm_setzero_si128();
+
+		// the values of the first 4 pixels and the increment per 4 pixels;
+		// sse2 has no 32 bit multiply, they are built by additions
+		__m128i lo[3], step4[3];
+		for (int ch = 0; ch < 3; ch++) {
+			__m128i s = _mm_set1_epi32(step[ch]);
+			__m128i s2 = _mm_add_epi32(s, s);
+			__m128i ramp =
+			    _mm_unpacklo_epi64(_mm_unpacklo_epi32(zero, s), _mm_unpacklo_epi32(s2, _mm_add_epi32(s2, s)));
+			lo[ch] = _mm_add_epi32(_mm_set1_epi32(start[ch]), ramp);
+			step4[ch] = _mm_add_epi32(s2, s2);
+		}
+
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m128i pixel = zero;
+			for (int ch = 0; ch < 3; ch++) {
+				__m128i hi = _mm_add_epi32(lo[ch], step4[ch]);
+				__m128i c = _mm_packs_epi32(_mm_srai_epi32(lo[ch], 12), _mm_srai_epi32(hi, 12));
+				c = _mm_min_epi16(_mm_max_epi16(_mm_adds_epi16(c, offsets), zero), max);
+				pixel = _mm_or_si128(pixel, _mm_slli_epi16(_mm_srli_epi16(c, 3), 5 * ch));
+				lo[ch] = _mm_add_epi32(hi, step4[ch]);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), pixel);
+		}
+		std::array<int32_t, 3> rest = {start[0] + i * step[0], start[1] + i * step[1], start[2] + i * step[2]};
+		gouraud_scalar(out + i, n - i, rest, step, dither, x + i);
+	}
+
+	__attribute__((target("avx2"))) void gouraud_avx2(uint16_t* out,
+	                                                  int n,
+	                                                  std::array<int32_t, 3> const& start,
+	                                                  std::array<int32_t, 3> const& step,
+	                                                  int8_t const* dither,
+	                                                  int x) {
+		int16_t d[4];
+		for (int k = 0; k < 4; k++) {
+			d[k] = dither[(x + k) & 3];
+		}
+		__m256i const offsets = _mm256_set_epi16(d[3], d[2], d[1], d[0], d[3], d[2], d[1], d[0],
+		                                         d[3], d[2], d[1], d[0], d[3], d[2], d[1], d[0]);
+		__m256i const max = _mm256_set1_epi16(0xff);
+		__m256i const zero = _mm256_setzero_si256();
+
+		// the values of the first 8 pixels and the increment per 8 pixels
+		__m256i lo[3], step8[3];
+		for (int ch = 0; ch < 3; ch++) {
+			int32_t s = step[ch];
+			lo[ch] = _mm256_add_epi32(_mm256_set1_epi32(start[ch]),
+			                          _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s));
+			step8[ch] = _mm256_set1_epi32(8 * s);
+		}
+
+		int i = 0;
+		for (; i + 16 <= n; i += 16) {
+			__m256i pixel = zero;
+			for (int ch = 0; ch < 3; ch++) {
+				__m256i hi = _mm256_add_epi32(lo[ch], step8[ch]);
+				// the pack works within the 128 bit lanes, the permutation
+				// puts the pixels back in order
+				__m256i c = _mm256_packs_epi32(_mm256_srai_epi32(lo[ch], 12), _mm256_srai_epi32(hi, 12));
+				c = _mm256_permute4x64_epi64(c, 0xd8);
+				c = _mm256_min_epi16(_mm256_max_epi16(_mm256_adds_epi16(c, offsets), zero), max);
+				pixel = _mm256_or_si256(pixel, _mm256_slli_epi16(_mm256_srli_epi16(c, 3), 5 * ch));
+				lo[ch] = _mm256_add_epi32(hi, step8[ch]);
+			}
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), pixel);
+		}
+		std::array<int32_t, 3> rest = {start[0] + i * step[0], start[1] + i * step[1], start[2] + i * step[2]};
+		gouraud_sse2(out + i, n - i, rest, step, dither, x + i);
+	}
+
+	__attribute__((target("sse2"))) void write_sse2(uint16_t* dst,
+	                                                uint16_t const* src,
+	                                                uint16_t const* keep,
+	                                                int n,
+	                                                rasterizer::write_mode m) {
+		__m128i const zero = _mm_setzero_si128();
+		__m128i const color = _mm_set1_epi16(0x7fff);
+		__m128i const set_mask = _mm_set1_epi16(static_cast<int16_t>(m.set_mask));
+
+		int i = 0;
+		for (; i + 8 <= n; i += 8) {
+			__m128i d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(dst + i));
+			__m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+
+			// the pixels left as they are
+			__m128i skip = zero;
+			if (keep) {
+				skip = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(keep + i)), zero);
+			}
+			if (m.check_mask) {
+				skip = _mm_or_si128(skip, _mm_srai_epi16(d, 15));
+			}
+
+			__m128i c = _mm_and_si128(s, color);
+			if (m.semi >= 0) {
+				__m128i blended = blend_sse2(d, c, m.semi);
+				if (m.textured) {
+					__m128i semi = _mm_srai_epi16(s, 15);
+					blended = _mm_or_si128(_mm_and_si128(semi, blended), _mm_andnot_si128(semi, c));
+				}
+				c = blended;
+			}
+			c = _mm_or_si128(_mm_or_si128(c, _mm_andnot_si128(color, s)), set_mask);
+			c = _mm_or_si128(_mm_and_si128(skip, d), _mm_andnot_si128(skip, c));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), c);
+		}
+		write_scalar(dst + i, src + i, keep ? keep + i : nullptr, n - i, m);
+	}
+
+	__attribute__((target("avx2"))) void write_avx2(uint16_t* dst,
+	                                                uint16_t const* src,
+	                                                uint16_t const* keep,
+	                                                int n,
+	                                                rasterizer::write_mode m) {
+		__m256i const zero = _mm256_setzero_si256();
+		__m256i const color = _mm256_set1_epi16(0x7fff);
+		__m256i const set_mask = _mm256_set1_epi16(static_cast<int16_t>(m.set_mask));
+
+		int i = 0;
+		for (; i + 16 <= n; i += 16) {
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dst + i));
+			__m256i s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+
+			__m256i skip = zero;
+			if (keep) {
+				skip = _mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(keep + i)), zero);
+			}
+			if (m.check_mask) {
+				skip = _mm256_or_si256(skip, _mm256_srai_epi16(d, 15));
+			}
+
+			__m256i c = _mm256_and_si256(s, color);
+			if (m.semi >= 0) {
+				__m256i blended = blend_avx2(d, c, m.semi);
+				if (m.textured) {
+					blended = _mm256_blendv_epi8(c, blended, _mm256_srai_epi16(s, 15));
+				}
+				c = blended;
+			}
+			c = _mm256_or_si256(_mm256_or_si256(c, _mm256_andnot_si256(color, s)), set_mask);
+			c = _mm256_blendv_epi8(c, d, skip);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), c);
+		}
+		write_sse2(dst + i, src + i, keep ? keep + i : nullptr, n - i, m);
+	}
+#else
+	void fill_sse2(uint16_t* dst, int n, uint16_t color) { fill_scalar(dst, n, color); }
+
+	void fill_avx2(uint16_t* dst, int n, uint16_t color) { fill_scalar(dst, n, color); }
+
+	void gouraud_sse2(uint16_t* out,
+	                  int n,
+	                  std::array<int32_t, 3> const& start,
+	                  std::array<int32_t, 3> const& step,
+	                  int8_t const* dither,
+	                  int x) {
+		gouraud_scalar(out, n, start, step, dither, x);
+	}
+
+	void gouraud_avx2(uint16_t* out,
+	                  int n,
+	                  std::array<int32_t, 3> const& start,
+	                  std::array<int32_t, 3> const& step,
+	                  int8_t const* dither,
+	                  int x) {
+		gouraud_scalar(out, n, start, step, dither, x);
+	}
+
+	void write_sse2(uint16_t* dst, uint16_t const* src, uint16_t const* keep, int n, rasterizer::write_mode m) {
+		write_scalar(dst, src, keep, n, m);
+	}
+
+	void write_avx2(uint16_t* dst, uint16_t const* src, uint16_t const* keep, int n, rasterizer::write_mode m) {
+		write_scalar(dst, src, keep, n, m);
+	}
+#endif
+}
@@ -1,23 +1,26 @@
 #include "interrupt_control.hpp"
-#include "../../cpu/cop0.hpp"
+#include "../../cpu/cpu.hpp"
 
 namespace psycris::hw {
-	interrupt_control::interrupt_control(gsl::span<uint8_t, size> buffer, cpu::cop0& cop)
-	    : mmap_device(buffer, i_stat{}, i_mask{}), cop0(&cop) {}
+	interrupt_control::interrupt_control(gsl::span<uint8_t, size> buffer, cpu::mips& cpu)
+	    : mmap_device(buffer), cpu(&cpu) {}
 
 	void interrupt_control::request(interrupt pin) {
 		uint32_t stat = read<i_stat>();
 		uint32_t changed = stat | (0xffff'ffff & pin);
 		if (stat != changed) {
 			write<i_stat>(changed);
-			wcb(i_stat{}, changed, stat);
+			update_line();
 		}
 	}
 
 	void interrupt_control::wcb(i_stat, uint32_t new_value, uint32_t old_value) {
-		auto int_request = new_value & (old_value ^ new_value) & read<i_mask>();
-		if (int_request) {
-			cop0->interrupt_request();
-		}
+		// a request is acknowledged writing 0, a 1 leaves the bit as it is
+		write<i_stat>(old_value & new_value);
+		update_line();
 	}
-}
\ No newline at end of file
+
+	void interrupt_control::wcb(i_mask, uint32_t, uint32_t) { update_line(); }
+
+	void interrupt_control::update_line() { cpu->interrupt_line((read<i_stat>() & read<i_mask>()) != 0); }
+}
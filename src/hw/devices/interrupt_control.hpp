@@ -2,15 +2,22 @@
 #include "../mmap_device.hpp"
 
 namespace cpu {
-	class cop0;
+	class mips;
 }
 
 namespace psycris::hw {
+	/**
+	 * \brief The interrupt controller
+	 *
+	 * The requests latched in I_STAT and enabled in I_MASK drive the
+	 * hardware interrupt 0 of the cpu; a request is acknowledged writing 0
+	 * to its I_STAT bit.
+	 */
 	class interrupt_control : public mmap_device<interrupt_control, 8> {
 	  public:
 		static constexpr char const* device_name = "Interrupt Control";
 
-		interrupt_control(gsl::span<uint8_t, size> buffer, cpu::cop0& cop);
+		interrupt_control(gsl::span<uint8_t, size> buffer, cpu::mips& cpu);
 
 	  public:
 		enum interrupt {
@@ -33,11 +40,17 @@ namespace psycris::hw {
 		using i_stat = data_reg<0>;
 		using i_mask = data_reg<4>;
 
+		using data_ports = std::tuple<i_stat, i_mask>;
+
 		friend mmap_device;
 
 		void wcb(i_stat, uint32_t, uint32_t);
+		void wcb(i_mask, uint32_t, uint32_t);
+
+	  private:
+		void update_line();
 
 	  private:
-		cpu::cop0* cop0;
+		cpu::mips* cpu;
 	};
 }
\ No newline at end of file
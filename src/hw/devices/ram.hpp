@@ -16,4 +16,18 @@ namespace psycris::hw {
 
 		rom(gsl::span<uint8_t, size> buffer) : mmap_device{buffer} {}
 	};
+
+	/**
+	 * \brief The data cache used as fast RAM
+	 *
+	 * The scratchpad is mapped in KUSEG and KSEG0 only; the cpu serves its
+	 * loads and stores directly (see `mips::map_scratchpad`), the bus mapping
+	 * is used by everyone else.
+	 */
+	class scratchpad : public mmap_device<scratchpad, 1024> {
+	  public:
+		static constexpr char const* device_name = "Scratchpad";
+
+		scratchpad(gsl::span<uint8_t, size> buffer) : mmap_device{buffer} {}
+	};
 }
\ No newline at end of file
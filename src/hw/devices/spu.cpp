@@ -217,7 +217,7 @@ namespace {
 namespace psycris::hw {
 	using psycris::log;
 
-	spu::spu(gsl::span<uint8_t, size> buffer) : mmap_device{buffer, spucnt{}, spustat{}} {}
+	spu::spu(gsl::span<uint8_t, size> buffer) : mmap_device{buffer} {}
 
 	void spu::wcb(spucnt, uint32_t new_value, uint32_t) {
 		using namespace spucnt_bits;
@@ -16,6 +16,8 @@ namespace psycris::hw {
 		using spucnt = data_reg<426, 2>;
 		using spustat = data_reg<430, 2>;
 
+		using data_ports = std::tuple<spucnt, spustat>;
+
 		friend mmap_device;
 
 		void wcb(spucnt, uint32_t, uint32_t);
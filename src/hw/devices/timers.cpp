@@ -0,0 +1,301 @@
+#include "timers.hpp"
+#include "interrupt_control.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <istream>
+#include <ostream>
+
+namespace {
+	constexpr uint32_t max_value = 0xffff;
+
+	// the increments needed by a counter at `value` to reach `x`, when it
+	// wraps to 0 after `limit`; `scheduler::never` if it never does
+	//
+	// A counter above its limit (the target has been lowered) runs up to
+	// 0xffff before wrapping.
+	uint64_t steps_to(uint32_t value, uint32_t x, uint32_t limit) {
+		if (value > limit) {
+			if (x > value) {
+				return x - value;
+			}
+			uint64_t wrap = max_value + 1 - value;
+			return x <= limit ? wrap + x : psycris::scheduler::never;
+		}
+		if (x > limit) {
+			return psycris::scheduler::never;
+		}
+		uint64_t d = (x + limit + 1 - value) % (limit + 1);
+		return d == 0 ? limit + 1 : d;
+	}
+
+	// the counter at `value` after `steps` increments
+	uint32_t advance(uint32_t value, uint64_t steps, uint32_t limit) {
+		if (value > limit) {
+			uint64_t wrap = max_value + 1 - value;
+			if (steps < wrap) {
+				return value + static_cast<uint32_t>(steps);
+			}
+			steps -= wrap;
+			value = 0;
+		}
+		return static_cast<uint32_t>((value + steps) % (limit + 1));
+	}
+}
+
+namespace psycris::hw {
+	uint64_t timers::count(source s, uint64_t t) {
+		switch (s) {
+		case source::system:
+			return t;
+		case source::system_div8:
+			return t / 8;
+		case source::dotclock:
+			// the gpu runs at 11/7 of the cpu clock, a pixel lasts 8 gpu
+			// cycles at 320 pixels per line
+			return t * 11 / 56;
+		case source::hblank:
+			return t * frame_lines / frame_ticks;
+		}
+		return t;
+	}
+
+	uint64_t timers::time_of(source s, uint64_t n) {
+		switch (s) {
+		case source::system:
+			return n;
+		case source::system_div8:
+			return n * 8;
+		case source::dotclock:
+			return (n * 56 + 10) / 11;
+		case source::hblank:
+			return (n * frame_ticks + frame_lines - 1) / frame_lines;
+		}
+		return n;
+	}
+
+	timers::timers(gsl::span<uint8_t, size> buffer, interrupt_control& icontrol, scheduler& events)
+	    : mmap_device{buffer}, ic{&icontrol}, events{&events} {
+		for (uint8_t n = 0; n < counters; n++) {
+			state[n] = counter{0, 0, 0, 0, true, true, timer_mode_bits::irq.mask};
+			interrupts[n] = events.add(fmt::format("TMR{} IRQ", n), [this, n](uint64_t at) { interrupt(n, at); });
+			blanks[n] = events.add(fmt::format("TMR{} BLANK", n), [this, n](uint64_t at) { sync(n, at); });
+		}
+	}
+
+	timers::source timers::clock_of(uint8_t n) const {
+		uint32_t s = timer_mode_bits::clock_source(state[n].mode);
+		switch (n) {
+		case 0:
+			return s & 1 ? source::dotclock : source::system;
+		case 1:
+			return s & 1 ? source::hblank : source::system;
+		default:
+			return s & 2 ? source::system_div8 : source::system;
+		}
+	}
+
+	uint32_t timers::limit(uint8_t n) const {
+		auto const& c = state[n];
+		return timer_mode_bits::reset_at_target(c.mode) ? c.target : max_value;
+	}
+
+	void timers::settle(uint8_t n, uint64_t t) {
+		using namespace timer_mode_bits;
+
+		auto& c = state[n];
+		if (t <= c.since) {
+			return;
+		}
+		if (c.running) {
+			source s = clock_of(n);
+			uint64_t steps = count(s, t) - count(s, c.since);
+			uint32_t lim = limit(n);
+			if (steps_to(c.value, c.target, lim) <= steps) {
+				c.status |= reached_target.mask;
+			}
+			if (steps_to(c.value, max_value, lim) <= steps) {
+				c.status |= reached_max.mask;
+			}
+			c.value = advance(c.value, steps, lim);
+		}
+		c.since = t;
+	}
+
+	uint32_t timers::mode_read(uint8_t n) {
+		using namespace timer_mode_bits;
+
+		settle(n, events->now());
+		auto& c = state[n];
+		uint32_t value = c.mode | c.status;
+		c.status &= ~(reached_target.mask | reached_max.mask);
+		return value;
+	}
+
+	void timers::value_written(uint8_t n, uint32_t value) {
+		settle(n, events->now());
+		state[n].value = value & max_value;
+		schedule_irq(n);
+	}
+
+	void timers::mode_written(uint8_t n, uint32_t mode) {
+		using namespace timer_mode_bits;
+
+		uint64_t now = events->now();
+		auto& c = state[n];
+		// the write resets the counter and rearms the interrupt
+		c.mode = mode & 0x3ff;
+		c.value = 0;
+		c.since = now;
+		c.armed = true;
+		c.status = irq.mask;
+
+		uint32_t sync = sync_mode(c.mode);
+		if (!sync_enable(c.mode)) {
+			c.running = true;
+		} else if (n == 2) {
+			c.running = sync == 1 || sync == 2;
+		} else {
+			c.running = sync == 1 || (sync == 0 && !in_blank(n, now)) || (sync == 2 && in_blank(n, now));
+		}
+
+		schedule_irq(n);
+		schedule_sync(n);
+	}
+
+	void timers::target_written(uint8_t n, uint32_t target) {
+		settle(n, events->now());
+		state[n].target = target & max_value;
+		schedule_irq(n);
+	}
+
+	void timers::schedule_irq(uint8_t n) {
+		using namespace timer_mode_bits;
+
+		events->cancel(interrupts[n]);
+		auto const& c = state[n];
+		if (!c.running || !c.armed) {
+			return;
+		}
+
+		uint64_t steps = scheduler::never;
+		if (irq_at_target(c.mode)) {
+			steps = std::min(steps, steps_to(c.value, c.target, limit(n)));
+		}
+		if (irq_at_max(c.mode)) {
+			steps = std::min(steps, steps_to(c.value, max_value, limit(n)));
+		}
+		if (steps == scheduler::never) {
+			return;
+		}
+		source s = clock_of(n);
+		events->schedule(interrupts[n], time_of(s, count(s, c.since) + steps));
+	}
+
+	void timers::interrupt(uint8_t n, uint64_t at) {
+		using namespace timer_mode_bits;
+
+		settle(n, at);
+		auto& c = state[n];
+		bool raise = true;
+		if (irq_toggle(c.mode)) {
+			c.status ^= irq.mask;
+			raise = (c.status & irq.mask) == 0;
+		}
+		if (raise) {
+			ic->request(static_cast<interrupt_control::interrupt>(interrupt_control::TMR0 << n));
+		}
+		if (!irq_repeat(c.mode)) {
+			c.armed = false;
+		}
+		schedule_irq(n);
+	}
+
+	bool timers::in_blank(uint8_t n, uint64_t t) const {
+		if (n == 0) {
+			uint64_t line = count(source::hblank, t);
+			return t < time_of(source::hblank, line) + hblank_ticks;
+		}
+		return t % frame_ticks < vblank_ticks;
+	}
+
+	uint64_t timers::next_blank_edge(uint8_t n, uint64_t t) const {
+		if (n == 0) {
+			uint64_t line = count(source::hblank, t);
+			uint64_t end = time_of(source::hblank, line) + hblank_ticks;
+			return t < end ? end : time_of(source::hblank, line + 1);
+		}
+		uint64_t frame = t / frame_ticks * frame_ticks;
+		return t < frame + vblank_ticks ? frame + vblank_ticks : frame + frame_ticks;
+	}
+
+	void timers::schedule_sync(uint8_t n) {
+		using namespace timer_mode_bits;
+
+		events->cancel(blanks[n]);
+		auto const& c = state[n];
+		// the counter 2 has no blank, and a counter in sync mode 3 ignores
+		// the blanks once started
+		if (n == 2 || !sync_enable(c.mode) || (sync_mode(c.mode) == 3 && c.running)) {
+			return;
+		}
+		events->schedule(blanks[n], next_blank_edge(n, c.since));
+	}
+
+	void timers::sync(uint8_t n, uint64_t at) {
+		using namespace timer_mode_bits;
+
+		settle(n, at);
+		auto& c = state[n];
+		bool start = in_blank(n, at);
+		switch (static_cast<uint32_t>(sync_mode(c.mode))) {
+		case 0:
+			c.running = !start;
+			break;
+		case 1:
+			if (start) {
+				c.value = 0;
+			}
+			break;
+		case 2:
+			if (start) {
+				c.value = 0;
+			}
+			c.running = start;
+			break;
+		case 3:
+			c.running = c.running || start;
+			break;
+		}
+		schedule_irq(n);
+		schedule_sync(n);
+	}
+
+	void dump_timers(std::ostream& f, timers const& t) {
+		auto w = [&](auto const& v) { f.write(reinterpret_cast<char const*>(&v), sizeof(v)); };
+
+		for (auto const& c : t.state) {
+			w(c.mode);
+			w(c.target);
+			w(c.value);
+			w(c.since);
+			w(c.running);
+			w(c.armed);
+			w(c.status);
+		}
+	}
+
+	void restore_timers(std::istream& f, timers& t) {
+		auto r = [&](auto& v) { f.read(reinterpret_cast<char*>(&v), sizeof(v)); };
+
+		for (auto& c : t.state) {
+			r(c.mode);
+			r(c.target);
+			r(c.value);
+			r(c.since);
+			r(c.running);
+			r(c.armed);
+			r(c.status);
+		}
+	}
+}
@@ -0,0 +1,234 @@
+#pragma once
+#include "../../bitmask.hpp"
+#include "../../scheduler.hpp"
+#include "../mmap_device.hpp"
+
+#include <array>
+#include <iosfwd>
+
+namespace psycris::hw {
+	class interrupt_control;
+
+	namespace timer_mode_bits {
+		using mask = psycris::bit_mask<class timer_mode_bits_>;
+
+		// the counter is paused or reset by the blanks, see `sync_mode`
+		constexpr mask sync_enable{0x0001};
+
+		// timer 0 (hblank) and 1 (vblank):
+		// 0: paused during the blank, 1: reset at the blank start,
+		// 2: reset at the blank start and paused outside the blank,
+		// 3: paused until the first blank, then free running
+		//
+		// timer 2: 0 and 3: stopped, 1 and 2: free running
+		constexpr mask sync_mode{0x0006};
+
+		// 0: the counter wraps after 0xffff, 1: after the target
+		constexpr mask reset_at_target{0x0008};
+
+		constexpr mask irq_at_target{0x0010};
+		constexpr mask irq_at_max{0x0020};
+
+		// 0: one interrupt only (until the mode is written), 1: repeated
+		constexpr mask irq_repeat{0x0040};
+
+		// 0: the interrupt bit is pulsed, 1: it is toggled (and the interrupt
+		// is raised when it goes to 0)
+		constexpr mask irq_toggle{0x0080};
+
+		// timer 0: 0 or 2 system clock, 1 or 3 dotclock
+		// timer 1: 0 or 2 system clock, 1 or 3 hblank
+		// timer 2: 0 or 1 system clock, 2 or 3 system clock / 8
+		constexpr mask clock_source{0x0300};
+
+		// read only: 0 while an interrupt is requested
+		constexpr mask irq{0x0400};
+
+		// read only, reset after the mode is read
+		constexpr mask reached_target{0x0800};
+		constexpr mask reached_max{0x1000};
+	}
+
+	/**
+	 * \brief The three root counters
+	 *
+	 * A counter is not incremented tick by tick: its value is derived from
+	 * the cpu clock when it is read (or when a write changes how it counts)
+	 * since the last time it was settled. The interrupts and the blanks that
+	 * pause or reset a counter are scheduled events, so a counter that
+	 * raises no interrupt and is not synchronized costs nothing while the
+	 * cpu runs.
+	 *
+	 * The dotclock and the blanks follow a fixed NTSC video timing, with a
+	 * 320 pixel wide display, until there is a gpu.
+	 */
+	class timers : public mmap_device<timers, 0x30> {
+	  public:
+		static constexpr char const* device_name = "Timers";
+
+		static constexpr uint8_t counters = 3;
+
+		/**
+		 * \brief the cpu ticks of a frame, the same as `psx::board::vblank_period`
+		 */
+		static constexpr uint64_t frame_ticks = 33'868'800 / 60;
+
+		static constexpr uint64_t frame_lines = 263;
+
+		/**
+		 * \brief the length of a vertical blank, the lines not displayed
+		 */
+		static constexpr uint64_t vblank_ticks = 23 * frame_ticks / frame_lines;
+
+		/**
+		 * \brief the length of an horizontal blank
+		 */
+		static constexpr uint64_t hblank_ticks = 543;
+
+		enum class source : uint8_t { system, system_div8, dotclock, hblank };
+
+		/**
+		 * \brief the ticks of `s` counted from the power on to the cpu tick `t`
+		 */
+		static uint64_t count(source s, uint64_t t);
+
+		/**
+		 * \brief the first cpu tick at which `count(s, t)` is `n`
+		 */
+		static uint64_t time_of(source s, uint64_t n);
+
+		timers(gsl::span<uint8_t, size> buffer, interrupt_control& icontrol, scheduler& events);
+
+	  private:
+		// the registers of a counter, at 0x10 * counter
+		template <uint8_t N>
+		struct value_reg : data_reg<0x10 * N> {};
+
+		template <uint8_t N>
+		struct mode_reg : data_reg<0x10 * N + 4> {};
+
+		template <uint8_t N>
+		struct target_reg : data_reg<0x10 * N + 8> {};
+
+		using data_ports = std::tuple<value_reg<0>,
+		                              mode_reg<0>,
+		                              target_reg<0>,
+		                              value_reg<1>,
+		                              mode_reg<1>,
+		                              target_reg<1>,
+		                              value_reg<2>,
+		                              mode_reg<2>,
+		                              target_reg<2>>;
+
+		friend mmap_device;
+
+		template <uint8_t N>
+		void rcb(value_reg<N>) {
+			settle(N, events->now());
+			write<value_reg<N>>(state[N].value);
+		}
+
+		template <uint8_t N>
+		void rcb(mode_reg<N>) {
+			write<mode_reg<N>>(mode_read(N));
+		}
+
+		template <uint8_t N>
+		void wcb(value_reg<N>, uint32_t new_value, uint32_t) {
+			value_written(N, new_value);
+		}
+
+		template <uint8_t N>
+		void wcb(mode_reg<N>, uint32_t new_value, uint32_t) {
+			mode_written(N, new_value);
+		}
+
+		template <uint8_t N>
+		void wcb(target_reg<N>, uint32_t new_value, uint32_t) {
+			target_written(N, new_value);
+		}
+
+	  private:
+		struct counter {
+			// the mode and the target as written, without the read only bits
+			uint32_t mode;
+			uint32_t target;
+
+			// the value at the tick `since`
+			uint32_t value;
+			uint64_t since;
+
+			// false while the counter is paused (or stopped) by the blanks
+			bool running;
+			// false after the interrupt of a one shot counter
+			bool armed;
+			// the read only bits of the mode
+			uint32_t status;
+		};
+
+		source clock_of(uint8_t n) const;
+
+		// the value after which the counter wraps to 0
+		uint32_t limit(uint8_t n) const;
+
+		/**
+		 * \brief advances the counter `n` to the tick `t`, updating the
+		 * reached flags
+		 */
+		void settle(uint8_t n, uint64_t t);
+
+		uint32_t mode_read(uint8_t n);
+
+		void value_written(uint8_t n, uint32_t value);
+		void mode_written(uint8_t n, uint32_t mode);
+		void target_written(uint8_t n, uint32_t target);
+
+		/**
+		 * \brief schedules the next interrupt of the counter `n`, if any
+		 */
+		void schedule_irq(uint8_t n);
+
+		void interrupt(uint8_t n, uint64_t at);
+
+		// the blanks that drive the synchronization of the counter `n`
+		bool in_blank(uint8_t n, uint64_t t) const;
+		uint64_t next_blank_edge(uint8_t n, uint64_t t) const;
+
+		/**
+		 * \brief schedules the next blank edge that changes the counter `n`,
+		 * if any
+		 */
+		void schedule_sync(uint8_t n);
+
+		void sync(uint8_t n, uint64_t at);
+
+	  private:
+		interrupt_control* ic;
+
+		scheduler* events;
+		std::array<scheduler::event, counters> interrupts;
+		std::array<scheduler::event, counters> blanks;
+
+		std::array<counter, counters> state;
+
+		friend void dump_timers(std::ostream&, timers const&);
+		friend void restore_timers(std::istream&, timers&);
+	};
+
+	/**
+	 * \brief Writes the state of the counters kept outside the device memory
+	 *
+	 * For every counter: the mode, the target and the value (4 bytes each),
+	 * the tick of the value (8 bytes), the running and the armed flags (1
+	 * byte each) and the read only bits of the mode (4 bytes).
+	 */
+	void dump_timers(std::ostream&, timers const&);
+
+	/**
+	 * \brief Restores the counters saved by `dump_timers`
+	 *
+	 * The events of the counters are not scheduled again, they are restored
+	 * with the board scheduler (see `restore_scheduler`).
+	 */
+	void restore_timers(std::istream&, timers&);
+}
@@ -0,0 +1,117 @@
+#include "fastmem.hpp"
+#include "../logging.hpp"
+#include "bus.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__) && defined(__x86_64__)
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace psycris::bus {
+	shared_memory::shared_memory(size_t size, bool shareable) : file{-1}, memory{nullptr}, length{size} {
+		if (shareable) {
+			file = memfd_create("psycris-board", MFD_CLOEXEC);
+			if (file >= 0 && ftruncate(file, static_cast<off_t>(size)) == 0) {
+				void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+				if (p != MAP_FAILED) {
+					memory = static_cast<uint8_t*>(p);
+					return;
+				}
+			}
+			psycris::log->warn("[BUS] cannot create the shared board memory, falling back to a plain allocation");
+			if (file >= 0) {
+				close(file);
+				file = -1;
+			}
+		}
+		plain.resize(size);
+		memory = plain.data();
+	}
+
+	shared_memory::~shared_memory() {
+		if (file >= 0) {
+			munmap(memory, length);
+			close(file);
+		}
+	}
+
+	bool fastmem::available() { return true; }
+
+	fastmem::fastmem(shared_memory const& m) : memory{m}, region{nullptr} {
+		assert(memory.fd() >= 0);
+		void* p = mmap(nullptr, region_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (p == MAP_FAILED) {
+			psycris::log->warn("[BUS] cannot reserve the address space for the fastmem: {}", std::strerror(errno));
+			return;
+		}
+		region = static_cast<uint8_t*>(p);
+		pages.assign(size_t(1) << (32 - data_bus::page_bits), page_state{-1, PROT_NONE});
+	}
+
+	fastmem::~fastmem() {
+		if (region) {
+			munmap(region, region_size);
+		}
+	}
+
+	void fastmem::map(uint32_t ix, uint8_t const* host, bool writable) {
+		int32_t offset = -1;
+		int prot = PROT_NONE;
+		if (host >= memory.data() && host < memory.data() + memory.size()) {
+			offset = static_cast<int32_t>(host - memory.data());
+			prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+		}
+		// a page that cannot be mapped (not aligned to the host pages) is
+		// left to the bus
+		if (offset % sysconf(_SC_PAGESIZE) != 0) {
+			offset = -1;
+			prot = PROT_NONE;
+		}
+
+		auto& state = pages[ix];
+		uint8_t* start = region + (uint64_t(ix) << data_bus::page_bits);
+		void* p = start;
+		if (offset != state.offset) {
+			// the page is replaced (and its previous mapping dropped) at once
+			if (offset >= 0) {
+				p = mmap(start, data_bus::page_size, prot, MAP_SHARED | MAP_FIXED, memory.fd(), offset);
+			} else {
+				p = mmap(start,
+				         data_bus::page_size,
+				         PROT_NONE,
+				         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+				         -1,
+				         0);
+			}
+		} else if (prot != state.prot && mprotect(start, data_bus::page_size, prot) != 0) {
+			p = MAP_FAILED;
+		}
+		if (p == MAP_FAILED) {
+			// whatever is left at `start` must fault, the recompiler then
+			// completes the access through the bus
+			psycris::log->warn("[BUS] cannot map the guest page {:0>4x} in the fastmem: {}", ix, std::strerror(errno));
+			mprotect(start, data_bus::page_size, PROT_NONE);
+			state = {-1, PROT_NONE};
+			return;
+		}
+		state = {offset, prot};
+	}
+}
+#else
+namespace psycris::bus {
+	shared_memory::shared_memory(size_t size, bool) : plain(size), file{-1}, memory{plain.data()}, length{size} {}
+
+	shared_memory::~shared_memory() = default;
+
+	bool fastmem::available() { return false; }
+
+	fastmem::fastmem(shared_memory const& m) : memory{m}, region{nullptr} { assert(0); }
+
+	fastmem::~fastmem() = default;
+
+	void fastmem::map(uint32_t, uint8_t const*, bool) { assert(0); }
+}
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <gsl/span>
+#include <vector>
+
+namespace psycris::bus {
+	/**
+	 * \brief Host memory that can be mapped more than once, see `fastmem`
+	 *
+	 * If `shareable` is true (and the host supports it) the memory is an
+	 * anonymous file (a memfd); otherwise it is a plain allocation. The
+	 * memory starts zeroed in both cases.
+	 */
+	class shared_memory {
+	  public:
+		shared_memory(size_t size, bool shareable);
+		~shared_memory();
+
+		shared_memory(shared_memory const&) = delete;
+		shared_memory& operator=(shared_memory const&) = delete;
+
+	  public:
+		uint8_t* data() const { return memory; }
+
+		size_t size() const { return length; }
+
+		operator gsl::span<uint8_t>() const { return {memory, static_cast<std::ptrdiff_t>(length)}; }
+
+		/**
+		 * \brief the file descriptor of the memory, -1 if it is a plain
+		 * allocation
+		 */
+		int fd() const { return file; }
+
+	  private:
+		std::vector<uint8_t> plain;
+		int file;
+		uint8_t* memory;
+		size_t length;
+	};
+
+	/**
+	 * \brief The guest address space laid out in a 4GiB host region
+	 *
+	 * Every page of the `data_bus` served by the `shared_memory` is mapped at
+	 * `base() + guest address`, so the mirrors of the same memory share the
+	 * host pages. A page follows the fast path of the bus: it is readable if
+	 * its loads need no further processing, writable if its stores need none
+	 * either; all the other pages (the I/O, the unmapped, the watched and,
+	 * while the accesses are counted, every page) are `PROT_NONE`.
+	 *
+	 * The region is a cache of the bus lookup table, kept in sync by the bus
+	 * itself (see `data_bus::mirror_to`); an access that faults must be
+	 * completed through the bus, see `recompiler`.
+	 *
+	 * `available()` is false on a host other than Linux x86-64.
+	 */
+	class fastmem {
+	  public:
+		/**
+		 * \brief the size of the region, a guest access of up to 4 bytes
+		 * never leaves it
+		 */
+		static constexpr uint64_t region_size = (uint64_t(1) << 32) + (1 << 16);
+
+		static bool available();
+
+		/**
+		 * \brief reserves the region; every page is `PROT_NONE`
+		 *
+		 * `memory` must be shareable and outlive the region. If the host
+		 * refuses the reservation (after logging the reason) the region is
+		 * not `ready()`, and it must not be used.
+		 */
+		explicit fastmem(shared_memory const& memory);
+		~fastmem();
+
+		fastmem(fastmem const&) = delete;
+		fastmem& operator=(fastmem const&) = delete;
+
+	  public:
+		bool ready() const { return region != nullptr; }
+
+		uint8_t* base() const { return region; }
+
+		bool contains(void const* host) const {
+			auto p = static_cast<uint8_t const*>(host);
+			return p >= region && static_cast<uint64_t>(p - region) < region_size;
+		}
+
+		/**
+		 * \brief maps the guest page `ix` (see `data_bus::page_size`) to
+		 * `host`
+		 *
+		 * The page is readable if `host` is part of the shared memory,
+		 * writable if `writable` is also true; a nullptr `host` leaves the
+		 * page `PROT_NONE`. A page that the host refuses to map is left
+		 * `PROT_NONE` too, its accesses are served by the bus.
+		 */
+		void map(uint32_t ix, uint8_t const* host, bool writable);
+
+	  private:
+		shared_memory const& memory;
+		uint8_t* region;
+
+		// the offset in `memory` mapped by every guest page, -1 if none, and
+		// its protection
+		struct page_state {
+			int32_t offset;
+			int prot;
+		};
+		std::vector<page_state> pages;
+	};
+}
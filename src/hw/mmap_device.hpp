@@ -1,7 +1,11 @@
 #pragma once
 #include "../meta.hpp"
 #include "./bus.hpp"
+#include <boost/hana/traits.hpp>
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <tuple>
 
 namespace psycris::hw {
 
@@ -30,47 +34,122 @@ namespace psycris::hw {
 		};
 	}
 
+	/**
+	 * \brief A device backed by a slice of the board memory
+	 *
+	 * The data ports of the device are the `data_reg` passed to the
+	 * constructor; a write to a port calls the `wcb()` method of the
+	 * `Derived` class that accepts the port type as the first argument. The
+	 * `Derived` class is not required to define a method for every port.
+	 *
+	 * A port whose value changes over time (a counter, a status register) is
+	 * computed on demand: before a read of the port the bus calls the
+	 * `rcb()` method of the `Derived` class that accepts the port type, that
+	 * `write`s the current value. A device without any `rcb()` is read as
+	 * plain memory.
+	 *
+	 * The ports are resolved at compile time: a table maps every byte of the
+	 * device memory to the port that contains it, so a write finds the
+	 * touched ports with an index instead of a scan.
+	 *
+	 * Instead of passing the ports to the constructor, the `Derived` class
+	 * can list them in a `data_ports` tuple; then `notify_ports` knows the
+	 * ports of the device type and the write callbacks can be inlined by a
+	 * statically dispatched bus (see `bus::static_bus`).
+	 */
 	template <typename Derived, size_t MemoryBytes>
 	class mmap_device : public bus::device {
 	  private:
 		/**
-		 * \brief a `bus::data_port` that forwards the `post_write` callback to the `Derived` subclass.
-		 *
-		 * \tparam DataPort is a specialization of `data_reg`; the `post_write`
-		 * method of this specific class calls the `wcb()` method in the
-		 * `Derived` one that accepts an instance of this type as the first
-		 * argument. The `Derived` class is not required to define a method for
-		 * every `DataPort`.s
+		 * \brief a data port of the device
 		 */
+		struct port {
+			uint32_t offset;
+			uint8_t size;
+			// calls the `Derived` write callback for this port, if any
+			void (*post_write)(Derived&, uint32_t new_value, uint32_t old_value);
+			// the `Derived` read callback for this port, nullptr if none
+			void (*pre_read)(Derived&);
+		};
+
+		template <typename, typename = void>
+		struct has_data_ports : std::false_type {};
+
+		template <typename T>
+		struct has_data_ports<T, std::void_t<typename T::data_ports>> : std::true_type {};
+
+		// the device type is a lambda argument (and not `Derived`) so that the
+		// lookup of the callbacks is dependent: a device is not required to
+		// define any of them
 		template <typename DataPort>
-		struct mmap_data_port : public bus::data_port {
-			// silence the ubsan; we are casting a mmap_device* to Derived*
-			// before the latter is constructed. Using now  such pointer is
-			// obviously wrong, but we will use it later, in the post_write
-			// method, when the Derived class is correctly built.
-			__attribute__((no_sanitize("vptr"))) mmap_data_port(mmap_device* d)
-			    : bus::data_port{DataPort::offset, DataPort::size}, _device{static_cast<Derived*>(d)} {}
-
-			void post_write([[maybe_unused]] uint32_t new_value, [[maybe_unused]] uint32_t old_value) const override {
-				auto has_write_callback = hana::is_valid(
-				    [](auto&& port) -> decltype(std::declval<Derived>().wcb(port, 0, 0)) {});
-
-				if constexpr (has_write_callback(DataPort{})) {
-					_device->wcb(DataPort{}, new_value, old_value);
-				}
+		static constexpr bool has_write_callback() {
+			auto valid = hana::is_valid(
+			    [](auto device, auto&& port) -> decltype(hana::traits::declval(device).wcb(port, 0, 0)) {});
+			return valid(hana::type_c<Derived&>, DataPort{});
+		}
+
+		template <typename DataPort>
+		static constexpr bool has_read_callback() {
+			auto valid =
+			    hana::is_valid([](auto device, auto&& port) -> decltype(hana::traits::declval(device).rcb(port)) {});
+			return valid(hana::type_c<Derived&>, DataPort{});
+		}
+
+		template <typename DataPort>
+		static void notify(Derived& d, [[maybe_unused]] uint32_t new_value, [[maybe_unused]] uint32_t old_value) {
+			if constexpr (has_write_callback<DataPort>()) {
+				d.wcb(DataPort{}, new_value, old_value);
+			}
+		}
+
+		template <typename DataPort>
+		static void refresh(Derived& d) {
+			d.rcb(DataPort{});
+		}
+
+		template <typename DataPort>
+		static constexpr port make_port() {
+			if constexpr (has_read_callback<DataPort>()) {
+				return {DataPort::offset, DataPort::size, &notify<DataPort>, &refresh<DataPort>};
+			} else {
+				return {DataPort::offset, DataPort::size, &notify<DataPort>, nullptr};
 			}
+		}
+
+		template <typename... DataPorts>
+		struct port_table {
+			static constexpr std::array<port, sizeof...(DataPorts)> ports = {make_port<DataPorts>()...};
+
+			// true if any port has a read callback
+			static constexpr bool lazy = (has_read_callback<DataPorts>() || ...);
 
-			Derived* _device;
+			static_assert(sizeof...(DataPorts) < 0xffff, "too many data ports");
+
+			// for every byte of the device memory, 1 + the index in `ports`
+			// of the port that contains it; 0 if the byte is not in a port
+			static constexpr std::array<uint16_t, MemoryBytes> index = [] {
+				std::array<uint16_t, MemoryBytes> t{};
+				for (size_t ix = 0; ix < ports.size(); ix++) {
+					for (uint32_t b = ports[ix].offset; b < ports[ix].offset + ports[ix].size; b++) {
+						t[b] = static_cast<uint16_t>(ix + 1);
+					}
+				}
+				return t;
+			}();
 		};
 
 	  public:
 		static constexpr size_t size = MemoryBytes;
 
+		mmap_device(gsl::span<uint8_t, size> buffer) : _memory{buffer} {
+			if constexpr (has_data_ports<Derived>::value) {
+				use_ports(static_cast<typename Derived::data_ports*>(nullptr));
+			}
+		}
+
 		template <typename... DataPorts>
 		mmap_device(gsl::span<uint8_t, size> buffer, DataPorts...) : _memory{buffer} {
-			if constexpr (sizeof...(DataPorts) > 0) {
-				initialize_ports<DataPorts...>();
-			}
+			use_ports(static_cast<std::tuple<DataPorts...>*>(nullptr));
 		}
 
 	  private:
@@ -88,9 +167,95 @@ namespace psycris::hw {
 			return "unknown device";
 		}
 
-		gsl::span<uint8_t> memory() const override { return _memory; }
+		gsl::span<uint8_t> memory() const final { return _memory; }
+
+		bool has_ports() const final { return _ports != nullptr; }
+
+		bool has_lazy_ports() const final { return _lazy; }
+
+		void post_write(uint32_t offset, uint8_t size, uint32_t overwritten) final {
+			uint32_t const end = std::min<uint32_t>(offset + size, MemoryBytes);
+
+			for (uint32_t b = offset; b < end;) {
+				uint16_t ix = _port_index[b];
+				if (ix == 0) {
+					b++;
+					continue;
+				}
+
+				port const& p = _ports[ix - 1];
+				notify_port(p, offset, end, overwritten);
+				b = p.offset + p.size;
+			}
+		}
+
+		void pre_read(uint32_t offset, uint8_t size) final {
+			uint32_t const end = std::min<uint32_t>(offset + size, MemoryBytes);
+
+			for (uint32_t b = offset; b < end;) {
+				uint16_t ix = _port_index[b];
+				if (ix == 0) {
+					b++;
+					continue;
+				}
+
+				port const& p = _ports[ix - 1];
+				if (p.pre_read) {
+					p.pre_read(static_cast<Derived&>(*this));
+				}
+				b = p.offset + p.size;
+			}
+		}
+
+		int64_t port_at(uint32_t offset) const final {
+			if (!_port_index || offset >= MemoryBytes || _port_index[offset] == 0) {
+				return -1;
+			}
+			return _ports[_port_index[offset] - 1].offset;
+		}
+
+		/**
+		 * \brief the same as `pre_read` for a read of a `T`
+		 *
+		 * When `Derived` lists its `data_ports` the ports are resolved at
+		 * compile time; nothing is done for a device without read callbacks.
+		 */
+		template <typename T>
+		void refresh_ports(uint32_t offset) {
+			if constexpr (has_data_ports<Derived>::value) {
+				hana::for_each(to_type_t<typename Derived::data_ports>, [&](auto t) {
+					using P = typename decltype(t)::type;
+					if constexpr (has_read_callback<P>()) {
+						if (offset < P::offset + P::size && offset + sizeof(T) > P::offset) {
+							refresh<P>(static_cast<Derived&>(*this));
+						}
+					}
+				});
+			} else if (_lazy) {
+				mmap_device::pre_read(offset, sizeof(T));
+			}
+		}
 
-		std::vector<bus::data_port const*> const& ports() override { return _ports_ptrs; }
+		/**
+		 * \brief the same as `post_write` for a write of a `T`
+		 *
+		 * When `Derived` lists its `data_ports` the ports are resolved at
+		 * compile time.
+		 */
+		template <typename T>
+		void notify_ports(uint32_t offset, T overwritten) {
+			if constexpr (has_data_ports<Derived>::value) {
+				hana::for_each(to_type_t<typename Derived::data_ports>, [&](auto t) {
+					using P = typename decltype(t)::type;
+					if (offset < P::offset + P::size && offset + sizeof(T) > P::offset) {
+						constexpr port p = make_port<P>();
+						notify_port(p, offset, offset + sizeof(T), overwritten);
+					}
+				});
+			} else {
+				mmap_device::post_write(offset, sizeof(T), overwritten);
+			}
+		}
 
 	  protected:
 		template <typename DataPort>
@@ -106,8 +271,37 @@ namespace psycris::hw {
 		}
 
 	  private:
+		/**
+		 * \brief calls the write callback of `p` after a write of the bytes
+		 * in [start, end)
+		 */
+		void notify_port(port const& p, uint32_t start, uint32_t end, uint32_t overwritten) {
+			uint32_t new_value = 0;
+			std::memcpy(&new_value, _memory.data() + p.offset, p.size);
+
+			// only the bytes in [first, last) of the port were written
+			uint32_t first = std::max(p.offset, start);
+			uint32_t last = std::min(p.offset + p.size, end);
+			uint32_t old_value = new_value;
+			std::memcpy(reinterpret_cast<char*>(&old_value) + (first - p.offset),
+			            reinterpret_cast<char const*>(&overwritten) + (first - start),
+			            last - first);
+
+			p.post_write(static_cast<Derived&>(*this), new_value, old_value);
+		}
+
+		template <typename... DataPorts>
+		void use_ports(std::tuple<DataPorts...>*) {
+			if constexpr (sizeof...(DataPorts) > 0) {
+				check_ports<DataPorts...>();
+				_ports = port_table<DataPorts...>::ports.data();
+				_port_index = port_table<DataPorts...>::index.data();
+				_lazy = port_table<DataPorts...>::lazy;
+			}
+		}
+
 		template <typename... DataPorts>
-		void initialize_ports() {
+		static constexpr void check_ports() {
 			constexpr auto get_offset = [](auto reg) {
 				using T = typename decltype(reg)::type;
 				return hana::int_c<T::offset>;
@@ -121,14 +315,6 @@ namespace psycris::hw {
 			              "last data port is mapped outside the device memory");
 
 			static_assert(!details::ports_overlaps(types), "a data port overlaps");
-
-			hana::for_each(types, [&](auto port_def) {
-				using DataPort = typename decltype(port_def)::type;
-
-				auto port = std::make_unique<mmap_data_port<DataPort>>(this);
-				_ports_ptrs.push_back(port.get());
-				_ports.push_back(std::move(port));
-			});
 		}
 
 	  private:
@@ -138,18 +324,13 @@ namespace psycris::hw {
 		gsl::span<uint8_t, MemoryBytes> _memory;
 
 		/**
-		 * \brief The device data ports (if any).
+		 * \brief The device data ports (if any) and the port index of every
+		 * byte, see `port_table`
 		 */
-		std::vector<std::unique_ptr<bus::data_port>> _ports;
+		port const* _ports = nullptr;
+		uint16_t const* _port_index = nullptr;
 
-		/**
-		 * \brief a copy of the `_ports` vector used to implement the `device`
-		 * interface.
-		 *
-		 * The `ports()` method must return a const-ref to an already existent
-		 * vector, but i don't want to ditch the unique pointers from the
-		 * `_ports` member.
-		 */
-		std::vector<bus::data_port const*> _ports_ptrs;
+		// true if a port has a read callback
+		bool _lazy = false;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,175 @@
+#pragma once
+#include "./bus.hpp"
+
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+namespace psycris::bus {
+	/**
+	 * \brief `Device` mapped to the address range [Start, End]
+	 */
+	template <typename Device, uint32_t Start, uint32_t End>
+	struct mapping {
+		static_assert(Start <= End, "empty address range");
+
+		using device = Device;
+		static constexpr address_range range{Start, End};
+	};
+
+	template <typename Layout, typename Map>
+	class static_bus;
+
+	/**
+	 * \brief A bus whose devices and mappings are known at compile time
+	 *
+	 * `Devices` are the device types of a board (e.g. `psx::board::layout`)
+	 * and `Mappings` the `mapping` of each one of them; the address ranges are
+	 * checked in order, so the hottest ones should come first.
+	 *
+	 * The dispatch is a chain of constant comparisons that calls the concrete
+	 * device type: there are no virtual calls and, for a device that lists its
+	 * `data_ports` (see `mmap_device`), the read and write callbacks are
+	 * inlined in the load and store paths.
+	 *
+	 * The `static_bus` does not map any memory page; `connect` connects its
+	 * devices to a `data_bus`, that serves the memory pages, and routes the
+	 * other accesses here.
+	 */
+	template <typename... Devices, typename... Mappings>
+	class static_bus<std::tuple<Devices...>, std::tuple<Mappings...>> final : public io_space {
+		template <typename M>
+		static constexpr bool fits = M::range.end - M::range.start < M::device::size;
+
+		static_assert((fits<Mappings> && ...), "a mapping is larger than its device");
+
+	  public:
+		static_bus(Devices&... devices) : devices{&devices...}, unmapped{&own_unmapped} {}
+
+		static_bus(static_bus const&) = delete;
+		static_bus& operator=(static_bus const&) = delete;
+
+	  public:
+		/**
+		 * \brief connects every mapping to `bus` and routes to this bus the
+		 * accesses outside the memory pages
+		 *
+		 * From now on the unmapped accesses are counted by `bus`.
+		 */
+		void connect(data_bus& bus) {
+			(bus.connect(Mappings::range, *std::get<typename Mappings::device*>(devices)), ...);
+			bus.route_io(*this);
+			unmapped = &bus.unmapped();
+		}
+
+	  public:
+		template <typename T>
+		T read(uint32_t addr) {
+			static_assert(std::is_unsigned_v<T> && sizeof(T) <= 4,
+			              "The static_bus read type must be a 8/16/32 unsigned int");
+
+			T value;
+			bool mapped = dispatch(addr, [&](auto& device, uint32_t offset) {
+				device.template refresh_ports<T>(offset);
+				std::memcpy(&value, device.memory().data() + offset, sizeof(T));
+			});
+			if (!mapped) {
+				unmapped->read(addr, sizeof(T));
+				return static_cast<T>(data_bus::open_bus);
+			}
+			return value;
+		}
+
+		template <typename T>
+		void write(uint32_t addr, T val) {
+			static_assert(std::is_unsigned_v<T> && sizeof(T) <= 4,
+			              "The static_bus write type must be a 8/16/32 unsigned int");
+
+			bool mapped = dispatch(addr, [&](auto& device, uint32_t offset) {
+				uint8_t* host = device.memory().data() + offset;
+				if (!device.has_ports()) {
+					std::memcpy(host, &val, sizeof(T));
+					return;
+				}
+
+				T prev_value;
+				std::memcpy(&prev_value, host, sizeof(T));
+				std::memcpy(host, &val, sizeof(T));
+				device.notify_ports(offset, prev_value);
+			});
+			if (!mapped) {
+				unmapped->write(addr, sizeof(T), val);
+			}
+		}
+
+	  public:
+		uint32_t read(uint32_t addr, uint8_t size) override {
+			switch (size) {
+			case 1:
+				return read<uint8_t>(addr);
+			case 2:
+				return read<uint16_t>(addr);
+			default:
+				return read<uint32_t>(addr);
+			}
+		}
+
+		void write(uint32_t addr, uint32_t value, uint8_t size) override {
+			switch (size) {
+			case 1:
+				write(addr, static_cast<uint8_t>(value));
+				break;
+			case 2:
+				write(addr, static_cast<uint16_t>(value));
+				break;
+			default:
+				write(addr, value);
+			}
+		}
+
+		gsl::span<uint8_t> plain_memory(uint32_t addr) override {
+			gsl::span<uint8_t> memory;
+			(plain_memory<Mappings>(addr, memory) || ...);
+			return memory;
+		}
+
+	  private:
+		template <typename M>
+		bool plain_memory(uint32_t addr, gsl::span<uint8_t>& memory) {
+			if (addr < M::range.start || addr > M::range.end) {
+				return false;
+			}
+			auto& device = *std::get<typename M::device*>(devices);
+			if (!device.has_ports() && !device.has_lazy_ports()) {
+				uint8_t* host = device.memory().data() + (addr - M::range.start);
+				memory = {host, static_cast<gsl::span<uint8_t>::index_type>(M::range.end - addr + 1)};
+			}
+			return true;
+		}
+
+		/**
+		 * \brief calls `f(device, offset)` with the device mapped at `addr`
+		 *
+		 * \return false if `addr` is unmapped
+		 */
+		template <typename F>
+		bool dispatch(uint32_t addr, F&& f) {
+			return (dispatch_to<Mappings>(addr, f) || ...);
+		}
+
+		template <typename M, typename F>
+		bool dispatch_to(uint32_t addr, F& f) {
+			if (addr < M::range.start || addr > M::range.end) {
+				return false;
+			}
+			f(*std::get<typename M::device*>(devices), addr - M::range.start);
+			return true;
+		}
+
+	  private:
+		std::tuple<Devices*...> devices;
+
+		unmapped_accesses own_unmapped;
+		unmapped_accesses* unmapped;
+	};
+}
@@ -84,12 +84,13 @@ namespace {
 namespace psycris {
 	using psycris::log;
 
-	void load_bios(std::istream& in, gsl::span<uint8_t> buffer) {
+	bool load_bios(std::istream& in, gsl::span<uint8_t> buffer) {
 		auto ptr = reinterpret_cast<char*>(buffer.data());
 		if (!in.read(ptr, buffer.size())) {
 			log->critical("cannot read BIOS");
-			std::exit(2);
+			return false;
 		}
+		return true;
 	}
 
 	// void load_exe(std::istream& in, cpu::data_bus& bus) {
@@ -7,9 +7,9 @@ namespace psycris {
 	 * \brief loads a bios
 	 *
 	 * The `istream` content is read as-is into the memory region; no parsing is
-	 * performed on the input data.
+	 * performed on the input data; returns false if the input is too short.
 	 */
-	void load_bios(std::istream&, gsl::span<uint8_t>);
+	bool load_bios(std::istream&, gsl::span<uint8_t>);
 
 	/**
 	 * \brief loads a PSX-EXE
@@ -0,0 +1,148 @@
+#include "lockstep.hpp"
+#include "logging.hpp"
+#include "session.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <memory>
+
+namespace {
+	template <size_t N>
+	std::string compare_regs(char const* name, std::array<uint32_t, N> const& a, std::array<uint32_t, N> const& b) {
+		for (size_t ix = 0; ix < N; ix++) {
+			if (a[ix] != b[ix]) {
+				return fmt::format("{}[{}]: 0x{:0>8x} != 0x{:0>8x}", name, ix, a[ix], b[ix]);
+			}
+		}
+		return "";
+	}
+
+	// the registers as seen by MFC2/CFC2
+	std::array<uint32_t, 64> gte_regs(cpu::gte const& g) {
+		std::array<uint32_t, 64> r;
+		for (uint8_t ix = 0; ix < r.size(); ix++) {
+			r[ix] = g.read(ix);
+		}
+		return r;
+	}
+
+	psycris::psx::engine engine_of(psycris::config const& cfg) {
+		switch (cfg.engine) {
+		case psycris::config::cached_interpreter:
+			return &cpu::mips::run_cached;
+		case psycris::config::recompiler:
+			return &cpu::mips::run_jit;
+		default:
+			return &cpu::mips::run;
+		}
+	}
+}
+
+namespace psycris {
+	uint64_t memory_hash(gsl::span<uint8_t const> m) {
+		uint64_t h = 0x9e37'79b9'7f4a'7c15 ^ m.size();
+		auto mix = [&](uint64_t v) {
+			h = (h ^ v) * 0x9ddf'ea08'eb38'2d69;
+			h ^= h >> 47;
+		};
+
+		size_t ix = 0;
+		for (; ix + 8 <= static_cast<size_t>(m.size()); ix += 8) {
+			uint64_t v;
+			std::memcpy(&v, m.data() + ix, sizeof(v));
+			mix(v);
+		}
+		for (; ix < static_cast<size_t>(m.size()); ix++) {
+			mix(m[ix]);
+		}
+		return h;
+	}
+
+	lockstep::lockstep(psx& r, psx& c, psx::engine e) : reference{&r}, candidate{&c}, engine{e}, tick{0} {}
+
+	bool lockstep::run(uint64_t until, uint64_t step) {
+		step = std::max<uint64_t>(step, 1);
+		while (reference->cpu.ticks() < until) {
+			uint64_t t = std::min(until, reference->cpu.ticks() + step);
+			reference->run(t);
+			candidate->run(t, engine);
+
+			if (!compare()) {
+				return false;
+			}
+			if (reference->cpu.halted()) {
+				break;
+			}
+		}
+		return true;
+	}
+
+	bool lockstep::compare() {
+		auto const& a = reference->cpu;
+		auto const& b = candidate->cpu;
+		tick = a.ticks();
+
+		if (a.ticks() != b.ticks()) {
+			diff = fmt::format("ticks: {} != {}", a.ticks(), b.ticks());
+		} else if (a.halted() != b.halted()) {
+			diff = fmt::format("halted: {} != {}", a.halted(), b.halted());
+		} else {
+			diff = compare_regs("regs", a.regs, b.regs);
+			if (diff.empty()) {
+				diff = compare_regs("mult_regs", a.mult_regs, b.mult_regs);
+			}
+			if (diff.empty()) {
+				diff = compare_regs("cop0.regs", a.cop0.regs, b.cop0.regs);
+			}
+			if (diff.empty()) {
+				diff = compare_regs("cop2.regs", gte_regs(a.cop2), gte_regs(b.cop2));
+			}
+			if (diff.empty() && memory_hash(reference->memory()) != memory_hash(candidate->memory())) {
+				// the hashes tell that the memory differs, not where
+				auto ma = reference->memory();
+				auto mb = candidate->memory();
+				auto pos = std::mismatch(std::begin(ma), std::end(ma), std::begin(mb));
+				diff = fmt::format("memory: the board memory differs at offset 0x{:x}", pos.first - std::begin(ma));
+			}
+		}
+		return diff.empty();
+	}
+
+	bool lockstep::dump(std::string const& prefix) const {
+		for (auto [board, suffix] : {std::pair{reference, ".reference"}, std::pair{candidate, ".candidate"}}) {
+			std::ofstream f(prefix + suffix, std::ios::binary | std::ios_base::out | std::ios_base::trunc);
+			if (!f) {
+				return false;
+			}
+			dump_board(f, *board);
+		}
+		return true;
+	}
+
+	int run_lockstep(config const& cfg) {
+		auto reference = std::make_unique<psx>(cfg);
+		auto candidate = std::make_unique<psx>(cfg);
+		for (auto* board : {reference.get(), candidate.get()}) {
+			if (int status = load_input(*board); status != 0) {
+				return status;
+			}
+		}
+
+		lockstep l{*reference, *candidate, engine_of(cfg)};
+		if (l.run(cfg.ticks, cfg.lockstep_step)) {
+			log->info("the boards agree after {} ticks", reference->cpu.ticks());
+			return 0;
+		}
+
+		std::string prefix = fmt::format("lockstep@{}", l.diverged_at());
+		log->critical("the boards diverged at tick {}: {}", l.diverged_at(), l.difference());
+		if (l.dump(prefix)) {
+			log->info("the boards are dumped on {}.reference and {}.candidate", prefix, prefix);
+		} else {
+			log->error("cannot write the dumps {}.*", prefix);
+		}
+		return 3;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "config.hpp"
+#include "psx.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace psycris {
+	/**
+	 * \brief Runs two boards in lockstep and compares their state
+	 *
+	 * The reference board runs with the plain interpreter, the candidate
+	 * with the engine under test; every `step` ticks the cpu registers
+	 * (`regs`, `mult_regs`, `cop0.regs`, the GTE registers), the clock and
+	 * a hash of the board memory are compared, the run stops at the first
+	 * difference.
+	 */
+	class lockstep {
+	  public:
+		lockstep(psx& reference, psx& candidate, psx::engine);
+
+	  public:
+		/**
+		 * \brief runs both boards until `until`, comparing them every `step`
+		 * ticks
+		 *
+		 * Returns false if the boards diverged.
+		 */
+		bool run(uint64_t until, uint64_t step);
+
+		/**
+		 * \brief the first difference found, empty if none
+		 */
+		std::string const& difference() const { return diff; }
+
+		/**
+		 * \brief the tick where the difference has been found
+		 */
+		uint64_t diverged_at() const { return tick; }
+
+		/**
+		 * \brief dumps both boards, in `prefix.reference` and
+		 * `prefix.candidate`, with `dump_board`
+		 *
+		 * Returns false if the files cannot be written.
+		 */
+		bool dump(std::string const& prefix) const;
+
+	  private:
+		bool compare();
+
+	  private:
+		psx* reference;
+		psx* candidate;
+		psx::engine engine;
+
+		std::string diff;
+		uint64_t tick;
+	};
+
+	/**
+	 * \brief a 64 bit hash of a memory region
+	 */
+	uint64_t memory_hash(gsl::span<uint8_t const>);
+
+	/**
+	 * \brief the lockstep mode of the command line
+	 *
+	 * Loads the input of `cfg` into two boards and runs them in lockstep,
+	 * the candidate with the engine of `cfg`; on a divergence both boards
+	 * are dumped in `lockstep@<tick>.reference` and
+	 * `lockstep@<tick>.candidate`. Returns the exit status: 0 if the boards
+	 * agree, 3 if they diverge or the status of `run_session`.
+	 */
+	int run_lockstep(config const& cfg);
+}
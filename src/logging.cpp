@@ -2,15 +2,23 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
+namespace {
+	std::shared_ptr<spdlog::logger> process;
+}
+
 namespace psycris {
-	std::shared_ptr<spdlog::logger> log;
+	// a new thread starts with the process logger
+	thread_local std::shared_ptr<spdlog::logger> log = process;
 
 	void init_logging(bool verbose) {
-		log = spdlog::stdout_color_st(logger_name);
-		log->set_pattern("[%^%l%$] %v");
+		process = spdlog::stdout_color_mt(logger_name);
+		process->set_pattern("[%^%l%$] %v");
 
 		if (verbose) {
-			log->set_level(spdlog::level::level_enum::trace);
+			process->set_level(spdlog::level::level_enum::trace);
 		}
+		log = process;
 	}
-}
\ No newline at end of file
+
+	std::shared_ptr<spdlog::logger> process_logger() { return process; }
+}
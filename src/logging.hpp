@@ -4,7 +4,34 @@
 namespace psycris {
 	constexpr char const* logger_name = "psycris";
 
-	extern std::shared_ptr<spdlog::logger> log;
+	/**
+	 * \brief the logger of the code running on this thread
+	 *
+	 * Every board has its own logger, bound to the thread while the board
+	 * runs (see `log_scope`); elsewhere `log` is the process logger created
+	 * by `init_logging`.
+	 */
+	extern thread_local std::shared_ptr<spdlog::logger> log;
 
 	void init_logging(bool verbose);
-}
\ No newline at end of file
+
+	/**
+	 * \brief the process logger
+	 */
+	std::shared_ptr<spdlog::logger> process_logger();
+
+	/**
+	 * \brief binds a logger to the current thread, until the end of the scope
+	 */
+	class log_scope {
+	  public:
+		log_scope(std::shared_ptr<spdlog::logger> l) : previous{std::move(log)} { log = std::move(l); }
+		~log_scope() { log = std::move(previous); }
+
+		log_scope(log_scope const&) = delete;
+		log_scope& operator=(log_scope const&) = delete;
+
+	  private:
+		std::shared_ptr<spdlog::logger> previous;
+	};
+}
@@ -1,57 +1,61 @@
+#include "batch.hpp"
 #include "config.hpp"
-#include "cpu/cpu.hpp"
-#include "loader.hpp"
+#include "lockstep.hpp"
 #include "logging.hpp"
 #include "psx.hpp"
+#include "session.hpp"
 
-#include <cstdlib>
 #include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
 
 namespace {
-	psycris::psx board;
-
-	void dump_on_exit() {
+	int batch(psycris::config const& cfg) {
 		using psycris::log;
 
-		std::string filename = fmt::format("dump@{}", board.cpu.ticks());
-		log->info("saving the board dump on {}", filename);
-
-		std::ofstream dump_file(filename, std::ios::binary | std::ios_base::out | std::ios_base::trunc);
-		if (!dump_file) {
-			log->critical("cannot open the dump file for writing");
+		std::ifstream f(cfg.batch_file);
+		std::vector<psycris::batch_job> jobs;
+		if (!f || !psycris::read_jobs(f, jobs)) {
+			log->critical("cannot read the jobs from {}", cfg.batch_file);
+			return 1;
 		}
 
-		psycris::dump_board(dump_file, board);
+		size_t threads = cfg.jobs > 0 ? cfg.jobs : std::max(1u, std::thread::hardware_concurrency());
+		log->info("running {} jobs on {} threads", jobs.size(), threads);
+
+		auto results = psycris::run_batch(jobs, cfg, threads, cfg.batch_file + ".");
+
+		size_t failed = 0;
+		for (size_t ix = 0; ix < jobs.size(); ix++) {
+			auto const& r = results[ix];
+			log->info("{}: status={} ticks={} {:.3f}s", jobs[ix].input_file, r.status, r.ticks, r.seconds);
+			if (r.status != 0) {
+				failed++;
+				std::ifstream job_log(r.log_file);
+				std::cout << job_log.rdbuf() << std::flush;
+			}
+		}
+		log->info("the logs of the jobs are in {}.<job>.log", cfg.batch_file);
+		log->info("{} jobs, {} failed", jobs.size(), failed);
+		return failed == 0 ? 0 : 1;
 	}
 }
 
 int main(int argc, char* argv[]) {
-	using psycris::cfg;
-	psycris::parse_cmdline(argc, argv);
+	psycris::config cfg = psycris::parse_cmdline(argc, argv);
 
 	using psycris::log;
 	psycris::init_logging(cfg.verbose);
 
 	log->info("PSX board. Total memory={}", psycris::psx::board::memory_size());
-	if (cfg.dump_on_exit) {
-		log->trace("dump on exit");
-		std::atexit(dump_on_exit);
+	if (!cfg.batch_file.empty()) {
+		return batch(cfg);
 	}
-
-	std::ifstream f(cfg.input_file, std::ios::binary | std::ios::in);
-	if (!f) {
-		log->critical("error opening {}", cfg.input_file);
-		return 1;
-	}
-
-	if (cfg.mode == cfg.bios) {
-		log->info("loading bios {}", cfg.input_file);
-		psycris::load_bios(f, board.rom.memory());
-	} else {
-		log->info("restoring from {}", cfg.input_file);
-		psycris::restore_board(f, board);
+	if (cfg.lockstep) {
+		return psycris::run_lockstep(cfg);
 	}
 
-	board.cpu.run(cfg.ticks);
-	fmt::print("run out of ticks\n");
-}
\ No newline at end of file
+	auto board = std::make_unique<psycris::psx>(cfg);
+	return psycris::run_session(*board);
+}
@@ -1,5 +1,7 @@
 #include "psx.hpp"
+#include "logging.hpp"
 
+#include <algorithm>
 #include <fmt/format.h>
 #include <stdexcept>
 
@@ -49,27 +51,71 @@ namespace {
 }
 
 namespace psycris {
-	psx::psx()
-	    : _board_memory(psx::board::memory_size()),
+	psx::psx(config settings, std::shared_ptr<spdlog::logger> logger)
+	    : _settings(std::move(settings)),
+	      _logger(logger ? std::move(logger) : process_logger()),
+	      _board_memory(psx::board::memory_size(), _settings.fastmem && bus::fastmem::available()),
 	      cpu(_bus),
+	      events(cpu),
 	      ram(v<0>(_board_memory)),
 	      rom(v<1>(_board_memory)),
-	      interrupt_control(v<2>(_board_memory), cpu.cop0),
-	      dma(v<3>(_board_memory), interrupt_control),
-	      spu(v<4>(_board_memory)) {
+	      interrupt_control(v<2>(_board_memory), cpu),
+	      dma(v<3>(_board_memory), interrupt_control, events, _bus),
+	      spu(v<4>(_board_memory)),
+	      scratchpad(v<5>(_board_memory)),
+	      timers(v<6>(_board_memory), interrupt_control, events),
+	      vram(v<7>(_board_memory)),
+	      gpu(v<8>(_board_memory), vram, interrupt_control),
+	      _io(ram, rom, interrupt_control, dma, spu, scratchpad, timers, vram, gpu) {
+
+		_io.connect(_bus);
+		cpu.map_scratchpad(scratchpad.memory());
+		dma.connect(hw::dma::gpu, gpu);
+
+		if (_settings.fastmem) {
+			if (_board_memory.fd() >= 0) {
+				_fastmem = std::make_unique<bus::fastmem>(_board_memory);
+			}
+			if (_fastmem && _fastmem->ready()) {
+				_bus.mirror_to(_fastmem.get());
+				cpu.map_fastmem(_fastmem.get());
+			} else {
+				_fastmem.reset();
+				_logger->warn("the fastmem is not available on this host");
+			}
+		}
 
-		_bus.connect({0x1fc0'0000, 0x1fc8'0000}, rom);
-		_bus.connect({0x9fc0'0000, 0x9fc8'0000}, rom);
-		_bus.connect({0xbfc0'0000, 0xbfc8'0000}, rom);
+		vblank = events.add("VBLANK", [this](uint64_t at) {
+			interrupt_control.request(hw::interrupt_control::VBLANK);
+			events.schedule(vblank, at + board::vblank_period);
+		});
+		events.schedule(vblank, board::vblank_period);
 
-		_bus.connect({0x0000'0000, 0x0020'0000}, ram);
-		_bus.connect({0x8000'0000, 0x8020'0000}, ram);
-		_bus.connect({0xa000'0000, 0xa020'0000}, ram);
+		unmapped_report = events.add("UNMAPPED REPORT", [this](uint64_t at) {
+			_bus.unmapped().report();
+			events.schedule(unmapped_report, at + board::unmapped_report_period);
+		});
+		events.schedule(unmapped_report, board::unmapped_report_period);
+	}
 
-		_bus.connect({0x1f80'1070, 0x1f80'1078}, interrupt_control);
+	psx::~psx() {
+		log_scope scope{_logger};
+		_bus.unmapped().report();
+	}
 
-		_bus.connect(0x1f80'10f0, dma);
-		_bus.connect(0x1f80'1c00, spu);
+	void psx::run(uint64_t until, engine run) {
+		log_scope scope{_logger};
+
+		while (cpu.ticks() < until && !cpu.halted()) {
+			uint64_t deadline = std::min(until, events.next());
+			if (deadline > cpu.ticks()) {
+				(cpu.*run)(deadline);
+			}
+			events.dispatch();
+			if (cpu.stopped_by()) {
+				break;
+			}
+		}
 	}
 }
 
@@ -80,6 +126,9 @@ namespace psycris {
 
 		dump_cpu(f, board.cpu);
 		f.write(reinterpret_cast<char const*>(board._board_memory.data()), board._board_memory.size());
+		dump_scheduler(f, board.events);
+		dump_timers(f, board.timers);
+		dump_gpu(f, board.gpu);
 	}
 
 	void restore_board(std::istream& f, psx& board) {
@@ -93,5 +142,9 @@ namespace psycris {
 
 		restore_cpu(f, board.cpu);
 		f.read(reinterpret_cast<char*>(board._board_memory.data()), board._board_memory.size());
+		// the pending events are due at the ticks of the restored clock
+		restore_scheduler(f, board.events);
+		restore_timers(f, board.timers);
+		restore_gpu(f, board.gpu);
 	}
 }
\ No newline at end of file
@@ -2,13 +2,21 @@
 #include "cpu/cpu.hpp"
 
 #include "hw/bus.hpp"
+#include "hw/fastmem.hpp"
+#include "hw/static_bus.hpp"
 #include "hw/devices/dma.hpp"
+#include "hw/devices/gpu.hpp"
 #include "hw/devices/interrupt_control.hpp"
 #include "hw/devices/ram.hpp"
 #include "hw/devices/spu.hpp"
+#include "hw/devices/timers.hpp"
 
+#include "config.hpp"
 #include "meta.hpp"
+#include "scheduler.hpp"
 #include <iosfwd>
+#include <memory>
+#include <spdlog/spdlog.h>
 #include <vector>
 
 namespace psycris {
@@ -19,9 +27,28 @@ namespace psycris {
 			/**
 			 * \brief The board revision used as the verison of the dump files
 			 */
-			constexpr static uint16_t rev = 0x1;
+			constexpr static uint16_t rev = 0x8;
 
-			using layout = std::tuple<hw::ram, hw::rom, hw::interrupt_control, hw::dma, hw::spu>;
+			/**
+			 * \brief the cpu ticks between two vertical blanks (NTSC)
+			 */
+			constexpr static uint64_t vblank_period = 33'868'800 / 60;
+
+			/**
+			 * \brief the cpu ticks between two reports of the unmapped
+			 * accesses (one second)
+			 */
+			constexpr static uint64_t unmapped_report_period = 33'868'800;
+
+			using layout = std::tuple<hw::ram,
+			                          hw::rom,
+			                          hw::interrupt_control,
+			                          hw::dma,
+			                          hw::spu,
+			                          hw::scratchpad,
+			                          hw::timers,
+			                          hw::vram,
+			                          hw::gpu>;
 
 			constexpr static size_t memory_size() {
 				return boost::hana::fold_left(to_type_t<layout>, 0, [](int state, auto p) {
@@ -29,13 +56,86 @@ namespace psycris {
 					return state + T::size;
 				});
 			}
+
+			/**
+			 * \brief where the devices of the `layout` are mapped
+			 *
+			 * The I/O ports come first, the memory is normally served by the
+			 * pages of the data bus.
+			 */
+			using memory_map = std::tuple<
+			    bus::mapping<hw::interrupt_control, 0x1f80'1070, 0x1f80'1077>,
+			    bus::mapping<hw::dma, 0x1f80'1080, 0x1f80'10ff>,
+			    bus::mapping<hw::timers, 0x1f80'1100, 0x1f80'112f>,
+			    bus::mapping<hw::gpu, 0x1f80'1810, 0x1f80'1817>,
+			    bus::mapping<hw::spu, 0x1f80'1c00, 0x1f80'1dff>,
+			    bus::mapping<hw::scratchpad, 0x1f80'0000, 0x1f80'03ff>,
+			    bus::mapping<hw::scratchpad, 0x9f80'0000, 0x9f80'03ff>,
+			    bus::mapping<hw::ram, 0x0000'0000, 0x001f'ffff>,
+			    bus::mapping<hw::ram, 0x8000'0000, 0x801f'ffff>,
+			    bus::mapping<hw::ram, 0xa000'0000, 0xa01f'ffff>,
+			    bus::mapping<hw::rom, 0x1fc0'0000, 0x1fc7'ffff>,
+			    bus::mapping<hw::rom, 0x9fc0'0000, 0x9fc7'ffff>,
+			    bus::mapping<hw::rom, 0xbfc0'0000, 0xbfc7'ffff>>;
 		};
 
 	  public:
-		psx();
+		/**
+		 * \brief a board described by `settings`
+		 *
+		 * A board is self-contained: several boards can run in parallel, one
+		 * per thread. The board logs through `logger`, the process logger if
+		 * none is given.
+		 */
+		psx(config settings = {}, std::shared_ptr<spdlog::logger> logger = nullptr);
+
+		/**
+		 * \brief reports the unmapped accesses not yet logged
+		 */
+		~psx();
+
+		psx(psx const&) = delete;
+		psx& operator=(psx const&) = delete;
+
+	  public:
+		config const& settings() const { return _settings; }
+
+		std::shared_ptr<spdlog::logger> const& logger() const { return _logger; }
+
+	  public:
+		/**
+		 * \brief the CPU data bus, with all the board devices connected
+		 */
+		bus::data_bus& bus() { return _bus; }
+
+		/**
+		 * \brief the memory of all the board devices, as saved by `dump_board`
+		 */
+		gsl::span<uint8_t const> memory() const { return gsl::span<uint8_t>(_board_memory); }
+
+		using engine = void (cpu::mips::*)(uint64_t);
+
+		/**
+		 * \brief runs the board until the cpu clock reaches `until`
+		 *
+		 * The cpu runs, with the given engine, in slices that end at the next
+		 * scheduled event; the due events are dispatched between the slices.
+		 * The run ends early if the cpu halts or hits a watchpoint (see
+		 * `mips::watch`).
+		 *
+		 * While the board runs its logger is bound to the thread.
+		 */
+		void run(uint64_t until, engine = &cpu::mips::run);
 
 	  private:
-		std::vector<uint8_t> _board_memory;
+		config _settings;
+		std::shared_ptr<spdlog::logger> _logger;
+
+		// shareable if the board uses the fastmem (see `config::fastmem`)
+		bus::shared_memory _board_memory;
+
+		// the guest address space seen by the recompiler, if enabled
+		std::unique_ptr<bus::fastmem> _fastmem;
 
 	  private:
 		bus::data_bus _bus;
@@ -43,6 +143,8 @@ namespace psycris {
 	  public:
 		cpu::mips cpu;
 
+		scheduler events;
+
 		/**
 		 * \brief CPU data bus
 		 *
@@ -67,6 +169,19 @@ namespace psycris {
 		hw::interrupt_control interrupt_control;
 		hw::dma dma;
 		hw::spu spu;
+		hw::scratchpad scratchpad;
+		hw::timers timers;
+		hw::vram vram;
+		hw::gpu gpu;
+
+	  private:
+		// the accesses outside the memory pages, dispatched at compile time
+		bus::static_bus<board::layout, board::memory_map> _io;
+
+		// the vertical blank, at the fixed NTSC rate
+		scheduler::event vblank;
+
+		scheduler::event unmapped_report;
 
 		friend void dump_board(std::ostream&, psx const&);
 		friend void restore_board(std::istream&, psx&);
@@ -0,0 +1,108 @@
+#include "scheduler.hpp"
+#include "cpu/cpu.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fmt/format.h>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+namespace psycris {
+	scheduler::scheduler(cpu::mips& c) : cpu{&c}, scheduled{0} {}
+
+	scheduler::event scheduler::add(std::string name, handler fn) {
+		sources.push_back({std::move(name), std::move(fn), never, 0});
+		return static_cast<event>(sources.size() - 1);
+	}
+
+	void scheduler::schedule(event e, uint64_t at) {
+		assert(e < sources.size());
+		auto& s = sources[e];
+		s.at = at;
+		s.order = ++scheduled;
+
+		heap.push_back({at, s.order, e});
+		std::push_heap(std::begin(heap), std::end(heap), std::greater<>{});
+
+		cpu->stop_at(at);
+	}
+
+	void scheduler::cancel(event e) {
+		assert(e < sources.size());
+		sources[e].at = never;
+	}
+
+	uint64_t scheduler::when(event e) const { return sources[e].at; }
+
+	std::string const& scheduler::name(event e) const { return sources[e].name; }
+
+	uint64_t scheduler::now() const { return cpu->ticks(); }
+
+	uint64_t scheduler::next() {
+		drop_stale();
+		return heap.empty() ? never : heap.front().at;
+	}
+
+	void scheduler::dispatch() {
+		uint64_t t = now();
+		while (next() <= t) {
+			entry top = heap.front();
+			std::pop_heap(std::begin(heap), std::end(heap), std::greater<>{});
+			heap.pop_back();
+
+			auto& s = sources[top.e];
+			s.at = never;
+			s.fn(top.at);
+		}
+	}
+
+	void scheduler::drop_stale() {
+		while (!heap.empty()) {
+			auto const& top = heap.front();
+			auto const& s = sources[top.e];
+			if (s.at != never && s.order == top.order) {
+				return;
+			}
+			std::pop_heap(std::begin(heap), std::end(heap), std::greater<>{});
+			heap.pop_back();
+		}
+	}
+
+	void dump_scheduler(std::ostream& f, scheduler const& events) {
+		auto w = [&](auto const& v) { f.write(reinterpret_cast<char const*>(&v), sizeof(v)); };
+
+		w(static_cast<uint32_t>(events.sources.size()));
+		for (auto const& s : events.sources) {
+			w(s.at);
+			w(s.order);
+		}
+	}
+
+	void restore_scheduler(std::istream& f, scheduler& events) {
+		auto r = [&](auto& v) { f.read(reinterpret_cast<char*>(&v), sizeof(v)); };
+
+		uint32_t count;
+		r(count);
+		if (count != events.sources.size()) {
+			throw std::runtime_error(
+			    fmt::format("cannot restore: {} event sources, expected {}", count, events.sources.size()));
+		}
+
+		// the sources keep their position in the scheduling order, so the
+		// events due at the same tick are dispatched in the same order
+		events.heap.clear();
+		events.scheduled = 0;
+		for (scheduler::event e = 0; e < count; e++) {
+			auto& s = events.sources[e];
+			r(s.at);
+			r(s.order);
+			events.scheduled = std::max(events.scheduled, s.order);
+			if (s.at != scheduler::never) {
+				events.heap.push_back({s.at, s.order, e});
+				events.cpu->stop_at(s.at);
+			}
+		}
+		std::make_heap(std::begin(events.heap), std::end(events.heap), std::greater<>{});
+	}
+}
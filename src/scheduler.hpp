@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace cpu {
+	class mips;
+}
+
+namespace psycris {
+	/**
+	 * \brief The board clock and the timed events of the devices
+	 *
+	 * The time is measured in cpu ticks. A device registers its event sources
+	 * once, with `add`, and then (re)schedules them as needed; every source
+	 * has at most one pending occurrence, scheduling it again moves it.
+	 *
+	 * The board runs the cpu in slices that end at the `next` event, then it
+	 * `dispatch`es the events that are due. When an event is scheduled while
+	 * the cpu is running, before the end of the current slice, the slice is
+	 * shortened accordingly (see `cpu::mips::stop_at`).
+	 *
+	 * The pending events are kept in a binary min-heap; moving or cancelling
+	 * an event leaves a stale entry in the heap, skipped when it surfaces.
+	 */
+	class scheduler {
+	  public:
+		using event = uint32_t;
+
+		// the handler receives the tick the event was scheduled for
+		using handler = std::function<void(uint64_t)>;
+
+		static constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
+
+	  public:
+		scheduler(cpu::mips&);
+
+		scheduler(scheduler const&) = delete;
+		scheduler& operator=(scheduler const&) = delete;
+
+	  public:
+		/**
+		 * \brief registers a new event source
+		 */
+		event add(std::string name, handler);
+
+		/**
+		 * \brief schedules `e` at the tick `at`
+		 *
+		 * An event scheduled in the past is dispatched as soon as the current
+		 * instruction completes.
+		 */
+		void schedule(event e, uint64_t at);
+
+		/**
+		 * \brief schedules `e` after `ticks` from now
+		 */
+		void schedule_in(event e, uint64_t ticks) { schedule(e, now() + ticks); }
+
+		void cancel(event e);
+
+		/**
+		 * \brief the tick `e` is scheduled for, `never` if it is not pending
+		 */
+		uint64_t when(event e) const;
+
+		std::string const& name(event e) const;
+
+	  public:
+		uint64_t now() const;
+
+		/**
+		 * \brief the tick of the first pending event, `never` if none
+		 */
+		uint64_t next();
+
+		/**
+		 * \brief runs the handlers of all the events due by now
+		 *
+		 * The events are dispatched in time order; the events scheduled for
+		 * the same tick are dispatched in the order they were scheduled.
+		 */
+		void dispatch();
+
+	  private:
+		struct source {
+			std::string name;
+			handler fn;
+			uint64_t at;
+			// identifies the last heap entry pushed for this source
+			uint64_t order;
+		};
+
+		struct entry {
+			uint64_t at;
+			uint64_t order;
+			event e;
+
+			bool operator>(entry const& o) const { return at != o.at ? at > o.at : order > o.order; }
+		};
+
+		void drop_stale();
+
+		friend void dump_scheduler(std::ostream&, scheduler const&);
+		friend void restore_scheduler(std::istream&, scheduler&);
+
+	  private:
+		cpu::mips* cpu;
+
+		std::vector<source> sources;
+		std::vector<entry> heap;
+
+		uint64_t scheduled;
+	};
+
+	/**
+	 * \brief Writes the pending events into the output stream
+	 *
+	 * The number of event sources (4 bytes) is followed, for every source in
+	 * the order they were added, by the tick it is scheduled for (`never` if
+	 * it is not pending) and its position in the scheduling order, 8 bytes
+	 * each.
+	 */
+	void dump_scheduler(std::ostream&, scheduler const&);
+
+	/**
+	 * \brief Schedules again the events saved by `dump_scheduler`
+	 *
+	 * The events are matched by their index, the scheduler must have the same
+	 * sources, added in the same order, as the one that was dumped. The ticks
+	 * are absolute, the cpu clock is expected to be restored too.
+	 */
+	void restore_scheduler(std::istream&, scheduler&);
+}
@@ -0,0 +1,190 @@
+#include "session.hpp"
+#include "cpu/profiler.hpp"
+#include "cpu/trace_recorder.hpp"
+#include "hw/bus_stats.hpp"
+#include "loader.hpp"
+#include "logging.hpp"
+
+#include <exception>
+#include <fstream>
+#include <memory>
+
+namespace {
+	using psycris::config;
+	using psycris::log;
+	using psycris::psx;
+
+	void dump(psx const& board) {
+		std::string filename = fmt::format("dump@{}", board.cpu.ticks());
+		log->info("saving the board dump on {}", filename);
+
+		std::ofstream dump_file(filename, std::ios::binary | std::ios_base::out | std::ios_base::trunc);
+		if (!dump_file) {
+			log->critical("cannot open the dump file for writing");
+			return;
+		}
+
+		psycris::dump_board(dump_file, board);
+	}
+
+	void write_profile(config const& cfg, cpu::profiler const& profiler) {
+		cpu::symbol_map symbols;
+		if (!cfg.symbols_file.empty()) {
+			std::ifstream f(cfg.symbols_file);
+			if (!f) {
+				log->error("cannot open the symbols file {}", cfg.symbols_file);
+			} else {
+				log->info("{} symbols loaded from {}", symbols.load(f), cfg.symbols_file);
+			}
+		}
+
+		auto write = [&](char const* ext, void (cpu::profiler::*report)(std::ostream&, cpu::symbol_map const&) const) {
+			std::string filename = cfg.profile_prefix + ext;
+			std::ofstream out(filename, std::ios_base::out | std::ios_base::trunc);
+			if (!out) {
+				log->error("cannot open the profile file {}", filename);
+				return;
+			}
+			(profiler.*report)(out, symbols);
+			log->info("profile written on {}", filename);
+		};
+		write(".pcs", &cpu::profiler::write_pcs);
+		write(".blocks", &cpu::profiler::write_blocks);
+		write(".folded", &cpu::profiler::write_folded);
+		write(".perf", &cpu::profiler::write_perf_script);
+	}
+
+	void write_bus_stats(config const& cfg, psycris::bus::access_stats const& stats) {
+		auto write = [&](char const* ext, auto report) {
+			std::string filename = cfg.bus_stats_prefix + ext;
+			std::ofstream out(filename, std::ios_base::out | std::ios_base::trunc);
+			if (!out) {
+				log->error("cannot open the bus stats file {}", filename);
+				return;
+			}
+			report(out);
+			log->info("bus stats written on {}", filename);
+		};
+		write(".txt", [&](std::ostream& out) { stats.write_report(out); });
+		write(".json", [&](std::ostream& out) { stats.write_json(out); });
+	}
+
+}
+
+namespace psycris {
+	int load_input(psx& board) {
+		config const& cfg = board.settings();
+
+		std::ifstream f(cfg.input_file, std::ios::binary | std::ios::in);
+		if (!f) {
+			log->critical("error opening {}", cfg.input_file);
+			return 1;
+		}
+
+		if (cfg.mode == cfg.bios) {
+			log->info("loading bios {}", cfg.input_file);
+			return psycris::load_bios(f, board.rom.memory()) ? 0 : 2;
+		}
+
+		log->info("restoring from {}", cfg.input_file);
+		try {
+			psycris::restore_board(f, board);
+		} catch (std::exception const& e) {
+			log->critical("cannot restore {}: {}", cfg.input_file, e.what());
+			return 1;
+		}
+		return 0;
+	}
+
+	int run_session(psx& board) {
+		log_scope scope{board.logger()};
+		config const& cfg = board.settings();
+
+		if (int status = load_input(board); status != 0) {
+			return status;
+		}
+
+		std::unique_ptr<cpu::trace_recorder> recorder;
+		if (!cfg.trace_file.empty()) {
+			recorder = cpu::trace_recorder::create(cfg.trace_file, board.cpu.ticks());
+			if (!recorder) {
+				return 1;
+			}
+			log->info("recording the trace on {}", cfg.trace_file);
+			board.cpu.record_to(recorder.get());
+		}
+
+		std::unique_ptr<cpu::profiler> profiler;
+		if (!cfg.profile_prefix.empty()) {
+			if (recorder) {
+				log->critical("the trace and the profile cannot be recorded together");
+				return 1;
+			}
+			profiler = std::make_unique<cpu::profiler>();
+			board.cpu.profile_with(profiler.get());
+		}
+
+		std::unique_ptr<bus::access_stats> bus_stats;
+		if (!cfg.bus_stats_prefix.empty()) {
+			bus_stats = std::make_unique<bus::access_stats>();
+			board.bus().collect_stats(bus_stats.get());
+		}
+
+		for (auto& w : cfg.watchpoints) {
+			uint8_t kinds = (w.read ? bus::access::read : 0) | (w.write ? bus::access::write : 0)
+			    | (w.execute ? bus::access::execute : 0);
+			board.cpu.watch({w.start, w.end}, kinds);
+		}
+
+		if (recorder) {
+			board.run(cfg.ticks, &cpu::mips::run<cpu::binary_trace>);
+		} else if (profiler) {
+			board.run(cfg.ticks, &cpu::mips::run<cpu::profile>);
+		} else if (cfg.engine == cfg.cached_interpreter) {
+			board.run(cfg.ticks, &cpu::mips::run_cached);
+		} else if (cfg.engine == cfg.recompiler) {
+			board.run(cfg.ticks, &cpu::mips::run_jit);
+		} else if (cfg.verbose) {
+			board.run(cfg.ticks, &cpu::mips::run<cpu::text_trace>);
+		} else {
+			board.run(cfg.ticks);
+		}
+
+		board.cpu.record_to(nullptr);
+		bool trace_complete = !recorder || recorder->finish();
+		recorder.reset();
+
+		if (profiler) {
+			board.cpu.profile_with(nullptr);
+			write_profile(cfg, *profiler);
+		}
+
+		if (bus_stats) {
+			board.bus().collect_stats(nullptr);
+			write_bus_stats(cfg, *bus_stats);
+		}
+
+		int status = board.cpu.halted();
+		if (auto& hit = board.cpu.stopped_by()) {
+			char const* kind = hit->kind == bus::access::read    ? "load"
+			                   : hit->kind == bus::access::write ? "store"
+			                                                     : "fetch";
+			log->info("watchpoint hit by a {} of {} bytes at {:0>8x} (clock={})",
+			          kind,
+			          hit->size,
+			          hit->addr,
+			          board.cpu.ticks());
+		} else if (status == 0) {
+			log->info("run out of ticks");
+		}
+
+		if (uint64_t idle = board.cpu.idle_ticks(); idle > 0) {
+			log->info("idle loops skipped {} ticks ({:.1f}% of the run)", idle, 100.0 * idle / board.cpu.ticks());
+		}
+
+		if (cfg.dump_on_exit) {
+			dump(board);
+		}
+		return trace_complete ? status : 1;
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "psx.hpp"
+
+namespace psycris {
+	/**
+	 * \brief loads the input file (a bios or a dump) of the board settings
+	 *
+	 * Returns 0 on success, 1 if the input cannot be loaded, 2 if the bios
+	 * is too short.
+	 */
+	int load_input(psx&);
+
+	/**
+	 * \brief runs a board as described by its settings
+	 *
+	 * The input file (a bios or a dump) is loaded, then the cpu runs for the
+	 * configured ticks with the configured engine, recording a trace or a
+	 * profile if requested; at the end the board is dumped if requested.
+	 *
+	 * Returns the exit status: 0 on success, the status of `load_input` if
+	 * the input cannot be loaded, the `halted` status of the cpu if it has
+	 * been halted.
+	 */
+	int run_session(psx&);
+}
@@ -0,0 +1,88 @@
+#include <catch2/catch.hpp>
+
+#include "batch.hpp"
+#include "psx.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+	// lui t0, 0x8000; loop: addiu t1, t1, 1; sw t1, 0(t0); j loop; nop
+	std::vector<uint32_t> counter() { return {0x3c088000, 0x25290001, 0xad090000, 0x0bf00001, 0}; }
+
+	// an unknown instruction
+	std::vector<uint32_t> broken() { return {0, 0xfc00'0000}; }
+
+	std::string read_log(std::string const& path) {
+		std::ifstream f(path);
+		std::ostringstream s;
+		s << f.rdbuf();
+		return s.str();
+	}
+
+	std::string write_bios(std::string const& name, std::vector<uint32_t> code) {
+		auto path = (std::filesystem::temp_directory_path() / name).string();
+		code.resize(psycris::hw::rom::size / sizeof(uint32_t));
+
+		std::ofstream f(path, std::ios::binary);
+		f.write(reinterpret_cast<char const*>(code.data()), code.size() * sizeof(uint32_t));
+		return path;
+	}
+}
+
+TEST_CASE("the job list", "[batch]") {
+	std::vector<psycris::batch_job> jobs;
+
+	SECTION("one job per line") {
+		std::istringstream list{"# a comment\nbios a.bin 100\n\nrestore dump@1 2000\n"};
+		REQUIRE(psycris::read_jobs(list, jobs));
+		REQUIRE(jobs.size() == 2);
+		REQUIRE(jobs[0].mode == psycris::config::bios);
+		REQUIRE(jobs[1].mode == psycris::config::restore);
+		REQUIRE(jobs[1].input_file == "dump@1");
+		REQUIRE(jobs[1].ticks == 2000);
+	}
+
+	SECTION("a malformed line") {
+		std::istringstream list{"bios a.bin\n"};
+		REQUIRE_FALSE(psycris::read_jobs(list, jobs));
+	}
+}
+
+TEST_CASE("the boards run in parallel", "[batch]") {
+	auto good = write_bios("psycris_counter.bin", counter());
+	auto bad = write_bios("psycris_broken.bin", broken());
+
+	std::vector<psycris::batch_job> jobs;
+	for (uint64_t ticks : {1000, 2000, 3000, 4000, 5000, 6000}) {
+		jobs.push_back({psycris::config::bios, good, ticks});
+	}
+	jobs.push_back({psycris::config::bios, bad, 1000});
+
+	auto prefix = (std::filesystem::temp_directory_path() / "psycris_batch.").string();
+	auto results = psycris::run_batch(jobs, psycris::config{}, 4, prefix);
+	std::filesystem::remove(good);
+	std::filesystem::remove(bad);
+
+	REQUIRE(results.size() == jobs.size());
+	std::vector<std::string> logs;
+	for (auto const& r : results) {
+		logs.push_back(read_log(r.log_file));
+		std::filesystem::remove(r.log_file);
+	}
+	REQUIRE(results[1].log_file == prefix + "1.log");
+
+	for (size_t ix = 0; ix + 1 < jobs.size(); ix++) {
+		INFO("job " << ix);
+		REQUIRE(results[ix].status == 0);
+		REQUIRE(results[ix].ticks == jobs[ix].ticks);
+		REQUIRE(logs[ix].find("run out of ticks") != std::string::npos);
+	}
+
+	// an unimplemented instruction halts its own board only
+	auto const& halted = results.back();
+	REQUIRE(halted.status == 99);
+	REQUIRE(halted.ticks == 3);
+	REQUIRE(logs.back().find("unimplemented instruction") != std::string::npos);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "psx.hpp"
+#include <cstdint>
+
+/**
+ * \brief The board used by the device tests.
+ *
+ * Every test file derives its own fixture from `psycris::test::board` and adds
+ * only the setup of the device it tests.
+ */
+namespace psycris::test {
+	struct board : psx {
+		/**
+		 * \brief reads the word at `addr` through the bus
+		 */
+		uint32_t read(uint32_t addr) { return bus().read<uint32_t>(addr); }
+
+		/**
+		 * \brief writes `value` at `addr` through the bus
+		 */
+		void write(uint32_t addr, uint32_t value) { bus().write(addr, value); }
+	};
+}
@@ -1,7 +1,14 @@
 #include <catch2/catch.hpp>
 
 #include "hw/bus.hpp"
+#include "hw/bus_stats.hpp"
+#include "hw/fastmem.hpp"
 #include "hw/mmap_device.hpp"
+#include "hw/static_bus.hpp"
+#include "logging.hpp"
+
+#include <spdlog/sinks/ostream_sink.h>
+#include <sstream>
 
 namespace {
 	namespace hw = psycris::hw;
@@ -12,6 +19,8 @@ namespace {
 	using reg4 = hw::data_reg<8>;
 
 	struct controller : hw::mmap_device<controller, 12> {
+		static constexpr char const* device_name = "controller";
+
 		controller(gsl::span<uint8_t, size> buffer) : mmap_device{buffer, reg1{}, reg2{}, reg3{}, reg4{}} {}
 
 		struct logged_value {
@@ -22,7 +31,7 @@ namespace {
 		void wcb(reg1, uint32_t value, uint32_t old_value) { writes[0].push_back({value, old_value}); }
 		void wcb(reg2, uint32_t value, uint32_t old_value) { writes[1].push_back({value, old_value}); }
 		void wcb(reg3, uint32_t value, uint32_t old_value) { writes[2].push_back({value, old_value}); }
-		void wcb(reg4, uint32_t value, uint32_t old_value) { writes[4].push_back({value, old_value}); }
+		void wcb(reg4, uint32_t value, uint32_t old_value) { writes[3].push_back({value, old_value}); }
 
 		std::array<std::vector<logged_value>, 4> writes = {};
 	};
@@ -163,4 +172,605 @@ TEST_CASE("data_bus write operations", "[bus]") {
 			REQUIRE(logged.old == 0xaa01);
 		}
 	}
-}
\ No newline at end of file
+}
+namespace {
+	struct big_ram : hw::mmap_device<big_ram, 128 * 1024> {
+		static constexpr char const* device_name = "big ram";
+
+		big_ram(gsl::span<uint8_t, size> buffer) : mmap_device{buffer} {}
+	};
+}
+
+TEST_CASE("data_bus memory pages", "[bus]") {
+	std::vector<uint8_t> memory(big_ram::size + controller::size);
+	big_ram ram{{memory.data(), big_ram::size}};
+	controller ctrl{{memory.data() + big_ram::size, controller::size}};
+
+	psycris::bus::data_bus bus;
+	// a page aligned mapping, a mapping that covers its pages only partially
+	// and a device with data ports mapped over a memory page.
+	bus.connect(0x8000'0000, ram);
+	bus.connect(0x0000'8000, ram);
+	bus.connect(0x8001'0000, ctrl);
+
+	SECTION("a write is visible from every mapping of the same device") {
+		bus.write(0x8000'8010, static_cast<uint32_t>(0xdead'beef));
+		REQUIRE(bus.read<uint32_t>(0x0001'0010) == 0xdead'beef);
+
+		bus.write(0x0001'0020, static_cast<uint16_t>(0xcafe));
+		REQUIRE(bus.read<uint16_t>(0x8000'8020) == 0xcafe);
+	}
+
+	SECTION("an access that spans two pages is handled") {
+		bus.write(0x8000'fffe, static_cast<uint32_t>(0x0403'0201));
+		REQUIRE(bus.read<uint8_t>(0x8000'ffff) == 0x02);
+		REQUIRE(bus.read<uint8_t>(0x8001'0000) == 0x03);
+		REQUIRE(bus.read<uint32_t>(0x8000'fffe) == 0x0403'0201);
+	}
+
+	SECTION("the first mapping takes precedence over the following ones") {
+		bus.write(0x8001'0000, static_cast<uint32_t>(0x1234'5678));
+		REQUIRE(ctrl.writes[0].empty());
+		REQUIRE(memory[big_ram::size] == 0x00);
+	}
+}
+
+TEST_CASE("the fastmem mirrors the memory pages", "[bus]") {
+	if (!psycris::bus::fastmem::available()) {
+		return;
+	}
+	psycris::bus::shared_memory memory{big_ram::size, true};
+	big_ram ram{{memory.data(), big_ram::size}};
+
+	psycris::bus::data_bus bus;
+	bus.connect(0x8000'0000, ram);
+	psycris::bus::fastmem view{memory};
+	bus.mirror_to(&view);
+	// a mapping added later is mirrored too
+	bus.connect(0xa000'0000, ram);
+
+	auto load = [&](uint32_t addr) {
+		uint32_t v;
+		std::memcpy(&v, view.base() + addr, sizeof(v));
+		return v;
+	};
+
+	SECTION("every mapping shares the same host memory") {
+		bus.write(0x8001'0010, static_cast<uint32_t>(0xdead'beef));
+		REQUIRE(load(0x8001'0010) == 0xdead'beef);
+		REQUIRE(load(0xa001'0010) == 0xdead'beef);
+
+		uint32_t v = 0xcafe'babe;
+		std::memcpy(view.base() + 0xa000'0020, &v, sizeof(v));
+		REQUIRE(bus.read<uint32_t>(0x8000'0020) == 0xcafe'babe);
+	}
+
+	SECTION("the fastmem is not needed by the bus") {
+		bus.mirror_to(nullptr);
+		bus.write(0x8000'0010, static_cast<uint32_t>(1));
+		REQUIRE(load(0xa000'0010) == 1);
+	}
+}
+
+namespace {
+	// a device that lists its data ports in the type
+	struct listed_ports : hw::mmap_device<listed_ports, 8> {
+		using data_ports = std::tuple<reg1, reg2>;
+
+		listed_ports(gsl::span<uint8_t, size> buffer) : mmap_device{buffer} {}
+
+		void wcb(reg2, uint32_t value, uint32_t old_value) { writes.push_back({value, old_value}); }
+
+		std::vector<controller::logged_value> writes;
+	};
+}
+
+TEST_CASE("static_bus dispatch", "[bus]") {
+	test_board board;
+	std::array<uint8_t, listed_ports::size> listed_memory = {};
+	listed_ports listed{listed_memory};
+
+	using layout = std::tuple<controller, ram, listed_ports>;
+	using map = std::tuple<psycris::bus::mapping<controller, 0x3000'0000, 0x3000'000b>,
+	                       psycris::bus::mapping<ram, 0x3000'0010, 0x3000'0019>,
+	                       psycris::bus::mapping<listed_ports, 0x3000'0020, 0x3000'0027>>;
+	psycris::bus::static_bus<layout, map> io{board.ctrl, board.buffer, listed};
+
+	SECTION("the accesses are dispatched to the mapped device") {
+		REQUIRE(io.read<uint32_t>(0x3000'0000) == 0x0302'0100);
+		REQUIRE(io.read<uint16_t>(0x3000'0010) == 0x0d0c);
+
+		io.write(0x3000'0012, static_cast<uint16_t>(0xbeef));
+		REQUIRE(board.buffer.memory()[2] == 0xef);
+	}
+
+	SECTION("an unmapped location reads as the 'open_bus' constant") {
+		REQUIRE(io.read<uint32_t>(0x3000'000c) == 0xffff'ffff);
+		io.write(0x3000'000c, static_cast<uint32_t>(0));
+	}
+
+	SECTION("the device is informed for every port written") {
+		io.write(0x3000'0003, static_cast<uint32_t>(0xdead'beef));
+
+		REQUIRE(board.ctrl.writes[0].back().curr == 0xef02'0100);
+		REQUIRE(board.ctrl.writes[0].back().old == 0x0302'0100);
+		REQUIRE(board.ctrl.writes[1].back().curr == 0xadbe);
+		REQUIRE(board.ctrl.writes[1].back().old == 0x0504);
+		REQUIRE(board.ctrl.writes[2].back().curr == 0x07de);
+		REQUIRE(board.ctrl.writes[2].back().old == 0x0706);
+	}
+
+	SECTION("the ports listed in the device type are notified as well") {
+		io.write(0x3000'0022, static_cast<uint32_t>(0x1234'5678));
+		io.write(0x3000'0020, static_cast<uint8_t>(0xff));
+
+		REQUIRE(listed.writes.size() == 1);
+		REQUIRE(listed.writes[0].curr == 0x1234);
+		REQUIRE(listed.writes[0].old == 0);
+	}
+
+	SECTION("a data_bus routes the accesses outside its pages") {
+		psycris::bus::data_bus bus;
+		io.connect(bus);
+
+		bus.write(0x3000'0024, static_cast<uint16_t>(0xcafe));
+		REQUIRE(listed.writes.back().curr == 0xcafe);
+		REQUIRE(bus.read<uint8_t>(0x3000'0011) == 0x0d);
+		REQUIRE(bus.read<uint32_t>(0x3000'0028) == 0xffff'ffff);
+	}
+}
+
+namespace {
+	// a device with a counter computed when it is read
+	struct timer : hw::mmap_device<timer, 8> {
+		timer(gsl::span<uint8_t, size> buffer) : mmap_device{buffer, reg1{}, reg2{}} {}
+
+		void rcb(reg1) {
+			write<reg1>(now);
+			reads++;
+		}
+
+		uint32_t now = 0;
+		int reads = 0;
+	};
+
+	// the same device, with the ports listed in the type
+	struct listed_timer : hw::mmap_device<listed_timer, 8> {
+		using data_ports = std::tuple<reg1, reg2>;
+
+		listed_timer(gsl::span<uint8_t, size> buffer) : mmap_device{buffer} {}
+
+		void rcb(reg1) {
+			write<reg1>(now);
+			reads++;
+		}
+
+		uint32_t now = 0;
+		int reads = 0;
+	};
+}
+
+TEST_CASE("lazy data ports", "[bus]") {
+	std::array<uint8_t, timer::size + listed_timer::size + controller::size> memory = {};
+	timer dynamic{gsl::span<uint8_t, timer::size>{memory.data(), timer::size}};
+	listed_timer listed{gsl::span<uint8_t, listed_timer::size>{memory.data() + 8, listed_timer::size}};
+	controller ctrl{gsl::span<uint8_t, controller::size>{memory.data() + 16, controller::size}};
+
+	REQUIRE(dynamic.has_lazy_ports());
+	REQUIRE(listed.has_lazy_ports());
+	REQUIRE_FALSE(ctrl.has_lazy_ports());
+
+	using layout = std::tuple<timer, listed_timer, controller>;
+	using map = std::tuple<psycris::bus::mapping<timer, 0x1000'0000, 0x1000'0007>,
+	                       psycris::bus::mapping<listed_timer, 0x1000'0010, 0x1000'0017>,
+	                       psycris::bus::mapping<controller, 0x1000'0020, 0x1000'002b>>;
+	psycris::bus::static_bus<layout, map> io{dynamic, listed, ctrl};
+
+	psycris::bus::data_bus dynamic_bus;
+	dynamic_bus.connect({0x1000'0000, 0x1000'0007}, dynamic);
+	dynamic_bus.connect({0x1000'0010, 0x1000'0017}, listed);
+	dynamic_bus.connect({0x1000'0020, 0x1000'002b}, ctrl);
+
+	psycris::bus::data_bus routed_bus;
+	io.connect(routed_bus);
+
+	std::string bus = GENERATE(as<std::string>{}, "dynamic", "static", "routed");
+	auto read = [&](uint32_t addr) {
+		if (bus == "dynamic") {
+			return dynamic_bus.read<uint16_t>(addr);
+		}
+		if (bus == "static") {
+			return io.read<uint16_t>(addr);
+		}
+		return routed_bus.read<uint16_t>(addr);
+	};
+	INFO(bus);
+
+	SECTION("a port is computed before every read that touches it") {
+		dynamic.now = listed.now = 0x1234;
+		REQUIRE(read(0x1000'0000) == 0x1234);
+		REQUIRE(read(0x1000'0010) == 0x1234);
+
+		dynamic.now = listed.now = 0x5678;
+		REQUIRE(read(0x1000'0002) == 0);
+		REQUIRE(read(0x1000'0012) == 0);
+		REQUIRE(read(0x1000'0000) == 0x5678);
+		REQUIRE(read(0x1000'0010) == 0x5678);
+	}
+
+	SECTION("the other ports are not computed") {
+		REQUIRE(read(0x1000'0004) == 0);
+		REQUIRE(read(0x1000'0014) == 0);
+		REQUIRE(dynamic.reads == 0);
+		REQUIRE(listed.reads == 0);
+	}
+
+	SECTION("a device without read callbacks is read as memory") {
+		REQUIRE(read(0x1000'0020) == 0);
+		REQUIRE(ctrl.writes[0].empty());
+	}
+}
+
+TEST_CASE("data_bus block transfers", "[bus]") {
+	std::vector<uint8_t> memory(big_ram::size + controller::size + ram::size);
+	big_ram paged{{memory.data(), big_ram::size}};
+	controller ctrl{{memory.data() + big_ram::size, controller::size}};
+	ram buffer{{memory.data() + big_ram::size + controller::size, ram::size}};
+
+	// the controller is followed by a plain device outside the memory pages
+	psycris::bus::data_bus bus;
+	bus.connect({0x8000'0000, 0x8001'ffff}, paged);
+	bus.connect({0x1000'0000, 0x1000'000b}, ctrl);
+	bus.connect({0x1000'000c, 0x1000'0015}, buffer);
+
+	std::vector<uint8_t> data(0x30);
+	for (size_t ix = 0; ix < data.size(); ix++) {
+		data[ix] = static_cast<uint8_t>(0x80 + ix);
+	}
+
+	SECTION("a block can span the memory pages") {
+		bus.write_block(0x8000'fff0, data);
+		REQUIRE(bus.read<uint32_t>(0x8000'fff0) == 0x8382'8180);
+		REQUIRE(bus.read<uint32_t>(0x8001'0000) == 0x9392'9190);
+
+		std::vector<uint8_t> out(data.size());
+		bus.read_block(0x8000'fff0, out);
+		REQUIRE(out == data);
+	}
+
+	SECTION("a block can span several devices") {
+		std::vector<uint8_t> out(0x18);
+		bus.read_block(0x1000'0000, out);
+		REQUIRE(out[0] == memory[big_ram::size]);
+		REQUIRE(out[0x15] == memory[big_ram::size + 0x15]);
+		// past the end of the last device
+		REQUIRE(out[0x16] == 0xff);
+		REQUIRE(out[0x17] == 0xff);
+	}
+
+	SECTION("the data ports are notified once per word written") {
+		bus.write_block(0x1000'0002, gsl::span<uint8_t const>{data.data(), 14});
+
+		REQUIRE(ctrl.writes[0].size() == 1);
+		REQUIRE(ctrl.writes[0].back().curr == 0x8180'0000);
+		REQUIRE(ctrl.writes[1].size() == 1);
+		REQUIRE(ctrl.writes[1].back().curr == 0x8382);
+		REQUIRE(ctrl.writes[2].size() == 1);
+		REQUIRE(ctrl.writes[2].back().curr == 0x8584);
+		REQUIRE(ctrl.writes[3].size() == 1);
+		REQUIRE(ctrl.writes[3].back().curr == 0x8988'8786);
+		REQUIRE(bus.read<uint32_t>(0x1000'000c) == 0x8d8c'8b8a);
+	}
+
+	SECTION("a copy moves the bytes between any two ranges") {
+		bus.write_block(0x8000'0100, data);
+
+		bus.copy(0x8001'fff8, 0x8000'0100, 8);
+		REQUIRE(bus.read<uint32_t>(0x8001'fffc) == 0x8786'8584);
+
+		bus.copy(0x1000'000c, 0x8000'0100, 8);
+		REQUIRE(bus.read<uint32_t>(0x1000'0010) == 0x8786'8584);
+
+		bus.copy(0x8000'0200, 0x1000'000c, 8);
+		REQUIRE(bus.read<uint32_t>(0x8000'0200) == 0x8382'8180);
+	}
+
+	SECTION("the static_bus serves the plain memory devices") {
+		using layout = std::tuple<controller, ram>;
+		using map = std::tuple<psycris::bus::mapping<controller, 0x1000'0000, 0x1000'000b>,
+		                       psycris::bus::mapping<ram, 0x1000'000c, 0x1000'0015>>;
+		psycris::bus::static_bus<layout, map> io{ctrl, buffer};
+		io.connect(bus);
+
+		REQUIRE(io.plain_memory(0x1000'0000).empty());
+		REQUIRE(io.plain_memory(0x1000'000e).size() == 8);
+
+		bus.write_block(0x1000'0008, gsl::span<uint8_t const>{data.data(), 8});
+		REQUIRE(ctrl.writes[3].back().curr == 0x8382'8180);
+		REQUIRE(bus.read<uint32_t>(0x1000'000c) == 0x8786'8584);
+	}
+}
+
+TEST_CASE("the unmapped accesses", "[bus]") {
+	using psycris::bus::guess_io_port;
+
+	SECTION("the I/O ports are described in every segment") {
+		REQUIRE(guess_io_port(0x1f80'1070) == "I_STAT - Interrupt status register");
+		REQUIRE(guess_io_port(0xbf80'1074) == "I_MASK - Interrupt mask register");
+		REQUIRE(guess_io_port(0x1f80'1dfc) == "vIN    Reverb Input Volume Left/Right");
+		REQUIRE(guess_io_port(0x1f80'1000) == "Expansion 1 Base Address (usually 1F000000h)");
+	}
+
+	SECTION("a port can cover a range of addresses") {
+		REQUIRE(guess_io_port(0x1f80'1088) == "DMA0 channel 0 - MDECin");
+		REQUIRE(guess_io_port(0x1f80'10ef) == "DMA6 channel 6 - OTC (reverse clear OT) (GPU related)");
+		REQUIRE(guess_io_port(0x1f80'1130).empty());
+	}
+
+	SECTION("between the ports at the same address the first one wins") {
+		REQUIRE(guess_io_port(0x1f80'1810) == "GP0 Send GP0 Commands/Packets (Rendering and VRAM Access)");
+	}
+
+	SECTION("the unknown ports have no description") {
+		REQUIRE(guess_io_port(0).empty());
+		REQUIRE(guess_io_port(0x1f80'1002).empty());
+		REQUIRE(guess_io_port(0x1fff'ffff).empty());
+	}
+
+	SECTION("only the first access to an address is logged right away") {
+		std::ostringstream out;
+		auto sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(out);
+		sink->set_pattern("%v");
+		psycris::log_scope scope{std::make_shared<spdlog::logger>("test", sink)};
+
+		psycris::bus::data_bus bus;
+		for (int i = 0; i < 100; i++) {
+			bus.read<uint32_t>(0x1f80'1040);
+		}
+		bus.write(0x1f80'1040, static_cast<uint16_t>(1));
+		bus.write(0x1f80'1050, static_cast<uint8_t>(2));
+		REQUIRE(out.str()
+		        == "[BUS] unmapped read of 4 bytes at 1f801040 (JOY_DATA Joypad/Memory Card Data (R/W))\n"
+		           "[BUS] unmapped write of 1 bytes at 1f801050 (00000002) (SIO_DATA Serial Port Data (R/W))\n");
+
+		out.str("");
+		bus.unmapped().report();
+		REQUIRE(out.str()
+		        == "[BUS] 99 unmapped reads and 1 writes at 1f801040 (JOY_DATA Joypad/Memory Card Data (R/W))\n");
+
+		out.str("");
+		bus.unmapped().report();
+		REQUIRE(out.str().empty());
+	}
+}
+
+namespace {
+	struct page_observer : psycris::bus::write_observer {
+		void written(uint8_t const*, size_t size) override { bytes += size; }
+
+		size_t bytes = 0;
+	};
+}
+
+TEST_CASE("bus access stats", "[bus]") {
+	std::vector<uint8_t> memory(big_ram::size + controller::size);
+	big_ram ram{{memory.data(), big_ram::size}};
+	controller ctrl{{memory.data() + big_ram::size, controller::size}};
+
+	psycris::bus::data_bus bus;
+	bus.connect(0x8000'0000, ram);
+	bus.connect(0x0000'0000, ram);
+	bus.connect(0x1f80'1070, ctrl);
+
+	psycris::bus::access_stats stats;
+	bus.collect_stats(&stats);
+
+	SECTION("the accesses are counted per device and per access size") {
+		bus.write(0x8000'0000, static_cast<uint32_t>(1));
+		bus.write(0x8000'0004, static_cast<uint8_t>(2));
+		REQUIRE(bus.read<uint16_t>(0x0000'0004) == 2);
+		bus.read<uint32_t>(0x1f80'1070);
+		bus.read<uint32_t>(0x1f80'2000);
+
+		auto& devices = stats.by_device();
+		REQUIRE(devices.size() == 3);
+		REQUIRE(devices.at("big ram").writes == std::array<uint64_t, 3>{1, 0, 1});
+		REQUIRE(devices.at("big ram").reads == std::array<uint64_t, 3>{0, 1, 0});
+		REQUIRE(devices.at("controller").total_reads() == 1);
+		REQUIRE(devices.at("unmapped").total_reads() == 1);
+	}
+
+	SECTION("the mirrors of a memory page are counted together") {
+		bus.read<uint32_t>(0x8000'1000);
+		bus.read<uint32_t>(0x0000'1ffc);
+		bus.read<uint32_t>(0x8000'2000);
+
+		auto& pages = stats.by_page();
+		REQUIRE(pages.size() == 2);
+		REQUIRE(pages.at(0x1000).accesses.total_reads() == 2);
+		REQUIRE(pages.at(0x1000).device == "big ram");
+		REQUIRE(pages.at(0x2000).accesses.total_reads() == 1);
+	}
+
+	SECTION("an access is counted on every data port it touches") {
+		bus.write(0x1f80'1073, static_cast<uint32_t>(0xdead'beef));
+		bus.read<uint16_t>(0x1f80'1074);
+
+		auto& ports = stats.by_port();
+		REQUIRE(ports.size() == 3);
+		REQUIRE(ports.at({"controller", 0}).accesses.writes[2] == 1);
+		REQUIRE(ports.at({"controller", 4}).accesses.total() == 2);
+		REQUIRE(ports.at({"controller", 4}).addr == 0x1f80'1074);
+		REQUIRE(ports.at({"controller", 6}).accesses.total_writes() == 1);
+		REQUIRE(ctrl.writes[2].size() == 1);
+	}
+
+	SECTION("the block transfers are counted a word at a time") {
+		bus.copy(0x8000'2000, 0x8000'1000, 16);
+
+		auto& pages = stats.by_page();
+		REQUIRE(pages.at(0x1000).accesses.reads[2] == 4);
+		REQUIRE(pages.at(0x2000).accesses.writes[2] == 4);
+	}
+
+	SECTION("the watched pages are still notified") {
+		page_observer observer;
+		bus.watch_writes(bus.host_page(0x8000'0000).data(), observer);
+
+		bus.write(0x0000'0010, static_cast<uint16_t>(1));
+		bus.write(0x8001'0010, static_cast<uint16_t>(1));
+		REQUIRE(observer.bytes == 2);
+	}
+
+	SECTION("the report lists every counter") {
+		bus.write(0x1f80'1074, static_cast<uint16_t>(1));
+		bus.read<uint8_t>(0x0000'0010);
+
+		std::ostringstream json;
+		stats.write_json(json);
+		REQUIRE(json.str()
+		        == "{\n"
+		           "  \"devices\": [\n"
+		           "    {\"name\": \"big ram\", \"reads\": [1, 0, 0], \"writes\": [0, 0, 0]},\n"
+		           "    {\"name\": \"controller\", \"reads\": [0, 0, 0], \"writes\": [0, 1, 0]}\n"
+		           "  ],\n"
+		           "  \"ports\": [\n"
+		           "    {\"device\": \"controller\", \"offset\": 4, \"address\": 528486516, \"description\": "
+		           "\"I_MASK - Interrupt mask register\", \"reads\": [0, 0, 0], \"writes\": [0, 1, 0]}\n"
+		           "  ],\n"
+		           "  \"pages\": [\n"
+		           "    {\"address\": 0, \"device\": \"big ram\", \"reads\": [1, 0, 0], \"writes\": [0, 0, 0]}\n"
+		           "  ]\n"
+		           "}\n");
+
+		std::ostringstream report;
+		stats.write_report(report);
+		REQUIRE(report.str().find("controller +4 (I_MASK - Interrupt mask register)") != std::string::npos);
+	}
+
+	SECTION("the accesses are no longer counted when the collection stops") {
+		bus.collect_stats(nullptr);
+		bus.write(0x8000'0000, static_cast<uint32_t>(0xcafe));
+		REQUIRE(bus.read<uint32_t>(0x0000'0000) == 0xcafe);
+		REQUIRE(stats.by_device().empty());
+	}
+}
+
+namespace {
+	struct watch_log : psycris::bus::watch_listener {
+		struct entry {
+			uint32_t id;
+			uint32_t addr;
+			uint8_t size;
+			psycris::bus::access::kind kind;
+
+			bool operator==(entry const& o) const {
+				return id == o.id && addr == o.addr && size == o.size && kind == o.kind;
+			}
+		};
+
+		void hit(uint32_t id, uint32_t addr, uint8_t size, psycris::bus::access::kind kind) override {
+			hits.push_back({id, addr, size, kind});
+		}
+
+		std::vector<entry> hits;
+	};
+}
+
+TEST_CASE("data_bus watchpoints", "[bus]") {
+	using psycris::bus::access;
+
+	std::vector<uint8_t> memory(big_ram::size + controller::size);
+	big_ram ram{{memory.data(), big_ram::size}};
+	controller ctrl{{memory.data() + big_ram::size, controller::size}};
+
+	psycris::bus::data_bus bus;
+	bus.connect(0x8000'0000, ram);
+	bus.connect(0x0000'0000, ram);
+	bus.connect(0x1f80'1070, ctrl);
+
+	watch_log log;
+
+	SECTION("only the watched kinds of access to the range are notified") {
+		uint32_t id = bus.watch({0x8000'0100, 0x8000'0103}, access::read, log);
+		bus.write(0x8000'0100, static_cast<uint32_t>(0xcafe));
+		REQUIRE(bus.read<uint32_t>(0x8000'0104) == 0);
+		REQUIRE(bus.read<uint32_t>(0x0000'0100) == 0xcafe);
+		REQUIRE(log.hits.empty());
+
+		REQUIRE(bus.read<uint16_t>(0x8000'0102) == 0);
+		REQUIRE(bus.read<uint32_t>(0x8000'00fe) == 0xcafe'0000);
+		REQUIRE(log.hits == std::vector<watch_log::entry>{{id, 0x8000'0102, 2, access::read},
+		                                                  {id, 0x8000'00fe, 4, access::read}});
+	}
+
+	SECTION("a watched write still reaches the write observers") {
+		page_observer observer;
+		bus.watch_writes(bus.host_page(0x8000'0000).data(), observer);
+		uint32_t id = bus.watch({0x8000'0010, 0x8000'0010}, access::write, log);
+
+		bus.write(0x0000'0010, static_cast<uint8_t>(1));
+		bus.write(0x8000'0010, static_cast<uint8_t>(2));
+		REQUIRE(observer.bytes == 2);
+		REQUIRE(bus.read<uint8_t>(0x0000'0010) == 2);
+		REQUIRE(log.hits == std::vector<watch_log::entry>{{id, 0x8000'0010, 1, access::write}});
+	}
+
+	SECTION("the instruction fetches are watched apart from the reads") {
+		uint32_t id = bus.watch({0x8000'0200, 0x8000'0203}, access::execute, log);
+		REQUIRE(bus.code_page(0x8000'0000).empty());
+		REQUIRE(!bus.code_page(0x0000'0000).empty());
+		REQUIRE(!bus.host_page(0x8000'0000).empty());
+
+		bus.read<uint32_t>(0x8000'0200);
+		bus.fetch(0x8000'0204);
+		REQUIRE(log.hits.empty());
+		bus.fetch(0x8000'0200);
+		REQUIRE(log.hits == std::vector<watch_log::entry>{{id, 0x8000'0200, 4, access::execute}});
+	}
+
+	SECTION("the block transfers are checked a word at a time") {
+		uint32_t id = bus.watch({0x8000'2008, 0x8000'200b}, access::write, log);
+		bus.copy(0x8000'2000, 0x8000'1000, 16);
+		REQUIRE(log.hits == std::vector<watch_log::entry>{{id, 0x8000'2008, 4, access::write}});
+	}
+
+	SECTION("the accesses outside the memory pages are watched") {
+		uint32_t id = bus.watch({0x1f80'1074, 0x1f80'1077}, access::read | access::write, log);
+		bus.write(0x1f80'1070, static_cast<uint16_t>(1));
+		bus.write(0x1f80'1074, static_cast<uint16_t>(1));
+		REQUIRE(ctrl.writes[1].size() == 1);
+		bus.read<uint8_t>(0x1f80'1077);
+		REQUIRE(log.hits == std::vector<watch_log::entry>{{id, 0x1f80'1074, 2, access::write},
+		                                                  {id, 0x1f80'1077, 1, access::read}});
+	}
+
+	SECTION("a removed watchpoint leaves the others in place") {
+		uint32_t first = bus.watch({0x8000'0000, 0x8000'00ff}, access::write, log);
+		uint32_t second = bus.watch({0x8000'0100, 0x8000'01ff}, access::write, log);
+		bus.unwatch(first);
+
+		bus.write(0x8000'0000, static_cast<uint32_t>(1));
+		bus.write(0x8000'0100, static_cast<uint32_t>(1));
+		REQUIRE(log.hits == std::vector<watch_log::entry>{{second, 0x8000'0100, 4, access::write}});
+
+		bus.unwatch(second);
+		REQUIRE(!bus.code_page(0x8000'0000).empty());
+		bus.write(0x8000'0100, static_cast<uint32_t>(2));
+		REQUIRE(bus.read<uint32_t>(0x0000'0100) == 2);
+		REQUIRE(log.hits.size() == 1);
+	}
+
+	SECTION("the watchpoints and the stats work together") {
+		psycris::bus::access_stats stats;
+		bus.collect_stats(&stats);
+		uint32_t id = bus.watch({0x8000'0000, 0x8000'0003}, access::read, log);
+		bus.read<uint32_t>(0x8000'0000);
+		bus.collect_stats(nullptr);
+		bus.read<uint32_t>(0x8000'0000);
+
+		REQUIRE(stats.by_device().at("big ram").total_reads() == 1);
+		REQUIRE(log.hits.size() == 2);
+		REQUIRE(log.hits[1].id == id);
+	}
+}
@@ -0,0 +1,856 @@
+#include <catch2/catch.hpp>
+
+#include "cpu/disassembly.hpp"
+#include "cpu/profiler.hpp"
+#include "cpu/trace_recorder.hpp"
+#include "lockstep.hpp"
+#include "psx.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+	// clang-format off
+	enum reg : uint32_t { zero = 0, v0 = 2, t0 = 8, t1, t2, t3, t4, t5, t6, ra = 31 };
+
+	uint32_t i_type(uint32_t op, uint32_t rs, uint32_t rt, uint32_t imm) { return op << 26 | rs << 21 | rt << 16 | (imm & 0xffff); }
+	uint32_t r_type(uint32_t funct, uint32_t rs, uint32_t rt, uint32_t rd) { return rs << 21 | rt << 16 | rd << 11 | funct; }
+
+	uint32_t lui(reg rt, uint32_t imm) { return i_type(0x0f, 0, rt, imm); }
+	uint32_t ori(reg rt, reg rs, uint32_t imm) { return i_type(0x0d, rs, rt, imm); }
+	uint32_t andi(reg rt, reg rs, uint32_t imm) { return i_type(0x0c, rs, rt, imm); }
+	uint32_t addiu(reg rt, reg rs, int32_t imm) { return i_type(0x09, rs, rt, imm); }
+	uint32_t sw(reg rt, int32_t offset, reg base) { return i_type(0x2b, base, rt, offset); }
+	uint32_t lw(reg rt, int32_t offset, reg base) { return i_type(0x23, base, rt, offset); }
+	uint32_t beq(reg rs, reg rt, int32_t offset) { return i_type(0x04, rs, rt, offset); }
+	uint32_t bne(reg rs, reg rt, int32_t offset) { return i_type(0x05, rs, rt, offset); }
+	uint32_t addu(reg rd, reg rs, reg rt) { return r_type(0x21, rs, rt, rd); }
+	uint32_t jr(reg rs) { return r_type(0x08, rs, 0, 0); }
+	uint32_t jalr(reg rd, reg rs) { return r_type(0x09, rs, 0, rd); }
+	uint32_t j(uint32_t target) { return 0x02 << 26 | ((target >> 2) & 0x3ff'ffff); }
+	uint32_t mfc0(reg rt, uint32_t rd) { return 0x10 << 26 | 0x00 << 21 | rt << 16 | rd << 11; }
+	uint32_t mtc0(reg rt, uint32_t rd) { return 0x10 << 26 | 0x04 << 21 | rt << 16 | rd << 11; }
+	constexpr uint32_t nop = 0;
+	constexpr uint32_t rfe = 0x4200'0010;
+	// clang-format on
+
+	// A program that runs a loop, then copies a routine into the RAM and
+	// calls it twice, patching it between the two calls.
+	std::vector<uint32_t> program() {
+		uint32_t inc1 = addiu(v0, v0, 1);
+		uint32_t inc16 = addiu(v0, v0, 16);
+		uint32_t ret = jr(ra);
+
+		return {
+		    lui(t0, 0x8000),
+		    ori(t1, zero, 100),
+		    addu(t2, zero, zero),
+		    // loop:
+		    addu(t2, t2, t1),
+		    sw(t2, 0x100, t0),
+		    addiu(t1, t1, -1),
+		    bne(t1, zero, -4),
+		    addiu(t3, t3, 1),
+		    // copy the routine
+		    lui(t4, inc1 >> 16),
+		    ori(t4, t4, inc1 & 0xffff),
+		    sw(t4, 0x200, t0),
+		    lui(t5, ret >> 16),
+		    ori(t5, t5, ret & 0xffff),
+		    sw(t5, 0x204, t0),
+		    sw(zero, 0x208, t0),
+		    ori(t6, t0, 0x200),
+		    jalr(ra, t6),
+		    nop,
+		    // patch and call it again
+		    lui(t4, inc16 >> 16),
+		    ori(t4, t4, inc16 & 0xffff),
+		    sw(t4, 0x200, t0),
+		    jalr(ra, t6),
+		    nop,
+		    lw(t1, 0x100, t0),
+		    // idle:
+		    j(0x1fc0'0000 + 24 * 4),
+		    nop,
+		};
+	}
+
+	// A program that polls I_MASK until it is not zero.
+	std::vector<uint32_t> polling() {
+		return {
+		    lui(t0, 0x1f80),
+		    // poll:
+		    lw(t1, 0x1074, t0),
+		    beq(t1, zero, -2),
+		    nop,
+		    ori(v0, zero, 7),
+		    // idle:
+		    j(0x1fc0'0000 + 5 * 4),
+		    nop,
+		};
+	}
+
+	// A program that polls the reached target flag of the root counter 1.
+	std::vector<uint32_t> timer_polling() {
+		return {
+		    lui(t0, 0x1f80),
+		    ori(t1, zero, 5000),
+		    sw(t1, 0x1118, t0),
+		    sw(zero, 0x1114, t0),
+		    // poll:
+		    lw(t2, 0x1114, t0),
+		    andi(t2, t2, 0x800),
+		    beq(t2, zero, -3),
+		    nop,
+		    ori(v0, zero, 7),
+		    // idle:
+		    j(0x1fc0'0000 + 9 * 4),
+		    nop,
+		};
+	}
+
+	// A program that waits for a flag in the RAM, counts it and clears it.
+	std::vector<uint32_t> waiting() {
+		return {
+		    lui(t0, 0x8000),
+		    // poll:
+		    lw(t1, 0x100, t0),
+		    beq(t1, zero, -2),
+		    nop,
+		    addiu(v0, v0, 1),
+		    sw(zero, 0x100, t0),
+		    j(0x1fc0'0000 + 1 * 4),
+		    nop,
+		};
+	}
+
+	// A program that raises the DMA interrupt (a DICR write schedules it)
+	// and reads I_STAT right after.
+	std::vector<uint32_t> raise_dma_irq() {
+		return {
+		    lui(t0, 0x1f80),
+		    ori(t1, zero, 0x8000),
+		    // the first write sets the master flag and raises the irq, the
+		    // second one leaves it set
+		    sw(t1, 0x10f4, t0),
+		    sw(t1, 0x10f4, t0),
+		    lw(t2, 0x1070, t0),
+		    // idle:
+		    j(0x1fc0'0000 + 5 * 4),
+		    nop,
+		};
+	}
+
+	// A program that stores a word in the scratchpad and loads it back from
+	// the KSEG0 mirror.
+	std::vector<uint32_t> scratch() {
+		return {
+		    lui(t0, 0x1f80),
+		    ori(t1, zero, 0x1234),
+		    sw(t1, 0x3fc, t0),
+		    lui(t2, 0x9f80),
+		    lw(v0, 0x3fc, t2),
+		    // idle:
+		    j(0x1fc0'0000 + 5 * 4),
+		    nop,
+		};
+	}
+
+	// A program that arms a COP0 breakpoint (on the routine at 80000200h or
+	// on a store to 80000100h) with the debug handler at 80000040h.
+	std::vector<uint32_t> breakpoint(bool data) {
+		return {
+		    lui(t0, 0x8000),
+		    ori(t1, t0, data ? 0x100 : 0x200),
+		    mtc0(t1, data ? cpu::cop0::BDA : cpu::cop0::BPC),
+		    addiu(t2, zero, -1),
+		    mtc0(t2, data ? cpu::cop0::BDAM : cpu::cop0::BPCM),
+		    // both the super-master and the master enables, plus the code
+		    // breakpoint or the data breakpoint on writes
+		    lui(t3, data ? 0xca80 : 0xc180),
+		    mtc0(t3, cpu::cop0::DCIC),
+		    sw(t1, 0x100, t0),
+		    addiu(v0, zero, 5),
+		    ori(t1, t0, 0x200),
+		    jalr(ra, t1),
+		    nop,
+		    // idle:
+		    j(0x1fc0'0000 + 12 * 4),
+		    nop,
+		};
+	}
+
+	// A program that raises the DMA interrupt and enables it in SR, in one
+	// order or in the other, then counts forever.
+	std::vector<uint32_t> interrupted(bool enable_first) {
+		std::array<uint32_t, 2> enable = {ori(t2, zero, 0x0401), mtc0(t2, cpu::cop0::SR)};
+		std::array<uint32_t, 2> raise = {ori(t1, zero, 0x8000), sw(t1, 0x10f4, t0)};
+		auto first = enable_first ? enable : raise;
+		auto second = enable_first ? raise : enable;
+		return {
+		    lui(t0, 0x1f80),
+		    // I_MASK
+		    ori(t1, zero, 0x8),
+		    sw(t1, 0x1074, t0),
+		    first[0],
+		    first[1],
+		    second[0],
+		    second[1],
+		    // count:
+		    addiu(v0, v0, 1),
+		    j(0x1fc0'0000 + 7 * 4),
+		    nop,
+		};
+	}
+
+	// A program that calls the routine at 80000600h forever.
+	std::vector<uint32_t> calling() {
+		return {
+		    lui(t0, 0x8000),
+		    ori(t6, t0, 0x600),
+		    // call:
+		    jalr(ra, t6),
+		    nop,
+		    j(0x1fc0'0000 + 2 * 4),
+		    nop,
+		};
+	}
+
+	// An interrupt handler that acknowledges the interrupt and counts it.
+	std::vector<uint32_t> interrupt_handler() {
+		return {
+		    mfc0(t4, cpu::cop0::EPC),
+		    mfc0(t5, cpu::cop0::Cause),
+		    sw(zero, 0x1070, t0),
+		    addiu(t6, t6, 1),
+		    jr(t4),
+		    rfe,
+		};
+	}
+
+	std::vector<uint32_t> debug_handler() {
+		return {
+		    mfc0(t4, cpu::cop0::EPC),
+		    mfc0(t5, cpu::cop0::DCIC),
+		    // idle:
+		    j(0x8000'0048),
+		    nop,
+		};
+	}
+
+	struct board : psycris::psx {
+		board(std::vector<uint32_t> code = program(), psycris::config settings = {}) : psx(std::move(settings)) {
+			std::memcpy(rom.memory().data(), code.data(), code.size() * sizeof(uint32_t));
+		}
+
+		// sets the flag polled by `waiting` every `period` ticks
+		void poke_every(uint64_t period) {
+			poke = events.add("poke", [this, period](uint64_t at) {
+				bus().write<uint32_t>(0x8000'0100, 1);
+				events.schedule(poke, at + period);
+			});
+			events.schedule(poke, period);
+		}
+
+		psycris::scheduler::event poke;
+
+		std::string dump() const {
+			std::stringstream s;
+			psycris::dump_board(s, *this);
+			return s.str();
+		}
+	};
+
+	// Where the dumps of two boards differ, empty if they are the same. The
+	// dumps are a few MiB, too large to be printed by a failed REQUIRE.
+	std::string dump_difference(board const& a, board const& b) {
+		std::string x = a.dump();
+		std::string y = b.dump();
+		auto [ix, iy] = std::mismatch(std::begin(x), std::end(x), std::begin(y), std::end(y));
+		if (ix == std::end(x) && iy == std::end(y)) {
+			return {};
+		}
+
+		std::ostringstream s;
+		s << "offset " << (ix - std::begin(x)) << ": ";
+		if (ix == std::end(x) || iy == std::end(y)) {
+			s << "size " << x.size() << " != " << y.size();
+		} else {
+			s << std::hex << "0x" << int(uint8_t(*ix)) << " != 0x" << int(uint8_t(*iy));
+		}
+		return s.str();
+	}
+}
+
+TEST_CASE("the cached interpreter behaves like the plain one", "[cpu]") {
+	auto plain = std::make_unique<board>();
+	auto cached = std::make_unique<board>();
+
+	SECTION("at every point of the execution") {
+		for (uint64_t ticks : {1, 2, 7, 50, 300, 411, 420, 435, 600}) {
+			plain->cpu.run(ticks);
+			cached->cpu.run_cached(ticks);
+
+			INFO("ticks " << ticks);
+			REQUIRE(plain->cpu.regs == cached->cpu.regs);
+			REQUIRE(dump_difference(*plain, *cached) == "");
+		}
+	}
+
+	SECTION("a cached block is invalidated when its memory is written") {
+		cached->cpu.run_cached(1000);
+		REQUIRE(cached->cpu.regs[v0] == 17);
+		REQUIRE(cached->cpu.regs[t1] == 5050);
+	}
+}
+
+TEST_CASE("the recompiler behaves like the plain interpreter", "[cpu]") {
+	auto plain = std::make_unique<board>();
+	auto jit = std::make_unique<board>();
+
+	SECTION("at every point of the execution") {
+		for (uint64_t ticks : {1, 2, 7, 50, 300, 411, 420, 435, 600}) {
+			plain->cpu.run(ticks);
+			jit->cpu.run_jit(ticks);
+
+			INFO("ticks " << ticks);
+			REQUIRE(plain->cpu.regs == jit->cpu.regs);
+			REQUIRE(dump_difference(*plain, *jit) == "");
+		}
+	}
+
+	SECTION("the translated code is invalidated when its memory is written") {
+		jit->cpu.run_jit(1000);
+		REQUIRE(jit->cpu.regs[v0] == 17);
+		REQUIRE(jit->cpu.regs[t1] == 5050);
+	}
+}
+
+TEST_CASE("the recompiler accesses the memory through the fastmem", "[cpu]") {
+	psycris::config settings;
+	settings.fastmem = true;
+
+	auto compare = [&](std::vector<uint32_t> code, std::initializer_list<uint64_t> ticks) {
+		auto plain = std::make_unique<board>(code);
+		auto jit = std::make_unique<board>(code, settings);
+		for (uint64_t t : ticks) {
+			plain->run(t);
+			jit->run(t, &cpu::mips::run_jit);
+
+			INFO("ticks " << t);
+			REQUIRE(plain->cpu.regs == jit->cpu.regs);
+			REQUIRE(dump_difference(*plain, *jit) == "");
+		}
+	};
+
+	SECTION("a store to the code of a block invalidates it") {
+		compare(program(), {1, 7, 300, 420, 600, 1000});
+	}
+
+	SECTION("the I/O accesses are served by the bus") {
+		compare(raise_dma_irq(), {3, 5, 40});
+		compare(polling(), {20, 200});
+	}
+
+	SECTION("the scratchpad is served by the cpu") {
+		auto b = std::make_unique<board>(scratch(), settings);
+		b->run(20, &cpu::mips::run_jit);
+		REQUIRE(b->cpu.regs[v0] == 0x1234);
+	}
+
+	SECTION("a watched access is served by the bus") {
+		auto b = std::make_unique<board>(program(), settings);
+		b->cpu.watch({0x8000'0100, 0x8000'0103}, psycris::bus::access::write);
+		b->run(10'000, &cpu::mips::run_jit);
+		REQUIRE(b->cpu.stopped_by());
+		REQUIRE(b->cpu.regs[t1] == 100);
+	}
+
+	SECTION("without the address space for the region the bus serves every access") {
+		// the limit leaves room for the board, not for the 4GiB region
+		std::ifstream statm{"/proc/self/statm"};
+		uint64_t pages = 0;
+		statm >> pages;
+		rlimit previous;
+		REQUIRE(getrlimit(RLIMIT_AS, &previous) == 0);
+		rlimit limited = previous;
+		limited.rlim_cur = pages * sysconf(_SC_PAGESIZE) + (uint64_t(1) << 30);
+		REQUIRE(setrlimit(RLIMIT_AS, &limited) == 0);
+		auto b = std::make_unique<board>(program(), settings);
+		setrlimit(RLIMIT_AS, &previous);
+
+		REQUIRE(b->cpu.fastmem() == nullptr);
+		auto plain = std::make_unique<board>();
+		plain->run(1000);
+		b->run(1000, &cpu::mips::run_jit);
+		REQUIRE(dump_difference(*plain, *b) == "");
+	}
+}
+
+TEST_CASE("the idle loops are skipped", "[cpu]") {
+	auto run = GENERATE(as<psycris::psx::engine>{}, &cpu::mips::run_cached, &cpu::mips::run_jit);
+
+	SECTION("a loop that polls the memory") {
+		auto plain = std::make_unique<board>(waiting());
+		auto b = std::make_unique<board>(waiting());
+		for (uint64_t ticks : {100, 10'000, 10'007}) {
+			plain->cpu.run(ticks);
+			(b->cpu.*run)(ticks);
+			REQUIRE(dump_difference(*plain, *b) == "");
+		}
+		REQUIRE(b->cpu.idle_ticks() > 9'000);
+
+		// the loop ends when the polled flag changes
+		for (auto* x : {plain.get(), b.get()}) {
+			x->bus().write<uint32_t>(0x8000'0100, 1);
+		}
+		plain->cpu.run(20'000);
+		(b->cpu.*run)(20'000);
+		REQUIRE(dump_difference(*plain, *b) == "");
+		REQUIRE(b->cpu.regs[v0] == 1);
+	}
+
+	SECTION("a loop that polls a device is executed") {
+		// the flag of the counter 1 is set at the tick 5000, when the loop
+		// looks the same at every iteration
+		auto plain = std::make_unique<board>(timer_polling());
+		auto b = std::make_unique<board>(timer_polling());
+		for (uint64_t ticks : {100, 4'990, 5'020, 20'000}) {
+			plain->cpu.run(ticks);
+			(b->cpu.*run)(ticks);
+
+			INFO("ticks " << ticks);
+			REQUIRE(dump_difference(*plain, *b) == "");
+		}
+		REQUIRE(b->cpu.regs[v0] == 7);
+		REQUIRE(b->cpu.idle_ticks() > 10'000);
+	}
+}
+
+TEST_CASE("the board runs the cpu in slices between the events", "[cpu]") {
+	auto check = [](std::vector<uint32_t> code, auto setup, psycris::psx::engine run) {
+		auto plain = std::make_unique<board>(code);
+		auto other = std::make_unique<board>(code);
+		setup(*plain);
+		setup(*other);
+
+		for (uint64_t ticks : {3, 4, 5, 500, 1000, 1001, 1003, 2500, 10'000}) {
+			plain->run(ticks);
+			other->run(ticks, run);
+
+			INFO("ticks " << ticks);
+			REQUIRE(plain->cpu.ticks() == ticks);
+			REQUIRE(dump_difference(*plain, *other) == "");
+		}
+		return other;
+	};
+
+	auto run = GENERATE(as<psycris::psx::engine>{}, &cpu::mips::run_cached, &cpu::mips::run_jit);
+
+	SECTION("with the events scheduled between the slices") {
+		auto b = check(waiting(), [](board& b) { b.poke_every(1000); }, run);
+		REQUIRE(b->cpu.regs[v0] == 9);
+	}
+
+	SECTION("with the events scheduled by the cpu") {
+		auto b = check(raise_dma_irq(), [](board&) {}, run);
+		REQUIRE(b->cpu.regs[t2] == psycris::hw::interrupt_control::DMA);
+	}
+}
+
+TEST_CASE("the scratchpad is served by the cpu", "[cpu]") {
+	auto run = GENERATE(as<psycris::psx::engine>{}, &cpu::mips::run, &cpu::mips::run_cached, &cpu::mips::run_jit);
+
+	auto b = std::make_unique<board>(scratch());
+	b->run(20, run);
+	REQUIRE(b->cpu.regs[v0] == 0x1234);
+
+	// the bus sees the same memory
+	REQUIRE(b->bus().read<uint32_t>(0x1f80'03fc) == 0x1234);
+	REQUIRE(b->bus().read<uint32_t>(0x9f80'03fc) == 0x1234);
+	REQUIRE(b->scratchpad.memory()[0x3fc] == 0x34);
+
+	// and it is saved in the dumps
+	auto restored = std::make_unique<board>(scratch());
+	std::stringstream s{b->dump()};
+	psycris::restore_board(s, *restored);
+	REQUIRE(restored->bus().read<uint32_t>(0x1f80'03fc) == 0x1234);
+}
+
+TEST_CASE("a restored board runs like the dumped one", "[cpu]") {
+	constexpr uint32_t i_stat = 0x1f80'1070;
+	constexpr uint64_t frame = psycris::psx::board::vblank_period;
+
+	auto dumped = std::make_unique<board>();
+	// the counter 2 interrupts every 1000 ticks
+	dumped->bus().write<uint32_t>(0x1f80'1128, 1000);
+	dumped->bus().write<uint32_t>(0x1f80'1124, 0x58);
+
+	uint64_t late = 10 * frame + 1234;
+	dumped->run(late);
+	dumped->bus().write<uint32_t>(i_stat, 0);
+
+	auto restored = std::make_unique<board>();
+	std::stringstream s{dumped->dump()};
+	psycris::restore_board(s, *restored);
+	REQUIRE(dump_difference(*dumped, *restored) == "");
+
+	// the vertical blanks before the dump are not raised again
+	restored->run(late + 100);
+	REQUIRE((restored->bus().read<uint32_t>(i_stat) & psycris::hw::interrupt_control::VBLANK) == 0);
+
+	for (uint64_t ticks : {late + 100, 11 * frame - 1, 11 * frame, 11 * frame + 1, 13 * frame + 5}) {
+		dumped->run(ticks);
+		restored->run(ticks);
+
+		INFO("ticks " << ticks);
+		REQUIRE(dump_difference(*dumped, *restored) == "");
+	}
+	REQUIRE((restored->bus().read<uint32_t>(i_stat) & psycris::hw::interrupt_control::VBLANK) != 0);
+	REQUIRE((restored->bus().read<uint32_t>(i_stat) & psycris::hw::interrupt_control::TMR2) != 0);
+}
+
+TEST_CASE("the binary trace records every instruction", "[cpu]") {
+	auto path = std::filesystem::temp_directory_path() / "psycris_test.trace";
+
+	auto plain = std::make_unique<board>();
+	auto traced = std::make_unique<board>();
+	{
+		auto recorder = cpu::trace_recorder::create(path.string(), traced->cpu.ticks());
+		REQUIRE(recorder);
+		traced->cpu.record_to(recorder.get());
+
+		for (uint64_t ticks : {300, 600}) {
+			plain->cpu.run(ticks);
+			traced->cpu.run<cpu::binary_trace>(ticks);
+			REQUIRE(dump_difference(*plain, *traced) == "");
+		}
+		traced->cpu.record_to(nullptr);
+		REQUIRE(recorder->finish());
+	}
+
+	std::ifstream f(path, std::ios::binary);
+	cpu::trace_reader trace{f};
+	REQUIRE(trace.valid());
+
+	std::vector<cpu::trace_record> records;
+	for (cpu::trace_record r; trace.next(r);) {
+		records.push_back(r);
+	}
+	std::filesystem::remove(path);
+
+	REQUIRE(records.size() == 600);
+
+	SECTION("the registers can be replayed") {
+		cpu::registers regs{};
+		uint64_t clock = trace.header().start_clock;
+		for (auto const& r : records) {
+			clock += r.clock_delta;
+			if (r.reg != cpu::trace_record::no_reg) {
+				regs[r.reg] = r.reg_value;
+			}
+		}
+		REQUIRE(clock == 600);
+		REQUIRE(regs == traced->cpu.regs);
+	}
+
+	SECTION("with the memory accesses") {
+		// the first store of the loop; the first record is the noop fetched
+		// at reset
+		auto const& r = records[5];
+		REQUIRE(r.pc == 0x1fc0'0010);
+		REQUIRE(r.mem == (4 | cpu::trace_record::mem_write));
+		REQUIRE(r.mem_addr == 0x8000'0100);
+		REQUIRE(r.mem_value == 100);
+		REQUIRE(r.reg == cpu::trace_record::no_reg);
+	}
+}
+
+TEST_CASE("the profiler follows the guest calls", "[cpu]") {
+	auto b = std::make_unique<board>();
+	cpu::profiler profiler;
+	b->cpu.profile_with(&profiler);
+	b->cpu.run<cpu::profile>(300);
+	b->cpu.run<cpu::profile>(600);
+	b->cpu.profile_with(nullptr);
+
+	cpu::symbol_map symbols;
+	std::istringstream map{"1fb00000 T main\n80000200 routine\n"};
+	REQUIRE(symbols.load(map) == 2);
+
+	auto report = [&](auto write) {
+		std::ostringstream out;
+		(profiler.*write)(out, symbols);
+		return out.str();
+	};
+
+	SECTION("every tick is counted") {
+		std::istringstream pcs{report(&cpu::profiler::write_pcs)};
+		uint64_t total = 0;
+		for (std::string line; std::getline(pcs, line);) {
+			std::istringstream fields{line};
+			std::string pc;
+			uint64_t ticks;
+			fields >> pc >> ticks;
+			total += ticks;
+		}
+		REQUIRE(total == 600);
+	}
+
+	SECTION("the basic blocks start at the branch targets") {
+		auto blocks = report(&cpu::profiler::write_blocks);
+		REQUIRE(blocks.find("1fc0000c 99 main\n") != std::string::npos);
+		REQUIRE(blocks.find("80000200 2 routine\n") != std::string::npos);
+	}
+
+	SECTION("the routine is called twice") {
+		// 3 instructions per call, with the delay slot of the return
+		auto folded = report(&cpu::profiler::write_folded);
+		REQUIRE(folded == "main 594\nmain;routine 6\n");
+
+		auto perf = report(&cpu::profiler::write_perf_script);
+		REQUIRE(perf.find(": 6 cycles:\n\t        80000200 routine (psx)\n\t        1fbffffc main (psx)\n") !=
+		        std::string::npos);
+	}
+}
+
+TEST_CASE("the opcode table", "[cpu]") {
+	using cpu::encoding;
+
+	SECTION("every described instruction is identified") {
+		for (auto const& op : cpu::opcodes) {
+			uint32_t raw = 0;
+			switch (op.enc) {
+			case encoding::primary:
+				raw = op.code << 26;
+				break;
+			case encoding::special:
+				raw = op.code;
+				break;
+			case encoding::regimm:
+				raw = 0x01 << 26 | op.code << 16;
+				break;
+			}
+			INFO("opcode " << op.format);
+			REQUIRE(cpu::identify(cpu::decoder{raw}) == op.id);
+			REQUIRE(cpu::describe(op.id).delay_slot == op.delay_slot);
+		}
+	}
+
+	SECTION("the disassembly uses the same table") {
+		REQUIRE(cpu::disassembly(r_type(0x0c, 0, 0, 0), 0) == "syscall");
+		REQUIRE(cpu::disassembly(nop, 0) == "noop");
+		REQUIRE(cpu::disassembly(jr(ra), 0).rfind("jr ", 0) == 0);
+		REQUIRE(cpu::disassembly(bne(t1, zero, -4), 0).rfind("bne ", 0) == 0);
+	}
+}
+
+TEST_CASE("the engines run in lockstep with the interpreter", "[cpu]") {
+	auto engine = GENERATE(as<psycris::psx::engine>{}, &cpu::mips::run_cached, &cpu::mips::run_jit);
+
+	auto reference = std::make_unique<board>();
+	auto candidate = std::make_unique<board>();
+	psycris::lockstep l{*reference, *candidate, engine};
+
+	SECTION("the boards agree") {
+		REQUIRE(l.run(2000, 37));
+		REQUIRE(l.difference().empty());
+	}
+
+	SECTION("a difference in memory is found") {
+		REQUIRE(l.run(100, 50));
+		candidate->bus().write<uint32_t>(0x8000'0300, 1);
+		REQUIRE_FALSE(l.run(2000, 1));
+		REQUIRE(l.diverged_at() == 101);
+		REQUIRE(l.difference().rfind("memory", 0) == 0);
+	}
+
+	SECTION("a difference in the registers is found") {
+		REQUIRE(l.run(100, 10));
+		candidate->cpu.regs[v0] = 42;
+		REQUIRE_FALSE(l.run(2000, 10));
+		REQUIRE(l.diverged_at() == 110);
+		REQUIRE(l.difference() == "regs[2]: 0x00000000 != 0x0000002a");
+	}
+
+	SECTION("a difference in the multiply registers is found") {
+		// the program does not multiply, HI and LO keep their reset value
+		REQUIRE(l.run(100, 10));
+		candidate->cpu.mult_regs[1] = 42;
+		REQUIRE_FALSE(l.run(2000, 10));
+		REQUIRE(l.diverged_at() == 110);
+		REQUIRE(l.difference() == "mult_regs[1]: 0x00000000 != 0x0000002a");
+	}
+}
+
+TEST_CASE("the watchpoints stop the cpu", "[cpu]") {
+	using psycris::bus::access;
+	auto run = GENERATE(as<psycris::psx::engine>{}, &cpu::mips::run_cached, &cpu::mips::run_jit);
+
+	auto plain = std::make_unique<board>();
+	auto other = std::make_unique<board>();
+
+	// runs both the boards until the next hit
+	auto next_hit = [&] {
+		plain->run(10'000);
+		other->run(10'000, run);
+		REQUIRE(plain->cpu.stopped_by());
+		REQUIRE(other->cpu.stopped_by());
+		REQUIRE(dump_difference(*plain, *other) == "");
+		return *plain->cpu.stopped_by();
+	};
+
+	SECTION("a store stops the cpu after the instruction") {
+		uint32_t id = plain->cpu.watch({0x8000'0100, 0x8000'0103}, access::write);
+		other->cpu.watch({0x8000'0100, 0x8000'0103}, access::write);
+
+		auto hit = next_hit();
+		REQUIRE(hit.id == id);
+		REQUIRE(hit.kind == access::write);
+		REQUIRE(hit.addr == 0x8000'0100);
+		REQUIRE(hit.size == 4);
+		REQUIRE(plain->cpu.regs[t1] == 100);
+
+		next_hit();
+		REQUIRE(plain->cpu.regs[t2] == 100 + 99);
+		REQUIRE(plain->cpu.regs[t1] == 99);
+	}
+
+	SECTION("a fetch stops the cpu before the instruction") {
+		plain->cpu.watch({0x8000'0200, 0x8000'0203}, access::execute);
+		other->cpu.watch({0x8000'0200, 0x8000'0203}, access::execute);
+
+		REQUIRE(next_hit().kind == access::execute);
+		REQUIRE(plain->cpu.regs[v0] == 0);
+
+		// the next run starts from the watched instruction
+		next_hit();
+		REQUIRE(plain->cpu.regs[v0] == 1);
+
+		plain->run(10'000);
+		other->run(10'000, run);
+		REQUIRE(!plain->cpu.stopped_by());
+		REQUIRE(plain->cpu.regs[v0] == 17);
+		REQUIRE(dump_difference(*plain, *other) == "");
+	}
+
+	SECTION("a removed watchpoint does not stop the cpu") {
+		plain->cpu.unwatch(plain->cpu.watch({0x8000'0200, 0x8000'0203}, access::execute));
+		plain->run(10'000);
+		REQUIRE(!plain->cpu.stopped_by());
+		REQUIRE(plain->cpu.ticks() == 10'000);
+	}
+}
+
+TEST_CASE("a watched scratchpad is served by the bus", "[cpu]") {
+	using psycris::bus::access;
+	auto run = GENERATE(as<psycris::psx::engine>{}, &cpu::mips::run, &cpu::mips::run_cached, &cpu::mips::run_jit);
+
+	auto b = std::make_unique<board>(scratch());
+	b->cpu.watch({0x1f80'03fc, 0x1f80'03ff}, access::write);
+	b->run(20, run);
+	REQUIRE(b->cpu.stopped_by());
+	REQUIRE(b->cpu.stopped_by()->addr == 0x1f80'03fc);
+	REQUIRE(b->scratchpad.memory()[0x3fc] == 0x34);
+
+	b->run(20, run);
+	REQUIRE(b->cpu.regs[v0] == 0x1234);
+}
+
+TEST_CASE("the COP0 breakpoints raise a debug exception", "[cpu]") {
+	auto run = GENERATE(as<psycris::psx::engine>{}, &cpu::mips::run, &cpu::mips::run_cached, &cpu::mips::run_jit);
+
+	auto check = [&](bool data) {
+		auto b = std::make_unique<board>(breakpoint(data));
+		auto handler = debug_handler();
+		b->bus().write_block(cpu::mips::dbg_vector,
+		                     {reinterpret_cast<uint8_t const*>(handler.data()),
+		                      static_cast<std::ptrdiff_t>(handler.size() * sizeof(uint32_t))});
+		b->run(200, run);
+
+		// the guest breakpoints do not stop the board
+		REQUIRE(!b->cpu.stopped_by());
+		REQUIRE(cpu::cause_bits::ExcCode(b->cpu.cop0.cause()) == cpu::cop0::Bp);
+		return b;
+	};
+
+	SECTION("on an instruction fetch, before the instruction") {
+		auto b = check(false);
+		REQUIRE(b->cpu.regs[v0] == 5);
+		REQUIRE(b->cpu.regs[t4] == 0x8000'0200);
+		REQUIRE((b->cpu.regs[t5] & 0x3f) == 0x03);
+	}
+
+	SECTION("on a store, after the instruction") {
+		auto b = check(true);
+		REQUIRE(b->cpu.regs[v0] == 0);
+		REQUIRE(b->bus().read<uint32_t>(0x8000'0100) == 0x8000'0100);
+		REQUIRE(b->cpu.regs[t4] == 0x1fc0'0000 + 8 * 4);
+		REQUIRE((b->cpu.regs[t5] & 0x3f) == 0x15);
+	}
+}
+
+TEST_CASE("a block write invalidates all the code it covers", "[cpu]") {
+	auto run = GENERATE(as<psycris::psx::engine>{}, &cpu::mips::run_cached, &cpu::mips::run_jit);
+
+	// the routine is written at 80000600h by a block write that starts
+	// 1.5KiB before it
+	auto load = [](board& b, uint32_t increment) {
+		std::vector<uint32_t> memory(0x200);
+		memory[0x180] = addiu(v0, v0, increment);
+		memory[0x181] = jr(ra);
+		memory[0x182] = nop;
+		b.bus().write_block(0x8000'0000,
+		                    {reinterpret_cast<uint8_t const*>(memory.data()),
+		                     static_cast<std::ptrdiff_t>(memory.size() * sizeof(uint32_t))});
+	};
+
+	auto b = std::make_unique<board>(calling());
+	load(*b, 1);
+	b->run(100, run);
+	REQUIRE(b->cpu.regs[v0] > 0);
+
+	load(*b, 16);
+	b->cpu.regs[v0] = 0;
+	b->run(200, run);
+	REQUIRE(b->cpu.regs[v0] > 0);
+	REQUIRE(b->cpu.regs[v0] % 16 == 0);
+}
+
+TEST_CASE("the interrupts are taken between the slices", "[cpu]") {
+	auto run = GENERATE(as<psycris::psx::engine>{}, &cpu::mips::run_cached, &cpu::mips::run_jit);
+	bool enable_first = GENERATE(true, false);
+
+	auto make = [&] {
+		auto b = std::make_unique<board>(interrupted(enable_first));
+		auto handler = interrupt_handler();
+		b->bus().write_block(cpu::mips::exc_vector,
+		                     {reinterpret_cast<uint8_t const*>(handler.data()),
+		                      static_cast<std::ptrdiff_t>(handler.size() * sizeof(uint32_t))});
+		return b;
+	};
+	auto plain = make();
+	auto other = make();
+
+	for (uint64_t ticks : {5, 7, 8, 9, 12, 20, 100}) {
+		plain->run(ticks);
+		other->run(ticks, run);
+
+		INFO("ticks " << ticks);
+		REQUIRE(dump_difference(*plain, *other) == "");
+	}
+
+	// the interrupt is taken once, before the first instruction of the loop
+	REQUIRE(other->cpu.regs[t6] == 1);
+	REQUIRE(other->cpu.regs[t4] == 0x1fc0'0000 + 7 * 4);
+	REQUIRE((other->cpu.regs[t5] & 0x7c) == cpu::cop0::Int);
+	REQUIRE((other->cpu.regs[t5] & 0x400) == 0x400);
+	REQUIRE(other->cpu.regs[v0] > 10);
+	// the handler returned with the interrupts enabled again
+	REQUIRE((other->cpu.cop0.sr() & 0x3f) == 0x01);
+	REQUIRE_FALSE(other->cpu.cop0.interrupt_pending());
+}
@@ -0,0 +1,155 @@
+#include <catch2/catch.hpp>
+
+#include "test_board.hpp"
+
+#include <memory>
+
+namespace {
+	using psycris::hw::dma;
+
+	constexpr uint32_t dpcr = 0x1f80'10f0;
+	constexpr uint32_t dicr = 0x1f80'10f4;
+	constexpr uint32_t i_stat = 0x1f80'1070;
+
+	uint32_t madr(dma::channel c) { return 0x1f80'1080 + 0x10 * c; }
+	uint32_t bcr(dma::channel c) { return madr(c) + 4; }
+	uint32_t chcr(dma::channel c) { return madr(c) + 8; }
+
+	// a device that records the words it receives and sends a counter
+	struct fifo : psycris::hw::dma_port {
+		void dma_write(gsl::span<uint8_t const> data) override {
+			for (ptrdiff_t ix = 0; ix < data.size(); ix += 4) {
+				uint32_t w;
+				std::memcpy(&w, &data[ix], sizeof(w));
+				received.push_back(w);
+			}
+		}
+
+		void dma_read(gsl::span<uint8_t> data) override {
+			for (ptrdiff_t ix = 0; ix < data.size(); ix += 4) {
+				std::memcpy(&data[ix], &next, sizeof(next));
+				next++;
+			}
+		}
+
+		std::vector<uint32_t> received;
+		uint32_t next = 0x100;
+	};
+
+	struct board : psycris::test::board {
+		board() {
+			dma.connect(dma::gpu, port);
+			// every channel enabled
+			write(dpcr, 0x0fed'cba9);
+		}
+
+		fifo port;
+	};
+}
+
+TEST_CASE("the DMA channels", "[dma]") {
+	auto b = std::make_unique<board>();
+
+	SECTION("the OTC channel clears an ordering table") {
+		b->write(madr(dma::otc), 0x8000'1000);
+		b->write(bcr(dma::otc), 4);
+		b->write(chcr(dma::otc), 0x1100'0000);
+
+		REQUIRE(b->read(0x1000) == 0x0ffc);
+		REQUIRE(b->read(0x0ffc) == 0x0ff8);
+		REQUIRE(b->read(0x0ff8) == 0x0ff4);
+		REQUIRE(b->read(0x0ff4) == 0x00ff'ffff);
+		REQUIRE(b->read(0x0ff0) == 0);
+		REQUIRE(b->read(chcr(dma::otc)) == 0x0100'0002);
+
+		// the channel is busy until the transfer is completed
+		b->run(3);
+		REQUIRE(b->read(chcr(dma::otc)) == 0x0100'0002);
+		b->run(10);
+		REQUIRE(b->read(chcr(dma::otc)) == 0x0000'0002);
+	}
+
+	SECTION("a long ordering table is cleared in chunks") {
+		uint32_t const n = 3001;
+		b->write(madr(dma::otc), 0x0010'0000);
+		b->write(bcr(dma::otc), n);
+		b->write(chcr(dma::otc), 0x1100'0000);
+
+		uint32_t addr = 0x0010'0000;
+		for (uint32_t i = 0; i + 1 < n; i++, addr -= 4) {
+			INFO("entry " << i);
+			REQUIRE(b->read(addr) == addr - 4);
+		}
+		REQUIRE(b->read(addr) == 0x00ff'ffff);
+	}
+
+	SECTION("a block transfer sends the RAM to the device") {
+		for (uint32_t i = 0; i < 8; i++) {
+			b->write(0x2000 + 4 * i, 0xa0 + i);
+		}
+		b->write(madr(dma::gpu), 0x2000);
+		// 2 blocks of 4 words, from the RAM
+		b->write(bcr(dma::gpu), 0x0002'0004);
+		b->write(chcr(dma::gpu), 0x0100'0201);
+
+		REQUIRE(b->port.received == std::vector<uint32_t>{0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7});
+		REQUIRE(b->read(madr(dma::gpu)) == 0x2020);
+		REQUIRE(b->read(bcr(dma::gpu)) == 0x0000'0004);
+	}
+
+	SECTION("a triggered transfer fills the RAM from the device") {
+		b->write(madr(dma::gpu), 0x3000);
+		b->write(bcr(dma::gpu), 3);
+		b->write(chcr(dma::gpu), 0x0100'0000);
+		// sync mode 0 waits for the trigger
+		REQUIRE(b->read(0x3000) == 0);
+
+		b->write(chcr(dma::gpu), 0x1100'0000);
+		REQUIRE(b->read(0x3000) == 0x100);
+		REQUIRE(b->read(0x3008) == 0x102);
+		REQUIRE(b->read(madr(dma::gpu)) == 0x3000);
+		REQUIRE(b->read(chcr(dma::gpu)) == 0x0100'0000);
+	}
+
+	SECTION("a linked list is sent node by node") {
+		b->write(0x4000, 0x0200'5000);
+		b->write(0x4004, 0xa);
+		b->write(0x4008, 0xb);
+		b->write(0x5000, 0x0100'6000);
+		b->write(0x5004, 0xc);
+		b->write(0x6000, 0x00ff'ffff);
+		b->write(madr(dma::gpu), 0x4000);
+		b->write(chcr(dma::gpu), 0x0100'0401);
+
+		REQUIRE(b->port.received == std::vector<uint32_t>{0xa, 0xb, 0xc});
+		REQUIRE(b->read(madr(dma::gpu)) == 0x00ff'ffff);
+	}
+
+	SECTION("a disabled channel starts when it is enabled") {
+		b->write(dpcr, 0);
+		b->write(madr(dma::otc), 0x1000);
+		b->write(bcr(dma::otc), 2);
+		b->write(chcr(dma::otc), 0x1100'0000);
+		REQUIRE(b->read(0x1000) == 0);
+
+		b->write(dpcr, 0x0800'0000);
+		REQUIRE(b->read(0x1000) == 0x0ffc);
+	}
+
+	SECTION("the completion flags the channel and raises the interrupt") {
+		// the master enable and the OTC interrupt
+		b->write(dicr, 0x00c0'0000);
+		b->write(madr(dma::otc), 0x1000);
+		b->write(bcr(dma::otc), 16);
+		b->write(chcr(dma::otc), 0x1100'0000);
+		REQUIRE(b->read(i_stat) == 0);
+
+		b->run(100);
+		REQUIRE(b->read(dicr) == 0xc0c0'0000);
+		REQUIRE(b->read(i_stat) == psycris::hw::interrupt_control::DMA);
+
+		// a flag is acknowledged writing 1
+		b->write(dicr, 0x40c0'0000);
+		REQUIRE(b->read(dicr) == 0x00c0'0000);
+	}
+}
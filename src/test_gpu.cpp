@@ -0,0 +1,350 @@
+#include <catch2/catch.hpp>
+
+#include "test_board.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace {
+	using psycris::hw::interrupt_control;
+	using psycris::hw::rasterizer;
+
+	constexpr uint32_t gp0 = 0x1f80'1810;
+	constexpr uint32_t gp1 = 0x1f80'1814;
+	constexpr uint32_t i_stat = 0x1f80'1070;
+
+	uint32_t position(int x, int y) { return static_cast<uint32_t>(x & 0xffff) | static_cast<uint32_t>(y) << 16; }
+
+	struct board : psycris::test::board {
+		board() {
+			// the whole VRAM is the drawing area
+			send({0xe300'0000, 0xe400'0000 | 1023 | 511 << 10});
+		}
+
+		void send(std::vector<uint32_t> const& words) {
+			for (uint32_t w : words) {
+				write(gp0, w);
+			}
+		}
+
+		uint16_t pixel(int x, int y) const { return vram.pixels()[y * 1024 + x]; }
+	};
+
+	std::vector<uint16_t> pixels(rasterizer::isa isa, std::vector<uint16_t> vram, std::mt19937& rng) {
+		rasterizer r{vram.data()};
+		r.use(isa);
+		r.env.right = 1023;
+		r.env.bottom = 511;
+
+		auto coord = [&](int limit) { return static_cast<int32_t>(rng() % limit) - 64; };
+		auto random_vertex = [&] {
+			rasterizer::vertex v;
+			v.x = coord(400);
+			v.y = coord(300);
+			v.r = static_cast<uint8_t>(rng());
+			v.g = static_cast<uint8_t>(rng());
+			v.b = static_cast<uint8_t>(rng());
+			v.u = static_cast<uint8_t>(rng());
+			v.v = static_cast<uint8_t>(rng());
+			return v;
+		};
+
+		for (int i = 0; i < 200; i++) {
+			rasterizer::primitive p;
+			uint32_t flags = rng();
+			p.gouraud = flags & 1;
+			p.textured = flags & 2;
+			p.raw = flags & 4;
+			p.semi_transparent = flags & 8;
+			p.semi_mode = (flags >> 4) & 3;
+			p.depth = (flags >> 6) % 3;
+			p.page_x = 512;
+			p.clut_y = 480;
+			r.env.dither = flags & 0x100;
+			r.env.set_mask = flags & 0x200;
+			r.env.check_mask = flags & 0x400;
+
+			switch (i % 3) {
+			case 0:
+				r.triangle({random_vertex(), random_vertex(), random_vertex()}, p);
+				break;
+			case 1:
+				r.rectangle(random_vertex(), coord(300), coord(200), p, flags & 0x800, flags & 0x1000);
+				break;
+			default:
+				r.line(random_vertex(), random_vertex(), p);
+				break;
+			}
+		}
+		return vram;
+	}
+}
+
+TEST_CASE("the GPU commands", "[gpu]") {
+	auto b = std::make_unique<board>();
+
+	SECTION("a fill and the image transfers") {
+		// the fill is aligned to 16 pixels
+		b->send({0x0200'00ff, position(16, 10), position(20, 4)});
+		REQUIRE(b->pixel(16, 10) == 0x001f);
+		REQUIRE(b->pixel(47, 13) == 0x001f);
+		REQUIRE(b->pixel(48, 10) == 0);
+		REQUIRE(b->pixel(16, 14) == 0);
+
+		// two pixels per word, the second half of the last word is ignored
+		b->send({0xa000'0000, position(100, 200), position(3, 1), 0x1234'0001, 0x9999'5678});
+		REQUIRE(b->pixel(100, 200) == 0x0001);
+		REQUIRE(b->pixel(101, 200) == 0x1234);
+		REQUIRE(b->pixel(102, 200) == 0x5678);
+		REQUIRE(b->pixel(103, 200) == 0);
+
+		b->send({0xc000'0000, position(100, 200), position(3, 1)});
+		REQUIRE((b->read(gp1) & 0x0800'0000) != 0);
+		REQUIRE(b->read(gp0) == 0x1234'0001);
+		REQUIRE(b->read(gp0) == 0x0000'5678);
+		REQUIRE((b->read(gp1) & 0x0800'0000) == 0);
+
+		// the copy
+		b->send({0x8000'0000, position(100, 200), position(0, 0), position(2, 1)});
+		REQUIRE(b->pixel(0, 0) == 0x0001);
+		REQUIRE(b->pixel(1, 0) == 0x1234);
+	}
+
+	SECTION("a quad covers its area without gaps or overlaps") {
+		// additive semi-transparency: a pixel drawn twice would be brighter
+		b->send({0xe100'0020, 0x2a08'0808, position(10, 10), position(30, 10), position(10, 20), position(30, 20)});
+		for (int y = 8; y < 22; y++) {
+			for (int x = 8; x < 32; x++) {
+				INFO("x " << x << " y " << y);
+				bool inside = x >= 10 && x < 30 && y >= 10 && y < 20;
+				REQUIRE(b->pixel(x, y) == (inside ? 0x0421 : 0));
+			}
+		}
+	}
+
+	SECTION("the drawing offset and area") {
+		b->send({0xe500'0000 | 100 | 50 << 11, 0xe300'0000 | 105 | 50 << 10});
+		b->send({0x6000'00ff, position(0, 0), position(10, 10)});
+		REQUIRE(b->pixel(104, 55) == 0);
+		REQUIRE(b->pixel(105, 55) == 0x001f);
+		REQUIRE(b->pixel(109, 59) == 0x001f);
+		REQUIRE(b->pixel(110, 59) == 0);
+	}
+
+	SECTION("the gouraud shading reaches the colors of the vertices") {
+		b->send({0x3000'00ff, position(0, 0), 0x0000'ff00, position(64, 0), 0x00ff'0000, position(0, 64)});
+		REQUIRE(b->pixel(0, 0) == 0x001f);
+		REQUIRE(b->pixel(63, 0) == 0x03e0);
+		REQUIRE(b->pixel(0, 63) == 0x7c00);
+		// halfway between the red and the green
+		REQUIRE(b->pixel(32, 0) == (0x10 | 0x10 << 5));
+	}
+
+	SECTION("the dithering") {
+		constexpr int8_t matrix[4][4] = {{-4, 0, -3, 1}, {2, -2, 3, -1}, {-3, 1, -4, 0}, {3, -1, 2, -2}};
+		b->send({0xe100'0200, 0x3006'0606, position(0, 0), 0x0006'0606, position(32, 0), 0x0006'0606, position(0, 32)});
+		for (int y = 0; y < 4; y++) {
+			for (int x = 0; x < 4; x++) {
+				INFO("x " << x << " y " << y);
+				uint16_t c = 6 + matrix[y][x] >= 8 ? 1 : 0;
+				REQUIRE(b->pixel(x, y) == (c | c << 5 | c << 10));
+			}
+		}
+
+		// the flat shading is not dithered
+		b->send({0x2006'0606, position(0, 100), position(32, 100), position(0, 132)});
+		REQUIRE(b->pixel(1, 101) == 0);
+	}
+
+	SECTION("a textured rectangle uses the CLUT and skips the transparent texels") {
+		// the CLUT at (0, 256): transparent, red, green with the bit 15
+		b->send({0xa000'0000, position(0, 256), position(3, 1), 0x001f'0000, 0x0000'83e0});
+		// a 4 bit texture at (640, 0): 0, 1, 2, 0
+		b->send({0xa000'0000, position(640, 0), position(1, 1), 0x0000'0210});
+		b->send({0x0200'0000 | 0xff << 16, position(0, 100), position(16, 1)});
+
+		b->send({0xe100'000a, 0x6500'0000, position(0, 100), 0x4000'0000, position(4, 1)});
+		REQUIRE(b->pixel(0, 100) == 0x7c00);
+		REQUIRE(b->pixel(1, 100) == 0x001f);
+		REQUIRE(b->pixel(2, 100) == 0x83e0);
+		REQUIRE(b->pixel(3, 100) == 0x7c00);
+
+		// modulated by the color: 80h keeps a channel as it is, 40h halves it
+		b->send({0x6400'4080, position(0, 101), 0x4000'0000, position(3, 1)});
+		REQUIRE(b->pixel(1, 101) == 0x001f);
+		REQUIRE(b->pixel(2, 101) == (0x8000 | 0x0f << 5));
+
+		// a textured triangle takes the page from its second vertex
+		b->send({0xe100'0000, 0x2580'8080, position(0, 200), 0x4000'0000, position(8, 200), 0x000a'0004,
+		         position(0, 208), 0x0000'0800});
+		REQUIRE((b->read(gp1) & 0x1ff) == 0xa);
+		REQUIRE(b->pixel(1, 200) == 0x001f);
+	}
+
+	SECTION("the semi-transparency modes") {
+		uint16_t const expected[] = {12, 24, 8, 18};
+		for (uint32_t mode = 0; mode < 4; mode++) {
+			INFO("mode " << mode);
+			b->send({0x0280'8080, position(0, 0), position(16, 1)});
+			b->send({0xe100'0000 | mode << 5, 0x6240'4040, position(0, 0), position(4, 1)});
+			uint16_t c = expected[mode];
+			REQUIRE(b->pixel(0, 0) == (c | c << 5 | c << 10));
+			REQUIRE(b->pixel(4, 0) == 0x4210);
+		}
+	}
+
+	SECTION("the mask bits") {
+		b->send({0xe600'0001, 0x6000'00ff, position(0, 0), position(4, 1)});
+		REQUIRE(b->pixel(0, 0) == 0x801f);
+		REQUIRE((b->read(gp1) & 0x1800) == 0x0800);
+
+		b->send({0xe600'0002, 0x60ff'0000, position(0, 0), position(8, 1)});
+		REQUIRE(b->pixel(0, 0) == 0x801f);
+		REQUIRE(b->pixel(4, 0) == 0x7c00);
+
+		// the image transfers honor the mask too
+		b->send({0xa000'0000, position(0, 0), position(2, 1), 0x1111'2222});
+		REQUIRE(b->pixel(0, 0) == 0x801f);
+
+		b->send({0xe600'0000, 0x60ff'0000, position(0, 0), position(4, 1)});
+		REQUIRE(b->pixel(0, 0) == 0x7c00);
+	}
+
+	SECTION("the lines and the polylines") {
+		b->send({0x4000'00ff, position(0, 0), position(10, 0)});
+		for (int x = 0; x <= 10; x++) {
+			REQUIRE(b->pixel(x, 0) == 0x001f);
+		}
+		REQUIRE(b->pixel(11, 0) == 0);
+
+		b->send({0x4800'00ff, position(0, 5), position(5, 5), position(5, 10), 0x5555'5555});
+		REQUIRE(b->pixel(2, 5) == 0x001f);
+		REQUIRE(b->pixel(5, 8) == 0x001f);
+		REQUIRE(b->pixel(5, 10) == 0x001f);
+
+		// the gouraud polyline ends at a terminator in place of a color
+		b->send({0x5800'00ff, position(20, 0), 0x0000'ff00, position(20, 10), 0x00ff'0000, position(30, 10),
+		         0x5000'5000});
+		REQUIRE(b->pixel(20, 0) == 0x001f);
+		REQUIRE(b->pixel(20, 10) == 0x03e0);
+		REQUIRE(b->pixel(30, 10) == 0x7c00);
+
+		// and the next command is parsed as usual
+		b->send({0x0200'00ff, position(0, 20), position(16, 1)});
+		REQUIRE(b->pixel(0, 20) == 0x001f);
+	}
+
+	SECTION("the display control and the interrupt") {
+		uint32_t stat = b->read(gp1);
+		REQUIRE((stat & 0x1480'2000) == 0x1480'2000);
+
+		b->write(gp1, 0x0300'0000);
+		b->write(gp1, 0x0400'0002);
+		b->write(gp1, 0x0800'0001);
+		stat = b->read(gp1);
+		REQUIRE((stat & 0x0080'0000) == 0);
+		REQUIRE((stat & 0x6200'0000) == 0x4200'0000);
+		REQUIRE((stat & 0x007f'0000) == 0x0002'0000);
+
+		b->write(gp0, 0x1f00'0000);
+		REQUIRE((b->read(gp1) & 0x0100'0000) != 0);
+		REQUIRE(b->read(i_stat) == interrupt_control::GPU);
+		b->write(gp1, 0x0200'0000);
+		REQUIRE((b->read(gp1) & 0x0100'0000) == 0);
+
+		b->write(gp1, 0x1000'0007);
+		REQUIRE(b->read(gp0) == 2);
+		b->send({0xe300'0000 | 5 | 7 << 10});
+		b->write(gp1, 0x1000'0003);
+		REQUIRE(b->read(gp0) == (5 | 7 << 10));
+
+		b->write(gp1, 0);
+		REQUIRE((b->read(gp1) & 0x6080'0000) == 0x0080'0000);
+	}
+
+	SECTION("the DMA channel 2 sends a linked list of commands") {
+		constexpr uint32_t madr = 0x1f80'10a0;
+		constexpr uint32_t chcr = 0x1f80'10a8;
+		constexpr uint32_t dpcr = 0x1f80'10f0;
+
+		b->write(0x1000, 0x0200'2000);
+		b->write(0x1004, 0x0200'00ff);
+		b->write(0x1008, position(0, 300));
+		b->write(0x2000, 0x01ff'ffff);
+		b->write(0x2004, position(16, 2));
+		b->write(dpcr, 0x0000'0800);
+		b->write(madr, 0x1000);
+		b->write(chcr, 0x0100'0401);
+
+		REQUIRE(b->pixel(0, 300) == 0x001f);
+		REQUIRE(b->pixel(15, 301) == 0x001f);
+		REQUIRE(b->pixel(16, 301) == 0);
+	}
+}
+
+TEST_CASE("the GPU state is saved in the dumps", "[gpu]") {
+	auto b = std::make_unique<board>();
+	// a drawing offset and the dithering, set before the dump
+	b->send({0xe500'0000 | 10 | 20 << 11, 0xe100'0200});
+
+	// restores the dump of `b` into a new board, then sends `rest` to both
+	auto check = [&](std::vector<uint32_t> const& rest) {
+		std::stringstream s;
+		psycris::dump_board(s, *b);
+		auto restored = std::make_unique<board>();
+		psycris::restore_board(s, *restored);
+
+		b->send(rest);
+		restored->send(rest);
+		REQUIRE(restored->read(gp1) == b->read(gp1));
+		auto x = b->memory();
+		auto y = restored->memory();
+		REQUIRE(std::equal(std::begin(x), std::end(x), std::begin(y), std::end(y)));
+	};
+
+	SECTION("in the middle of a command") {
+		b->send({0x3000'00ff, position(0, 0), 0x0000'ff00});
+		check({position(64, 0), 0x00ff'0000, position(0, 64)});
+		REQUIRE(b->pixel(10, 20) == 0x001f);
+	}
+
+	SECTION("in the middle of an image transfer") {
+		b->send({0xa000'0000, position(100, 200), position(4, 1), 0x1234'0001});
+		check({0x4321'5678});
+		REQUIRE(b->pixel(103, 200) == 0x4321);
+		REQUIRE((b->read(gp1) & 0x0400'0000) != 0);
+	}
+}
+
+TEST_CASE("the GPU kernels give the same results", "[gpu]") {
+	std::mt19937 rng{42};
+
+	for (auto isa : {rasterizer::isa::sse2, rasterizer::isa::avx2}) {
+		if (!rasterizer::supported(isa)) {
+			continue;
+		}
+		INFO("isa " << static_cast<int>(isa));
+
+		auto kernels = [](rasterizer::isa i) {
+			std::vector<uint16_t> vram(1024 * 512);
+			rasterizer r{vram.data()};
+			r.use(i);
+			return r.kernels();
+		};
+		REQUIRE(kernels(isa) == isa);
+
+		// the spans, on random textures and backgrounds
+		std::vector<uint16_t> vram(1024 * 512);
+		for (auto& p : vram) {
+			p = static_cast<uint16_t>(rng());
+		}
+		for (int round = 0; round < 5; round++) {
+			uint32_t seed = rng();
+			std::mt19937 a{seed}, b{seed};
+			REQUIRE(pixels(rasterizer::isa::scalar, vram, a) == pixels(isa, vram, b));
+		}
+	}
+}
@@ -0,0 +1,255 @@
+#include <catch2/catch.hpp>
+
+#include "cpu/disassembly.hpp"
+#include "cpu/gte.hpp"
+#include "psx.hpp"
+
+#include <cstring>
+#include <random>
+
+namespace {
+	using cpu::gte;
+
+	// clang-format off
+	enum data : uint8_t { vxy0 = 0, vz0, rgbc = 6, otz, ir0, ir1, ir2, ir3, sxy0, sxy1, sxy2, sxyp, sz0, sz1, sz2, sz3, rgb0, rgb1, rgb2, mac0 = 24, mac1, mac2, mac3, irgb, orgb, lzcs, lzcr };
+	enum control : uint8_t { rt11rt12 = 32, rt13rt21, rt22rt23, rt31rt32, rt33, trx, try_, trz, ofx = 32 + 24, ofy, h, dqa, dqb, zsf3, zsf4, flag };
+	// clang-format on
+
+	constexpr uint32_t sf = 1 << 19;
+	constexpr uint32_t lm = 1 << 10;
+
+	uint32_t pack(int16_t lo, int16_t hi) { return static_cast<uint16_t>(lo) | static_cast<uint16_t>(hi) << 16; }
+
+	void identity(gte& g) {
+		g.write(rt11rt12, pack(0x1000, 0));
+		g.write(rt13rt21, 0);
+		g.write(rt22rt23, pack(0x1000, 0));
+		g.write(rt31rt32, 0);
+		g.write(rt33, 0x1000);
+	}
+
+	std::array<uint32_t, 64> registers(gte const& g) {
+		std::array<uint32_t, 64> r;
+		for (uint8_t ix = 0; ix < r.size(); ix++) {
+			r[ix] = g.read(ix);
+		}
+		return r;
+	}
+}
+
+TEST_CASE("the GTE registers", "[gte]") {
+	gte g;
+
+	SECTION("the 16 bit registers are sign-extended") {
+		g.write(vz0, 0xffff'8000);
+		REQUIRE(g.read(vz0) == 0xffff'8000);
+		g.write(ir1, 0x0000'ffff);
+		REQUIRE(g.read(ir1) == 0xffff'ffff);
+		g.write(h, 0x8000);
+		REQUIRE(g.read(h) == 0xffff'8000);
+		g.write(otz, 0xffff'ffff);
+		REQUIRE(g.read(otz) == 0xffff);
+	}
+
+	SECTION("IRGB and ORGB convert the IR registers to a 15 bit color") {
+		g.write(irgb, 0x1f | 0x10 << 5 | 0x01 << 10);
+		REQUIRE(g.read(ir1) == 0xf80);
+		REQUIRE(g.read(ir2) == 0x800);
+		REQUIRE(g.read(ir3) == 0x80);
+		REQUIRE(g.read(orgb) == (0x1f | 0x10 << 5 | 0x01 << 10));
+
+		// ORGB saturates the negative and the large values
+		g.write(ir1, 0xffff'f000);
+		g.write(ir2, 0x7fff);
+		REQUIRE(g.read(orgb) == (0x1f << 5 | 0x01 << 10));
+	}
+
+	SECTION("LZCR counts the leading bits equal to the sign") {
+		g.write(lzcs, 0x0000'ffff);
+		REQUIRE(g.read(lzcr) == 16);
+		g.write(lzcs, 0xffff'0000);
+		REQUIRE(g.read(lzcr) == 16);
+		g.write(lzcs, 0);
+		REQUIRE(g.read(lzcr) == 32);
+		g.write(lzcs, 0xffff'ffff);
+		REQUIRE(g.read(lzcr) == 32);
+	}
+
+	SECTION("SXYP pushes in the screen coordinates FIFO") {
+		g.write(sxyp, 1);
+		g.write(sxyp, 2);
+		g.write(sxyp, 3);
+		REQUIRE(g.read(sxy0) == 1);
+		REQUIRE(g.read(sxy1) == 2);
+		REQUIRE(g.read(sxy2) == 3);
+		REQUIRE(g.read(sxyp) == 3);
+	}
+
+	SECTION("FLAG summarizes the errors in bit 31") {
+		g.write(flag, 0xffff'ffff);
+		REQUIRE(g.read(flag) == 0xffff'f000);
+		g.write(flag, 1 << 19);
+		REQUIRE(g.read(flag) == 1 << 19);
+	}
+}
+
+TEST_CASE("the GTE commands", "[gte]") {
+	gte g;
+	identity(g);
+
+	SECTION("RTPS projects a vertex") {
+		g.write(vxy0, pack(100, 50));
+		g.write(vz0, 1000);
+		g.write(h, 1000);
+		g.write(ofx, 10 << 16);
+		g.write(ofy, 20 << 16);
+		g.write(dqa, 0x10);
+		g.write(dqb, 0);
+
+		g.command(sf | 0x01);
+		REQUIRE(g.read(mac1) == 100);
+		REQUIRE(g.read(mac2) == 50);
+		REQUIRE(g.read(mac3) == 1000);
+		REQUIRE(g.read(sz3) == 1000);
+		REQUIRE(g.read(sxy2) == pack(110, 70));
+		REQUIRE(g.read(ir0) == 0x100);
+		REQUIRE(g.read(flag) == 0);
+	}
+
+	SECTION("RTPS reports a division overflow") {
+		g.write(vz0, 1);
+		g.write(h, 1000);
+
+		g.command(sf | 0x01);
+		REQUIRE(g.read(flag) == (1u << 31 | 1 << 17));
+	}
+
+	SECTION("NCLIP computes the winding of a triangle") {
+		g.write(sxy0, pack(0, 0));
+		g.write(sxy1, pack(10, 0));
+		g.write(sxy2, pack(0, 10));
+		g.command(0x06);
+		REQUIRE(g.read(mac0) == 100);
+
+		g.write(sxy1, pack(0, 10));
+		g.write(sxy2, pack(10, 0));
+		g.command(0x06);
+		REQUIRE(g.read(mac0) == static_cast<uint32_t>(-100));
+	}
+
+	SECTION("AVSZ3 averages the Z values") {
+		g.write(sz1, 300);
+		g.write(sz2, 600);
+		g.write(sz3, 900);
+		g.write(zsf3, 0x1000 / 3);
+		g.command(0x2d);
+		REQUIRE(g.read(mac0) == 0x555 * 1800);
+		REQUIRE(g.read(otz) == (0x555 * 1800) >> 12);
+	}
+
+	SECTION("the saturations are reported in FLAG") {
+		g.write(ir1, 0x7fff);
+		g.command(0x28);
+		REQUIRE(g.read(mac1) == 0x7fff * 0x7fff);
+		REQUIRE(g.read(ir1) == 0x7fff);
+		REQUIRE(g.read(flag) == (1u << 31 | 1 << 24));
+
+		g.write(ir1, 0);
+		g.write(ir2, 0xffff'f000);
+		g.command(sf | lm | 0x28);
+		REQUIRE(g.read(ir2) == 0x1000);
+		REQUIRE(g.read(flag) == 0);
+
+		// with lm the negative values saturate to zero
+
+		g.write(vxy0, pack(-100, 0));
+		g.write(vz0, 0);
+		g.command(sf | lm | 0x12);
+		REQUIRE(g.read(mac1) == static_cast<uint32_t>(-100));
+		REQUIRE(g.read(ir1) == 0);
+		REQUIRE(g.read(flag) == (1u << 31 | 1 << 24));
+	}
+}
+
+TEST_CASE("the GTE kernels give the same results", "[gte]") {
+	std::mt19937 rng{42};
+	auto word = [&] { return static_cast<uint32_t>(rng()); };
+
+	// every command, with and without sf and lm, on every matrix, vector and
+	// translation of MVMVA
+	std::vector<uint32_t> commands;
+	for (uint32_t op : {0x01, 0x06, 0x0c, 0x10, 0x11, 0x13, 0x14, 0x16, 0x1b, 0x1c, 0x1e, 0x20, 0x28, 0x29, 0x2a,
+	                    0x2d, 0x2e, 0x30, 0x3d, 0x3e, 0x3f}) {
+		for (uint32_t flags : {0u, sf, lm, sf | lm}) {
+			commands.push_back(op | flags);
+		}
+	}
+	for (uint32_t mvmva = 0; mvmva < 64; mvmva++) {
+		commands.push_back(0x12 | mvmva << 13 | (mvmva & 1 ? sf : 0));
+	}
+
+	for (auto isa : {gte::isa::sse4, gte::isa::avx2}) {
+		if (!gte::supported(isa)) {
+			continue;
+		}
+		INFO("isa " << static_cast<int>(isa));
+
+		for (int round = 0; round < 50; round++) {
+			gte reference, candidate;
+			reference.use(gte::isa::scalar);
+			candidate.use(isa);
+
+			for (uint8_t ix = 0; ix < 64; ix++) {
+				uint32_t v = word();
+				// the translations are sometimes small enough for the kernels
+				if (ix >= trx && ix <= trz && round % 2) {
+					v >>= 12;
+				}
+				reference.write(ix, v);
+				candidate.write(ix, v);
+			}
+
+			for (uint32_t cmd : commands) {
+				INFO("command " << std::hex << cmd);
+				reference.command(cmd);
+				candidate.command(cmd);
+				REQUIRE(registers(reference) == registers(candidate));
+			}
+		}
+	}
+}
+
+TEST_CASE("the cpu talks to the GTE", "[gte]") {
+	// clang-format off
+	auto i_type = [](uint32_t op, uint32_t rs, uint32_t rt, uint32_t imm) { return op << 26 | rs << 21 | rt << 16 | (imm & 0xffff); };
+	auto cop2 = [](uint32_t subop, uint32_t rt, uint32_t rd) { return 0x12 << 26 | subop << 21 | rt << 16 | rd << 11; };
+	// clang-format on
+	constexpr uint32_t t0 = 8, t1 = 9, t2 = 10;
+
+	std::vector<uint32_t> code = {
+	    i_type(0x0f, 0, t0, 0x8000),     // lui t0, 0x8000
+	    i_type(0x0f, 0, t1, 10),         // lui t1, 10
+	    i_type(0x0d, 0, t2, 10),         // ori t2, zero, 10
+	    cop2(0x04, 0, sxy0),             // mtc2 zero, sxy0
+	    cop2(0x04, t2, sxy1),            // mtc2 t2, sxy1
+	    i_type(0x2b, t0, t1, 0x100),     // sw t1, 0x100(t0)
+	    i_type(0x32, t0, sxy2, 0x100),   // lwc2 sxy2, 0x100(t0)
+	    0x4a << 24 | 0x06,               // nclip
+	    i_type(0x3a, t0, mac0, 0x104),   // swc2 mac0, 0x104(t0)
+	    cop2(0x06, t2, zsf3 - 32),       // ctc2 t2, zsf3
+	    cop2(0x02, t1, zsf3 - 32),       // cfc2 t1, zsf3
+	    0x02 << 26 | ((0x1fc0'0000 + 11 * 4) >> 2 & 0x3ff'ffff), // idle: j idle
+	    0,                               // nop
+	};
+
+	REQUIRE(cpu::disassembly(code[7], 0) == "nclip 0x6");
+	REQUIRE(cpu::disassembly(code[6], 0).rfind("lwc2 cop2r14, ", 0) == 0);
+
+	psycris::psx board;
+	std::memcpy(board.rom.memory().data(), code.data(), code.size() * sizeof(uint32_t));
+	board.cpu.run(board.cpu.ticks() + 20);
+
+	REQUIRE(board.cpu.cop2.read(mac0) == 100);
+	REQUIRE(board.bus().read<uint32_t>(0x8000'0104) == 100);
+	REQUIRE(board.cpu.regs[t1] == 10);
+}
@@ -0,0 +1,53 @@
+#include <catch2/catch.hpp>
+
+#include "psx.hpp"
+
+#include <vector>
+
+TEST_CASE("the scheduler dispatches the events in time order", "[core]") {
+	auto board = std::make_unique<psycris::psx>();
+	auto& events = board->events;
+
+	std::vector<std::pair<std::string, uint64_t>> fired;
+	auto record = [&](std::string name) {
+		return [&fired, name](uint64_t at) { fired.push_back({name, at}); };
+	};
+
+	auto a = events.add("a", record("a"));
+	auto b = events.add("b", record("b"));
+	auto c = events.add("c", record("c"));
+
+	SECTION("the earliest first, the same tick in schedule order") {
+		events.schedule(a, 300);
+		events.schedule(b, 100);
+		events.schedule(c, 300);
+		REQUIRE(events.next() == 100);
+
+		board->run(1000);
+		REQUIRE(fired == decltype(fired){{"b", 100}, {"a", 300}, {"c", 300}});
+		REQUIRE(events.when(a) == psycris::scheduler::never);
+	}
+
+	SECTION("a moved or cancelled event fires only once, at its last time") {
+		events.schedule(a, 100);
+		events.schedule(a, 200);
+		events.schedule(b, 150);
+		events.cancel(b);
+
+		board->run(1000);
+		REQUIRE(fired == decltype(fired){{"a", 200}});
+	}
+
+	SECTION("the cpu stops exactly at every event") {
+		std::vector<uint64_t> now;
+		psycris::scheduler::event tick;
+		tick = events.add("tick", [&](uint64_t at) {
+			now.push_back(events.now());
+			events.schedule(tick, at + 37);
+		});
+		events.schedule(tick, 37);
+
+		board->run(200, &cpu::mips::run_cached);
+		REQUIRE(now == std::vector<uint64_t>{37, 74, 111, 148, 185});
+	}
+}
@@ -0,0 +1,142 @@
+#include <catch2/catch.hpp>
+
+#include "test_board.hpp"
+
+#include <cstring>
+#include <memory>
+
+namespace {
+	using psycris::hw::interrupt_control;
+	using psycris::hw::timers;
+
+	constexpr uint32_t i_stat = 0x1f80'1070;
+
+	uint32_t value(int n) { return 0x1f80'1100 + 0x10 * n; }
+	uint32_t mode(int n) { return value(n) + 4; }
+	uint32_t target(int n) { return value(n) + 8; }
+
+	struct board : psycris::test::board {
+		board() {
+			// an endless loop at the reset vector: j 0x1fc0'0000; nop
+			uint32_t loop = 0x0ff0'0000;
+			std::memcpy(rom.memory().data(), &loop, sizeof(loop));
+		}
+
+		// runs the cpu for `ticks` ticks (or a bit more)
+		void wait(uint64_t ticks) { run(cpu.ticks() + ticks); }
+	};
+}
+
+TEST_CASE("the root counters", "[timers]") {
+	auto b = std::make_unique<board>();
+
+	SECTION("a counter follows the system clock") {
+		b->wait(10);
+		b->write(mode(0), 0);
+		uint64_t start = b->cpu.ticks();
+
+		b->wait(1000);
+		REQUIRE(b->read(value(0)) == b->cpu.ticks() - start);
+
+		b->write(value(0), 0x10);
+		start = b->cpu.ticks();
+		b->wait(500);
+		REQUIRE(b->read(value(0)) == 0x10 + b->cpu.ticks() - start);
+	}
+
+	SECTION("the counter 2 can count every 8 ticks") {
+		b->wait(13);
+		b->write(mode(2), 0x200);
+		uint64_t start = b->cpu.ticks();
+
+		b->wait(1000);
+		REQUIRE(b->read(value(2)) == b->cpu.ticks() / 8 - start / 8);
+	}
+
+	SECTION("the counter 1 can count the hblanks") {
+		b->write(mode(1), 0x100);
+		uint64_t start = b->cpu.ticks();
+
+		b->wait(timers::frame_ticks);
+		uint64_t lines = timers::count(timers::source::hblank, b->cpu.ticks()) -
+		                 timers::count(timers::source::hblank, start);
+		REQUIRE(lines >= timers::frame_lines);
+		REQUIRE(b->read(value(1)) == lines);
+	}
+
+	SECTION("a counter wraps at its target and raises the interrupt") {
+		b->write(target(0), 100);
+		// reset at target, irq at target, repeated
+		b->write(mode(0), 0x58);
+		uint64_t start = b->cpu.ticks();
+		REQUIRE((b->read(mode(0)) & 0x1c00) == 0x400);
+
+		b->wait(250);
+		REQUIRE(b->read(i_stat) == interrupt_control::TMR0);
+		REQUIRE(b->read(value(0)) == (b->cpu.ticks() - start) % 101);
+		// the reached flags are reset after the read
+		REQUIRE((b->read(mode(0)) & 0x1800) == 0x800);
+		REQUIRE((b->read(mode(0)) & 0x1800) == 0);
+
+		// the interrupt repeats
+		b->write(i_stat, 0);
+		b->wait(150);
+		REQUIRE(b->read(i_stat) == interrupt_control::TMR0);
+	}
+
+	SECTION("a one shot interrupt is raised once") {
+		// irq at 0xffff, one shot
+		b->write(mode(1), 0x20);
+		b->write(value(1), 0xfff0);
+
+		b->wait(0x20);
+		REQUIRE(b->read(i_stat) == interrupt_control::TMR1);
+		REQUIRE((b->read(mode(1)) & 0x1000) == 0x1000);
+
+		b->write(i_stat, 0);
+		b->wait(0x2'0000);
+		REQUIRE(b->read(i_stat) == 0);
+		// the counter keeps running
+		REQUIRE((b->read(mode(1)) & 0x1000) == 0x1000);
+	}
+
+	SECTION("a toggled interrupt is raised every other time") {
+		b->write(target(2), 50);
+		// reset at target, irq at target, repeated, toggle
+		b->write(mode(2), 0xd8);
+
+		b->wait(60);
+		REQUIRE((b->read(mode(2)) & 0x400) == 0);
+		REQUIRE(b->read(i_stat) == interrupt_control::TMR2);
+
+		b->write(i_stat, 0);
+		b->wait(50);
+		REQUIRE((b->read(mode(2)) & 0x400) == 0x400);
+		REQUIRE(b->read(i_stat) == 0);
+	}
+
+	SECTION("the counter 2 can be stopped") {
+		b->write(mode(2), 0x1);
+		b->wait(1000);
+		REQUIRE(b->read(value(2)) == 0);
+
+		b->write(mode(2), 0x3);
+		b->wait(1000);
+		REQUIRE(b->read(value(2)) > 0);
+	}
+
+	SECTION("the counter 1 can be paused during the vblank") {
+		// the board starts in the vblank
+		b->write(mode(1), 0x1);
+		b->wait(1000);
+		REQUIRE(b->read(value(1)) == 0);
+
+		b->run(timers::vblank_ticks + 1000);
+		REQUIRE(b->read(value(1)) == b->cpu.ticks() - timers::vblank_ticks);
+
+		// and reset at the next one
+		b->write(mode(1), 0x3);
+		b->run(timers::frame_ticks + 10);
+		REQUIRE(b->read(value(1)) == b->cpu.ticks() - timers::frame_ticks);
+	}
+}
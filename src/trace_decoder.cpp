@@ -0,0 +1,54 @@
+#include "cpu/tracing.hpp"
+#include "logging.hpp"
+
+#include <CLI/CLI.hpp>
+#include <fstream>
+
+// Prints a binary trace, recorded with `psycris --trace`, in the same format
+// of the text trace of the interpreter.
+int main(int argc, char* argv[]) {
+	CLI::App app("psycris trace decoder");
+
+	std::string input_file;
+	bool memory = false;
+	app.add_flag("--memory", memory, "print the memory accesses of the loads and the stores");
+	app.add_option("input_file", input_file, "the binary trace") //
+	    ->required()                                             //
+	    ->check(CLI::ExistingFile);                              //
+
+	try {
+		app.parse(argc, argv);
+	} catch (const CLI::ParseError& e) {
+		return app.exit(e);
+	}
+
+	using psycris::log;
+	psycris::init_logging(true);
+
+	std::ifstream f(input_file, std::ios::binary | std::ios::in);
+	cpu::trace_reader trace{f};
+	if (!trace.valid()) {
+		log->critical("{} is not a binary trace", input_file);
+		return 1;
+	}
+
+	cpu::registers regs{};
+	cpu::text_trace text{regs};
+
+	uint64_t clock = trace.header().start_clock;
+	cpu::trace_record r;
+	while (trace.next(r)) {
+		clock += r.clock_delta;
+		text.fetched(r.pc, clock, cpu::decoder{r.ins}, regs);
+
+		if (r.reg != cpu::trace_record::no_reg) {
+			regs[r.reg] = r.reg_value;
+		}
+		text.executed(regs);
+
+		if (memory && r.mem) {
+			bool write = r.mem & cpu::trace_record::mem_write;
+			log->trace("[ {:0>8x} {} 0x{:0>{}x} ]", r.mem_addr, write ? "<-" : "->", r.mem_value, (r.mem & 0x7) * 2);
+		}
+	}
+}